@@ -2,6 +2,10 @@
 #define BASE_HPP_
 
 
+#include "parallel.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <type_traits>
 #include <utility>
 
@@ -80,21 +84,111 @@ unsigned cols(const matrix<M>& m) {
 }
 
 
+// A reference to the element, or its value for views that compute their elements
 template <typename M>
 inline
-typename M::element_type&
-element_at(matrix<M>& m, unsigned row, unsigned col) {
+decltype(auto) element_at(matrix<M>& m, unsigned row, unsigned col) {
 	return concrete_matrix(m).element_at(row, col);
 }
 
 template <typename M>
 inline
-const typename M::element_type&
-element_at(const matrix<M>& m, unsigned row, unsigned col) {
+decltype(auto) element_at(const matrix<M>& m, unsigned row, unsigned col) {
 	return concrete_matrix(m).element_at(row, col);
 }
 
 
+/*
+ * Whether the elements of each row of M are adjacent in memory, so that
+ * &element_at(m, row, 0) may be walked as an array of cols(m) elements.
+ * Specialized by the matrix types that store their rows that way.
+ */
+template <typename M>
+struct has_contiguous_rows : std::false_type {};
+
+
+namespace __impl {
+
+
+/*
+ * &element_at(m, row, 0), or nullptr unless M has contiguous rows: only
+ * those are taken the address of, as views may compute their elements.
+ */
+template <typename M>
+const typename M::element_type* row_elements(const matrix<M>& m, unsigned row, std::true_type) {
+	return &element_at(m, row, 0);
+}
+
+template <typename M>
+const typename M::element_type* row_elements(const matrix<M>&, unsigned, std::false_type) {
+	return nullptr;
+}
+
+template <typename M>
+const typename M::element_type* row_elements(const matrix<M>& m, unsigned row) {
+	return row_elements(m, row, has_contiguous_rows<M>());
+}
+
+
+// The first element of rows [first_row, last_row) if they follow each other in memory, else nullptr
+template <typename M>
+const typename M::element_type* contiguous_rows(const matrix<M>& m, unsigned first_row, unsigned last_row) {
+	if(!has_contiguous_rows<M>::value  ||  first_row >= last_row  ||  cols(m) == 0) {
+		return nullptr;
+	}
+	const auto* first = row_elements(m, first_row);
+	const auto* last = row_elements(m, last_row - 1);
+	return last == first + std::size_t(last_row - 1 - first_row) * cols(m) ? first : nullptr;
+}
+
+template <typename M>
+typename M::element_type* contiguous_rows(matrix<M>& m, unsigned first_row, unsigned last_row) {
+	const matrix<M>& const_m = m;
+	return contiguous_rows(const_m, first_row, last_row) ? &element_at(m, first_row, 0) : nullptr;
+}
+
+
+// Zero bytes are stored with memset, which beats any loop the compiler would write
+template <typename T>
+void fill_array(T* first, std::size_t count, const T& value) {
+	static const unsigned char zero_bytes[sizeof(T)] = {};
+	if(std::is_trivially_copyable<T>::value  &&  std::memcmp(&value, zero_bytes, sizeof(T)) == 0) {
+		std::memset(static_cast<void*>(first), 0, count * sizeof(T));
+	} else {
+		std::fill_n(first, count, value);
+	}
+}
+
+
+// Calls func(element) on each element of m, through plain pointers for contiguous rows so it vectorizes
+template <typename M, typename F>
+void update_elements(matrix<M>& m, F func) {
+	if(auto* first = contiguous_rows(m, 0, rows(m))) {
+		std::size_t count = std::size_t(rows(m)) * cols(m);
+		for(std::size_t index = 0; index < count; ++index) {
+			func(first[index]);
+		}
+		return;
+	}
+
+	for(unsigned row = 0; row < rows(m); ++row) {
+		if(has_contiguous_rows<M>::value  &&  cols(m) > 0) {
+			auto* row_elements = &element_at(m, row, 0);
+			for(unsigned col = 0; col < cols(m); ++col) {
+				func(row_elements[col]);
+			}
+		} else {
+			for(unsigned col = 0; col < cols(m); ++col) {
+				func(element_at(m, row, col));
+			}
+		}
+	}
+}
+
+
+} /* namespace __impl */
+
+
 template <typename ML, typename MR>
 bool equal_to(const matrix<ML>& lhs, const matrix<MR>& rhs) {
 	for(unsigned row = 0; row < rows(lhs); ++row) {
@@ -108,19 +202,83 @@ bool equal_to(const matrix<ML>& lhs, const matrix<MR>& rhs) {
 }
 
 
+namespace __impl {
+
+
+// Whether all the matrices have contiguous rows, whether they are passed as such or as matrix<M>
+template <typename M>
+using concrete_type = typename std::decay<decltype(concrete_matrix(std::declval<M&>()))>::type;
+
+template <typename... M>
+struct all_have_contiguous_rows : std::true_type {};
+
+template <typename M, typename... MM>
+struct all_have_contiguous_rows<M, MM...> : std::integral_constant<bool,
+		has_contiguous_rows<concrete_type<M>>::value  &&  all_have_contiguous_rows<MM...>::value
+	> {};
+
+template <typename... M>
+struct operand_types {};
+
+
+template <typename F, typename... M, typename... T>
+void for_each_in_row(operand_types<M...>, F& func, unsigned count, T*... elements) {
+	for(unsigned col = 0; col < count; ++col) {
+		func(forward_with_qualifers_of<M>(elements[col])...);
+	}
+}
+
+// When all the matrices have contiguous rows, each row is walked through pointers taken once
 template <typename F, typename M, typename... MM>
-void for_each_element(F func, M&& m, MM&&... mm) {
+void for_each_element(std::true_type, F& func, M&& m, MM&&... mm) {
+	for(unsigned row = 0; row < rows(m)  &&  cols(m) > 0; ++row) {
+		for_each_in_row(operand_types<M, MM...>(), func, cols(m), &element_at(m, row, 0), &element_at(mm, row, 0)...);
+	}
+}
+
+template <typename F, typename M, typename... MM>
+void for_each_element(std::false_type, F& func, M&& m, MM&&... mm) {
 	for(unsigned row = 0; row < rows(m); ++row) {
 		for(unsigned col = 0; col < cols(m); ++col) {
 			func(
-				__impl::forward_with_qualifers_of<M >(element_at(m , row, col)),
-				__impl::forward_with_qualifers_of<MM>(element_at(mm, row, col))...
+				forward_with_qualifers_of<M >(element_at(m , row, col)),
+				forward_with_qualifers_of<MM>(element_at(mm, row, col))...
 			);
 		}
 	}
 }
 
 
+} /* namespace __impl */
+
+
+template <typename F, typename M, typename... MM>
+void for_each_element(F func, M&& m, MM&&... mm) {
+	__impl::for_each_element(
+		__impl::all_have_contiguous_rows<M, MM...>(), func, std::forward<M>(m), std::forward<MM>(mm)...
+	);
+}
+
+
+/*
+ * Like for_each_element, but splits the rows across the threads of the
+ * execution context, so func must be safe to call concurrently.
+ */
+template <typename F, typename M, typename... MM>
+void parallel_for_each_element(const parallel_options& options, F func, M&& m, MM&&... mm) {
+	parallel_for(0, rows(m), cols(m), [&](std::size_t first_row, std::size_t last_row) {
+		for(unsigned row = first_row; row < last_row; ++row) {
+			for(unsigned col = 0; col < cols(m); ++col) {
+				func(
+					__impl::forward_with_qualifers_of<M >(element_at(m , row, col)),
+					__impl::forward_with_qualifers_of<MM>(element_at(mm, row, col))...
+				);
+			}
+		}
+	}, options);
+}
+
+
 template <typename MT, typename MF>
 void move_to(matrix<MT>& to, matrix<MF>&& from) {
 	using element_type_to   = typename MT::element_type;
@@ -132,6 +290,37 @@ void move_to(matrix<MT>& to, matrix<MF>&& from) {
 }
 
 
+/*
+ * Sets every element of m, often a region reference, to value. Contiguous
+ * rows are filled as arrays, with memset when value is all zero bytes.
+ */
+template <typename M, typename T>
+void fill(matrix<M>& m, const T& value) {
+	using element_type = typename std::remove_const<typename M::element_type>::type;
+	const element_type element(value);
+
+	if(auto* first = __impl::contiguous_rows(m, 0, rows(m))) {
+		__impl::fill_array(first, std::size_t(rows(m)) * cols(m), element);
+		return;
+	}
+
+	for(unsigned row = 0; row < rows(m); ++row) {
+		if(has_contiguous_rows<M>::value  &&  cols(m) > 0) {
+			__impl::fill_array(&element_at(m, row, 0), cols(m), element);
+		} else {
+			for(unsigned col = 0; col < cols(m); ++col) {
+				element_at(m, row, col) = element;
+			}
+		}
+	}
+}
+
+template <typename M, typename T>
+void fill(matrix<M>&& m, const T& value) {
+	fill(m, value);
+}
+
+
 enum class all_t { all };
 constexpr const all_t& all = all_t::all;
 
@@ -0,0 +1,182 @@
+#ifndef BINARY_IO_HPP_
+#define BINARY_IO_HPP_
+
+#include "matrix.hpp"
+#include "mapped_dmatrix.hpp"
+#include "mapped_file.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+
+namespace matrix {
+
+
+class format_error : public std::runtime_error {
+public:
+	using std::runtime_error::runtime_error;
+};
+
+
+namespace __impl {
+
+
+enum class binary_element_kind : std::uint8_t {
+	signed_integer   = 1,
+	unsigned_integer = 2,
+	floating_point   = 3,
+};
+
+
+template <typename T>
+constexpr binary_element_kind binary_element_kind_of() {
+	static_assert(std::is_arithmetic<T>::value, "Only arithmetic element types can be stored in the binary format");
+	return std::is_floating_point<T>::value ? binary_element_kind::floating_point
+	     : std::is_signed<T>::value         ? binary_element_kind::signed_integer
+	     :                                    binary_element_kind::unsigned_integer;
+}
+
+
+/*
+ * File layout: this 64-byte header, zero padding up to data_offset (a
+ * multiple of alignment), then rows * cols elements in row-major order.
+ * Multi-byte fields are written in the byte order of the writer, which the
+ * reader detects through byte_order_mark.
+ */
+struct binary_header {
+	char          magic[6];
+	std::uint16_t version;
+	std::uint16_t byte_order_mark;
+	std::uint8_t  element_kind;
+	std::uint8_t  element_size;
+	std::uint8_t  layout;
+	std::uint8_t  reserved0[3];
+	std::uint32_t alignment;
+	std::uint32_t reserved1;
+	std::uint64_t rows;
+	std::uint64_t cols;
+	std::uint64_t data_offset;
+	std::uint8_t  reserved2[16];
+
+	static constexpr const char* expected_magic = "CPPMTX";
+	static constexpr std::uint16_t current_version = 1;
+	static constexpr std::uint16_t native_byte_order_mark = 0x0102;
+	static constexpr std::uint8_t row_major = 0;
+	static constexpr std::uint32_t default_alignment = 64;
+};
+
+static_assert(sizeof(binary_header) == 64, "");
+
+
+} /* namespace __impl */
+
+
+template <typename M>
+void save_binary(std::ostream& os, const matrix<M>& m) {
+	using value_type = typename std::remove_const<typename M::element_type>::type;
+	using header_type = __impl::binary_header;
+
+	header_type header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, header_type::expected_magic, sizeof(header.magic));
+	header.version = header_type::current_version;
+	header.byte_order_mark = header_type::native_byte_order_mark;
+	header.element_kind = static_cast<std::uint8_t>(__impl::binary_element_kind_of<value_type>());
+	header.element_size = sizeof(value_type);
+	header.layout = header_type::row_major;
+	header.alignment = header_type::default_alignment;
+	header.rows = rows(m);
+	header.cols = cols(m);
+	header.data_offset = (sizeof(header) + header.alignment - 1) / header.alignment * header.alignment;
+
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for(std::uint64_t i = sizeof(header); i < header.data_offset; ++i) {
+		os.put('\0');
+	}
+
+	// Stream one row at a time, so the whole matrix is never buffered
+	std::vector<value_type> row_buffer(cols(m));
+	for(unsigned row = 0; row < rows(m); ++row) {
+		for(unsigned col = 0; col < cols(m); ++col) {
+			row_buffer[col] = element_at(m, row, col);
+		}
+		os.write(reinterpret_cast<const char*>(row_buffer.data()), row_buffer.size() * sizeof(value_type));
+	}
+
+	if(!os) {
+		throw std::ios_base::failure("Error writing matrix in binary format");
+	}
+}
+
+
+template <typename M>
+void save_binary(const std::string& path, const matrix<M>& m) {
+	std::ofstream os(path, std::ios::binary | std::ios::trunc);
+	if(!os) {
+		throw std::system_error(errno, std::generic_category(), "open " + path);
+	}
+	save_binary(os, m);
+	os.close();
+	if(!os) {
+		throw std::ios_base::failure("Error writing matrix in binary format to " + path);
+	}
+}
+
+
+template <typename T>
+mapped_dmatrix<T> load_binary(const std::string& path) {
+	using header_type = __impl::binary_header;
+
+	auto file = std::make_shared<const mapped_file>(path);
+
+	header_type header;
+	if(file->size() < sizeof(header)) {
+		throw format_error("Truncated binary matrix header in " + path);
+	}
+	std::memcpy(&header, file->data(), sizeof(header));
+
+	if(std::memcmp(header.magic, header_type::expected_magic, sizeof(header.magic)) != 0) {
+		throw format_error("Not a binary matrix file: " + path);
+	}
+	if(header.byte_order_mark != header_type::native_byte_order_mark) {
+		throw format_error("Binary matrix file has foreign byte order: " + path);
+	}
+	if(header.version != header_type::current_version) {
+		throw format_error("Unsupported binary matrix version " + std::to_string(header.version) + " in " + path);
+	}
+	if(header.element_kind != static_cast<std::uint8_t>(__impl::binary_element_kind_of<T>())
+	|| header.element_size != sizeof(T)) {
+		throw format_error("Binary matrix element type does not match the requested one in " + path);
+	}
+	if(header.layout != header_type::row_major) {
+		throw format_error("Unsupported binary matrix layout in " + path);
+	}
+	if(header.rows > std::numeric_limits<unsigned>::max()
+	|| header.cols > std::numeric_limits<unsigned>::max()) {
+		throw format_error("Binary matrix dimensions are too large in " + path);
+	}
+
+	// By division, as rows * cols * sizeof(T) may wrap around
+	if(header.data_offset < sizeof(header)
+	|| header.data_offset > file->size()
+	|| (header.cols != 0  &&  header.rows > (file->size() - header.data_offset) / sizeof(T) / header.cols)) {
+		throw format_error("Truncated binary matrix data in " + path);
+	}
+
+	return mapped_dmatrix<T>(std::move(file), header.data_offset, header.rows, header.cols);
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* BINARY_IO_HPP_ */
@@ -0,0 +1,93 @@
+#ifndef BOUNDS_HPP_
+#define BOUNDS_HPP_
+
+#include "compat.hpp"
+#include <stdexcept>
+#include <type_traits>
+
+
+namespace matrix {
+
+
+/*
+ * Validates element indexes and subscript ranges against the shape they
+ * index into. Selected for the whole library by defining
+ * MATRIX_BOUNDS_CHECKING; otherwise null_bounds_verifier is used and every
+ * check compiles away.
+ */
+class bounds_verifier {
+public:
+	class exception : public std::out_of_range {
+	public:
+		using std::out_of_range::out_of_range;
+	};
+
+	static constexpr bool enabled = true;
+
+	static void verify_index(unsigned index, unsigned extent, const char* msg) {
+		if(index >= extent) {
+			fail(msg);
+		}
+	}
+
+	// Verifies that [first, first + size) lies within [0, extent)
+	static void verify_range(unsigned first, unsigned size, unsigned extent, const char* msg) {
+		if(first > extent  ||  size > extent - first) {
+			fail(msg);
+		}
+	}
+
+private:
+	[[noreturn]] MATRIX_COLD
+	static void fail(const char* msg) {
+		throw exception(msg);
+	}
+};
+
+
+class null_bounds_verifier {
+public:
+	static constexpr bool enabled = false;
+
+	static void verify_index(unsigned, unsigned, const char*) noexcept {}
+	static void verify_range(unsigned, unsigned, unsigned, const char*) noexcept {}
+};
+
+
+#ifdef MATRIX_BOUNDS_CHECKING
+using default_bounds_verifier = bounds_verifier;
+#else
+using default_bounds_verifier = null_bounds_verifier;
+#endif
+
+
+namespace __impl {
+
+
+// Element access cannot throw unless bounds are checked
+constexpr bool unchecked_access = !default_bounds_verifier::enabled;
+
+
+inline void verify_element_index(unsigned row, unsigned col, unsigned rows, unsigned cols) noexcept(unchecked_access) {
+	default_bounds_verifier::verify_index(row, rows, "Row index out of range");
+	default_bounds_verifier::verify_index(col, cols, "Column index out of range");
+}
+
+
+inline void verify_row_range(unsigned first, unsigned size, unsigned rows) noexcept(unchecked_access) {
+	default_bounds_verifier::verify_range(first, size, rows, "Row range out of range");
+}
+
+
+inline void verify_col_range(unsigned first, unsigned size, unsigned cols) noexcept(unchecked_access) {
+	default_bounds_verifier::verify_range(first, size, cols, "Column range out of range");
+}
+
+
+} /* namespace __impl */
+
+
+} /* namespace matrix */
+
+
+#endif /* BOUNDS_HPP_ */
@@ -0,0 +1,442 @@
+#ifndef CHOLESKY_HPP_
+#define CHOLESKY_HPP_
+
+#include "matrix.hpp"
+#include "gemm.hpp"
+#include "triangular.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+// Columns of one panel of the factorizations and of the updates
+constexpr unsigned cholesky_block_size = 64;
+
+// Columns of the trailing matrix updated by one gemm, as only its lower triangle is needed
+constexpr unsigned cholesky_strip_cols = 4 * cholesky_block_size;
+
+
+inline void throw_not_positive_definite(unsigned column) {
+	throw std::domain_error("The matrix is not positive definite (pivot " + std::to_string(column) + ")");
+}
+
+
+/*
+ * The elements of row of l in columns [first, row], for a row of the
+ * diagonal block of the panel starting at first, from those of a in their
+ * place once the columns before first are done.
+ */
+template <typename T>
+void cholesky_row(const strided_block<T>& a, unsigned row, unsigned first) {
+	T* a_row = &a(row, 0);
+	for(unsigned col = first; col < row; ++col) {
+		const T* l_col = &a(col, 0);
+		a_row[col] = (a_row[col] - dot_product(a_row + first, l_col + first, col - first)) / l_col[col];
+	}
+	T sum = a_row[row] - dot_product(a_row + first, a_row + first, row - first);
+	if(!(sum > T(0))) {
+		throw_not_positive_definite(row);
+	}
+	a_row[row] = std::sqrt(sum);
+}
+
+
+/*
+ * The same for l * d * transpose(l), with d on the diagonal, also setting
+ * work(row, col - first) to l(row, col) * d(col).
+ */
+template <typename T>
+void ldlt_row(const strided_block<T>& a, const strided_block<T>& work, unsigned row, unsigned first) {
+	T* a_row = &a(row, 0);
+	T* work_row = &work(row, 0);
+	for(unsigned col = first; col < row; ++col) {
+		const T* l_col = &a(col, 0);
+		T sum = a_row[col] - dot_product(work_row, l_col + first, col - first);
+		work_row[col - first] = sum;
+		a_row[col] = sum / l_col[col];
+	}
+	T sum = a_row[row] - dot_product(work_row, a_row + first, row - first);
+	if(sum == T(0)) {
+		throw std::domain_error("The matrix has a zero pivot (" + std::to_string(row) + ")");
+	}
+	a_row[row] = sum;
+}
+
+
+/*
+ * The right-looking blocked factorization shared by both. The rows of the
+ * diagonal block of a panel are done in order by factor_row(row, first).
+ * The rows below solve
+ * l(panel) * x = transpose(a(rows, panel)) all at once, as columns of a
+ * transposed copy, and store(row, col, x) puts each element of x back.
+ * Then the lower triangle of the trailing matrix loses left *
+ * transpose(l(rows, panel)) by strips of columns, where left is the
+ * n x (last - first) block returned by panel_left(first).
+ */
+template <typename T, typename FactorRow, typename Store, typename PanelLeft>
+void factor_symmetric(
+	const strided_block<T>& a, diagonal diag, FactorRow factor_row, Store store, PanelLeft panel_left,
+	const parallel_options& options
+) {
+	unsigned n = a.rows;
+	dmatrix<T> transposed(std::min(n, cholesky_block_size), n, uninitialized);
+	auto t = strided(transposed);
+
+	for(unsigned first = 0; first < n; first += cholesky_block_size) {
+		unsigned last = std::min(first + cholesky_block_size, n);
+		unsigned size = last - first;
+		for(unsigned row = first; row < last; ++row) {
+			factor_row(row, first);
+		}
+		if(last == n) {
+			break;
+		}
+
+		parallel_for(last, n, size, [&](std::size_t first_row, std::size_t last_row) {
+			for(unsigned row = first_row; row < last_row; ++row) {
+				for(unsigned col = 0; col < size; ++col) {
+					t(col, row - last) = a(row, first + col);
+				}
+			}
+		}, options);
+		solve_left<T>(a.block(first, first, size, size), triangle::lower, false, diag, t.block(0, 0, size, n - last), options);
+		parallel_for(last, n, size, [&](std::size_t first_row, std::size_t last_row) {
+			for(unsigned row = first_row; row < last_row; ++row) {
+				for(unsigned col = 0; col < size; ++col) {
+					store(row, first + col, t(col, row - last));
+				}
+			}
+		}, options);
+
+		strided_block<T> left = panel_left(first);
+		for(unsigned strip = last; strip < n; strip += cholesky_strip_cols) {
+			unsigned strip_cols = std::min(cholesky_strip_cols, n - strip);
+			gemm<T>(T(-1), left.block(strip, 0, n - strip, size), false, a.block(strip, first, strip_cols, size), true,
+			        T(1), a.block(strip, strip, n - strip, strip_cols), options);
+		}
+	}
+}
+
+
+// Zeroes the strict upper triangle, which the factorizations leave as it was or partly updated
+template <typename T>
+void clear_upper_triangle(const strided_block<T>& a, const parallel_options& options) {
+	parallel_for(0, a.rows, a.cols / 2, [&](std::size_t first_row, std::size_t last_row) {
+		for(unsigned row = first_row; row < last_row; ++row) {
+			std::fill(&a(row, 0) + row + 1, &a(row, 0) + a.cols, T(0));
+		}
+	}, options);
+}
+
+
+/*
+ * Applies the updates of each column of x to l, for factors of the form
+ * l * transpose(l) or l * d * transpose(l). The rows of a factor change
+ * through rotations that depend only on earlier columns, so the rows of a
+ * panel are done in order, recording the rotation of each of its columns
+ * with column(row), then the rows below apply them with
+ * rotate(row, col) in parallel.
+ */
+template <typename T, typename Column, typename Rotate>
+void update_factor(unsigned n, unsigned vectors, Column column, Rotate rotate, const parallel_options& options) {
+	for(unsigned first = 0; first < n; first += cholesky_block_size) {
+		unsigned last = std::min(first + cholesky_block_size, n);
+		for(unsigned row = first; row < last; ++row) {
+			for(unsigned col = first; col < row; ++col) {
+				rotate(row, col);
+			}
+			column(row);
+		}
+		std::size_t work_per_row = std::size_t(last - first) * vectors;
+		parallel_for(last, n, work_per_row, [&](std::size_t first_row, std::size_t last_row) {
+			for(unsigned row = first_row; row < last_row; ++row) {
+				for(unsigned col = first; col < last; ++col) {
+					rotate(row, col);
+				}
+			}
+		}, options);
+	}
+}
+
+
+template <typename T, typename M>
+dmatrix<T> copy_of_vectors(unsigned n, const matrix<M>& x, const dmatrix<T>& factor) {
+	if(rows(x) != n) {
+		throw incompatible_operands(factor, "update", x);
+	}
+	return dmatrix<T>::generate(rows(x), cols(x), [&](unsigned row, unsigned col) {
+		return element_at(x, row, col);
+	});
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * The factorization A = L * transpose(L) of a symmetric positive definite
+ * matrix, with L lower triangular. It can follow changes of A by a few
+ * vectors at a time with update() and downdate(), which take O(n^2) for
+ * each instead of the O(n^3) of factoring again.
+ */
+template <typename T>
+class cholesky_factorization {
+public:
+	explicit cholesky_factorization(dmatrix<T>&& factor) noexcept : _factor(std::move(factor)) {}
+
+	// L, with zeros above its diagonal
+	const dmatrix<T>& factor() const noexcept { return _factor; }
+
+	// Cheaper and safer than the determinant, which soon overflows
+	T log_determinant() const {
+		T sum(0);
+		for(unsigned index = 0; index < _factor.rows(); ++index) {
+			sum += std::log(_factor.element_at(index, index));
+		}
+		return 2 * sum;
+	}
+
+	// A becomes A + x * transpose(x), for an n x k matrix x
+	template <typename M>
+	void update(const matrix<M>& x, const parallel_options& options = parallel_options()) {
+		rotate(x, T(1), options);
+	}
+
+	/*
+	 * A becomes A - x * transpose(x), which must remain positive definite;
+	 * otherwise std::domain_error is thrown and the factor is left invalid.
+	 */
+	template <typename M>
+	void downdate(const matrix<M>& x, const parallel_options& options = parallel_options()) {
+		rotate(x, T(-1), options);
+	}
+
+private:
+	// The textbook rank-one update, where x is rotated into l one column at a time
+	template <typename M>
+	void rotate(const matrix<M>& x, T sign, const parallel_options& options) {
+		unsigned n = _factor.rows();
+		unsigned k = cols(x);
+		auto vectors = __impl::copy_of_vectors(n, x, _factor);
+		auto l = __impl::strided(_factor);
+		auto v = __impl::strided(vectors);
+		std::vector<T> cosines(std::size_t(n) * k);
+		std::vector<T> inverse_cosines(std::size_t(n) * k);
+		std::vector<T> sines(std::size_t(n) * k);
+
+		auto column = [&](unsigned row) {
+			T& diagonal = l(row, row);
+			for(unsigned vector = 0; vector < k; ++vector) {
+				T square = diagonal * diagonal + sign * v(row, vector) * v(row, vector);
+				if(!(square > T(0))) {
+					__impl::throw_not_positive_definite(row);
+				}
+				T updated = std::sqrt(square);
+				cosines[std::size_t(row) * k + vector] = updated / diagonal;
+				inverse_cosines[std::size_t(row) * k + vector] = diagonal / updated;
+				sines[std::size_t(row) * k + vector] = v(row, vector) / diagonal;
+				diagonal = updated;
+			}
+		};
+		auto rotate = [&](unsigned row, unsigned col) {
+			T& element = l(row, col);
+			T* v_row = &v(row, 0);
+			const T* c = &cosines[std::size_t(col) * k];
+			const T* inverse_c = &inverse_cosines[std::size_t(col) * k];
+			const T* s = &sines[std::size_t(col) * k];
+			for(unsigned vector = 0; vector < k; ++vector) {
+				element = (element + sign * s[vector] * v_row[vector]) * inverse_c[vector];
+				v_row[vector] = c[vector] * v_row[vector] - s[vector] * element;
+			}
+		};
+		__impl::update_factor<T>(n, k, column, rotate, options);
+	}
+
+	dmatrix<T> _factor;
+};
+
+
+/*
+ * Factors m in place, so passing it with std::move avoids any copy. Only
+ * the lower triangle of m is read. Throws std::domain_error if m is not
+ * positive definite.
+ */
+template <typename T>
+cholesky_factorization<T> cholesky(dmatrix<T> m, const parallel_options& options = parallel_options()) {
+	if(m.rows() != m.cols()) {
+		throw std::invalid_argument("Only square matrices have a Cholesky factorization");
+	}
+
+	auto a = __impl::strided(m);
+	__impl::factor_symmetric(a, diagonal::non_unit, [&](unsigned row, unsigned first) {
+		__impl::cholesky_row(a, row, first);
+	}, [&](unsigned row, unsigned col, T value) {
+		a(row, col) = value;
+	}, [&](unsigned first) {
+		return a.block(0, first, a.rows, std::min(__impl::cholesky_block_size, a.cols - first));
+	}, options);
+	__impl::clear_upper_triangle(a, options);
+	return cholesky_factorization<T>(std::move(m));
+}
+
+
+// The solution x of A * x = b for each column of b
+template <typename T, typename M>
+dmatrix<T> solve(const cholesky_factorization<T>& cholesky, const matrix<M>& b, const parallel_options& options = parallel_options()) {
+	if(rows(b) != cholesky.factor().rows()) {
+		throw incompatible_operands(cholesky.factor(), "solve", b);
+	}
+
+	auto x = dmatrix<T>::generate(rows(b), cols(b), [&](unsigned row, unsigned col) {
+		return element_at(b, row, col);
+	}, options);
+	auto l = __impl::strided(cholesky.factor());
+	__impl::solve_left(l, triangle::lower, false, diagonal::non_unit, __impl::strided(x), options);
+	__impl::solve_left(l, triangle::lower, true, diagonal::non_unit, __impl::strided(x), options);
+	return x;
+}
+
+
+/*
+ * The factorization A = L * D * transpose(L) of a symmetric matrix, with L
+ * unit lower triangular and D diagonal, packed into one dmatrix with D on
+ * its diagonal. Unlike Cholesky, it takes no square roots and allows
+ * indefinite matrices, as long as no pivot is zero: there is no pivoting.
+ */
+template <typename T>
+class ldlt_factorization {
+public:
+	explicit ldlt_factorization(dmatrix<T>&& factors) noexcept : _factors(std::move(factors)) {}
+
+	const dmatrix<T>& factors() const noexcept { return _factors; }
+
+	T determinant() const {
+		T determinant(1);
+		for(unsigned index = 0; index < _factors.rows(); ++index) {
+			determinant *= _factors.element_at(index, index);
+		}
+		return determinant;
+	}
+
+	// A becomes A + x * transpose(x), for an n x k matrix x
+	template <typename M>
+	void update(const matrix<M>& x, const parallel_options& options = parallel_options()) {
+		rotate(x, T(1), options);
+	}
+
+	// A becomes A - x * transpose(x); std::domain_error on a zero pivot leaves the factors invalid
+	template <typename M>
+	void downdate(const matrix<M>& x, const parallel_options& options = parallel_options()) {
+		rotate(x, T(-1), options);
+	}
+
+private:
+	// Method C1 of Gill, Golub, Murray and Saunders, one column of x at a time
+	template <typename M>
+	void rotate(const matrix<M>& x, T sign, const parallel_options& options) {
+		unsigned n = _factors.rows();
+		unsigned k = cols(x);
+		auto vectors = __impl::copy_of_vectors(n, x, _factors);
+		auto l = __impl::strided(_factors);
+		auto v = __impl::strided(vectors);
+		std::vector<T> alphas(k, sign);
+		std::vector<T> ps(std::size_t(n) * k);
+		std::vector<T> betas(std::size_t(n) * k);
+
+		auto column = [&](unsigned row) {
+			T& diagonal = l(row, row);
+			for(unsigned vector = 0; vector < k; ++vector) {
+				T p = v(row, vector);
+				T updated = diagonal + alphas[vector] * p * p;
+				if(updated == T(0)) {
+					throw std::domain_error("The matrix has a zero pivot (" + std::to_string(row) + ")");
+				}
+				ps[std::size_t(row) * k + vector] = p;
+				betas[std::size_t(row) * k + vector] = p * alphas[vector] / updated;
+				alphas[vector] *= diagonal / updated;
+				diagonal = updated;
+			}
+		};
+		auto rotate = [&](unsigned row, unsigned col) {
+			T& element = l(row, col);
+			T* v_row = &v(row, 0);
+			const T* p = &ps[std::size_t(col) * k];
+			const T* beta = &betas[std::size_t(col) * k];
+			for(unsigned vector = 0; vector < k; ++vector) {
+				v_row[vector] -= p[vector] * element;
+				element += beta[vector] * v_row[vector];
+			}
+		};
+		__impl::update_factor<T>(n, k, column, rotate, options);
+	}
+
+	dmatrix<T> _factors;
+};
+
+
+// Like cholesky, but for L * D * transpose(L); throws std::domain_error on a zero pivot
+template <typename T>
+ldlt_factorization<T> ldlt(dmatrix<T> m, const parallel_options& options = parallel_options()) {
+	if(m.rows() != m.cols()) {
+		throw std::invalid_argument("Only square matrices have an LDLT factorization");
+	}
+
+	// L * D of the current panel, which the trailing update multiplies by transpose(L)
+	dmatrix<T> work(m.rows(), std::min(m.rows(), __impl::cholesky_block_size), uninitialized);
+	auto a = __impl::strided(m);
+	auto w = __impl::strided(work);
+	__impl::factor_symmetric(a, diagonal::unit, [&](unsigned row, unsigned first) {
+		__impl::ldlt_row(a, w, row, first);
+	}, [&](unsigned row, unsigned col, T value) {
+		// The solve gives l * d, of which work keeps the columns of the current panel
+		w(row, col % __impl::cholesky_block_size) = value;
+		a(row, col) = value / a(col, col);
+	}, [&](unsigned first) {
+		return w.block(0, 0, w.rows, std::min(__impl::cholesky_block_size, a.cols - first));
+	}, options);
+	__impl::clear_upper_triangle(a, options);
+	return ldlt_factorization<T>(std::move(m));
+}
+
+
+// The solution x of A * x = b for each column of b
+template <typename T, typename M>
+dmatrix<T> solve(const ldlt_factorization<T>& ldlt, const matrix<M>& b, const parallel_options& options = parallel_options()) {
+	if(rows(b) != ldlt.factors().rows()) {
+		throw incompatible_operands(ldlt.factors(), "solve", b);
+	}
+
+	auto x = dmatrix<T>::generate(rows(b), cols(b), [&](unsigned row, unsigned col) {
+		return element_at(b, row, col);
+	}, options);
+	auto factors = __impl::strided(ldlt.factors());
+	auto x_block = __impl::strided(x);
+	__impl::solve_left(factors, triangle::lower, false, diagonal::unit, x_block, options);
+	parallel_for(0, x.rows(), x.cols(), [&](std::size_t first_row, std::size_t last_row) {
+		for(unsigned row = first_row; row < last_row; ++row) {
+			T diagonal = factors(row, row);
+			for(unsigned col = 0; col < x.cols(); ++col) {
+				x_block(row, col) /= diagonal;
+			}
+		}
+	}, options);
+	__impl::solve_left(factors, triangle::lower, true, diagonal::unit, x_block, options);
+	return x;
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* CHOLESKY_HPP_ */
@@ -2,6 +2,14 @@
 #define COMPAT_HPP_
 
 
+// Marks error paths, so they are kept out of line and away from hot code
+#if defined(__GNUC__)
+# define MATRIX_COLD __attribute__((noinline, cold))
+#else
+# define MATRIX_COLD
+#endif
+
+
 #ifdef __CYGWIN__
 
 # include <cstdio>
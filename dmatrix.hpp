@@ -1,11 +1,20 @@
 #ifndef DMATRIX_HPP_
 #define DMATRIX_HPP_
 
+#include "bounds.hpp"
+#include "compat.hpp"
+#include "parallel.hpp"
 #include <algorithm>
+#include <cstddef>
+#include <cstdio>
 #include <initializer_list>
 #include <iterator>
-#include <string>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -17,69 +26,240 @@ template <typename M> class dynamic_matrix;
 template <typename M> class dmatrix;
 
 
+enum class uninitialized_t { uninitialized };
+constexpr const uninitialized_t& uninitialized = uninitialized_t::uninitialized;
+
+
+namespace __impl {
+
+
+// Default-initializes instead of value-initializing, so trivial elements are left as is
+template <typename T>
+class default_init_allocator : public std::allocator<T> {
+public:
+	template <typename U>
+	struct rebind {
+		using other = default_init_allocator<U>;
+	};
+
+	using std::allocator<T>::allocator;
+
+	template <typename U>
+	void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+		::new(static_cast<void*>(p)) U;
+	}
+
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args) {
+		::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+	}
+};
+
+
+} /* namespace __impl */
+
+
+enum class operand_kind { scalar, dynamic_matrix, static_matrix };
+
+
+// One operand of a matrix operation, as reported in errors
+struct operand_shape {
+	operand_kind kind;
+	unsigned rows;
+	unsigned cols;
+};
+
+
+// The operands of an operation that do not fit together
+struct shape_mismatch {
+	operand_shape lhs;
+	const char* operation;
+	operand_shape rhs;
+
+	/*
+	 * Writes "lhs operation rhs", e.g. "dynamic_matrix[2x3] == smatrix[3x2]",
+	 * truncated to fit the buffer. Does not allocate.
+	 */
+	const char* format(char* buffer, std::size_t size) const noexcept {
+		char lhs_text[operand_text_size];
+		char rhs_text[operand_text_size];
+		std::snprintf(buffer, size, "%s %s %s",
+		              format_operand(lhs_text, lhs), operation, format_operand(rhs_text, rhs));
+		return buffer;
+	}
+
+private:
+	// Enough for "dynamic_matrix[4294967295x4294967295]"
+	static constexpr std::size_t operand_text_size = 40;
+
+	static const char* format_operand(char (&buffer)[operand_text_size], const operand_shape& operand) noexcept {
+		switch(operand.kind) {
+		case operand_kind::scalar:
+			return "scalar";
+		case operand_kind::dynamic_matrix:
+			std::snprintf(buffer, sizeof(buffer), "dynamic_matrix[%ux%u]", operand.rows, operand.cols);
+			break;
+		case operand_kind::static_matrix:
+			std::snprintf(buffer, sizeof(buffer), "smatrix[%ux%u]", operand.rows, operand.cols);
+			break;
+		}
+		return buffer;
+	}
+};
+
+
+namespace __impl {
+
+
+template <typename M>
+operand_shape describe_operand(const dynamic_matrix<M>& m) noexcept {
+	return { operand_kind::dynamic_matrix, rows(m), cols(m) };
+}
+
+template <typename M>
+operand_shape describe_operand(const static_matrix<M>& m) noexcept {
+	return { operand_kind::static_matrix, rows(m), cols(m) };
+}
+
+template <typename M>
+operand_shape describe_operand(const matrix<M>& m) noexcept {
+	return describe_operand(concrete_matrix(m));
+}
+
+inline operand_shape describe_operand(const char*) noexcept {
+	return { operand_kind::scalar, 1, 1 };
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * Holds its operands as plain data and only formats what() when asked, so
+ * throwing it does not allocate.
+ */
 class incompatible_operands : public std::invalid_argument {
 public:
+	/*
+	 * The checks below sit on element access paths such as m[i][j], so they
+	 * take the operation as a plain string and leave building the exception
+	 * to an out-of-line function: the passing case must fold away entirely.
+	 */
 	template <typename ML, typename MR>
-	static void throw_if_not_same_shape(const matrix<ML>& lhs, const std::string& operation, const matrix<MR>& rhs) {
+	static void throw_if_not_same_shape(const matrix<ML>& lhs, const char* operation, const matrix<MR>& rhs) {
 		if(rows(lhs) != rows(rhs)  ||  cols(lhs) != cols(rhs)) {
-			throw incompatible_operands(lhs, operation, rhs);
+			raise(lhs, operation, rhs);
 		}
 	}
 
 	template <typename ML>
-	static void throw_if_not_scalar_dynamic_matrix_at_left(const dynamic_matrix<ML>& lhs, const std::string& operation) {
+	static void throw_if_not_scalar_dynamic_matrix_at_left(const dynamic_matrix<ML>& lhs, const char* operation) {
 		if(!is_scalar_dynamic_matrix(lhs)) {
-			throw incompatible_operands(lhs, operation, "scalar");
+			raise(lhs, operation, "scalar");
 		}
 	}
 
 	template <typename MR>
-	static void throw_if_not_scalar_dynamic_matrix_at_right(const std::string& operation, const dynamic_matrix<MR>& rhs) {
+	static void throw_if_not_scalar_dynamic_matrix_at_right(const char* operation, const dynamic_matrix<MR>& rhs) {
 		if(!is_scalar_dynamic_matrix(rhs)) {
-			throw incompatible_operands("scalar", operation, rhs);
+			raise("scalar", operation, rhs);
 		}
 	}
 
 	template <typename TL, typename TR>
-	static void throw_if_not_scalar_dmatrices(const dmatrix<TL>& lhs, const std::string& operation, const dmatrix<TR>& rhs) {
+	static void throw_if_not_scalar_dmatrices(const dmatrix<TL>& lhs, const char* operation, const dmatrix<TR>& rhs) {
 		if(!is_scalar_dynamic_matrix(lhs)  ||  !is_scalar_dynamic_matrix(rhs)) {
-			throw incompatible_operands(lhs, operation, rhs);
+			raise(lhs, operation, rhs);
 		}
 	}
 
+	// The operation of the mismatch must be a string with static storage duration, like a literal
+	explicit incompatible_operands(const shape_mismatch& mismatch) noexcept
+		: invalid_argument(""), _mismatch(mismatch)
+	{}
+
+	// Only the pointer is kept, so the operation must have static storage duration too
 	template <typename TL, typename TR>
-	incompatible_operands(const TL& lhs, const std::string& operation, const TR& rhs)
-		: invalid_argument(type_string(lhs) + ' ' + operation + ' ' + type_string(rhs))
+	incompatible_operands(const TL& lhs, const char* operation, const TR& rhs) noexcept
+		: incompatible_operands(shape_mismatch{
+			__impl::describe_operand(lhs), operation, __impl::describe_operand(rhs)
+		})
 	{}
 
-private:
-	template <typename M>
-	static bool is_scalar_dynamic_matrix(const dynamic_matrix<M>& m) noexcept {
-		return (rows(m) == 1  &&  cols(m) == 1);
+	// Copies the operation, truncated to fit, so it may be any string
+	template <typename TL, typename TR>
+	incompatible_operands(const TL& lhs, const std::string& operation, const TR& rhs) noexcept
+		: incompatible_operands(lhs, "", rhs)
+	{
+		copy_operation(operation.c_str());
 	}
 
-	template <typename M>
-	static std::string dimensions(const matrix<M>& m) {
-		return '[' + std::to_string(rows(m)) + 'x' + std::to_string(cols(m)) + ']';
+	// A copy formats its own message, as the once_flag of the original cannot be copied
+	incompatible_operands(const incompatible_operands& other) noexcept
+		: invalid_argument(other), _mismatch(other._mismatch)
+	{
+		if(other.owns_operation()) {
+			copy_operation(other.operation);
+		}
 	}
 
-	template <typename M>
-	static std::string type_string(const matrix<M>& m) {
-		return type_string(concrete_matrix(m));
+	// Not concurrently with what(), like any assignment
+	incompatible_operands& operator=(const incompatible_operands& other) noexcept {
+		invalid_argument::operator=(other);
+		_mismatch = other._mismatch;
+		if(other.owns_operation()) {
+			copy_operation(other.operation);
+		}
+		// The flag cannot be reset, so a message what() has formatted already is formatted again
+		bool unformatted = false;
+		std::call_once(formatted, [this, &unformatted] {
+			unformatted = true;
+			format_message();
+		});
+		if(!unformatted) {
+			format_message();
+		}
+		return *this;
 	}
 
-	template <typename M>
-	static std::string type_string(const dynamic_matrix<M>& m) {
-		return "dynamic_matrix" + dimensions(m);
+	// The message is formatted on the first call, once even when threads call it at the same time
+	const char* what() const noexcept override {
+		std::call_once(formatted, [this] { format_message(); });
+		return message;
+	}
+
+	const shape_mismatch& mismatch() const noexcept { return _mismatch; }
+
+private:
+	shape_mismatch _mismatch;
+	// The operation, when it was passed as a std::string
+	char operation[32];
+	mutable std::once_flag formatted;
+	// Room for two operands of the largest shapes
+	mutable char message[96];
+
+	bool owns_operation() const noexcept {
+		return _mismatch.operation == operation;
+	}
+
+	void copy_operation(const char* text) noexcept {
+		std::snprintf(operation, sizeof(operation), "%s", text);
+		_mismatch.operation = operation;
 	}
 
-	template <typename T, unsigned Rows, unsigned Cols>
-	static std::string type_string(const smatrix<T, Rows, Cols>& m) {
-		return "smatrix" + dimensions(m);
+	void format_message() const noexcept {
+		_mismatch.format(message, sizeof(message));
 	}
 
-	static std::string type_string(const std::string& s) {
-		return s;
+	template <typename TL, typename TR>
+	[[noreturn]] MATRIX_COLD
+	static void raise(const TL& lhs, const char* operation, const TR& rhs) {
+		throw incompatible_operands(lhs, operation, rhs);
+	}
+
+	template <typename M>
+	static bool is_scalar_dynamic_matrix(const dynamic_matrix<M>& m) noexcept {
+		return (rows(m) == 1  &&  cols(m) == 1);
 	}
 };
 
@@ -90,6 +270,9 @@ class dynamic_matrix : public matrix<M> {};
 
 template <typename DMatrix, typename M>
 class dmatrix_region_reference_base : public dynamic_matrix<M> {
+private:
+	using value_type = typename std::remove_const<typename DMatrix::element_type>::type;
+
 public:
 	using element_type = typename DMatrix::element_type;
 	using referred_matrix_type = typename std::remove_const<DMatrix>::type;
@@ -108,7 +291,10 @@ public:
 		: dmatrix(dmatrix),
 		  _rows(rows), _cols(cols),
 		  first_row(first_row), first_col(first_col)
-	{}
+	{
+		__impl::verify_row_range(first_row, rows, dmatrix.rows());
+		__impl::verify_col_range(first_col, cols, dmatrix.cols());
+	}
 
 	~dmatrix_region_reference_base() = default;
 
@@ -129,7 +315,11 @@ public:
 		return *this;
 	}
 
-	dmatrix_region_reference_base& operator=(const element_type&);
+	dmatrix_region_reference_base& operator=(const element_type& value) {
+		incompatible_operands::throw_if_not_scalar_dynamic_matrix_at_left(*this, "=");
+		this->element_at(0, 0) = value;
+		return *this;
+	}
 
 	dmatrix_region_reference_base& operator=(element_type&& value) {
 		incompatible_operands::throw_if_not_scalar_dynamic_matrix_at_left(*this, "=");
@@ -137,15 +327,54 @@ public:
 		return *this;
 	}
 
+	/*
+	 * Scalars apply to every element; the value is copied first, as it may be
+	 * one of them. Any type converting to the elements is taken as is, so that
+	 * m[0] += 1 does not compete with the conversion of a 1x1 region.
+	 */
+	template <typename U>
+	typename std::enable_if<std::is_convertible<const U&, value_type>::value, M&>::type
+	operator+=(const U& value) {
+		value_type scalar(value);
+		__impl::update_elements(*this, [&](element_type& element) { element += scalar; });
+		return static_cast<M&>(*this);
+	}
+
+	template <typename U>
+	typename std::enable_if<std::is_convertible<const U&, value_type>::value, M&>::type
+	operator-=(const U& value) {
+		value_type scalar(value);
+		__impl::update_elements(*this, [&](element_type& element) { element -= scalar; });
+		return static_cast<M&>(*this);
+	}
+
+	template <typename U>
+	typename std::enable_if<std::is_convertible<const U&, value_type>::value, M&>::type
+	operator*=(const U& value) {
+		value_type scalar(value);
+		__impl::update_elements(*this, [&](element_type& element) { element *= scalar; });
+		return static_cast<M&>(*this);
+	}
+
+	template <typename U>
+	typename std::enable_if<std::is_convertible<const U&, value_type>::value, M&>::type
+	operator/=(const U& value) {
+		value_type scalar(value);
+		__impl::update_elements(*this, [&](element_type& element) { element /= scalar; });
+		return static_cast<M&>(*this);
+	}
+
 	unsigned rows() const noexcept { return _rows; };
 
 	unsigned cols() const noexcept { return _cols; };
 
 	element_type& element_at(unsigned row, unsigned col) {
+		__impl::verify_element_index(row, col, _rows, _cols);
 		return dmatrix.element_at(first_row + row, first_col + col);
 	}
 
 	const element_type& element_at(unsigned row, unsigned col) const {
+		__impl::verify_element_index(row, col, _rows, _cols);
 		return dmatrix.element_at(first_row + row, first_col + col);
 	}
 
@@ -154,7 +383,10 @@ public:
 		return this->element_at(0, 0);
 	}
 
-	operator const element_type&() const;
+	operator const element_type&() const {
+		incompatible_operands::throw_if_not_scalar_dynamic_matrix_at_right("=", *this);
+		return this->element_at(0, 0);
+	}
 
 protected:
 	DMatrix& dmatrix;
@@ -194,7 +426,10 @@ public:
 		return *this;
 	}
 
-	dmatrix_rows_reference& operator=(const element_type&);
+	dmatrix_rows_reference& operator=(const element_type& value) {
+		base::operator=(value);
+		return *this;
+	}
 
 	dmatrix_rows_reference& operator=(element_type&& value) {
 		base::operator=(std::move(value));
@@ -202,6 +437,7 @@ public:
 	}
 
 	area_reference operator[](unsigned col) {
+		__impl::verify_col_range(col, 1, this->_cols);
 		return {
 			this->dmatrix,
 			this->_rows, 1,
@@ -209,9 +445,17 @@ public:
 		};
 	}
 
-	const_area_reference operator[](unsigned col) const;
+	const_area_reference operator[](unsigned col) const {
+		__impl::verify_col_range(col, 1, this->_cols);
+		return {
+			this->dmatrix,
+			this->_rows, 1,
+			this->first_row, this->first_col + col
+		};
+	}
 
 	area_reference operator[](drange col_range) {
+		__impl::verify_col_range(col_range.first, col_range.size, this->_cols);
 		return {
 			this->dmatrix,
 			this->_rows, col_range.size,
@@ -219,7 +463,14 @@ public:
 		};
 	}
 
-	const_area_reference operator[](drange) const;
+	const_area_reference operator[](drange col_range) const {
+		__impl::verify_col_range(col_range.first, col_range.size, this->_cols);
+		return {
+			this->dmatrix,
+			this->_rows, col_range.size,
+			this->first_row, this->first_col + col_range.first
+		};
+	}
 
 	area_reference operator[](all_t) {
 		return {
@@ -229,7 +480,13 @@ public:
 		};
 	}
 
-	const_area_reference operator[](all_t) const;
+	const_area_reference operator[](all_t) const {
+		return {
+			this->dmatrix,
+			this->_rows, this->_cols,
+			this->first_row, this->first_col
+		};
+	}
 };
 
 
@@ -258,7 +515,10 @@ public:
 		return *this;
 	}
 
-	dmatrix_area_reference& operator=(const element_type&);
+	dmatrix_area_reference& operator=(const element_type& value) {
+		base::operator=(value);
+		return *this;
+	}
 
 	dmatrix_area_reference& operator=(element_type&& value) {
 		base::operator=(std::move(value));
@@ -266,6 +526,7 @@ public:
 	}
 
 	rows_reference operator[](unsigned row) {
+		__impl::verify_row_range(row, 1, this->_rows);
 		return {
 			this->dmatrix,
 			1, this->_cols,
@@ -273,7 +534,14 @@ public:
 		};
 	}
 
-	const_rows_reference operator[](unsigned row) const;
+	const_rows_reference operator[](unsigned row) const {
+		__impl::verify_row_range(row, 1, this->_rows);
+		return {
+			this->dmatrix,
+			1, this->_cols,
+			this->first_row + row, this->first_col
+		};
+	}
 };
 
 
@@ -288,9 +556,15 @@ public:
 
 	dmatrix() = delete;
 
-	dmatrix(const dmatrix&);
+	dmatrix(const dmatrix&) = default;
 
-	dmatrix(dmatrix&&);
+	dmatrix(dmatrix&& other) noexcept
+		: _rows(other._rows), _cols(other._cols),
+		  elements(std::move(other.elements))
+	{
+		other._rows = 0;
+		other._cols = 0;
+	}
 
 	template <typename U>
 	dmatrix(const dmatrix<U>&);
@@ -300,10 +574,8 @@ public:
 	{}
 
 	dmatrix(unsigned rows, unsigned cols, std::initializer_list<std::initializer_list<T>> values)
-		: _rows(rows), _cols(cols)
+		: dmatrix(rows, cols, uninitialized)
 	{
-		elements.reserve(_rows * _cols);
-
 		unsigned provided_rows = values.size();
 		auto row_count = std::min(_rows, provided_rows);
 
@@ -312,46 +584,95 @@ public:
 			unsigned provided_cols = row_ptr->size();
 			unsigned col_count = std::min(_cols, provided_cols);
 
-			std::copy_n(row_ptr->begin(), col_count, std::back_inserter(elements));
+			T* row_elements = elements.data() + to_linear_index(row, 0);
+			std::copy_n(row_ptr->begin(), col_count, row_elements);
 
 			// Fill missing values in the row
-			for(unsigned i = col_count; i < _cols; ++i) {
-				elements.emplace_back();
-			}
+			std::fill(row_elements + col_count, row_elements + _cols, T());
 		}
 
 		// Fill missing rows
-		for(unsigned row = row_count; row < _rows; ++row) {
-			for(unsigned col = 0; col < _cols; ++col) {
-				elements.emplace_back();
-			}
+		std::fill(elements.begin() + to_linear_index(row_count, 0), elements.end(), T());
+	}
+
+	// Copies rows * cols elements in row-major order
+	dmatrix(unsigned rows, unsigned cols, const T* values)
+		: _rows(rows), _cols(cols),
+		  elements(values, values + std::size_t(rows) * cols)
+	{}
+
+	// The range must hold exactly rows * cols elements, in row-major order
+	template <
+		typename InputIterator,
+		typename = typename std::iterator_traits<InputIterator>::iterator_category
+	>
+	dmatrix(unsigned rows, unsigned cols, InputIterator first, InputIterator last)
+		: _rows(rows), _cols(cols),
+		  elements(first, last)
+	{
+		if(elements.size() != std::size_t(_rows) * _cols) {
+			throw std::invalid_argument("The range size does not match the dmatrix shape");
 		}
 	}
 
+	// Elements are default-initialized, so trivial ones are left uninitialized
+	dmatrix(unsigned rows, unsigned cols, uninitialized_t)
+		: _rows(rows), _cols(cols),
+		  elements(std::size_t(rows) * cols)
+	{}
+
 	dmatrix(std::initializer_list<std::initializer_list<T>> values)
 		: dmatrix(values.size(), largest_row_size(values), values)
 	{}
 
 	~dmatrix() = default;
 
+	/*
+	 * Builds the matrix with element (row, col) set to generator(row, col).
+	 * Large matrices are filled by several threads at once, so the generator
+	 * must be safe to call concurrently.
+	 */
+	template <typename F>
+	static dmatrix generate(unsigned rows, unsigned cols, F generator, const parallel_options& options = parallel_options()) {
+		dmatrix m(rows, cols, uninitialized);
+
+		parallel_for(0, rows, cols, [&](std::size_t first_row, std::size_t last_row) {
+			for(unsigned row = first_row; row < last_row; ++row) {
+				T* row_elements = m.elements.data() + m.to_linear_index(row, 0);
+				for(unsigned col = 0; col < cols; ++col) {
+					row_elements[col] = generator(row, col);
+				}
+			}
+		}, options);
+
+		return m;
+	}
+
 	unsigned rows() const noexcept { return _rows; };
 
 	unsigned cols() const noexcept { return _cols; };
 
-	dmatrix& operator=(const dmatrix&) &;
+	dmatrix& operator=(const dmatrix&) & = default;
 
-	dmatrix& operator=(dmatrix&&) &;
+	dmatrix& operator=(dmatrix&& other) & noexcept {
+		std::swap(_rows, other._rows);
+		std::swap(_cols, other._cols);
+		elements.swap(other.elements);
+		return *this;
+	}
 
 	template <typename U>
 	dmatrix& operator=(const dmatrix<U>&) &;
 
-	T& element_at(unsigned row, unsigned col) noexcept {
-		unsigned index = to_linear_index(row, col);
+	T& element_at(unsigned row, unsigned col) noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, _rows, _cols);
+		std::size_t index = to_linear_index(row, col);
 		return elements[index];
 	}
 
-	const T& element_at(unsigned row, unsigned col) const noexcept {
-		unsigned index = to_linear_index(row, col);
+	const T& element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, _rows, _cols);
+		std::size_t index = to_linear_index(row, col);
 		return elements[index];
 	}
 
@@ -359,27 +680,33 @@ public:
 		return { *this, 1, _cols, row, 0 };
 	}
 
-	const_rows_reference operator[](unsigned row) const;
+	const_rows_reference operator[](unsigned row) const {
+		return { *this, 1, _cols, row, 0 };
+	}
 
 	rows_reference operator[](drange row_range) {
 		return { *this, row_range.size, _cols, row_range.first, 0 };
 	}
 
-	const_rows_reference operator[](drange row_range) const;
+	const_rows_reference operator[](drange row_range) const {
+		return { *this, row_range.size, _cols, row_range.first, 0 };
+	}
 
 	rows_reference operator[](all_t) {
 		return { *this, _rows, _cols, 0, 0 };
 	}
 
-	const_rows_reference operator[](all_t) const;
+	const_rows_reference operator[](all_t) const {
+		return { *this, _rows, _cols, 0, 0 };
+	}
 
 private:
 	unsigned _rows;
 	unsigned _cols;
-	std::vector<T> elements;
+	std::vector<T, __impl::default_init_allocator<T>> elements;
 
-	unsigned to_linear_index(unsigned row, unsigned col) const noexcept {
-		return row * _cols + col;
+	std::size_t to_linear_index(unsigned row, unsigned col) const noexcept {
+		return std::size_t(row) * _cols + col;
 	}
 
 	static unsigned largest_row_size(std::initializer_list<std::initializer_list<T>> values) {
@@ -392,6 +719,19 @@ private:
 };
 
 
+template <typename T>
+struct has_contiguous_rows<dmatrix<T>> : std::true_type {};
+
+// A region keeps whole stretches of the rows of the matrix it refers to
+template <typename DMatrix>
+struct has_contiguous_rows<dmatrix_rows_reference<DMatrix>>
+	: has_contiguous_rows<typename std::remove_const<DMatrix>::type> {};
+
+template <typename DMatrix>
+struct has_contiguous_rows<dmatrix_area_reference<DMatrix>>
+	: has_contiguous_rows<typename std::remove_const<DMatrix>::type> {};
+
+
 template <typename ML, typename MR>
 inline
 bool operator==(const dynamic_matrix<ML>& lhs, const dynamic_matrix<MR>& rhs) {
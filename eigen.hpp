@@ -0,0 +1,900 @@
+#ifndef EIGEN_HPP_
+#define EIGEN_HPP_
+
+#include "matrix.hpp"
+#include "gemm.hpp"
+#include "krylov.hpp"
+#include "parallel.hpp"
+#include "qr.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+// Columns reduced per panel, before the trailing matrix is updated with gemm
+constexpr unsigned tridiagonal_block_size = 32;
+// Columns of the lower triangle of the trailing matrix updated by one gemm
+constexpr unsigned tridiagonal_strip_cols = 256;
+// Rows of the trailing matrix per task of its product with a reflector
+constexpr unsigned symmetric_product_rows = 128;
+// Tridiagonal problems divide and conquer solves directly
+constexpr unsigned divide_and_conquer_leaf_size = 32;
+
+
+// The dot product of x and v, while adding x * scale to y
+template <typename T>
+T dot_product_and_add(const T* x, const T* v, T* y, T scale, unsigned count) {
+	constexpr unsigned lanes = 8;
+	T sums[lanes] = {};
+	unsigned index = 0;
+	for(; index + lanes <= count; index += lanes) {
+		for(unsigned lane = 0; lane < lanes; ++lane) {
+			sums[lane] += x[index + lane] * v[index + lane];
+			y[index + lane] += x[index + lane] * scale;
+		}
+	}
+	for(; index < count; ++index) {
+		sums[0] += x[index] * v[index];
+		y[index] += x[index] * scale;
+	}
+	for(unsigned lane = 1; lane < lanes; ++lane) {
+		sums[0] += sums[lane];
+	}
+	return sums[0];
+}
+
+
+/*
+ * y = a * v for a symmetric a of which only the lower triangle is read,
+ * each element once: row r gives y_r its dot product with v, and a(r, c) *
+ * v_r to every y_c left of the diagonal. Blocks of rows run in parallel,
+ * each adding into its own partial vector, and those are summed in block
+ * order. partials holds the partial vectors one after the other.
+ */
+template <typename T>
+void symmetric_times_vector(const strided_block<const T>& a, const T* v, T* y, T* partials, const parallel_options& options) {
+	unsigned n = a.rows;
+	constexpr unsigned block_rows = symmetric_product_rows;
+	unsigned blocks = (n + block_rows - 1) / block_rows;
+	auto partial_of = [&](std::size_t block) { return partials + block_rows * (block * (block - 1) / 2); };
+
+	parallel_for(0, blocks, std::size_t(block_rows) * n / 2, [&](std::size_t first_block, std::size_t last_block) {
+		for(std::size_t block = first_block; block < last_block; ++block) {
+			unsigned first_row = block * block_rows;
+			unsigned last_row = std::min(n, first_row + block_rows);
+			T* partial = partial_of(block);
+			std::fill_n(partial, first_row, T(0));
+			T* own = y + first_row;
+			std::fill(own, y + last_row, T(0));
+			for(unsigned row = first_row; row < last_row; ++row) {
+				const T* a_row = &a(row, 0);
+				T sum = dot_product_and_add(a_row, v, partial, v[row], first_row);
+				sum += dot_product_and_add(a_row + first_row, v + first_row, own, v[row], row - first_row);
+				own[row - first_row] += sum + a_row[row] * v[row];
+			}
+		}
+	}, options);
+
+	for(std::size_t block = 1; block < blocks; ++block) {
+		const T* partial = partial_of(block);
+		for(unsigned row = 0; row < block * block_rows; ++row) {
+			y[row] += partial[row];
+		}
+	}
+}
+
+
+/*
+ * Reduces the symmetric a, of which only the lower triangle is read, to
+ * the tridiagonal matrix with diagonal d and subdiagonal e by two-sided
+ * Householder reflections, as in LAPACK's sytrd: a panel of reflectors is
+ * formed with the product of the trailing matrix with each of them, and w
+ * such that the panel's update is a -= v * transpose(w) + w * transpose(v),
+ * which the lower triangle of the trailing matrix then takes as gemm calls
+ * by strips of columns. Reflector i is left below the subdiagonal of
+ * column i, with an implicit one on it.
+ */
+template <typename T>
+void tridiagonalize(const strided_block<T>& a, T* d, T* e, T* taus, const parallel_options& options) {
+	unsigned n = a.rows;
+	constexpr unsigned block_size = tridiagonal_block_size;
+	dmatrix<T> w_storage(n, block_size, uninitialized);
+	auto w = strided(w_storage);
+	std::vector<T> v(n), product(n), w_v(block_size), v_v(block_size);
+	std::size_t product_blocks = (n + symmetric_product_rows - 1) / symmetric_product_rows;
+	std::vector<T> partials(std::max<std::size_t>(symmetric_product_rows * (product_blocks * (product_blocks - 1) / 2), 1));
+
+	for(unsigned first = 0; first + 1 < n; first += block_size) {
+		unsigned k = std::min(block_size, n - 1 - first);
+		unsigned end = first + k;
+
+		for(unsigned i = 0; i < k; ++i) {
+			unsigned col = first + i;
+
+			// The column, brought up to date with the panel's reflectors so far
+			for(unsigned row = col; row < n; ++row) {
+				T sum(0);
+				for(unsigned j = 0; j < i; ++j) {
+					sum += a(row, first + j) * w(col, j) + w(row, j) * a(col, first + j);
+				}
+				a(row, col) -= sum;
+			}
+			d[col] = a(col, col);
+
+			T alpha = a(col + 1, col);
+			T norm_below(0);
+			for(unsigned row = col + 2; row < n; ++row) {
+				norm_below += a(row, col) * a(row, col);
+			}
+			T tau(0);
+			e[col] = alpha;
+			if(norm_below != T(0)) {
+				T beta = std::sqrt(alpha * alpha + norm_below);
+				if(alpha > T(0)) {
+					beta = -beta;
+				}
+				tau = (beta - alpha) / beta;
+				T scale = T(1) / (alpha - beta);
+				for(unsigned row = col + 2; row < n; ++row) {
+					a(row, col) *= scale;
+				}
+				e[col] = beta;
+			}
+			taus[col] = tau;
+			a(col + 1, col) = T(1);
+
+			// w = tau * (a * v - v * (transpose(w) * v) - w * (transpose(v) * v)), a being as of the panel start
+			unsigned length = n - col - 1;
+			for(unsigned index = 0; index < length; ++index) {
+				v[index] = a(col + 1 + index, col);
+			}
+			symmetric_times_vector<T>(a.block(col + 1, col + 1, length, length), v.data(), product.data(), partials.data(), options);
+			for(unsigned j = 0; j < i; ++j) {
+				T w_sum(0), v_sum(0);
+				for(unsigned index = 0; index < length; ++index) {
+					w_sum += w(col + 1 + index, j) * v[index];
+					v_sum += a(col + 1 + index, first + j) * v[index];
+				}
+				w_v[j] = w_sum;
+				v_v[j] = v_sum;
+			}
+			T w_dot_v(0);
+			for(unsigned index = 0; index < length; ++index) {
+				unsigned row = col + 1 + index;
+				T sum = product[index];
+				for(unsigned j = 0; j < i; ++j) {
+					sum -= a(row, first + j) * w_v[j] + w(row, j) * v_v[j];
+				}
+				w(row, i) = tau * sum;
+				w_dot_v += w(row, i) * v[index];
+			}
+			T correction = -tau / 2 * w_dot_v;
+			for(unsigned index = 0; index < length; ++index) {
+				w(col + 1 + index, i) += correction * v[index];
+			}
+		}
+
+		if(end < n) {
+			for(unsigned strip = end; strip < n; strip += tridiagonal_strip_cols) {
+				unsigned strip_cols = std::min(tridiagonal_strip_cols, n - strip);
+				auto trailing = a.block(strip, strip, n - strip, strip_cols);
+				gemm<T>(T(-1), a.block(strip, first, n - strip, k), false, w.block(strip, 0, strip_cols, k), true, T(1), trailing, options);
+				gemm<T>(T(-1), w.block(strip, 0, n - strip, k), false, a.block(strip, first, strip_cols, k), true, T(1), trailing, options);
+			}
+		}
+		for(unsigned col = first; col < end; ++col) {
+			a(col + 1, col) = e[col];
+		}
+	}
+	if(n > 0) {
+		d[n - 1] = a(n - 1, n - 1);
+	}
+}
+
+
+// The triangular factor t of the compact WY form I - v * t * transpose(v) of reflectors stored as in qr
+template <typename T>
+void reflector_block_factor(const strided_block<const T>& v, const T* taus, const strided_block<T>& t) {
+	unsigned k = v.cols;
+	for(unsigned j = 0; j < k; ++j) {
+		t(j, j) = taus[j];
+		for(unsigned i = 0; i < j; ++i) {
+			// transpose(v_i) * v_j, where v_j is zero above row j and one on it
+			T sum = v(j, i);
+			for(unsigned row = j + 1; row < v.rows; ++row) {
+				sum += v(row, i) * v(row, j);
+			}
+			t(i, j) = sum;
+		}
+		// Then t(0:j, j) = -tau_j * t(0:j, 0:j) * that, in place from the top
+		for(unsigned i = 0; i < j; ++i) {
+			T sum(0);
+			for(unsigned l = i; l < j; ++l) {
+				sum += t(i, l) * t(l, j);
+			}
+			t(i, j) = -taus[j] * sum;
+		}
+		for(unsigned i = j + 1; i < k; ++i) {
+			t(i, j) = T(0);
+		}
+	}
+}
+
+
+/*
+ * Eigenvalues and eigenvectors of the tridiagonal matrix with diagonal d
+ * and off-diagonal e, where e[index] couples index and index + 1 and
+ * e[n - 1] is zero, by implicit QL iterations (EISPACK's tql2). The
+ * rotations are accumulated into the columns of vectors, which has no rows
+ * when only the eigenvalues are wanted. Both come out in ascending order.
+ */
+template <typename T>
+void implicit_ql(T* d, T* e, unsigned n, const strided_block<T>& vectors) {
+	const T epsilon = std::numeric_limits<T>::epsilon();
+	T shift(0), largest(0);
+	for(unsigned l = 0; l < n; ++l) {
+		largest = std::max(largest, std::abs(d[l]) + std::abs(e[l]));
+		unsigned m = l;
+		while(m + 1 < n  &&  std::abs(e[m]) > epsilon * largest) {
+			++m;
+		}
+
+		for(unsigned iteration = 0; m > l  &&  std::abs(e[l]) > epsilon * largest; ++iteration) {
+			if(iteration == 60) {
+				throw std::domain_error("The eigenvalue iteration did not converge");
+			}
+			T g = d[l];
+			T p = (d[l + 1] - g) / (2 * e[l]);
+			T r = std::hypot(p, T(1));
+			if(p < T(0)) {
+				r = -r;
+			}
+			d[l] = e[l] / (p + r);
+			d[l + 1] = e[l] * (p + r);
+			T next_diagonal = d[l + 1];
+			T h = g - d[l];
+			for(unsigned index = l + 2; index < n; ++index) {
+				d[index] -= h;
+			}
+			shift += h;
+
+			p = d[m];
+			T c(1), c2(1), c3(1), s(0), s2(0);
+			T next_off_diagonal = e[l + 1];
+			for(unsigned index = m; index-- > l;) {
+				c3 = c2;
+				c2 = c;
+				s2 = s;
+				g = c * e[index];
+				h = c * p;
+				r = std::hypot(p, e[index]);
+				e[index + 1] = s * r;
+				s = e[index] / r;
+				c = p / r;
+				p = c * d[index] - s * g;
+				d[index + 1] = h + s * (c * g + s * d[index]);
+				for(unsigned row = 0; row < vectors.rows; ++row) {
+					T* vector_row = &vectors(row, 0);
+					T right = vector_row[index + 1];
+					vector_row[index + 1] = s * vector_row[index] + c * right;
+					vector_row[index] = c * vector_row[index] - s * right;
+				}
+			}
+			p = -s * s2 * c3 * next_off_diagonal * e[l] / next_diagonal;
+			e[l] = s * p;
+			d[l] = c * p;
+		}
+		d[l] += shift;
+		e[l] = T(0);
+	}
+
+	if(vectors.rows == 0) {
+		std::sort(d, d + n);
+		return;
+	}
+	for(unsigned index = 0; index < n; ++index) {
+		unsigned smallest = std::min_element(d + index, d + n) - d;
+		if(smallest != index) {
+			std::swap(d[index], d[smallest]);
+			for(unsigned row = 0; row < vectors.rows; ++row) {
+				std::swap(vectors(row, index), vectors(row, smallest));
+			}
+		}
+	}
+}
+
+
+/*
+ * The root in (d[j], d[j + 1]), or above d[k - 1] for the last, of
+ * 1 / rho + sum(z_i^2 / (d_i - lambda)), with d ascending and rho > 0. It
+ * is returned as lambda - d[origin], origin being the closer pole, so that
+ * the differences d_i - lambda the eigenvectors need stay accurate. Each
+ * step solves a model with the poles on either side, as LAPACK's laed4
+ * does, falling back to bisection of the bracket around the root.
+ */
+template <typename T>
+T secular_root(const T* d, const T* z, unsigned k, T rho, unsigned j, unsigned& origin) {
+	const T epsilon = std::numeric_limits<T>::epsilon();
+	bool last = j + 1 == k;
+	T lower, upper;
+	if(!last) {
+		T midpoint = (d[j + 1] - d[j]) / 2;
+		T f = T(1) / rho;
+		for(unsigned index = 0; index < k; ++index) {
+			f += z[index] * z[index] / ((d[index] - d[j]) - midpoint);
+		}
+		if(f >= T(0)) {
+			origin = j;
+			lower = T(0);
+			upper = midpoint;
+		} else {
+			origin = j + 1;
+			lower = -midpoint;
+			upper = T(0);
+		}
+	} else {
+		T norm(0);
+		for(unsigned index = 0; index < k; ++index) {
+			norm += z[index] * z[index];
+		}
+		origin = j;
+		lower = T(0);
+		upper = rho * norm;
+	}
+
+	T left_pole = d[j] - d[origin];
+	T right_pole = last ? T(0) : d[j + 1] - d[origin];
+	T tau = (lower + upper) / 2;
+	for(unsigned iteration = 0; iteration < 100; ++iteration) {
+		// psi sums the terms of the poles left of the root, phi those right of it
+		T psi(0), psi_derivative(0), phi(0), phi_derivative(0);
+		for(unsigned index = 0; index <= j; ++index) {
+			T ratio = z[index] / ((d[index] - d[origin]) - tau);
+			psi += z[index] * ratio;
+			psi_derivative += ratio * ratio;
+		}
+		for(unsigned index = j + 1; index < k; ++index) {
+			T ratio = z[index] / ((d[index] - d[origin]) - tau);
+			phi += z[index] * ratio;
+			phi_derivative += ratio * ratio;
+		}
+		T f = T(1) / rho + psi + phi;
+		T error_bound = 8 * (phi - psi) + 2 / rho + std::abs(tau) * (psi_derivative + phi_derivative);
+		if(std::abs(f) <= epsilon * error_bound) {
+			break;
+		}
+		if(f < T(0)) {
+			lower = tau;
+		} else {
+			upper = tau;
+		}
+
+		T to_left = left_pole - tau;
+		T step;
+		if(!last) {
+			// c + s / (to_left - step) + big_s / (to_right - step) = 0
+			T to_right = right_pole - tau;
+			T c = f - psi_derivative * to_left - phi_derivative * to_right;
+			T s = psi_derivative * to_left * to_left;
+			T big_s = phi_derivative * to_right * to_right;
+			T b = -(c * (to_left + to_right) + s + big_s);
+			T constant = f * to_left * to_right;
+			T discriminant = std::max(b * b - 4 * c * constant, T(0));
+			T q = -(b + std::copysign(std::sqrt(discriminant), b)) / 2;
+			step = q != T(0) ? constant / q : T(0);
+		} else {
+			// c + s / (to_left - step) = 0
+			T c = f - psi_derivative * to_left;
+			T s = psi_derivative * to_left * to_left;
+			step = c != T(0) ? to_left + s / c : T(0);
+		}
+
+		T next = tau + step;
+		if(!(next > lower  &&  next < upper)) {
+			next = (lower + upper) / 2;
+		}
+		if(next == tau) {
+			break;
+		}
+		tau = next;
+	}
+	return tau;
+}
+
+
+/*
+ * Merges the solutions of the two halves of a tridiagonal problem split at
+ * split, as Cuppen's divide and conquer does: q holds their eigenvectors
+ * on its diagonal blocks and d their eigenvalues, and the whole is
+ * diag(d) + rho * z * transpose(z) in that basis, z coming from the rows
+ * of q next to the split. Deflated eigenpairs are kept as they are, the
+ * others come from the roots of the secular equation, with z recomputed
+ * from them after Gu and Eisenstat so that the vectors are orthogonal. The
+ * vectors are then multiplied into q with gemm, one half of q at a time.
+ */
+template <typename T>
+void merge_eigenproblems(T* d, const strided_block<T>& q, unsigned split, T coupling, const parallel_options& options) {
+	unsigned n = q.rows;
+	const T epsilon = std::numeric_limits<T>::epsilon();
+
+	// Scaled to unit norm, as the rows of both halves' vectors are
+	std::vector<T> z(n);
+	T root_half = std::sqrt(T(0.5));
+	for(unsigned col = 0; col < split; ++col) {
+		z[col] = q(split - 1, col) * root_half;
+	}
+	for(unsigned col = split; col < n; ++col) {
+		z[col] = (coupling < T(0) ? -q(split, col) : q(split, col)) * root_half;
+	}
+	T rho = 2 * std::abs(coupling);
+
+	std::vector<unsigned> order(n);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](unsigned lhs, unsigned rhs) { return d[lhs] < d[rhs]; });
+
+	// Which rows of a column are nonzero: those of the first half, both halves, or the second half
+	enum { top, both, bottom };
+	std::vector<unsigned char> rows_used(n);
+	for(unsigned col = 0; col < n; ++col) {
+		rows_used[col] = col < split ? top : bottom;
+	}
+
+	T largest(0);
+	for(unsigned col = 0; col < n; ++col) {
+		largest = std::max({ largest, std::abs(d[col]), std::abs(z[col]) });
+	}
+	T tolerance = 8 * epsilon * largest;
+
+	// Tiny components of z, and pairs of close eigenvalues, one of which a rotation frees from z
+	std::vector<unsigned> kept, deflated;
+	bool pending = false;
+	unsigned previous = 0;
+	for(unsigned col : order) {
+		if(rho * std::abs(z[col]) <= tolerance) {
+			deflated.push_back(col);
+			continue;
+		}
+		if(!pending) {
+			pending = true;
+			previous = col;
+			continue;
+		}
+		T norm = std::hypot(z[col], z[previous]);
+		T c = z[col] / norm;
+		T s = z[previous] / norm;
+		if(std::abs((d[col] - d[previous]) * c * s) <= tolerance) {
+			z[col] = norm;
+			z[previous] = T(0);
+			for(unsigned row = 0; row < n; ++row) {
+				T x = q(row, previous);
+				T y = q(row, col);
+				q(row, previous) = c * x - s * y;
+				q(row, col) = s * x + c * y;
+			}
+			if(rows_used[previous] != rows_used[col]) {
+				rows_used[previous] = rows_used[col] = both;
+			}
+			T d_previous = d[previous];
+			d[previous] = d_previous * c * c + d[col] * s * s;
+			d[col] = d_previous * s * s + d[col] * c * c;
+			deflated.push_back(previous);
+		} else {
+			kept.push_back(previous);
+		}
+		previous = col;
+	}
+	if(pending) {
+		kept.push_back(previous);
+	}
+
+	unsigned k = kept.size();
+	std::vector<T> d_kept(k), z_kept(k), taus(k);
+	std::vector<unsigned> origins(k);
+	for(unsigned index = 0; index < k; ++index) {
+		d_kept[index] = d[kept[index]];
+		z_kept[index] = z[kept[index]];
+	}
+	parallel_for(0, k, k * 8, [&](std::size_t first, std::size_t last) {
+		for(std::size_t root = first; root < last; ++root) {
+			taus[root] = secular_root(d_kept.data(), z_kept.data(), k, rho, root, origins[root]);
+		}
+	}, options);
+	// lambda_j - d_i, accurately
+	auto distance = [&](unsigned root, unsigned index) {
+		return (d_kept[origins[root]] - d_kept[index]) + taus[root];
+	};
+
+	// The vectors of the rank-one problem, with rows in the order of the columns of q they combine
+	std::vector<unsigned> by_rows_used(k);
+	std::iota(by_rows_used.begin(), by_rows_used.end(), 0u);
+	std::stable_sort(by_rows_used.begin(), by_rows_used.end(), [&](unsigned lhs, unsigned rhs) {
+		return rows_used[kept[lhs]] < rows_used[kept[rhs]];
+	});
+	unsigned top_count = 0, bottom_count = 0;
+	for(unsigned index : kept) {
+		top_count += rows_used[index] != bottom;
+		bottom_count += rows_used[index] != top;
+	}
+
+	std::vector<T> z_hat(k);
+	for(unsigned index = 0; index < k; ++index) {
+		T product = distance(index, index) / rho;
+		for(unsigned other = 0; other < k; ++other) {
+			if(other != index) {
+				product *= distance(other, index) / (d_kept[other] - d_kept[index]);
+			}
+		}
+		z_hat[index] = std::copysign(std::sqrt(std::max(product, T(0))), z_kept[index]);
+	}
+	dmatrix<T> u(k, k, uninitialized);
+	parallel_for(0, k, k * 4, [&](std::size_t first, std::size_t last) {
+		for(std::size_t root = first; root < last; ++root) {
+			T norm(0);
+			for(unsigned row = 0; row < k; ++row) {
+				T element = z_hat[by_rows_used[row]] / -distance(root, by_rows_used[row]);
+				u.element_at(row, root) = element;
+				norm += element * element;
+			}
+			T inverse = T(1) / std::sqrt(norm);
+			for(unsigned row = 0; row < k; ++row) {
+				u.element_at(row, root) *= inverse;
+			}
+		}
+	}, options);
+
+	dmatrix<T> vectors(n, k, uninitialized);
+	{
+		dmatrix<T> gathered(n, k, uninitialized);
+		for(unsigned row = 0; row < n; ++row) {
+			for(unsigned col = 0; col < k; ++col) {
+				gathered.element_at(row, col) = q(row, kept[by_rows_used[col]]);
+			}
+		}
+		auto g = strided(static_cast<const dmatrix<T>&>(gathered));
+		auto u_block = strided(static_cast<const dmatrix<T>&>(u));
+		auto result = strided(vectors);
+		gemm<T>(T(1), g.block(0, 0, split, top_count), false, u_block.block(0, 0, top_count, k), false,
+		        T(0), result.block(0, 0, split, k), options);
+		gemm<T>(T(1), g.block(split, k - bottom_count, n - split, bottom_count), false, u_block.block(k - bottom_count, 0, bottom_count, k), false,
+		        T(0), result.block(split, 0, n - split, k), options);
+	}
+
+	// Everything in ascending order of eigenvalue, back into d and q
+	std::vector<std::pair<T, unsigned>> sorted;
+	sorted.reserve(n);
+	for(unsigned root = 0; root < k; ++root) {
+		sorted.emplace_back(d_kept[origins[root]] + taus[root], root);
+	}
+	for(unsigned index = 0; index < deflated.size(); ++index) {
+		sorted.emplace_back(d[deflated[index]], k + index);
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<T, unsigned>& lhs, const std::pair<T, unsigned>& rhs) {
+		return lhs.first < rhs.first;
+	});
+	dmatrix<T> deflated_vectors(n, deflated.size(), uninitialized);
+	for(unsigned row = 0; row < n; ++row) {
+		for(unsigned index = 0; index < deflated.size(); ++index) {
+			deflated_vectors.element_at(row, index) = q(row, deflated[index]);
+		}
+	}
+	for(unsigned col = 0; col < n; ++col) {
+		d[col] = sorted[col].first;
+	}
+	for(unsigned row = 0; row < n; ++row) {
+		for(unsigned col = 0; col < n; ++col) {
+			unsigned source = sorted[col].second;
+			q(row, col) = source < k ? vectors.element_at(row, source) : deflated_vectors.element_at(row, source - k);
+		}
+	}
+}
+
+
+// Eigenvalues into d and eigenvectors into q of the tridiagonal matrix of d and e, e[n - 1] not included
+template <typename T>
+void divide_and_conquer(T* d, const T* e, const strided_block<T>& q, const parallel_options& options) {
+	unsigned n = q.rows;
+	if(n <= divide_and_conquer_leaf_size) {
+		for(unsigned row = 0; row < n; ++row) {
+			for(unsigned col = 0; col < n; ++col) {
+				q(row, col) = row == col ? T(1) : T(0);
+			}
+		}
+		T off_diagonal[divide_and_conquer_leaf_size];
+		std::copy_n(e, n, off_diagonal);
+		off_diagonal[n - 1] = T(0);
+		implicit_ql(d, off_diagonal, n, q);
+		return;
+	}
+
+	// The coupling between the halves becomes a rank-one term
+	unsigned split = n / 2;
+	T coupling = e[split - 1];
+	d[split - 1] -= std::abs(coupling);
+	d[split] -= std::abs(coupling);
+	for(unsigned row = 0; row < split; ++row) {
+		std::fill_n(&q(row, split), n - split, T(0));
+	}
+	for(unsigned row = split; row < n; ++row) {
+		std::fill_n(&q(row, 0), split, T(0));
+	}
+	divide_and_conquer(d, e, q.block(0, 0, split, split), options);
+	divide_and_conquer(d + split, e + split, q.block(split, split, n - split, n - split), options);
+	merge_eigenproblems(d, q, split, coupling, options);
+}
+
+
+template <typename M>
+void throw_if_not_operator_of_size(const matrix<M>& a, unsigned size) {
+	if(rows(a) != size  ||  cols(a) != size) {
+		throw std::invalid_argument("The matrix does not have the size given");
+	}
+}
+
+template <typename F>
+typename std::enable_if<!std::is_base_of<matrix<F>, F>::value>::type
+throw_if_not_operator_of_size(const F&, unsigned) {}
+
+
+} /* namespace __impl */
+
+
+// Eigenvalues in ascending order, and orthonormal eigenvectors as the columns of a dmatrix in the same order
+template <typename T>
+class symmetric_eigen_decomposition {
+public:
+	symmetric_eigen_decomposition(std::vector<T>&& values, dmatrix<T>&& vectors) noexcept
+		: _values(std::move(values)), _vectors(std::move(vectors))
+	{}
+
+	const std::vector<T>& values() const noexcept { return _values; }
+
+	const dmatrix<T>& vectors() const noexcept { return _vectors; }
+
+private:
+	std::vector<T> _values;
+	dmatrix<T> _vectors;
+};
+
+
+/*
+ * All eigenvalues and eigenvectors of a symmetric matrix, of which only the
+ * lower triangle is read. The matrix is reduced to tridiagonal form in
+ * place, so passing it with std::move avoids any copy; divide and conquer
+ * solves the tridiagonal problem, and the reflectors are applied to its
+ * eigenvectors in blocks. All three spend most of their time in gemm.
+ */
+template <typename T>
+symmetric_eigen_decomposition<T> eigh(dmatrix<T> m, const parallel_options& options = parallel_options()) {
+	if(m.rows() != m.cols()) {
+		throw std::invalid_argument("Only square matrices have a symmetric eigendecomposition");
+	}
+	unsigned n = m.rows();
+	auto a = __impl::strided(m);
+
+	std::vector<T> d(n), e(n), taus(n);
+	__impl::tridiagonalize(a, d.data(), e.data(), taus.data(), options);
+	dmatrix<T> vectors(n, n, uninitialized);
+	if(n > 0) {
+		__impl::divide_and_conquer(d.data(), e.data(), __impl::strided(vectors), options);
+	}
+
+	// Q * vectors, Q being the product of the reflectors, the last block first
+	dmatrix<T> t(__impl::tridiagonal_block_size, __impl::tridiagonal_block_size, uninitialized);
+	unsigned reflectors = n > 0 ? n - 1 : 0;
+	for(unsigned end = reflectors; end > 0; ) {
+		unsigned first = (end - 1) / __impl::tridiagonal_block_size * __impl::tridiagonal_block_size;
+		unsigned k = end - first;
+		__impl::strided_block<const T> v = a.block(first + 1, first, n - first - 1, k);
+		auto t_block = __impl::strided(t).block(0, 0, k, k);
+		__impl::reflector_block_factor(v, taus.data() + first, t_block);
+		__impl::apply_block_reflector<T>(v, t_block, false, __impl::strided(vectors).block(first + 1, 0, n - first - 1, n), options);
+		end = first;
+	}
+
+	return symmetric_eigen_decomposition<T>(std::move(d), std::move(vectors));
+}
+
+
+// The eigenvalues alone, in ascending order, by implicit QL iterations on the tridiagonal form
+template <typename T>
+std::vector<T> eigvalsh(dmatrix<T> m, const parallel_options& options = parallel_options()) {
+	if(m.rows() != m.cols()) {
+		throw std::invalid_argument("Only square matrices have a symmetric eigendecomposition");
+	}
+	unsigned n = m.rows();
+	auto a = __impl::strided(m);
+
+	std::vector<T> d(n), e(n), taus(n);
+	__impl::tridiagonalize(a, d.data(), e.data(), taus.data(), options);
+	if(n > 0) {
+		e[n - 1] = T(0);
+	}
+	__impl::implicit_ql(d.data(), e.data(), n, __impl::strided_block<T>{ nullptr, 0, 0, 0 });
+	return d;
+}
+
+
+struct lanczos_options {
+	// Basis vectors built between restarts; 0 for max(2 * count, count + 32), at most the size
+	unsigned basis_size = 0;
+	// Stop once the residual norm of every eigenpair is at most this times the largest eigenvalue magnitude
+	double tolerance = 1e-10;
+	unsigned max_restarts = 200;
+	// Of the random start vector
+	unsigned seed = 1;
+};
+
+
+/*
+ * The count largest eigenvalues of a symmetric operator of the given size,
+ * and their eigenvectors, by thick-restart Lanczos: the operator is only
+ * applied to vectors, so it may be a dense or sparse matrix, a structured
+ * view, or a functor called as a(x, y) to store A * x into y. The basis
+ * is fully reorthogonalized, and at each restart the better half of the
+ * Ritz vectors beyond the count wanted is kept. Throws std::domain_error if
+ * the eigenpairs did not converge within the restarts allowed.
+ */
+template <typename T = double, typename Op>
+symmetric_eigen_decomposition<T> eigsh(
+	const Op& a, unsigned size, unsigned count,
+	const lanczos_options& settings = lanczos_options(),
+	const parallel_options& options = parallel_options()
+) {
+	__impl::throw_if_not_operator_of_size(a, size);
+	if(count > size) {
+		throw std::invalid_argument("More eigenpairs asked for than the size of the operator");
+	}
+	if(count == 0) {
+		return symmetric_eigen_decomposition<T>(std::vector<T>(), dmatrix<T>(size, 0));
+	}
+
+	unsigned m = settings.basis_size > 0 ? settings.basis_size : std::max(2 * count, count + 32);
+	m = std::min(std::max(m, count + 1), size);
+	dmatrix<T> basis(m + 1, size, uninitialized), projected(m, m);
+	auto v = [&](unsigned index) { return &basis.element_at(index, 0); };
+	std::vector<T> projections(m + 2), couplings(m), scratch(__impl::operator_scratch_size(a));
+	__impl::block_sums<T> sums(size, m + 2);
+	const T epsilon = std::numeric_limits<T>::epsilon();
+
+	std::mt19937_64 generator(settings.seed);
+	auto random_vector = [&](T* target) {
+		for(unsigned index = 0; index < size; ++index) {
+			target[index] = std::ldexp(T(generator() >> 11), -52) - T(1);
+		}
+	};
+
+	// next -= its projections onto the count basis vectors, which are returned, and its norm, as in gmres_into
+	std::vector<T> corrections(m + 1);
+	auto orthogonalize = [&](T* next, unsigned count) {
+		auto project = [&](const T* previous) {
+			return sums(count + 1, [&](std::size_t first, std::size_t last, T* sum) {
+				for(unsigned index = 0; previous  &&  index < count; ++index) {
+					const T* basis_vector = v(index);
+					for(std::size_t element = first; element < last; ++element) {
+						next[element] -= previous[index] * basis_vector[element];
+					}
+				}
+				for(unsigned index = 0; index < count; ++index) {
+					sum[index] = __impl::dot_product(v(index) + first, next + first, last - first);
+				}
+				sum[count] = __impl::dot_product(next + first, next + first, last - first);
+			}, options);
+		};
+		std::copy_n(project(nullptr), count + 1, projections.data());
+		T norm_before = std::sqrt(projections[count]);
+		const T* left = project(projections.data());
+		T norm = std::sqrt(left[count]);
+		if(norm < norm_before * T(0.7071)) {
+			std::copy_n(left, count, corrections.data());
+			norm = std::sqrt(project(corrections.data())[count]);
+			for(unsigned index = 0; index < count; ++index) {
+				projections[index] += corrections[index];
+			}
+		}
+		return norm;
+	};
+	auto scale = [&](T* vector, T factor) {
+		sums.for_each([&](std::size_t first, std::size_t last) {
+			for(std::size_t index = first; index < last; ++index) {
+				vector[index] *= factor;
+			}
+		}, options);
+	};
+
+	random_vector(v(0));
+	scale(v(0), T(1) / std::sqrt(sums.dot(v(0), v(0), options)));
+
+	parallel_options serial = options;
+	serial.max_threads = 1;
+	unsigned start = 0;
+	for(unsigned restart = 0; ; ++restart) {
+		for(unsigned j = start; j < m; ++j) {
+			T* next = v(j + 1);
+			__impl::apply_operator(a, static_cast<const T*>(v(j)), next, scratch.data(), options);
+			T norm = orthogonalize(next, j + 1);
+			for(unsigned index = 0; index <= j; ++index) {
+				projected.element_at(index, j) = projected.element_at(j, index) = projections[index];
+			}
+
+			// An invariant subspace: on with any vector orthogonal to it
+			T scale_norm(0);
+			for(unsigned index = 0; index <= j; ++index) {
+				scale_norm = std::max(scale_norm, std::abs(projections[index]));
+			}
+			if(norm <= epsilon * scale_norm * size) {
+				couplings[j] = T(0);
+				if(j + 1 == size) {
+					continue;
+				}
+				random_vector(next);
+				norm = orthogonalize(next, j + 1);
+			} else {
+				couplings[j] = norm;
+			}
+			scale(next, T(1) / norm);
+		}
+
+		auto ritz = eigh(projected, serial);
+		const auto& s = ritz.vectors();
+		T beta = couplings[m - 1];
+		T largest = std::max(std::abs(ritz.values().front()), std::abs(ritz.values().back()));
+		bool converged = true;
+		for(unsigned index = m - count; index < m; ++index) {
+			converged = converged  &&  std::abs(beta * s.element_at(m - 1, index)) <= T(settings.tolerance) * largest;
+		}
+
+		if(converged  ||  restart == settings.max_restarts) {
+			if(!converged) {
+				throw std::domain_error("The eigenpairs did not converge within the restarts allowed");
+			}
+			dmatrix<T> vectors(size, count, uninitialized);
+			__impl::gemm<T>(T(1), __impl::strided(static_cast<const dmatrix<T>&>(basis)).block(0, 0, m, size), true,
+			                __impl::strided(s).block(0, m - count, m, count), false, T(0), __impl::strided(vectors), options);
+			std::vector<T> values(ritz.values().end() - count, ritz.values().end());
+			return symmetric_eigen_decomposition<T>(std::move(values), std::move(vectors));
+		}
+
+		// The basis becomes the kept Ritz vectors, followed by the last basis vector
+		unsigned keep = std::min(count + (m - count) / 2, m - 1);
+		auto kept_vectors = __impl::strided(s).block(0, m - keep, m, keep);
+		dmatrix<T> chunk(keep, __impl::krylov_block_size, uninitialized);
+		for(std::size_t first = 0; first < size; first += __impl::krylov_block_size) {
+			unsigned width = std::min<std::size_t>(__impl::krylov_block_size, size - first);
+			auto columns = __impl::strided(basis).block(0, first, m, width);
+			auto chunk_block = __impl::strided(chunk).block(0, 0, keep, width);
+			__impl::gemm<T>(T(1), kept_vectors, true, columns, false, T(0), chunk_block, options);
+			for(unsigned row = 0; row < keep; ++row) {
+				std::copy_n(&chunk_block(row, 0), width, &columns(row, 0));
+			}
+		}
+		std::copy_n(v(m), size, v(keep));
+
+		for(unsigned row = 0; row < m; ++row) {
+			std::fill_n(&projected.element_at(row, 0), m, T(0));
+		}
+		for(unsigned index = 0; index < keep; ++index) {
+			projected.element_at(index, index) = ritz.values()[m - keep + index];
+			projected.element_at(index, keep) = projected.element_at(keep, index) = beta * s.element_at(m - 1, m - keep + index);
+		}
+		start = keep;
+	}
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* EIGEN_HPP_ */
@@ -0,0 +1,162 @@
+#ifndef EXPECTED_HPP_
+#define EXPECTED_HPP_
+
+#include "matrix.hpp"
+#include "storage.hpp"
+#include <utility>
+
+
+namespace matrix {
+
+
+/*
+ * Either the result of a shape-checked operation or the shape_mismatch that
+ * prevented it. value() throws incompatible_operands when there is no value,
+ * so the throwing behaviour of the operators is one call away.
+ */
+template <typename T>
+class expected {
+public:
+	expected(const T& value) : ok(true), _error() {
+		result.construct_value(value);
+	}
+
+	expected(T&& value) : ok(true), _error() {
+		result.construct_value(std::move(value));
+	}
+
+	expected(const shape_mismatch& error) noexcept
+		: ok(false), _error(error)
+	{}
+
+	expected(const expected& other)
+		: ok(other.ok), _error(other._error)
+	{
+		if(ok) {
+			result.construct_value(other.result.value_reference());
+		}
+	}
+
+	expected(expected&& other)
+		: ok(other.ok), _error(other._error)
+	{
+		if(ok) {
+			result.construct_value(std::move(other.result.value_reference()));
+		}
+	}
+
+	~expected() {
+		if(ok) {
+			result.destruct_value();
+		}
+	}
+
+	expected& operator=(const expected&) = delete;
+
+	expected& operator=(expected&&) = delete;
+
+	bool has_value() const noexcept { return ok; }
+
+	explicit operator bool() const noexcept { return ok; }
+
+	T& value() {
+		throw_if_error();
+		return result.value_reference();
+	}
+
+	const T& value() const {
+		throw_if_error();
+		return result.value_reference();
+	}
+
+	// Only meaningful when there is no value
+	const shape_mismatch& error() const noexcept { return _error; }
+
+private:
+	bool ok;
+	shape_mismatch _error;
+	storage<T> result;
+
+	void throw_if_error() const {
+		if(!ok) {
+			throw incompatible_operands(_error);
+		}
+	}
+};
+
+
+template <>
+class expected<void> {
+public:
+	expected() noexcept : ok(true), _error() {}
+
+	expected(const shape_mismatch& error) noexcept
+		: ok(false), _error(error)
+	{}
+
+	bool has_value() const noexcept { return ok; }
+
+	explicit operator bool() const noexcept { return ok; }
+
+	void value() const {
+		if(!ok) {
+			throw incompatible_operands(_error);
+		}
+	}
+
+	const shape_mismatch& error() const noexcept { return _error; }
+
+private:
+	bool ok;
+	shape_mismatch _error;
+};
+
+
+/*
+ * Non-throwing counterparts of the shape-checked operations: a shape mismatch
+ * is returned as the error of the result instead of thrown.
+ */
+template <typename ML, typename MR>
+expected<void> try_same_shape(const matrix<ML>& lhs, const char* operation, const matrix<MR>& rhs) noexcept {
+	if(rows(lhs) != rows(rhs)  ||  cols(lhs) != cols(rhs)) {
+		return shape_mismatch{ __impl::describe_operand(lhs), operation, __impl::describe_operand(rhs) };
+	}
+	return {};
+}
+
+
+template <typename ML, typename MR>
+expected<bool> try_equal(const matrix<ML>& lhs, const matrix<MR>& rhs) {
+	auto checked = try_same_shape(lhs, "==", rhs);
+	if(!checked) {
+		return checked.error();
+	}
+	return equal_to(lhs, rhs);
+}
+
+
+template <typename ML, typename MR>
+expected<bool> try_not_equal(const matrix<ML>& lhs, const matrix<MR>& rhs) {
+	auto checked = try_same_shape(lhs, "!=", rhs);
+	if(!checked) {
+		return checked.error();
+	}
+	return !equal_to(lhs, rhs);
+}
+
+
+// Takes the destination by forwarding reference, as it is usually a region reference temporary
+template <typename MT, typename MF>
+expected<void> try_move_to(MT&& to, matrix<MF>&& from) {
+	auto checked = try_same_shape(to, "=", from);
+	if(checked) {
+		move_to(to, std::move(from));
+	}
+	return checked;
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* EXPECTED_HPP_ */
@@ -0,0 +1,405 @@
+#ifndef GEMM_HPP_
+#define GEMM_HPP_
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+/*
+ * Rows of elements anywhere in memory, stride elements apart: what the
+ * dense kernels work on, whether the elements belong to a whole matrix or
+ * to a region of one.
+ */
+template <typename T>
+struct strided_block {
+	T* data;
+	std::size_t stride;
+	unsigned rows;
+	unsigned cols;
+
+	T& operator()(unsigned row, unsigned col) const {
+		return data[std::size_t(row) * stride + col];
+	}
+
+	strided_block block(unsigned first_row, unsigned first_col, unsigned block_rows, unsigned block_cols) const {
+		return { data + std::size_t(first_row) * stride + first_col, stride, block_rows, block_cols };
+	}
+
+	operator strided_block<const T>() const {
+		return { data, stride, rows, cols };
+	}
+};
+
+
+template <typename M>
+strided_block<typename M::element_type> strided(matrix<M>& m) {
+	static_assert(has_contiguous_rows<M>::value, "The rows of the matrix must be contiguous");
+	if(rows(m) == 0  ||  cols(m) == 0) {
+		return { nullptr, cols(m), rows(m), cols(m) };
+	}
+	auto* first = &element_at(m, 0, 0);
+	std::size_t stride = rows(m) > 1 ? &element_at(m, 1, 0) - first : cols(m);
+	return { first, stride, rows(m), cols(m) };
+}
+
+template <typename M>
+strided_block<const typename M::element_type> strided(const matrix<M>& m) {
+	static_assert(has_contiguous_rows<M>::value, "The rows of the matrix must be contiguous");
+	if(rows(m) == 0  ||  cols(m) == 0) {
+		return { nullptr, cols(m), rows(m), cols(m) };
+	}
+	const auto* first = &element_at(m, 0, 0);
+	std::size_t stride = rows(m) > 1 ? &element_at(m, 1, 0) - first : cols(m);
+	return { first, stride, rows(m), cols(m) };
+}
+
+
+// Matrices without contiguous rows are copied into copy first
+template <typename T, typename M>
+strided_block<const T> dense_view(const matrix<M>& m, dmatrix<T>&, std::true_type) {
+	return strided(m);
+}
+
+template <typename T, typename M>
+strided_block<const T> dense_view(const matrix<M>& m, dmatrix<T>& copy, std::false_type) {
+	copy = dmatrix<T>::generate(rows(m), cols(m), [&](unsigned row, unsigned col) {
+		return element_at(m, row, col);
+	});
+	return strided(static_cast<const dmatrix<T>&>(copy));
+}
+
+template <typename T, typename M>
+strided_block<const T> dense_view(const matrix<M>& m, dmatrix<T>& copy) {
+	return dense_view(m, copy, has_contiguous_rows<M>());
+}
+
+
+/*
+ * The register block computed at once, and the cache blocks around it: a
+ * kc x nc panel of b is packed once and shared, and each task packs an
+ * mc x kc block of a that stays in its core's cache while it sweeps the panel.
+ */
+namespace gemm_blocking {
+	constexpr unsigned mr = 6;
+	constexpr unsigned nr = 8;
+	constexpr unsigned mc = 96;
+	constexpr unsigned kc = 256;
+	constexpr unsigned nc = 2048;
+	// Columns of c each task covers within a panel
+	constexpr unsigned task_cols = 256;
+} /* namespace gemm_blocking */
+
+
+// op(m)(row, col), where op transposes when transposed is set
+template <typename T>
+const T& op_element(const strided_block<const T>& m, bool transposed, unsigned row, unsigned col) {
+	return transposed ? m(col, row) : m(row, col);
+}
+
+
+// Independent partial sums, which the compiler may keep in one vector register
+template <typename T>
+T dot_product(const T* x, const T* y, unsigned count) {
+	constexpr unsigned lanes = 8;
+	T sums[lanes] = {};
+	unsigned index = 0;
+	for(; index + lanes <= count; index += lanes) {
+		for(unsigned lane = 0; lane < lanes; ++lane) {
+			sums[lane] += x[index + lane] * y[index + lane];
+		}
+	}
+	for(; index < count; ++index) {
+		sums[0] += x[index] * y[index];
+	}
+	for(unsigned lane = 1; lane < lanes; ++lane) {
+		sums[0] += sums[lane];
+	}
+	return sums[0];
+}
+
+
+// The block of m holding the given block of op(m)
+template <typename T>
+strided_block<const T> op_block(
+	const strided_block<const T>& m, bool transposed,
+	unsigned first_row, unsigned first_col, unsigned block_rows, unsigned block_cols
+) {
+	return transposed ? m.block(first_col, first_row, block_cols, block_rows) : m.block(first_row, first_col, block_rows, block_cols);
+}
+
+
+// Slivers of mr rows of op(a), each stored column after column, zero-padded at the edge
+template <typename T>
+void pack_a(const strided_block<const T>& a, bool transposed, unsigned first_row, unsigned first_k, unsigned rows, unsigned depth, T* packed) {
+	constexpr unsigned mr = gemm_blocking::mr;
+	for(unsigned sliver = 0; sliver < rows; sliver += mr) {
+		for(unsigned k = 0; k < depth; ++k) {
+			for(unsigned row = 0; row < mr; ++row) {
+				*packed++ = sliver + row < rows ? op_element(a, transposed, first_row + sliver + row, first_k + k) : T(0);
+			}
+		}
+	}
+}
+
+
+// Slivers of nr columns of op(b), each stored row after row, zero-padded at the edge
+template <typename T>
+void pack_b(const strided_block<const T>& b, bool transposed, unsigned first_k, unsigned first_col, unsigned depth, unsigned cols, T* packed) {
+	constexpr unsigned nr = gemm_blocking::nr;
+	for(unsigned sliver = 0; sliver < cols; sliver += nr) {
+		T* sliver_start = packed + std::size_t(sliver) * depth;
+		for(unsigned k = 0; k < depth; ++k) {
+			T* to = sliver_start + std::size_t(k) * nr;
+			if(!transposed  &&  sliver + nr <= cols) {
+				const T* from = &b(first_k + k, first_col + sliver);
+				std::copy(from, from + nr, to);
+			} else {
+				for(unsigned col = 0; col < nr; ++col) {
+					to[col] = sliver + col < cols ? op_element(b, transposed, first_k + k, first_col + sliver + col) : T(0);
+				}
+			}
+		}
+	}
+}
+
+
+/*
+ * c += alpha * (mr x depth sliver of a) * (depth x nr sliver of b), for the
+ * rows x cols top-left part of the register block that lies within c.
+ */
+template <typename T>
+void gemm_micro_kernel(unsigned depth, T alpha, const T* a, const T* b, const strided_block<T>& c, unsigned rows, unsigned cols) {
+	constexpr unsigned mr = gemm_blocking::mr;
+	constexpr unsigned nr = gemm_blocking::nr;
+
+	T acc[mr][nr] = {};
+	for(unsigned k = 0; k < depth; ++k) {
+		for(unsigned row = 0; row < mr; ++row) {
+			for(unsigned col = 0; col < nr; ++col) {
+				acc[row][col] += a[row] * b[col];
+			}
+		}
+		a += mr;
+		b += nr;
+	}
+
+	for(unsigned row = 0; row < rows; ++row) {
+		T* c_row = &c(row, 0);
+		for(unsigned col = 0; col < cols; ++col) {
+			c_row[col] += alpha * acc[row][col];
+		}
+	}
+}
+
+
+template <typename T>
+void gemm_macro_kernel(unsigned depth, T alpha, const T* packed_a, const T* packed_b, const strided_block<T>& c) {
+	constexpr unsigned mr = gemm_blocking::mr;
+	constexpr unsigned nr = gemm_blocking::nr;
+	for(unsigned col = 0; col < c.cols; col += nr) {
+		for(unsigned row = 0; row < c.rows; row += mr) {
+			gemm_micro_kernel(
+				depth, alpha,
+				packed_a + std::size_t(row) * depth, packed_b + std::size_t(col) * depth,
+				c.block(row, col, std::min(mr, c.rows - row), std::min(nr, c.cols - col)),
+				std::min(mr, c.rows - row), std::min(nr, c.cols - col)
+			);
+		}
+	}
+}
+
+
+template <typename T>
+void scale_block(const strided_block<T>& c, T beta, const parallel_options& options) {
+	if(beta == T(1)  ||  c.cols == 0) {
+		return;
+	}
+	parallel_for(0, c.rows, c.cols, [&](std::size_t first_row, std::size_t last_row) {
+		for(unsigned row = first_row; row < last_row; ++row) {
+			T* c_row = &c(row, 0);
+			for(unsigned col = 0; col < c.cols; ++col) {
+				// A zero beta overwrites c, NaNs included
+				c_row[col] = beta == T(0) ? T(0) : beta * c_row[col];
+			}
+		}
+	}, options);
+}
+
+
+template <typename T>
+void gemm(
+	T alpha, strided_block<const T> a, bool transpose_a, strided_block<const T> b, bool transpose_b,
+	T beta, const strided_block<T>& c, const parallel_options& options = parallel_options()
+);
+
+
+/*
+ * When c fits in a single tile but the products are long, as for the
+ * transpose of a tall matrix times another, the depth is split instead:
+ * slices of fixed size are multiplied in parallel and their products
+ * summed in order, so that the result does not depend on the threads.
+ */
+template <typename T>
+void gemm_split_depth(
+	T alpha, const strided_block<const T>& a, bool transpose_a, const strided_block<const T>& b, bool transpose_b,
+	const strided_block<T>& c, unsigned depth, const parallel_options& options
+) {
+	constexpr unsigned slice_depth = 4 * gemm_blocking::kc;
+	unsigned slices = (depth + slice_depth - 1) / slice_depth;
+	std::size_t slice_size = std::size_t(c.rows) * c.cols;
+	std::vector<T> products(slices * slice_size);
+
+	parallel_options serial = options;
+	serial.max_threads = 1;
+	parallel_for(0, slices, slice_size * slice_depth, [&](std::size_t first, std::size_t last) {
+		for(std::size_t slice = first; slice < last; ++slice) {
+			unsigned first_k = slice * slice_depth;
+			unsigned slice_k = std::min(slice_depth, depth - first_k);
+			gemm<T>(
+				alpha, op_block(a, transpose_a, 0, first_k, c.rows, slice_k), transpose_a,
+				op_block(b, transpose_b, first_k, 0, slice_k, c.cols), transpose_b,
+				T(0), strided_block<T>{ &products[slice * slice_size], c.cols, c.rows, c.cols }, serial
+			);
+		}
+	}, options);
+
+	for(unsigned slice = 0; slice < slices; ++slice) {
+		const T* product = &products[slice * slice_size];
+		for(unsigned row = 0; row < c.rows; ++row) {
+			T* c_row = &c(row, 0);
+			for(unsigned col = 0; col < c.cols; ++col) {
+				c_row[col] += product[std::size_t(row) * c.cols + col];
+			}
+		}
+	}
+}
+
+
+/*
+ * c = alpha * op(a) * op(b) + beta * c, where op transposes its operand when
+ * asked. Tiles of c are computed in parallel; c must not overlap a or b.
+ */
+template <typename T>
+void gemm(
+	T alpha, strided_block<const T> a, bool transpose_a, strided_block<const T> b, bool transpose_b,
+	T beta, const strided_block<T>& c, const parallel_options& options
+) {
+	namespace blocking = gemm_blocking;
+	unsigned depth = transpose_a ? a.rows : a.cols;
+
+	scale_block(c, beta, options);
+	if(c.rows == 0  ||  c.cols == 0  ||  depth == 0  ||  alpha == T(0)) {
+		return;
+	}
+	if(c.rows <= blocking::mc  &&  c.cols <= blocking::task_cols  &&  depth > 8 * blocking::kc) {
+		gemm_split_depth(alpha, a, transpose_a, b, transpose_b, c, depth, options);
+		return;
+	}
+
+	std::vector<T, default_init_allocator<T>> packed_b(std::size_t(blocking::kc) * (std::min(blocking::nc, c.cols) + blocking::nr));
+	for(unsigned first_col = 0; first_col < c.cols; first_col += blocking::nc) {
+		unsigned panel_cols = std::min(blocking::nc, c.cols - first_col);
+		for(unsigned first_k = 0; first_k < depth; first_k += blocking::kc) {
+			unsigned panel_depth = std::min(blocking::kc, depth - first_k);
+			pack_b(b, transpose_b, first_k, first_col, panel_depth, panel_cols, packed_b.data());
+
+			unsigned row_blocks = (c.rows + blocking::mc - 1) / blocking::mc;
+			unsigned col_blocks = (panel_cols + blocking::task_cols - 1) / blocking::task_cols;
+			std::size_t work_per_tile = std::size_t(std::min(blocking::mc, c.rows)) * panel_depth
+			                          * std::min(blocking::task_cols, panel_cols);
+
+			parallel_for(0, std::size_t(row_blocks) * col_blocks, work_per_tile, [&](std::size_t first, std::size_t last) {
+				std::vector<T, default_init_allocator<T>> packed_a(std::size_t(blocking::mc + blocking::mr) * panel_depth);
+				unsigned packed_row_block = ~0u;
+
+				// Tiles go along rows of blocks, so consecutive ones reuse the packed block of a
+				for(std::size_t tile = first; tile < last; ++tile) {
+					unsigned row_block = tile / col_blocks;
+					unsigned col_block = tile % col_blocks;
+					unsigned first_row = row_block * blocking::mc;
+					unsigned block_rows = std::min(blocking::mc, c.rows - first_row);
+					if(row_block != packed_row_block) {
+						pack_a(a, transpose_a, first_row, first_k, block_rows, panel_depth, packed_a.data());
+						packed_row_block = row_block;
+					}
+
+					unsigned tile_first_col = col_block * blocking::task_cols;
+					unsigned tile_cols = std::min(blocking::task_cols, panel_cols - tile_first_col);
+					gemm_macro_kernel(
+						panel_depth, alpha,
+						packed_a.data(), packed_b.data() + std::size_t(tile_first_col) * panel_depth,
+						c.block(first_row, first_col + tile_first_col, block_rows, tile_cols)
+					);
+				}
+			}, options);
+		}
+	}
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * c = alpha * a * b + beta * c, with a blocked kernel that runs on the
+ * threads of the execution context. c may be a region reference, but must
+ * not overlap a or b. Operands without contiguous rows are copied first.
+ */
+template <typename MC, typename MA, typename MB>
+void multiply_into(
+	MC&& c, const matrix<MA>& a, const matrix<MB>& b,
+	typename std::remove_const<typename MA::element_type>::type alpha = 1,
+	typename std::remove_const<typename MA::element_type>::type beta = 0,
+	const parallel_options& options = parallel_options()
+) {
+	using T = typename std::remove_const<typename MA::element_type>::type;
+	static_assert(std::is_same<T, typename std::remove_const<typename MB::element_type>::type>::value,
+	              "Both factors must have the same element type");
+
+	if(cols(a) != rows(b)) {
+		throw incompatible_operands(a, "*", b);
+	}
+	if(rows(c) != rows(a)  ||  cols(c) != cols(b)) {
+		throw incompatible_operands(shape_mismatch{
+			__impl::describe_operand(c), "=",
+			operand_shape{ operand_kind::dynamic_matrix, rows(a), cols(b) }
+		});
+	}
+
+	dmatrix<T> a_copy(0, 0);
+	dmatrix<T> b_copy(0, 0);
+	__impl::gemm(
+		alpha, __impl::dense_view(a, a_copy), false, __impl::dense_view(b, b_copy), false,
+		beta, __impl::strided(c), options
+	);
+}
+
+
+// The product a * b as a new dmatrix
+template <typename MA, typename MB>
+dmatrix<typename std::remove_const<typename MA::element_type>::type>
+multiply(const matrix<MA>& a, const matrix<MB>& b, const parallel_options& options = parallel_options()) {
+	using T = typename std::remove_const<typename MA::element_type>::type;
+	if(cols(a) != rows(b)) {
+		throw incompatible_operands(a, "*", b);
+	}
+	dmatrix<T> c(rows(a), cols(b), uninitialized);
+	multiply_into(c, a, b, T(1), T(0), options);
+	return c;
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* GEMM_HPP_ */
@@ -0,0 +1,132 @@
+#ifndef HEAP_ARRAY_HPP_
+#define HEAP_ARRAY_HPP_
+
+#include "compat.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+
+namespace matrix {
+
+
+/*
+ * A fixed-size array whose elements live in an aligned heap buffer, with the
+ * same interface as safely_constructed_array. Moving only moves the buffer
+ * pointer. A moved-from array reads as default elements and gets a new
+ * buffer of them the first time one is accessed for writing, so a
+ * moved-from smatrix still has the elements its shape promises.
+ */
+template <typename T, unsigned Size>
+class heap_array {
+public:
+	using value_type = T;
+	enum { size = Size };
+
+	// Elements start at a cache line boundary
+	static constexpr std::size_t alignment = alignof(T) > 64 ? alignof(T) : 64;
+
+	heap_array()
+		: heap_array(
+			[](unsigned) {
+				return T();
+			}
+		)
+	{}
+
+	heap_array(const heap_array& other)
+		: heap_array(
+			[&](unsigned index) -> const T& {
+				return other[index];
+			}
+		)
+	{}
+
+	heap_array(heap_array&& other) noexcept
+		: values(other.values)
+	{
+		other.values = nullptr;
+	}
+
+	template <typename P>
+	explicit heap_array(P provider)
+		: values(allocate())
+	{
+		unsigned index;
+		try {
+			for(index = 0; index < Size; ++index) {
+				::new(static_cast<void*>(values + index)) T(provider(index));
+			}
+		} catch(...) {
+			destruct(index);
+			std::free(values);
+			throw;
+		}
+	}
+
+	~heap_array() {
+		if(values) {
+			destruct(Size);
+			std::free(values);
+		}
+	}
+
+	heap_array& operator=(const heap_array& other) & {
+		if(!values) {
+			return *this = heap_array(other);
+		}
+		for(unsigned index = 0; index < Size; ++index) {
+			values[index] = other[index];
+		}
+		return *this;
+	}
+
+	heap_array& operator=(heap_array&& other) & noexcept {
+		std::swap(values, other.values);
+		return *this;
+	}
+
+	T& operator[](unsigned index) {
+		return (values ? values : refill())[index];
+	}
+
+	const T& operator[](unsigned index) const {
+		return values ? values[index] : default_element();
+	}
+
+private:
+	// Null once moved from, until an element is written
+	T* values;
+
+	MATRIX_COLD T* refill() {
+		heap_array fresh;
+		std::swap(values, fresh.values);
+		return values;
+	}
+
+	static const T& default_element() {
+		static const T element{};
+		return element;
+	}
+
+	static T* allocate() {
+		void* buffer = nullptr;
+		if(::posix_memalign(&buffer, alignment, sizeof(T) * std::size_t(Size)) != 0) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(buffer);
+	}
+
+	void destruct(unsigned count) {
+		while(count > 0) {
+			values[--count].~T();
+		}
+	}
+};
+
+
+} /* namespace matrix */
+
+
+#endif /* HEAP_ARRAY_HPP_ */
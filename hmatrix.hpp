@@ -0,0 +1,247 @@
+#ifndef HMATRIX_HPP_
+#define HMATRIX_HPP_
+
+#include "matrix.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+
+namespace matrix {
+
+
+// Marks an extent of an hmatrix as known only at run time
+constexpr unsigned dynamic_extent = ~0u;
+
+
+namespace __impl {
+
+
+// Whether two extents may describe the same dimension: static ones must agree
+constexpr bool extents_compatible(unsigned lhs, unsigned rhs) {
+	return lhs == dynamic_extent  ||  rhs == dynamic_extent  ||  lhs == rhs;
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * A dynamic_matrix whose extents may each be fixed at compile time, as in
+ * hmatrix<double, dynamic_extent, 3> for any number of 3-column rows. Static
+ * extents are constants wherever rows() or cols() is used, so loops over them
+ * unroll, and mismatches between static extents are compile-time errors.
+ */
+template <typename T, unsigned Rows, unsigned Cols>
+class hmatrix : public dynamic_matrix<hmatrix<T, Rows, Cols>> {
+private:
+	using rows_reference = dmatrix_rows_reference<hmatrix>;
+	using const_rows_reference = const dmatrix_rows_reference<const hmatrix>;
+
+public:
+	using element_type = T;
+
+	static constexpr unsigned static_rows = Rows;
+	static constexpr unsigned static_cols = Cols;
+
+	hmatrix() = delete;
+
+	hmatrix(const hmatrix&) = default;
+
+	hmatrix(hmatrix&& other) noexcept
+		: _rows(other._rows), _cols(other._cols),
+		  elements(std::move(other.elements))
+	{
+		other._rows = 0;
+		other._cols = 0;
+	}
+
+	// Static extents must be given their declared value
+	hmatrix(unsigned rows, unsigned cols)
+		: hmatrix(rows, cols, uninitialized)
+	{
+		std::fill(elements.begin(), elements.end(), T());
+	}
+
+	// Elements are default-initialized, so trivial ones are left uninitialized
+	hmatrix(unsigned rows, unsigned cols, uninitialized_t)
+		: _rows(rows), _cols(cols),
+		  elements(std::size_t(rows) * cols)
+	{
+		if(!accepts_shape(rows, cols)) {
+			throw std::invalid_argument("The shape does not match the static extents of the hmatrix");
+		}
+	}
+
+	// Dynamic extents are taken from the values; missing values are filled with T()
+	hmatrix(std::initializer_list<std::initializer_list<T>> values)
+		: hmatrix(
+			Rows != dynamic_extent ? Rows : values.size(),
+			Cols != dynamic_extent ? Cols : largest_row_size(values),
+			uninitialized
+		)
+	{
+		if(values.size() > _rows  ||  largest_row_size(values) > _cols) {
+			throw std::invalid_argument("The values exceed the static extents of the hmatrix");
+		}
+
+		std::fill(elements.begin(), elements.end(), T());
+		unsigned row = 0;
+		for(const auto& row_values : values) {
+			std::copy(row_values.begin(), row_values.end(), elements.begin() + to_linear_index(row, 0));
+			++row;
+		}
+	}
+
+	template <typename M>
+	explicit hmatrix(const matrix<M>& m)
+		: hmatrix(::matrix::rows(m), ::matrix::cols(m), uninitialized)
+	{
+		for(unsigned row = 0; row < rows(); ++row) {
+			for(unsigned col = 0; col < cols(); ++col) {
+				element_at(row, col) = ::matrix::element_at(m, row, col);
+			}
+		}
+	}
+
+	~hmatrix() = default;
+
+	unsigned rows() const noexcept { return Rows != dynamic_extent ? Rows : _rows; }
+
+	unsigned cols() const noexcept { return Cols != dynamic_extent ? Cols : _cols; }
+
+	hmatrix& operator=(const hmatrix&) & = default;
+
+	hmatrix& operator=(hmatrix&& other) & noexcept {
+		std::swap(_rows, other._rows);
+		std::swap(_cols, other._cols);
+		elements.swap(other.elements);
+		return *this;
+	}
+
+	T& element_at(unsigned row, unsigned col) noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, rows(), cols());
+		return elements[to_linear_index(row, col)];
+	}
+
+	const T& element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, rows(), cols());
+		return elements[to_linear_index(row, col)];
+	}
+
+	// The elements in row-major order
+	T* data() noexcept { return elements.data(); }
+
+	const T* data() const noexcept { return elements.data(); }
+
+	rows_reference operator[](unsigned row) {
+		return { *this, 1, cols(), row, 0 };
+	}
+
+	const_rows_reference operator[](unsigned row) const {
+		return { *this, 1, cols(), row, 0 };
+	}
+
+	rows_reference operator[](drange row_range) {
+		return { *this, row_range.size, cols(), row_range.first, 0 };
+	}
+
+	const_rows_reference operator[](drange row_range) const {
+		return { *this, row_range.size, cols(), row_range.first, 0 };
+	}
+
+	rows_reference operator[](all_t) {
+		return { *this, rows(), cols(), 0, 0 };
+	}
+
+	const_rows_reference operator[](all_t) const {
+		return { *this, rows(), cols(), 0, 0 };
+	}
+
+private:
+	unsigned _rows;
+	unsigned _cols;
+	std::vector<T, __impl::default_init_allocator<T>> elements;
+
+	std::size_t to_linear_index(unsigned row, unsigned col) const noexcept {
+		return std::size_t(row) * cols() + col;
+	}
+
+	static bool accepts_shape(unsigned rows, unsigned cols) noexcept {
+		return (Rows == dynamic_extent  ||  rows == Rows)
+		    && (Cols == dynamic_extent  ||  cols == Cols);
+	}
+
+	static unsigned largest_row_size(std::initializer_list<std::initializer_list<T>> values) {
+		std::size_t largest = 0;
+		for(const auto& row_values : values) {
+			largest = std::max(largest, row_values.size());
+		}
+		return largest;
+	}
+};
+
+
+template <typename T, unsigned Rows, unsigned Cols>
+struct has_contiguous_rows<hmatrix<T, Rows, Cols>> : std::true_type {};
+
+
+template <unsigned RowsL, unsigned ColsL, unsigned RowsR, unsigned ColsR>
+inline void static_assert_extents_compatible() {
+	static_assert(__impl::extents_compatible(RowsL, RowsR)  &&  __impl::extents_compatible(ColsL, ColsR),
+	              "The static extents of both matrices must agree for this operation");
+}
+
+
+/*
+ * Comparisons with another hmatrix or an smatrix check the static extents at
+ * compile time; only the dynamic ones are left to check at run time.
+ */
+template <typename TL, unsigned RowsL, unsigned ColsL, typename TR, unsigned RowsR, unsigned ColsR>
+inline
+bool operator==(const hmatrix<TL, RowsL, ColsL>& lhs, const hmatrix<TR, RowsR, ColsR>& rhs) {
+	static_assert_extents_compatible<RowsL, ColsL, RowsR, ColsR>();
+	incompatible_operands::throw_if_not_same_shape(lhs, "==", rhs);
+	return equal_to(lhs, rhs);
+}
+
+template <typename TL, unsigned RowsL, unsigned ColsL, typename TR, unsigned RowsR, unsigned ColsR>
+inline
+bool operator==(const hmatrix<TL, RowsL, ColsL>& lhs, const smatrix<TR, RowsR, ColsR>& rhs) {
+	static_assert_extents_compatible<RowsL, ColsL, RowsR, ColsR>();
+	incompatible_operands::throw_if_not_same_shape(lhs, "==", rhs);
+	return equal_to(lhs, rhs);
+}
+
+template <typename TL, unsigned RowsL, unsigned ColsL, typename TR, unsigned RowsR, unsigned ColsR>
+inline
+bool operator==(const smatrix<TL, RowsL, ColsL>& lhs, const hmatrix<TR, RowsR, ColsR>& rhs) {
+	return rhs == lhs;
+}
+
+
+template <typename TL, unsigned RowsL, unsigned ColsL, typename TR, unsigned RowsR, unsigned ColsR>
+inline
+bool operator!=(const hmatrix<TL, RowsL, ColsL>& lhs, const hmatrix<TR, RowsR, ColsR>& rhs) {
+	return !(lhs == rhs);
+}
+
+template <typename TL, unsigned RowsL, unsigned ColsL, typename TR, unsigned RowsR, unsigned ColsR>
+inline
+bool operator!=(const hmatrix<TL, RowsL, ColsL>& lhs, const smatrix<TR, RowsR, ColsR>& rhs) {
+	return !(lhs == rhs);
+}
+
+template <typename TL, unsigned RowsL, unsigned ColsL, typename TR, unsigned RowsR, unsigned ColsR>
+inline
+bool operator!=(const smatrix<TL, RowsL, ColsL>& lhs, const hmatrix<TR, RowsR, ColsR>& rhs) {
+	return !(lhs == rhs);
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* HMATRIX_HPP_ */
@@ -0,0 +1,628 @@
+#ifndef KRYLOV_HPP_
+#define KRYLOV_HPP_
+
+#include "matrix.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+#include "sparse.hpp"
+#include "structured.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+
+namespace matrix {
+
+
+struct iterative_options {
+	// Stop once the norm of b - A * x is at most this fraction of the norm of b
+	double tolerance = 1e-8;
+	unsigned max_iterations = 1000;
+	// Basis vectors GMRES keeps before restarting, each as long as x
+	unsigned restart = 30;
+};
+
+
+template <typename T>
+struct iterative_result {
+	unsigned iterations;
+	// The norm of b - A * x relative to that of b
+	T relative_residual;
+	bool converged;
+};
+
+
+// The default: residuals are used as they are, without even a copy
+struct identity_preconditioner {};
+
+
+/*
+ * Scales residuals by the inverse of the diagonal of A. Like any
+ * preconditioner, it is called as p(r, z) to store an approximation of
+ * inverse(A) * r into z.
+ */
+template <typename T>
+class jacobi_preconditioner {
+public:
+	template <typename M>
+	explicit jacobi_preconditioner(const matrix<M>& a)
+		: _inverse_diagonal(rows(a))
+	{
+		if(rows(a) != cols(a)) {
+			throw std::invalid_argument("Only square matrices have a Jacobi preconditioner");
+		}
+		for(unsigned index = 0; index < rows(a); ++index) {
+			T element = element_at(a, index, index);
+			if(element == T(0)) {
+				throw std::domain_error("A diagonal element is zero");
+			}
+			_inverse_diagonal[index] = T(1) / element;
+		}
+	}
+
+	void operator()(const T* r, T* z) const {
+		for(std::size_t index = 0; index < _inverse_diagonal.size(); ++index) {
+			z[index] = _inverse_diagonal[index] * r[index];
+		}
+	}
+
+private:
+	std::vector<T> _inverse_diagonal;
+};
+
+
+/*
+ * Incomplete LU factorization with no fill: L * U matches A on the
+ * nonzeros of A, and both keep its sparsity pattern, with L's unit diagonal
+ * implied. Applying it is a forward and a backward substitution.
+ */
+template <typename T>
+class ilu0_preconditioner {
+public:
+	explicit ilu0_preconditioner(const csr_matrix<T>& a)
+		: _row_offsets(a.row_offsets()), _col_indices(a.col_indices()), _values(a.values()),
+		  _diagonal(a.rows())
+	{
+		if(a.rows() != a.cols()) {
+			throw std::invalid_argument("Only square matrices have an ILU(0) preconditioner");
+		}
+
+		// Where each column of the row being factored is stored, if anywhere
+		constexpr std::size_t absent = std::numeric_limits<std::size_t>::max();
+		std::vector<std::size_t> positions(a.cols(), absent);
+
+		for(unsigned row = 0; row < a.rows(); ++row) {
+			std::size_t first = _row_offsets[row];
+			std::size_t last = _row_offsets[row + 1];
+			for(std::size_t at = first; at < last; ++at) {
+				positions[_col_indices[at]] = at;
+			}
+
+			std::size_t at = first;
+			for(; at < last  &&  _col_indices[at] < row; ++at) {
+				unsigned col = _col_indices[at];
+				T factor = _values[at] /= _values[_diagonal[col]];
+				for(std::size_t above = _diagonal[col] + 1; above < _row_offsets[col + 1]; ++above) {
+					std::size_t target = positions[_col_indices[above]];
+					if(target != absent) {
+						_values[target] -= factor * _values[above];
+					}
+				}
+			}
+			if(at == last  ||  _col_indices[at] != row  ||  _values[at] == T(0)) {
+				throw std::domain_error("A pivot of the incomplete factorization is zero");
+			}
+			_diagonal[row] = at;
+
+			for(std::size_t at = first; at < last; ++at) {
+				positions[_col_indices[at]] = absent;
+			}
+		}
+	}
+
+	void operator()(const T* r, T* z) const {
+		unsigned n = _diagonal.size();
+		for(unsigned row = 0; row < n; ++row) {
+			T sum = r[row];
+			for(std::size_t at = _row_offsets[row]; at < _diagonal[row]; ++at) {
+				sum -= _values[at] * z[_col_indices[at]];
+			}
+			z[row] = sum;
+		}
+		for(unsigned row = n; row-- > 0;) {
+			T sum = z[row];
+			for(std::size_t at = _diagonal[row] + 1; at < _row_offsets[row + 1]; ++at) {
+				sum -= _values[at] * z[_col_indices[at]];
+			}
+			z[row] = sum / _values[_diagonal[row]];
+		}
+	}
+
+private:
+	std::vector<std::size_t> _row_offsets;
+	std::vector<unsigned> _col_indices;
+	std::vector<T> _values;
+	// Where the diagonal element of each row is stored
+	std::vector<std::size_t> _diagonal;
+};
+
+
+namespace __impl {
+
+
+// Elements of the vectors each task of the vector passes goes through at once
+constexpr std::size_t krylov_block_size = 8192;
+
+
+/*
+ * Runs pass(first, last, sums) over fixed blocks of vector elements,
+ * possibly in parallel, and adds up the count sums of each block in block
+ * order, so that results do not depend on the number of threads. The
+ * partial sums are allocated once, for the largest count asked for.
+ */
+template <typename T>
+class block_sums {
+public:
+	block_sums(std::size_t size, unsigned max_count)
+		: _size(size), _blocks((size + krylov_block_size - 1) / krylov_block_size),
+		  _partials(std::max<std::size_t>(_blocks, 1) * max_count, T(0))
+	{}
+
+	template <typename Pass>
+	const T* operator()(unsigned count, Pass pass, const parallel_options& options) {
+		parallel_for(0, _blocks, krylov_block_size * std::max(count, 1u), [&](std::size_t first, std::size_t last) {
+			for(std::size_t block = first; block < last; ++block) {
+				T* sums = _partials.data() + block * count;
+				std::fill_n(sums, count, T(0));
+				std::size_t begin = block * krylov_block_size;
+				pass(begin, std::min(_size, begin + krylov_block_size), sums);
+			}
+		}, options);
+
+		for(std::size_t block = 1; block < _blocks; ++block) {
+			for(unsigned index = 0; index < count; ++index) {
+				_partials[index] += _partials[block * count + index];
+			}
+		}
+		return _partials.data();
+	}
+
+	// Calls pass(first, last) when there is nothing to sum
+	template <typename Pass>
+	void for_each(Pass pass, const parallel_options& options) {
+		(*this)(0, [&](std::size_t first, std::size_t last, T*) { pass(first, last); }, options);
+	}
+
+	T dot(const T* x, const T* y, const parallel_options& options) {
+		return (*this)(1, [&](std::size_t first, std::size_t last, T* sums) {
+			*sums = dot_product(x + first, y + first, last - first);
+		}, options)[0];
+	}
+
+private:
+	std::size_t _size;
+	std::size_t _blocks;
+	std::vector<T> _partials;
+};
+
+
+template <typename T, typename P>
+void precondition(const P& preconditioner, const T* r, T* z) {
+	preconditioner(r, z);
+}
+
+template <typename T>
+void precondition(const identity_preconditioner&, const T*, T*) {}
+
+
+template <typename T, typename M>
+void throw_if_not_operator_of(const matrix<M>& a, const dmatrix<T>& b) {
+	if(rows(a) != cols(a)  ||  rows(a) != b.rows()) {
+		throw incompatible_operands(a, "solve", b);
+	}
+}
+
+// Functors are trusted to apply to vectors as long as b
+template <typename T, typename F>
+typename std::enable_if<!std::is_base_of<matrix<F>, F>::value>::type
+throw_if_not_operator_of(const F&, const dmatrix<T>&) {}
+
+
+template <typename T, typename Op>
+void throw_if_not_iterative_operands(const dmatrix<T>& x, const Op& a, const dmatrix<T>& b) {
+	if(b.cols() != 1  ||  x.rows() != b.rows()  ||  x.cols() != 1) {
+		throw incompatible_operands(x, "solve", b);
+	}
+	throw_if_not_operator_of(a, b);
+}
+
+
+// The vector elements of a column of n elements, or nullptr when empty
+template <typename T>
+T* vector_data(dmatrix<T>& v) {
+	return strided(v).data;
+}
+
+template <typename T>
+const T* vector_data(const dmatrix<T>& v) {
+	return strided(v).data;
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * Preconditioned conjugate gradient for a symmetric positive definite A,
+ * starting from the x given and leaving the solution of A * x = b in it.
+ * A is a dense or sparse matrix, a structured view applied through its
+ * structure, or a functor called as a(x, y) to store A * x into y. Each
+ * iteration applies A and the preconditioner once and makes three fused
+ * passes over the vectors, which are allocated upfront.
+ */
+template <typename Op, typename T, typename P = identity_preconditioner>
+iterative_result<T> conjugate_gradient_into(
+	dmatrix<T>& x, const Op& a, const dmatrix<T>& b,
+	const P& preconditioner = P(),
+	const iterative_options& settings = iterative_options(),
+	const parallel_options& options = parallel_options()
+) {
+	__impl::throw_if_not_iterative_operands(x, a, b);
+	constexpr bool preconditioned = !std::is_same<P, identity_preconditioner>::value;
+	std::size_t n = b.rows();
+	if(n == 0) {
+		return { 0, T(0), true };
+	}
+
+	// Without a preconditioner, z is r itself
+	std::vector<T> r(n), p(n), q(n), z(preconditioned ? n : 0), scratch(__impl::operator_scratch_size(a));
+	T* xs = __impl::vector_data(x);
+	const T* bs = __impl::vector_data(b);
+	T* zs = preconditioned ? z.data() : r.data();
+	__impl::block_sums<T> sums(n, 1);
+
+	T b_norm = std::sqrt(sums.dot(bs, bs, options));
+	if(b_norm == T(0)) {
+		std::fill_n(xs, n, T(0));
+		return { 0, T(0), true };
+	}
+	T target = T(settings.tolerance) * b_norm;
+
+	__impl::apply_operator(a, xs, q.data(), scratch.data(), options);
+	T rr = sums(1, [&](std::size_t first, std::size_t last, T* sum) {
+		for(std::size_t index = first; index < last; ++index) {
+			r[index] = bs[index] - q[index];
+		}
+		*sum = __impl::dot_product(&r[first], &r[first], last - first);
+	}, options)[0];
+	__impl::precondition(preconditioner, r.data(), zs);
+	T rz = preconditioned ? sums.dot(r.data(), zs, options) : rr;
+	std::copy_n(zs, n, p.data());
+
+	unsigned iteration = 0;
+	while(std::sqrt(rr) > target  &&  iteration < settings.max_iterations) {
+		__impl::apply_operator(a, p.data(), q.data(), scratch.data(), options);
+		T pq = sums.dot(p.data(), q.data(), options);
+		if(!(pq > T(0))) {
+			throw std::domain_error("The operator is not positive definite");
+		}
+
+		T alpha = rz / pq;
+		rr = sums(1, [&](std::size_t first, std::size_t last, T* sum) {
+			for(std::size_t index = first; index < last; ++index) {
+				xs[index] += alpha * p[index];
+				r[index] -= alpha * q[index];
+			}
+			*sum = __impl::dot_product(&r[first], &r[first], last - first);
+		}, options)[0];
+		++iteration;
+		if(std::sqrt(rr) <= target) {
+			break;
+		}
+
+		__impl::precondition(preconditioner, r.data(), zs);
+		T next_rz = preconditioned ? sums.dot(r.data(), zs, options) : rr;
+		T beta = next_rz / rz;
+		rz = next_rz;
+		sums.for_each([&](std::size_t first, std::size_t last) {
+			for(std::size_t index = first; index < last; ++index) {
+				p[index] = zs[index] + beta * p[index];
+			}
+		}, options);
+	}
+
+	return { iteration, std::sqrt(rr) / b_norm, std::sqrt(rr) <= target };
+}
+
+
+/*
+ * Restarted GMRES for any nonsingular A, preconditioned on the right so
+ * that the residual it minimizes is that of the original system. A new
+ * basis vector is orthogonalized by classical Gram-Schmidt, so that each
+ * pass reads the basis once, whatever its size; a second pass subtracts
+ * what rounding left and runs a third only when the first cancelled most
+ * of the vector. Iterations count the basis vectors built, and the
+ * residual reported is recomputed from x at the end.
+ */
+template <typename Op, typename T, typename P = identity_preconditioner>
+iterative_result<T> gmres_into(
+	dmatrix<T>& x, const Op& a, const dmatrix<T>& b,
+	const P& preconditioner = P(),
+	const iterative_options& settings = iterative_options(),
+	const parallel_options& options = parallel_options()
+) {
+	__impl::throw_if_not_iterative_operands(x, a, b);
+	constexpr bool preconditioned = !std::is_same<P, identity_preconditioner>::value;
+	std::size_t n = b.rows();
+	if(n == 0) {
+		return { 0, T(0), true };
+	}
+
+	unsigned m = std::max(settings.restart, 1u);
+	// Row j of hessenberg is column j of the Hessenberg matrix, rotated to upper triangular
+	dmatrix<T> basis(m + 1, n, uninitialized), hessenberg(m, m + 1);
+	std::vector<T> w(preconditioned ? n : 0), cosines(m), sines(m), g(m + 1), coefficients(m + 1);
+	std::vector<T> scratch(__impl::operator_scratch_size(a));
+	T* xs = __impl::vector_data(x);
+	const T* bs = __impl::vector_data(b);
+	auto v = [&](unsigned index) { return &basis.element_at(index, 0); };
+	__impl::block_sums<T> sums(n, m + 2);
+
+	T b_norm = std::sqrt(sums.dot(bs, bs, options));
+	if(b_norm == T(0)) {
+		std::fill_n(xs, n, T(0));
+		return { 0, T(0), true };
+	}
+	T target = T(settings.tolerance) * b_norm;
+
+	unsigned iteration = 0;
+	for(;;) {
+		T* r = v(0);
+		__impl::apply_operator(a, xs, r, scratch.data(), options);
+		T residual = std::sqrt(sums(1, [&](std::size_t first, std::size_t last, T* sum) {
+			for(std::size_t index = first; index < last; ++index) {
+				r[index] = bs[index] - r[index];
+			}
+			*sum = __impl::dot_product(r + first, r + first, last - first);
+		}, options)[0]);
+		if(residual <= target  ||  iteration >= settings.max_iterations) {
+			return { iteration, residual / b_norm, residual <= target };
+		}
+
+		T inverse = T(1) / residual;
+		sums.for_each([&](std::size_t first, std::size_t last) {
+			for(std::size_t index = first; index < last; ++index) {
+				r[index] *= inverse;
+			}
+		}, options);
+		std::fill(g.begin(), g.end(), T(0));
+		g[0] = residual;
+
+		unsigned size = 0;
+		while(size < m  &&  iteration < settings.max_iterations) {
+			T* next = v(size + 1);
+			T* h = &hessenberg.element_at(size, 0);
+			if(preconditioned) {
+				__impl::precondition(preconditioner, v(size), w.data());
+				__impl::apply_operator(a, w.data(), next, scratch.data(), options);
+			} else {
+				__impl::apply_operator(a, v(size), next, scratch.data(), options);
+			}
+
+			// Subtracts the projections a previous pass found, if any, then finds those left and the norm
+			unsigned count = size + 1;
+			auto project = [&](const T* previous) {
+				return sums(count + 1, [&](std::size_t first, std::size_t last, T* sum) {
+					for(unsigned index = 0; previous  &&  index < count; ++index) {
+						const T* basis_vector = v(index);
+						for(std::size_t element = first; element < last; ++element) {
+							next[element] -= previous[index] * basis_vector[element];
+						}
+					}
+					for(unsigned index = 0; index < count; ++index) {
+						sum[index] = __impl::dot_product(v(index) + first, next + first, last - first);
+					}
+					sum[count] = __impl::dot_product(next + first, next + first, last - first);
+				}, options);
+			};
+			std::copy_n(project(nullptr), count + 1, h);
+			T norm_before = std::sqrt(h[count]);
+			const T* projections = project(h);
+			T norm = std::sqrt(projections[count]);
+			// Only when cancellation left much of the vector along the basis does a second round pay off
+			if(norm < norm_before * T(0.7071)) {
+				std::copy_n(projections, count, coefficients.data());
+				norm = std::sqrt(project(coefficients.data())[count]);
+				for(unsigned index = 0; index < count; ++index) {
+					h[index] += coefficients[index];
+				}
+			}
+			h[count] = norm;
+			if(norm != T(0)) {
+				T inverse = T(1) / norm;
+				sums.for_each([&](std::size_t first, std::size_t last) {
+					for(std::size_t index = first; index < last; ++index) {
+						next[index] *= inverse;
+					}
+				}, options);
+			}
+
+			// The previous rotations, then one zeroing the new subdiagonal element
+			for(unsigned index = 0; index < size; ++index) {
+				T upper = h[index];
+				h[index] = cosines[index] * upper + sines[index] * h[index + 1];
+				h[index + 1] = cosines[index] * h[index + 1] - sines[index] * upper;
+			}
+			T diagonal = std::hypot(h[size], norm);
+			if(diagonal == T(0)) {
+				throw std::domain_error("The operator is singular");
+			}
+			cosines[size] = h[size] / diagonal;
+			sines[size] = norm / diagonal;
+			h[size] = diagonal;
+			h[count] = T(0);
+			g[count] = -sines[size] * g[size];
+			g[size] *= cosines[size];
+
+			size = count;
+			++iteration;
+			// A zero norm means the basis spans the solution
+			if(std::abs(g[size]) <= target  ||  norm == T(0)) {
+				break;
+			}
+		}
+
+		// The coefficients of the basis vectors in the correction, into g
+		for(unsigned index = size; index-- > 0;) {
+			T sum = g[index];
+			for(unsigned col = index + 1; col < size; ++col) {
+				sum -= hessenberg.element_at(col, index) * g[col];
+			}
+			g[index] = sum / hessenberg.element_at(index, index);
+		}
+
+		// The last basis vector does not take part, so it holds the correction
+		T* correction = v(size);
+		sums.for_each([&](std::size_t first, std::size_t last) {
+			std::fill(correction + first, correction + last, T(0));
+			for(unsigned index = 0; index < size; ++index) {
+				const T* basis_vector = v(index);
+				for(std::size_t element = first; element < last; ++element) {
+					correction[element] += g[index] * basis_vector[element];
+				}
+			}
+			if(!preconditioned) {
+				for(std::size_t element = first; element < last; ++element) {
+					xs[element] += correction[element];
+				}
+			}
+		}, options);
+		if(preconditioned) {
+			__impl::precondition(preconditioner, correction, w.data());
+			sums.for_each([&](std::size_t first, std::size_t last) {
+				for(std::size_t element = first; element < last; ++element) {
+					xs[element] += w[element];
+				}
+			}, options);
+		}
+	}
+}
+
+
+/*
+ * BiCGSTAB for any nonsingular A, preconditioned on the right. Each
+ * iteration applies A and the preconditioner twice and makes five fused
+ * passes over the vectors. It stops early, without converging, if the
+ * method breaks down.
+ */
+template <typename Op, typename T, typename P = identity_preconditioner>
+iterative_result<T> bicgstab_into(
+	dmatrix<T>& x, const Op& a, const dmatrix<T>& b,
+	const P& preconditioner = P(),
+	const iterative_options& settings = iterative_options(),
+	const parallel_options& options = parallel_options()
+) {
+	__impl::throw_if_not_iterative_operands(x, a, b);
+	constexpr bool preconditioned = !std::is_same<P, identity_preconditioner>::value;
+	std::size_t n = b.rows();
+	if(n == 0) {
+		return { 0, T(0), true };
+	}
+
+	// r also holds s, the residual halfway through an iteration
+	std::vector<T> r(n), shadow(n), p(n, T(0)), v(n, T(0)), t(n);
+	std::vector<T> preconditioned_p(preconditioned ? n : 0), preconditioned_s(preconditioned ? n : 0);
+	std::vector<T> scratch(__impl::operator_scratch_size(a));
+	T* xs = __impl::vector_data(x);
+	const T* bs = __impl::vector_data(b);
+	T* p_hat = preconditioned ? preconditioned_p.data() : p.data();
+	T* s_hat = preconditioned ? preconditioned_s.data() : r.data();
+	__impl::block_sums<T> sums(n, 2);
+
+	T b_norm = std::sqrt(sums.dot(bs, bs, options));
+	if(b_norm == T(0)) {
+		std::fill_n(xs, n, T(0));
+		return { 0, T(0), true };
+	}
+	T target = T(settings.tolerance) * b_norm;
+
+	__impl::apply_operator(a, xs, t.data(), scratch.data(), options);
+	T residual = std::sqrt(sums(1, [&](std::size_t first, std::size_t last, T* sum) {
+		for(std::size_t index = first; index < last; ++index) {
+			shadow[index] = r[index] = bs[index] - t[index];
+		}
+		*sum = __impl::dot_product(&r[first], &r[first], last - first);
+	}, options)[0]);
+	T rho_next = residual * residual;
+	T rho(1), alpha(1), omega(1);
+
+	unsigned iteration = 0;
+	while(residual > target  &&  iteration < settings.max_iterations  &&  rho_next != T(0)) {
+		T beta = (rho_next / rho) * (alpha / omega);
+		rho = rho_next;
+		sums.for_each([&](std::size_t first, std::size_t last) {
+			for(std::size_t index = first; index < last; ++index) {
+				p[index] = r[index] + beta * (p[index] - omega * v[index]);
+			}
+		}, options);
+		__impl::precondition(preconditioner, p.data(), p_hat);
+		__impl::apply_operator(a, p_hat, v.data(), scratch.data(), options);
+
+		T shadow_v = sums.dot(shadow.data(), v.data(), options);
+		if(shadow_v == T(0)) {
+			break;
+		}
+		alpha = rho / shadow_v;
+		T s_norm = std::sqrt(sums(1, [&](std::size_t first, std::size_t last, T* sum) {
+			for(std::size_t index = first; index < last; ++index) {
+				r[index] -= alpha * v[index];
+			}
+			*sum = __impl::dot_product(&r[first], &r[first], last - first);
+		}, options)[0]);
+		++iteration;
+
+		if(s_norm <= target) {
+			sums.for_each([&](std::size_t first, std::size_t last) {
+				for(std::size_t index = first; index < last; ++index) {
+					xs[index] += alpha * p_hat[index];
+				}
+			}, options);
+			residual = s_norm;
+			break;
+		}
+
+		__impl::precondition(preconditioner, r.data(), s_hat);
+		__impl::apply_operator(a, s_hat, t.data(), scratch.data(), options);
+		const T* products = sums(2, [&](std::size_t first, std::size_t last, T* sum) {
+			sum[0] = __impl::dot_product(&t[first], &r[first], last - first);
+			sum[1] = __impl::dot_product(&t[first], &t[first], last - first);
+		}, options);
+		omega = products[1] != T(0) ? products[0] / products[1] : T(0);
+
+		products = sums(2, [&](std::size_t first, std::size_t last, T* sum) {
+			for(std::size_t index = first; index < last; ++index) {
+				xs[index] += alpha * p_hat[index] + omega * s_hat[index];
+				r[index] -= omega * t[index];
+			}
+			sum[0] = __impl::dot_product(&r[first], &r[first], last - first);
+			sum[1] = __impl::dot_product(&shadow[first], &r[first], last - first);
+		}, options);
+		residual = std::sqrt(products[0]);
+		rho_next = products[1];
+		if(omega == T(0)) {
+			break;
+		}
+	}
+
+	return { iteration, residual / b_norm, residual <= target };
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* KRYLOV_HPP_ */
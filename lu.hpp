@@ -0,0 +1,160 @@
+#ifndef LU_HPP_
+#define LU_HPP_
+
+#include "matrix.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+#include "triangular.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+// Columns of the factorization handled by one panel
+constexpr unsigned lu_block_size = 64;
+
+
+template <typename T>
+void swap_rows(const strided_block<T>& m, unsigned row, unsigned other_row) {
+	if(row != other_row) {
+		std::swap_ranges(&m(row, 0), &m(row, 0) + m.cols, &m(other_row, 0));
+	}
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * The factorization P * A = L * U of a square matrix with partial pivoting,
+ * packed into one dmatrix: U on and above the diagonal, and L, whose
+ * diagonal is all ones, below it. Step i swapped rows i and pivots()[i].
+ */
+template <typename T>
+class lu_factorization {
+public:
+	lu_factorization(dmatrix<T>&& factors, std::vector<unsigned>&& pivots, bool singular) noexcept
+		: _factors(std::move(factors)), _pivots(std::move(pivots)), _singular(singular)
+	{}
+
+	const dmatrix<T>& factors() const noexcept { return _factors; }
+
+	const std::vector<unsigned>& pivots() const noexcept { return _pivots; }
+
+	// Whether a pivot was zero, so that there is no solution to solve for
+	bool singular() const noexcept { return _singular; }
+
+	T determinant() const {
+		T determinant(1);
+		for(unsigned index = 0; index < _factors.rows(); ++index) {
+			determinant *= _pivots[index] != index ? -_factors.element_at(index, index) : _factors.element_at(index, index);
+		}
+		return determinant;
+	}
+
+private:
+	dmatrix<T> _factors;
+	std::vector<unsigned> _pivots;
+	bool _singular;
+};
+
+
+/*
+ * Factors m in place, so passing it with std::move avoids any copy. Panels
+ * of columns are factored one after the other, each followed by a parallel
+ * gemm updating the rest of the matrix, where most of the work is.
+ */
+template <typename T>
+lu_factorization<T> lu(dmatrix<T> m, const parallel_options& options = parallel_options()) {
+	if(m.rows() != m.cols()) {
+		throw std::invalid_argument("Only square matrices have an LU factorization");
+	}
+
+	unsigned n = m.rows();
+	auto a = __impl::strided(m);
+	std::vector<unsigned> pivots(n);
+	bool singular = false;
+
+	for(unsigned first = 0; first < n; first += __impl::lu_block_size) {
+		unsigned size = std::min(__impl::lu_block_size, n - first);
+		unsigned end = first + size;
+
+		// The panel of columns [first, end), unblocked
+		for(unsigned step = first; step < end; ++step) {
+			unsigned pivot = step;
+			for(unsigned row = step + 1; row < n; ++row) {
+				if(std::abs(a(row, step)) > std::abs(a(pivot, step))) {
+					pivot = row;
+				}
+			}
+			pivots[step] = pivot;
+			if(a(pivot, step) == T(0)) {
+				singular = true;
+				continue;
+			}
+			__impl::swap_rows(a, step, pivot);
+
+			T inverse = T(1) / a(step, step);
+			const T* step_row = &a(step, 0);
+			for(unsigned row = step + 1; row < n; ++row) {
+				T* a_row = &a(row, 0);
+				T factor = a_row[step] *= inverse;
+				for(unsigned col = step + 1; col < end; ++col) {
+					a_row[col] -= factor * step_row[col];
+				}
+			}
+		}
+
+		if(end < n) {
+			// The panel's rows of U right of it, then the trailing matrix
+			__impl::triangular_solve<T>(side::left, triangle::lower, false, diagonal::unit, T(1), a.block(first, first, size, size), a.block(first, end, size, n - end), options);
+			__impl::gemm<T>(T(-1), a.block(end, first, n - end, size), false, a.block(first, end, size, n - end), false,
+			                T(1), a.block(end, end, n - end, n - end), options);
+		}
+	}
+
+	return lu_factorization<T>(std::move(m), std::move(pivots), singular);
+}
+
+
+/*
+ * The solution x of A * x = b for each column of b, from the factorization
+ * of A, which can be reused for any number of right-hand sides.
+ */
+template <typename T, typename M>
+dmatrix<T> solve(const lu_factorization<T>& lu, const matrix<M>& b, const parallel_options& options = parallel_options()) {
+	if(rows(b) != lu.factors().rows()) {
+		throw incompatible_operands(lu.factors(), "solve", b);
+	}
+	if(lu.singular()) {
+		throw std::domain_error("The matrix is singular");
+	}
+
+	auto x = dmatrix<T>::generate(rows(b), cols(b), [&](unsigned row, unsigned col) {
+		return element_at(b, row, col);
+	}, options);
+	auto x_block = __impl::strided(x);
+	for(unsigned row = 0; row < rows(b); ++row) {
+		__impl::swap_rows(x_block, row, lu.pivots()[row]);
+	}
+
+	auto factors = __impl::strided(lu.factors());
+	__impl::solve_left(factors, triangle::lower, false, diagonal::unit, x_block, options);
+	__impl::solve_left(factors, triangle::upper, false, diagonal::non_unit, x_block, options);
+	return x;
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* LU_HPP_ */
@@ -0,0 +1,91 @@
+#ifndef MAPPED_DMATRIX_HPP_
+#define MAPPED_DMATRIX_HPP_
+
+#include "matrix.hpp"
+#include "mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+
+namespace matrix {
+
+
+template <typename T>
+class mapped_dmatrix : public dynamic_matrix<mapped_dmatrix<T>> {
+private:
+	using rows_reference = dmatrix_rows_reference<const mapped_dmatrix>;
+
+public:
+	// The mapping is read-only, so the elements are exposed as const
+	using element_type = const T;
+	using value_type = T;
+
+	mapped_dmatrix() = delete;
+
+	mapped_dmatrix(std::shared_ptr<const mapped_file> file, std::size_t offset, unsigned rows, unsigned cols)
+		: _rows(rows), _cols(cols), mapped(true)
+	{
+		// By division, as rows * cols * sizeof(T) may wrap around
+		if(offset > file->size()  ||  (_cols != 0  &&  _rows > (file->size() - offset) / sizeof(T) / _cols)) {
+			throw std::out_of_range("The matrix elements exceed the mapped file");
+		}
+
+		const char* address = file->data() + offset;
+		if(reinterpret_cast<std::uintptr_t>(address) % alignof(T) != 0) {
+			throw std::invalid_argument("The matrix elements are misaligned in the mapped file");
+		}
+		elements = reinterpret_cast<const T*>(address);
+		owner = std::move(file);
+	}
+
+	// Views elements held in memory instead, for data that could not be mapped as is
+	mapped_dmatrix(std::shared_ptr<const T> buffer, unsigned rows, unsigned cols)
+		: owner(buffer), _rows(rows), _cols(cols), mapped(false),
+		  elements(buffer.get())
+	{}
+
+	unsigned rows() const noexcept { return _rows; };
+
+	unsigned cols() const noexcept { return _cols; };
+
+	const T& element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, _rows, _cols);
+		return elements[std::size_t(row) * _cols + col];
+	}
+
+	const T* data() const noexcept { return elements; }
+
+	// Whether the elements are read straight from the mapped file
+	bool is_mapped() const noexcept { return mapped; }
+
+	rows_reference operator[](unsigned row) const {
+		return { *this, 1, _cols, row, 0 };
+	}
+
+	rows_reference operator[](drange row_range) const {
+		return { *this, row_range.size, _cols, row_range.first, 0 };
+	}
+
+	rows_reference operator[](all_t) const {
+		return { *this, _rows, _cols, 0, 0 };
+	}
+
+private:
+	std::shared_ptr<const void> owner;
+	unsigned _rows;
+	unsigned _cols;
+	bool mapped;
+	const T* elements;
+};
+
+
+template <typename T>
+struct has_contiguous_rows<mapped_dmatrix<T>> : std::true_type {};
+
+
+} /* namespace matrix */
+
+
+#endif /* MAPPED_DMATRIX_HPP_ */
@@ -0,0 +1,93 @@
+#ifndef MAPPED_FILE_HPP_
+#define MAPPED_FILE_HPP_
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace matrix {
+
+
+class mapped_file {
+public:
+	mapped_file() = delete;
+
+	mapped_file(const mapped_file&) = delete;
+
+	mapped_file(mapped_file&& other) noexcept
+		: _data(other._data), _size(other._size)
+	{
+		other._data = nullptr;
+		other._size = 0;
+	}
+
+	explicit mapped_file(const std::string& path) {
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if(fd < 0) {
+			throw_system_error("open", path);
+		}
+
+		struct stat st;
+		if(::fstat(fd, &st) != 0) {
+			int error = errno;
+			::close(fd);
+			errno = error;
+			throw_system_error("fstat", path);
+		}
+
+		_size = static_cast<std::size_t>(st.st_size);
+		if(_size > 0) {
+			void* addr = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+			if(addr == MAP_FAILED) {
+				int error = errno;
+				::close(fd);
+				errno = error;
+				throw_system_error("mmap", path);
+			}
+			_data = static_cast<const char*>(addr);
+		}
+
+		// The mapping stays valid after the descriptor is closed
+		::close(fd);
+	}
+
+	~mapped_file() {
+		if(_data != nullptr) {
+			::munmap(const_cast<char*>(_data), _size);
+		}
+	}
+
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	mapped_file& operator=(mapped_file&& other) & noexcept {
+		std::swap(_data, other._data);
+		std::swap(_size, other._size);
+		return *this;
+	}
+
+	const char* data() const noexcept { return _data; }
+
+	std::size_t size() const noexcept { return _size; }
+
+private:
+	const char* _data = nullptr;
+	std::size_t _size = 0;
+
+	static void throw_system_error(const char* call, const std::string& path) {
+		throw std::system_error(errno, std::generic_category(), std::string(call) + ' ' + path);
+	}
+};
+
+
+} /* namespace matrix */
+
+
+#endif /* MAPPED_FILE_HPP_ */
@@ -1,10 +1,49 @@
 #include "matrix.hpp"
+#include "binary_io.hpp"
+#include "bounds.hpp"
+#include "cholesky.hpp"
+#include "expected.hpp"
+#include "gemm.hpp"
+#include "heap_array.hpp"
+#include "hmatrix.hpp"
+#include "lu.hpp"
+#include "mapped_dmatrix.hpp"
+#include "numpy_io.hpp"
+#include "parallel.hpp"
+#include "qr.hpp"
+#include "reduce.hpp"
 #include "safely_constructed_array.hpp"
+#include "shared_dmatrix.hpp"
+#include "sparse.hpp"
 #include "storage.hpp"
+#include "text_io.hpp"
+#include "transform.hpp"
+#include "triangular.hpp"
+#include "krylov.hpp"
+#include "eigen.hpp"
+#include "svd.hpp"
+#include "power.hpp"
+#include "structured.hpp"
+#include "permuted.hpp"
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <set>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <vector>
+#include <unistd.h>
 
 
 #define assert_throws(EXPR, EXCEPTION) \
@@ -19,6 +58,43 @@
 	assert("Should not compile" && false); EXPR;
 
 
+// Counts global allocations, for tests of code that must not allocate
+std::atomic<unsigned long> allocation_count(0);
+
+void* operator new(std::size_t size) {
+	++allocation_count;
+	if(void* p = std::malloc(size > 0 ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+
+struct temporary_file {
+	std::string path;
+
+	temporary_file() {
+		char name[] = "/tmp/matrix-test-XXXXXX";
+		int fd = ::mkstemp(name);
+		assert(fd >= 0);
+		::close(fd);
+		path = name;
+	}
+
+	~temporary_file() {
+		::unlink(path.c_str());
+	}
+};
+
+
 namespace storage {
 	template <typename T>
 	using verified_storage = matrix::storage<T, true>;
@@ -88,6 +164,93 @@ namespace storage {
 } /* namespace storage */
 
 
+namespace bounds {
+	void testVerifier() {
+		matrix::bounds_verifier::verify_index(2, 3, "");
+		assert_throws(matrix::bounds_verifier::verify_index(3, 3, ""), matrix::bounds_verifier::exception);
+
+		matrix::bounds_verifier::verify_range(1, 2, 3, "");
+		matrix::bounds_verifier::verify_range(3, 0, 3, "");
+		assert_throws(matrix::bounds_verifier::verify_range(2, 2, 3, ""), matrix::bounds_verifier::exception);
+		assert_throws(matrix::bounds_verifier::verify_range(4, 0, 3, ""), matrix::bounds_verifier::exception);
+		assert_throws(matrix::bounds_verifier::verify_range(1, ~0u, 3, ""), matrix::bounds_verifier::exception);
+	}
+
+	void testNullVerifier() {
+		matrix::null_bounds_verifier::verify_index(3, 3, "");
+		matrix::null_bounds_verifier::verify_range(2, 2, 3, "");
+	}
+
+	void testElementAccessExceptionSpecification() {
+		matrix::dmatrix<int> dm(2, 2);
+		matrix::smatrix<int, 2, 2> sm;
+		assert(noexcept(dm.element_at(0, 0)) == !matrix::default_bounds_verifier::enabled);
+		assert(noexcept(sm.element_at(0, 0)) == !matrix::default_bounds_verifier::enabled);
+	}
+
+#ifdef MATRIX_BOUNDS_CHECKING
+	void testCheckedDmatrix() {
+		using exception = matrix::bounds_verifier::exception;
+		matrix::dmatrix<int> m({ { 1, 2, 3 },
+		                         { 4, 5, 6 } });
+		const auto& cm = m;
+
+		assert_throws(m.element_at(2, 0), exception);
+		assert_throws(cm.element_at(0, 3), exception);
+		assert_throws(m[2], exception);
+		assert_throws(m[1][3], exception);
+		assert_throws(cm[0][3], exception);
+		assert_throws(m[matrix::drange(2, 1)], exception);
+		assert_throws(m[matrix::all][matrix::drange(2, 2)], exception);
+		assert_throws(m[matrix::drange(1, 1)][matrix::all][1], exception);
+		assert_throws(m[0][matrix::drange(2, 1)].element_at(0, 2), exception);
+
+		assert(m[matrix::drange(1, 1)][matrix::drange(2, 1)] == (matrix::dmatrix<int>({ { 5, 6 } })));
+		assert(m[matrix::drange(0, 2)][matrix::all].rows() == 0);
+	}
+
+	void testCheckedSmatrix() {
+		using exception = matrix::bounds_verifier::exception;
+		matrix::smatrix<int, 2, 3> m({ { 1, 2, 3 },
+		                               { 4, 5, 6 } });
+		const auto& cm = m;
+
+		assert_throws(m.element_at(2, 0), exception);
+		assert_throws(cm.element_at(0, 3), exception);
+		assert_throws(m[2], exception);
+		assert_throws(m[1][3], exception);
+		assert_throws(cm[0][3], exception);
+		assert_throws(m[matrix::srange<2>(1)], exception);
+		assert_throws(m[matrix::all][matrix::srange<2>(2)], exception);
+		assert_throws(m[matrix::srange<1>(1)][matrix::all][1], exception);
+
+		assert(m[matrix::srange<1>(1)][matrix::srange<2>(1)] == (matrix::smatrix<int, 1, 2>({ { 5, 6 } })));
+	}
+
+	void testCheckedOtherMatrices() {
+		using exception = matrix::bounds_verifier::exception;
+		auto sparse = matrix::csr_matrix<int>::from_entries(2, 2, { { 0, 1, 5 } });
+		assert_throws(sparse.element_at(2, 0), exception);
+
+		matrix::shared_dmatrix<int> shared(2, 2);
+		assert_throws(shared.element_at(0, 2), exception);
+		assert_throws(shared[2], exception);
+	}
+#endif
+
+	void test() {
+		testVerifier();
+		testNullVerifier();
+		testElementAccessExceptionSpecification();
+#ifdef MATRIX_BOUNDS_CHECKING
+		testCheckedDmatrix();
+		testCheckedSmatrix();
+		testCheckedOtherMatrices();
+#endif
+	}
+} /* namespace bounds */
+
+
 namespace safely_constructed_array {
 	struct Probe {
 		char ch;
@@ -193,14 +356,280 @@ namespace safely_constructed_array {
 		}));
 	}
 
+	void testCopyAndMove() {
+		matrix::safely_constructed_array<std::string, 2> a({ "a", "b" });
+
+		matrix::safely_constructed_array<std::string, 2> copy(a);
+		assert(copy[0] == "a"  &&  copy[1] == "b");
+
+		matrix::safely_constructed_array<std::string, 2> moved(std::move(copy));
+		assert(moved[0] == "a"  &&  moved[1] == "b");
+
+		a[0] = "c";
+		moved = a;
+		assert(moved[0] == "c");
+		moved = matrix::safely_constructed_array<std::string, 2>({ "d", "e" });
+		assert(moved[0] == "d"  &&  moved[1] == "e");
+	}
+
 	void test() {
 		testConstructWithProvider();
 		testConstructWithArrayAndChangeValue();
 		testConstructionThrowingOnMove();
+		testCopyAndMove();
 	}
 } /* namespace safely_constructed_array */
 
 
+namespace heap_array {
+	using safely_constructed_array::Probe;
+
+	void testConstructWithProvider() {
+		matrix::heap_array<int, 3> array([](unsigned index) { return int(index) * 2; });
+
+		assert(array[0] == 0);
+		assert(array[1] == 2);
+		assert(array[2] == 4);
+
+		matrix::heap_array<double, 4> zeros;
+		assert(zeros[3] == 0.0);
+	}
+
+	void testAlignment() {
+		matrix::heap_array<char, 5> array;
+		assert(reinterpret_cast<std::uintptr_t>(&array[0]) % 64 == 0);
+	}
+
+	void testConstructionThrowing() {
+		Probe::reset();
+
+		try {
+			matrix::heap_array<Probe, 3> array(
+				[](unsigned index) {
+					if(index == 2) {
+						throw std::runtime_error("throwing!");
+					}
+					return Probe('A' + index);
+				}
+			);
+			assert(false);
+		} catch(std::runtime_error&) {
+			Probe::log.push_back("exception caught");
+		}
+
+		assert((Probe::log == std::vector<std::string>{
+			"A0: char-constructed",
+			"B0: char-constructed",
+			"B0: destructed",
+			"A0: destructed",
+			"exception caught"
+		}));
+	}
+
+	void testCopyAndMove() {
+		matrix::heap_array<std::string, 2> a([](unsigned index) { return std::string(1, 'a' + index); });
+
+		matrix::heap_array<std::string, 2> copy(a);
+		assert(copy[0] == "a"  &&  copy[1] == "b");
+		assert(&copy[0] != &a[0]);
+
+		static_assert(std::is_nothrow_move_constructible<matrix::heap_array<std::string, 2>>::value, "");
+		const std::string* elements = &copy[0];
+		matrix::heap_array<std::string, 2> moved(std::move(copy));
+		assert(&moved[0] == elements);
+		const matrix::heap_array<std::string, 2> moved_from(std::move(copy));
+		assert(moved_from[0].empty()  &&  moved_from[1].empty());
+		assert(copy[0].empty()  &&  copy[1].empty());
+
+		copy = a;
+		assert(copy[1] == "b");
+
+		elements = &a[0];
+		moved = std::move(a);
+		assert(&moved[0] == elements);
+	}
+
+	void test() {
+		testConstructWithProvider();
+		testAlignment();
+		testConstructionThrowing();
+		testCopyAndMove();
+	}
+} /* namespace heap_array */
+
+
+namespace parallel {
+	matrix::thread_pool_options with_threads(unsigned threads) {
+		matrix::thread_pool_options options;
+		options.threads = threads;
+		return options;
+	}
+
+	void testRunCallsEveryIndex() {
+		matrix::thread_pool pool(with_threads(4));
+		assert(pool.concurrency() == 4);
+
+		std::vector<std::atomic<unsigned>> calls(100);
+		pool.run(calls.size(), [&](unsigned index) { ++calls[index]; });
+		for(auto& count : calls) {
+			assert(count == 1);
+		}
+
+		unsigned serial_calls = 0;
+		matrix::thread_pool(with_threads(1)).run(5, [&](unsigned) { ++serial_calls; });
+		assert(serial_calls == 5);
+	}
+
+	void testRunRethrowsFirstException() {
+		matrix::thread_pool pool(with_threads(3));
+		std::atomic<unsigned> calls(0);
+
+		try {
+			pool.run(10, [&](unsigned index) {
+				++calls;
+				if(index == 3  ||  index == 7) {
+					throw std::runtime_error(std::to_string(index));
+				}
+			});
+			assert(false);
+		} catch(std::runtime_error& e) {
+			assert(std::string(e.what()) == "3");
+		}
+		assert(calls == 10);
+	}
+
+	void testNestedRunsShareThreads() {
+		matrix::thread_pool pool(with_threads(3));
+		std::mutex mutex;
+		std::set<std::thread::id> threads;
+		std::atomic<unsigned> calls(0);
+
+		pool.run(6, [&](unsigned) {
+			pool.run(6, [&](unsigned) {
+				std::lock_guard<std::mutex> lock(mutex);
+				threads.insert(std::this_thread::get_id());
+				++calls;
+			});
+		});
+
+		assert(calls == 36);
+		assert(threads.size() <= pool.concurrency());
+	}
+
+	void testAffinity() {
+		matrix::thread_pool_options options = with_threads(2);
+		options.cpus = { 0 };
+		matrix::thread_pool pool(options);
+
+		std::atomic<unsigned> calls(0);
+		pool.run(4, [&](unsigned) { ++calls; });
+		assert(calls == 4);
+
+		// Worker 1 takes the first CPU, and the calling thread is not counted
+		options.cpus = { 4, 5, 6 };
+		assert(options.cpu_of(1) == 4  &&  options.cpu_of(3) == 6  &&  options.cpu_of(4) == 4);
+
+#if defined(__linux__)
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		::pthread_getaffinity_np(::pthread_self(), sizeof(allowed), &allowed);
+		unsigned first = 0;
+		while(!CPU_ISSET(first, &allowed)) {
+			++first;
+		}
+		options.cpus = { first };
+		matrix::thread_pool pinned(options);
+
+		std::atomic<bool> worker_pinned(false);
+		auto caller = std::this_thread::get_id();
+		for(unsigned attempt = 0; attempt < 1000  &&  !worker_pinned; ++attempt) {
+			pinned.run(2, [&](unsigned) {
+				if(std::this_thread::get_id() != caller) {
+					cpu_set_t cpus;
+					::pthread_getaffinity_np(::pthread_self(), sizeof(cpus), &cpus);
+					worker_pinned = CPU_COUNT(&cpus) == 1  &&  CPU_ISSET(first, &cpus);
+				}
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			});
+		}
+		assert(worker_pinned);
+
+		cpu_set_t after;
+		::pthread_getaffinity_np(::pthread_self(), sizeof(after), &after);
+		assert(CPU_EQUAL(&after, &allowed));
+#endif
+	}
+
+	void testParallelForCoversRange() {
+		matrix::execution_context context(with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+
+		std::vector<std::atomic<unsigned>> visits(1005);
+		std::atomic<unsigned> calls(0);
+		matrix::parallel_for(5, visits.size(), 1, [&](std::size_t first, std::size_t last) {
+			++calls;
+			for(std::size_t index = first; index < last; ++index) {
+				++visits[index];
+			}
+		}, options);
+
+		assert(calls > 1);
+		for(std::size_t index = 0; index < visits.size(); ++index) {
+			assert(visits[index] == (index < 5 ? 0u : 1u));
+		}
+	}
+
+	void testParallelForRunsSmallWorkSerially() {
+		matrix::execution_context context(with_threads(4));
+		matrix::parallel_options options;
+		options.context = &context;
+
+		auto caller = std::this_thread::get_id();
+		unsigned calls = 0;
+		auto body = [&](std::size_t first, std::size_t last) {
+			assert(std::this_thread::get_id() == caller);
+			assert(first == 0  &&  last == 100);
+			++calls;
+		};
+
+		matrix::parallel_for(0, 100, 10, body, options);
+		assert(calls == 1);
+
+		options.serial_threshold = 1;
+		options.max_threads = 1;
+		matrix::parallel_for(0, 100, 10, body, options);
+		assert(calls == 2);
+	}
+
+	void testDefaultExecutionContext() {
+		matrix::set_default_execution_context(std::make_shared<matrix::execution_context>(with_threads(3), 16));
+		assert(matrix::default_execution_context()->pool().concurrency() == 3);
+
+		auto m = matrix::dmatrix<int>::generate(50, 7, [](unsigned row, unsigned col) { return int(row * 7 + col); });
+		matrix::parallel_for_each_element(matrix::parallel_options(), [](int& element) { element *= 2; }, m);
+		for(unsigned row = 0; row < 50; ++row) {
+			for(unsigned col = 0; col < 7; ++col) {
+				assert(m.element_at(row, col) == int(row * 7 + col) * 2);
+			}
+		}
+
+		matrix::set_default_execution_context(nullptr);
+		assert(matrix::default_execution_context()->pool().concurrency() == std::max(std::thread::hardware_concurrency(), 1u));
+	}
+
+	void test() {
+		testRunCallsEveryIndex();
+		testRunRethrowsFirstException();
+		testNestedRunsShareThreads();
+		testAffinity();
+		testParallelForCoversRange();
+		testParallelForRunsSmallWorkSerially();
+		testDefaultExecutionContext();
+	}
+} /* namespace parallel */
+
+
 namespace base {
 	template <typename T, typename F, typename Expected>
 	struct test_with_qualifiers_of {
@@ -572,6 +1001,101 @@ namespace smatrix {
 		//assert_not_compilable(m[2][matrix::all] = (matrix::smatrix<int, 1, 2>({ { 3, 4 } })));
 	}
 
+	void testConstSubscript() {
+		const matrix::smatrix<int, 3, 3> m({ { 1, 2, 3 },
+		                                     { 4, 5, 6 },
+		                                     { 7, 8, 9 } });
+
+		assert(m[1][2] == 6);
+		const int& r = m[2][0];
+		assert(&r == &m.element_at(2, 0));
+
+		assert(m[matrix::srange<2>(1)][matrix::all][1][1] == 8);
+		assert(m[matrix::all][matrix::srange<2>(1)] == (matrix::smatrix<int, 3, 2>({ { 2, 3 },
+		                                                                            { 5, 6 },
+		                                                                            { 8, 9 } })));
+	}
+
+	void testFillAndScalarBroadcast() {
+		matrix::smatrix<int, 3, 3> m({ { 1, 2, 3 },
+		                               { 4, 5, 6 },
+		                               { 7, 8, 9 } });
+
+		matrix::fill(m[matrix::srange<2>(1)][matrix::srange<2>(0)], 0);
+		m[0] *= 3;
+		m[matrix::all][2] += 1;
+		assert(m == (matrix::smatrix<int, 3, 3>({ { 3, 6, 10 },
+		                                          { 0, 0, 7 },
+		                                          { 0, 0, 10 } })));
+
+		int value = -1;
+		m[1][1] = value;
+		assert(m.element_at(1, 1) == -1);
+		//assert_not_compilable(m[1] = value);
+
+		matrix::fill(m, 4);
+		assert(m == (matrix::smatrix<int, 3, 3>({ { 4, 4, 4 },
+		                                          { 4, 4, 4 },
+		                                          { 4, 4, 4 } })));
+	}
+
+	void testCopyAndMove() {
+		matrix::smatrix<int, 2, 2> m({ { 1, 2 },
+		                               { 3, 4 } });
+
+		matrix::smatrix<int, 2, 2> copy(m);
+		assert(copy == m);
+
+		matrix::smatrix<int, 2, 2> moved(std::move(copy));
+		assert(moved == m);
+
+		moved[0][0] = 5;
+		copy = moved;
+		assert(copy[0][0] == 5);
+	}
+
+	void testHeapStorage() {
+		using large = matrix::smatrix<double, 512, 512>;
+		static_assert(matrix::smatrix_uses_heap<double, 512, 512>::value, "");
+		static_assert(!matrix::smatrix_uses_heap<double, 4, 4>::value, "");
+		static_assert(sizeof(large) < 64, "");
+
+		large m;
+		m[511][511] = 2.5;
+		assert(m.element_at(511, 511) == 2.5);
+		assert(m[matrix::srange<2>(510)][matrix::srange<2>(510)] == (matrix::smatrix<double, 2, 2>({ { 0.0, 0.0 }, { 0.0, 2.5 } })));
+
+		large copy(m);
+		assert(copy == m);
+		assert(&copy.element_at(0, 0) != &m.element_at(0, 0));
+
+		const double* elements = &m.element_at(0, 0);
+		large moved(std::move(m));
+		assert(&moved.element_at(0, 0) == elements);
+		assert(m.element_at(511, 511) == 0.0);
+		m[0][0] = 1.0;
+		assert(m.element_at(0, 0) == 1.0);
+
+		m = copy;
+		assert(m.element_at(511, 511) == 2.5);
+	}
+
+	void testMovedFromHeapStorage() {
+		static_assert(std::is_nothrow_move_constructible<matrix::smatrix<double, 200, 200>>::value, "");
+		matrix::smatrix<double, 200, 200> a;
+		a[199][0] = 3.0;
+		auto b = std::move(a);
+		assert(b.element_at(199, 0) == 3.0);
+		auto c = std::move(a);
+		assert(c == (matrix::smatrix<double, 200, 200>()));
+		assert(a.element_at(0, 0) == 0.0);
+		a.element_at(0, 0) = 1.0;
+
+		b = std::move(a);
+		assert(b.element_at(0, 0) == 1.0);
+		assert(a.element_at(199, 0) == 3.0);
+	}
+
 	void test() {
 		testBasics();
 		testArrayConstructorAndElementAt();
@@ -588,6 +1112,11 @@ namespace smatrix {
 		testAllColumnsSubscript();
 		testSingleRowSingleColumnAreaReference();
 		testMultiRowOrMultiColumnAreaReference();
+		testConstSubscript();
+		testFillAndScalarBroadcast();
+		testCopyAndMove();
+		testHeapStorage();
+		testMovedFromHeapStorage();
 	}
 } /* namespace smatrix */
 
@@ -652,6 +1181,56 @@ namespace dmatrix {
 		assert(m.element_at(2, 1) == 0);
 	}
 
+	void testPointerConstructor() {
+		const double values[] = { 1, 2, 3, 4, 5, 6 };
+		matrix::dmatrix<double> m(3, 2, values);
+
+		assert(m == (matrix::dmatrix<double>({ { 1, 2 },
+		                                       { 3, 4 },
+		                                       { 5, 6 } })));
+	}
+
+	void testIteratorConstructor() {
+		std::vector<int> vector{ 1, 2, 3, 4, 5, 6 };
+		matrix::dmatrix<int> mA(2, 3, vector.begin(), vector.end());
+		assert(mA == (matrix::dmatrix<int>({ { 1, 2, 3 },
+		                                     { 4, 5, 6 } })));
+
+		std::list<int> list{ 1, 2, 3, 4 };
+		matrix::dmatrix<int> mB(1, 4, list.begin(), list.end());
+		assert(mB == (matrix::dmatrix<int>({ { 1, 2, 3, 4 } })));
+
+		assert_throws(matrix::dmatrix<int>(2, 2, vector.begin(), vector.end()), std::invalid_argument);
+	}
+
+	void testUninitializedConstructor() {
+		matrix::dmatrix<double> m(4, 5, matrix::uninitialized);
+		assert(m.rows() == 4);
+		assert(m.cols() == 5);
+
+		m.element_at(3, 4) = 1.0;
+		assert(m.element_at(3, 4) == 1.0);
+	}
+
+	void testGenerate() {
+		auto m = matrix::dmatrix<int>::generate(2, 3, [](unsigned row, unsigned col) {
+			return int(row * 10 + col);
+		});
+		assert(m == (matrix::dmatrix<int>({ {  0,  1,  2 },
+		                                    { 10, 11, 12 } })));
+
+		const unsigned rows = 1000;
+		const unsigned cols = 300;
+		auto large = matrix::dmatrix<long>::generate(rows, cols, [](unsigned row, unsigned col) {
+			return long(row) * cols + col;
+		});
+		for(unsigned row = 0; row < rows; ++row) {
+			for(unsigned col = 0; col < cols; ++col) {
+				assert(large.element_at(row, col) == long(row) * cols + col);
+			}
+		}
+	}
+
 	void testMatrixMatrixComparison() {
 		matrix::dmatrix<int>  mA({ { 1, 2, 3 },
 		                           { 4, 5, 6 } });
@@ -955,12 +1534,67 @@ namespace dmatrix {
 		assert_throws(m[2][matrix::all] = (matrix::dmatrix<int>({ { 3, 4 } })), matrix::incompatible_operands);
 	}
 
+	void testConstSubscript() {
+		const matrix::dmatrix<int> m({ { 1, 2, 3 },
+		                               { 4, 5, 6 },
+		                               { 7, 8, 9 } });
+
+		assert(m[1][2] == 6);
+		const int& r = m[2][0];
+		assert(&r == &m.element_at(2, 0));
+
+		assert(m[matrix::drange(2, 1)][matrix::all][1][1] == 8);
+		assert(m[matrix::all][matrix::drange(2, 1)] == (matrix::dmatrix<int>({ { 2, 3 },
+		                                                                       { 5, 6 },
+		                                                                       { 8, 9 } })));
+
+		assert_throws(const int& s = m[1][matrix::all]; (void)s, matrix::incompatible_operands);
+	}
+
+	void testFillAndScalarBroadcast() {
+		matrix::dmatrix<double> m({ { 1, 2, 3, 4 },
+		                            { 5, 6, 7, 8 },
+		                            { 9, 10, 11, 12 } });
+
+		matrix::fill(m[matrix::drange(2, 1)][matrix::drange(2, 1)], 0);
+		assert(m == (matrix::dmatrix<double>({ { 1, 2, 3, 4 },
+		                                       { 5, 0, 0, 8 },
+		                                       { 9, 0, 0, 12 } })));
+
+		m[0] += 10;
+		m[matrix::all][3] *= 2;
+		m[matrix::drange(2, 1)][0] -= 1;
+		m[2][matrix::drange(2, 1)] /= 4;
+		assert(m == (matrix::dmatrix<double>({ { 11, 12, 13, 28 },
+		                                       { 4, 0, 0, 16 },
+		                                       { 8, 0, 0, 24 } })));
+
+		// The scalar may be an element of the region itself
+		m[0] -= m.element_at(0, 0);
+		assert(m[0] == (matrix::dmatrix<double>({ { 0, 1, 2, 17 } })));
+
+		matrix::fill(m, -0.0);
+		assert(std::signbit(m.element_at(2, 3)));
+		matrix::fill(m, 2.5);
+		assert(m == matrix::dmatrix<double>::generate(3, 4, [](unsigned, unsigned) { return 2.5; }));
+
+		// Assigning a scalar is for 1x1 regions only, as for rvalues
+		const double value = 7;
+		m[1][1] = value;
+		assert(m.element_at(1, 1) == 7);
+		assert_throws(m[1] = value, matrix::incompatible_operands);
+	}
+
 	void test() {
 		testBasics();
 		testInitializerListConstructorAndElementAt();
 		testInitializerListConstructorWithMissingValues();
 		testSizesWithInitializerListConstructor();
 		testDefaultConstructor();
+		testPointerConstructor();
+		testIteratorConstructor();
+		testUninitializedConstructor();
+		testGenerate();
 		testMatrixMatrixComparison();
 		testMatrixScalarComparison();
 		testRowIndexSubscript();
@@ -973,6 +1607,8 @@ namespace dmatrix {
 		testAllColumnsSubscript();
 		testSingleRowSingleColumnAreaReference();
 		testMultiRowOrMultiColumnAreaReference();
+		testConstSubscript();
+		testFillAndScalarBroadcast();
 	}
 } /* namespace dmatrix */
 
@@ -1057,11 +1693,2491 @@ namespace common {
 } /* namespace common */
 
 
+namespace expected {
+	void testMessage() {
+		matrix::dmatrix<int> dm(2, 3);
+		matrix::smatrix<int, 3, 2> sm;
+
+		try {
+			(void)(dm == sm);
+			assert(false);
+		} catch(matrix::incompatible_operands& e) {
+			assert(std::string(e.what()) == "dynamic_matrix[2x3] == smatrix[3x2]");
+			assert(e.mismatch().lhs.kind == matrix::operand_kind::dynamic_matrix);
+			assert(e.mismatch().lhs.rows == 2  &&  e.mismatch().lhs.cols == 3);
+			assert(e.mismatch().rhs.kind == matrix::operand_kind::static_matrix);
+			assert(std::string(e.mismatch().operation) == "==");
+		}
+
+		try {
+			int r = dm[matrix::all][matrix::all];
+			(void)r;
+			assert(false);
+		} catch(matrix::incompatible_operands& e) {
+			assert(std::string(e.what()) == "scalar = dynamic_matrix[2x3]");
+			assert(e.mismatch().lhs.kind == matrix::operand_kind::scalar);
+		}
+
+		matrix::shape_mismatch largest = {
+			{ matrix::operand_kind::dynamic_matrix, ~0u, ~0u }, ">=",
+			{ matrix::operand_kind::dynamic_matrix, ~0u, ~0u }
+		};
+		assert(std::string(matrix::incompatible_operands(largest).what()) ==
+		       "dynamic_matrix[4294967295x4294967295] >= dynamic_matrix[4294967295x4294967295]");
+	}
+
+	void testThrowDoesNotAllocate() {
+		matrix::dmatrix<int> a(2, 3);
+		matrix::dmatrix<int> b(3, 2);
+
+		unsigned long before = allocation_count;
+		try {
+			(void)(a == b);
+			assert(false);
+		} catch(matrix::incompatible_operands& e) {
+			assert(e.what()[0] != '\0');
+		}
+		assert(allocation_count == before);
+	}
+
+	void testConcurrentWhat() {
+		matrix::incompatible_operands e({
+			{ matrix::operand_kind::dynamic_matrix, 2, 3 }, "*",
+			{ matrix::operand_kind::static_matrix, 2, 3 }
+		});
+		std::vector<std::thread> threads;
+		std::atomic<unsigned> matching(0);
+		for(unsigned index = 0; index < 4; ++index) {
+			threads.emplace_back([&] {
+				if(std::string(e.what()) == "dynamic_matrix[2x3] * smatrix[2x3]") {
+					++matching;
+				}
+			});
+		}
+		for(auto& thread : threads) {
+			thread.join();
+		}
+		assert(matching == 4);
+
+		matrix::incompatible_operands copy(e);
+		assert(std::string(copy.what()) == e.what());
+		copy = matrix::incompatible_operands({ { matrix::operand_kind::scalar, 1, 1 }, "+", { matrix::operand_kind::dynamic_matrix, 1, 2 } });
+		assert(std::string(copy.what()) == "scalar + dynamic_matrix[1x2]");
+	}
+
+	void testStringOperation() {
+		matrix::dmatrix<int> a(2, 3);
+		std::unique_ptr<matrix::incompatible_operands> e;
+		{
+			std::string operation = "custom";
+			e.reset(new matrix::incompatible_operands(a, operation, a));
+			operation = "overwritten";
+		}
+		assert(std::string(e->what()) == "dynamic_matrix[2x3] custom dynamic_matrix[2x3]");
+
+		matrix::incompatible_operands copy(*e);
+		e.reset();
+		assert(std::string(copy.mismatch().operation) == "custom");
+
+		matrix::incompatible_operands assigned(a, "+", a);
+		assigned = copy;
+		copy = matrix::incompatible_operands(a, "-", a);
+		assert(std::string(assigned.what()) == "dynamic_matrix[2x3] custom dynamic_matrix[2x3]");
+		assert(std::string(copy.what()) == "dynamic_matrix[2x3] - dynamic_matrix[2x3]");
+	}
+
+	void testTryEqual() {
+		matrix::dmatrix<int> a({ { 1, 2 } });
+		matrix::dmatrix<int> b({ { 1, 2 } });
+		matrix::dmatrix<int> c({ { 1 }, { 2 } });
+
+		auto same = matrix::try_equal(a, b);
+		assert(same  &&  same.has_value()  &&  same.value());
+		assert(matrix::try_not_equal(a, b).value() == false);
+
+		auto mismatched = matrix::try_equal(a, c);
+		assert(!mismatched);
+		assert(mismatched.error().rhs.rows == 2);
+		assert(std::string(mismatched.error().operation) == "==");
+		assert_throws(mismatched.value(), matrix::incompatible_operands);
+
+		assert(!matrix::try_not_equal(a, matrix::smatrix<int, 2, 1>()));
+	}
+
+	void testTryMoveTo() {
+		matrix::dmatrix<int> m({ { 1, 2, 3 },
+		                         { 4, 5, 6 } });
+
+		assert(matrix::try_move_to(m[0][matrix::drange(2, 1)], matrix::dmatrix<int>({ { 7, 8 } })));
+		auto failed = matrix::try_move_to(m[1], matrix::dmatrix<int>({ { 9, 9 } }));
+		assert(!failed);
+		assert_throws(failed.value(), matrix::incompatible_operands);
+
+		assert(m == (matrix::dmatrix<int>({ { 1, 7, 8 },
+		                                    { 4, 5, 6 } })));
+	}
+
+	void test() {
+		testMessage();
+		testThrowDoesNotAllocate();
+		testConcurrentWhat();
+		testStringOperation();
+		testTryEqual();
+		testTryMoveTo();
+	}
+} /* namespace expected */
+
+
+namespace binary_io {
+	void testSaveAndLoad() {
+		matrix::dmatrix<double> m({ { 1.5, 2.5, 3.5 },
+		                            { 4.5, 5.5, 6.5 } });
+		temporary_file file;
+		matrix::save_binary(file.path, m);
+
+		auto loaded = matrix::load_binary<double>(file.path);
+		assert(loaded.rows() == 2);
+		assert(loaded.cols() == 3);
+		assert(loaded == m);
+		assert(loaded.element_at(1, 2) == 6.5);
+		assert(loaded[0][1] == 2.5);
+		assert(loaded[1] == (matrix::dmatrix<double>({ { 4.5, 5.5, 6.5 } })));
+	}
+
+	void testSaveStaticMatrix() {
+		matrix::smatrix<int, 2, 2> m({ { 1, 2 },
+		                               { 3, 4 } });
+		temporary_file file;
+		matrix::save_binary(file.path, m);
+
+		auto loaded = matrix::load_binary<int>(file.path);
+		assert(loaded == (matrix::dmatrix<int>({ { 1, 2 },
+		                                         { 3, 4 } })));
+	}
+
+	void testDataIsAligned() {
+		matrix::dmatrix<double> m(3, 3);
+		temporary_file file;
+		matrix::save_binary(file.path, m);
+
+		auto loaded = matrix::load_binary<double>(file.path);
+		assert(reinterpret_cast<std::uintptr_t>(loaded.data()) % 64 == 0);
+	}
+
+	void testLoadWithWrongElementType() {
+		matrix::dmatrix<double> m(2, 2);
+		temporary_file file;
+		matrix::save_binary(file.path, m);
+
+		assert_throws(matrix::load_binary<float>(file.path), matrix::format_error);
+		assert_throws(matrix::load_binary<long>(file.path), matrix::format_error);
+	}
+
+	void testLoadInvalidFiles() {
+		temporary_file file;
+		std::ofstream(file.path) << "not a matrix at all, just some text that is long enough to fill a header";
+		assert_throws(matrix::load_binary<double>(file.path), matrix::format_error);
+
+		matrix::dmatrix<double> m(20, 20);
+		matrix::save_binary(file.path, m);
+		::truncate(file.path.c_str(), 1000);
+		assert_throws(matrix::load_binary<double>(file.path), matrix::format_error);
+
+		assert_throws(matrix::load_binary<double>("/nonexistent/matrix.bin"), std::system_error);
+	}
+
+	void testLoadOversizedHeader() {
+		// 2^31 x 2^31 doubles take 2^65 bytes, which wraps around to 0 in 64 bits
+		temporary_file file;
+		matrix::save_binary(file.path, matrix::dmatrix<double>(1, 1));
+		std::uint64_t side = std::uint64_t(1) << 31;
+		{
+			std::fstream patch(file.path, std::ios::in | std::ios::out | std::ios::binary);
+			patch.seekp(offsetof(matrix::__impl::binary_header, rows));
+			patch.write(reinterpret_cast<const char*>(&side), sizeof(side));
+			patch.seekp(offsetof(matrix::__impl::binary_header, cols));
+			patch.write(reinterpret_cast<const char*>(&side), sizeof(side));
+		}
+		assert_throws(matrix::load_binary<double>(file.path), matrix::format_error);
+
+		auto mapping = std::make_shared<const matrix::mapped_file>(file.path);
+		assert_throws(matrix::mapped_dmatrix<double>(mapping, 64, unsigned(side), unsigned(side)), std::out_of_range);
+		assert(matrix::mapped_dmatrix<double>(mapping, 64, 1, 1).rows() == 1);
+	}
+
+	void test() {
+		testSaveAndLoad();
+		testSaveStaticMatrix();
+		testDataIsAligned();
+		testLoadWithWrongElementType();
+		testLoadInvalidFiles();
+		testLoadOversizedHeader();
+	}
+} /* namespace binary_io */
+
+
+namespace sparse {
+	void testFromEntries() {
+		auto m = matrix::csr_matrix<double>::from_entries(3, 4, {
+			{ 2, 1, 5.0 },
+			{ 0, 3, 1.0 },
+			{ 0, 0, 2.0 },
+			{ 2, 1, 0.5 },
+		});
+
+		assert(m.nonzeros() == 3);
+		assert((m.row_offsets() == std::vector<std::size_t>{ 0, 2, 2, 3 }));
+		assert((m.col_indices() == std::vector<unsigned>{ 0, 3, 1 }));
+		assert(m == (matrix::dmatrix<double>({ { 2, 0, 0, 1 },
+		                                       { 0, 0, 0, 0 },
+		                                       { 0, 5.5, 0, 0 } })));
+	}
+
+	void testInconsistentArrays() {
+		assert_throws(matrix::csr_matrix<int>(2, 2, { 0, 1 }, { 0 }, { 1 }), std::invalid_argument);
+		assert_throws(matrix::csr_matrix<int>(1, 2, { 0, 2 }, { 0 }, { 1 }), std::invalid_argument);
+		assert_throws(matrix::csr_matrix<int>::from_entries(2, 2, { { 2, 0, 1 } }), std::out_of_range);
+	}
+
+	void test() {
+		testFromEntries();
+		testInconsistentArrays();
+	}
+} /* namespace sparse */
+
+
+namespace text_io {
+	template <typename T>
+	bool parses_as(const std::string& text, T expected) {
+		T value;
+		return matrix::__impl::parse_number(text.data(), text.data() + text.size(), value)
+		    && value == expected;
+	}
+
+	template <typename T>
+	bool rejects(const std::string& text) {
+		T value;
+		return !matrix::__impl::parse_number(text.data(), text.data() + text.size(), value);
+	}
+
+	void testParseNumber() {
+		assert(parses_as("0", 0.0));
+		assert(parses_as("-2.5E+3", -2500.0));
+		assert(parses_as("0.001", 0.001));
+		assert(parses_as(".5", 0.5));
+		assert(parses_as("7.", 7.0));
+		assert(parses_as("1e-5", 1e-5));
+		assert(parses_as("3.14159265358979", 3.14159265358979));
+		assert(parses_as("123456789012345678901234", 123456789012345678901234.0));
+		assert(parses_as("2.2250738585072014e-308", 2.2250738585072014e-308));
+		assert(parses_as("0.1", 0.1f));
+		assert(parses_as("inf", HUGE_VAL));
+		assert(parses_as("-42", -42));
+		assert(parses_as("+42", 42u));
+
+		assert(rejects<double>(""));
+		assert(rejects<double>("-"));
+		assert(rejects<double>("1e"));
+		assert(rejects<double>("1.2.3"));
+		assert(rejects<double>("12abc"));
+		assert(rejects<int>("1.5"));
+		assert(rejects<unsigned>("-1"));
+		assert(rejects<signed char>("300"));
+
+		// 64-bit limits, and values past them that wrap around when multiplied unchecked
+		assert(parses_as("18446744073709551615", std::uint64_t(18446744073709551615u)));
+		assert(parses_as("-9223372036854775808", std::numeric_limits<std::int64_t>::min()));
+		assert(parses_as("9223372036854775807", std::numeric_limits<std::int64_t>::max()));
+		assert(rejects<std::uint64_t>("18446744073709551616"));
+		assert(rejects<std::uint64_t>("99999999999999999999"));
+		assert(rejects<std::int64_t>("9223372036854775808"));
+		assert(rejects<std::int64_t>("-9223372036854775809"));
+		assert(rejects<std::int64_t>("-99999999999999999999"));
+
+		temporary_file file;
+		std::ofstream(file.path) << "1,99999999999999999999\n";
+		assert_throws(matrix::read_csv<std::uint64_t>(file.path), matrix::format_error);
+	}
+
+	void testReadCsv() {
+		temporary_file file;
+		std::ofstream(file.path) << "a;b;c\r\n"
+		                         << " 1 ; 2.5;3\r\n"
+		                         << "\n"
+		                         << "4;5;-6e1\r\n";
+
+		matrix::csv_options options;
+		options.delimiter = ';';
+		options.skip_rows = 1;
+		auto m = matrix::read_csv<double>(file.path, options);
+
+		assert(m == (matrix::dmatrix<double>({ { 1, 2.5,   3 },
+		                                       { 4,   5, -60 } })));
+	}
+
+	void testReadCsvInParallel() {
+		const unsigned rows = 20000;
+		temporary_file file;
+		{
+			std::ofstream os(file.path);
+			for(unsigned row = 0; row < rows; ++row) {
+				os << row << ',' << row * 0.5 << ',' << -double(row) << '\n';
+			}
+		}
+
+		matrix::csv_options options;
+		options.threads = 4;
+		auto m = matrix::read_csv<double>(file.path, options);
+
+		assert(m.rows() == rows);
+		assert(m.cols() == 3);
+		for(unsigned row = 0; row < rows; ++row) {
+			assert(m.element_at(row, 0) == row);
+			assert(m.element_at(row, 1) == row * 0.5);
+			assert(m.element_at(row, 2) == -double(row));
+		}
+	}
+
+	void testReadInvalidCsv() {
+		temporary_file file;
+		std::ofstream(file.path) << "1,2,3\n"
+		                         << "4,5\n";
+		assert_throws(matrix::read_csv<double>(file.path), matrix::format_error);
+
+		std::ofstream(file.path) << "1,2,3\n"
+		                         << "4,x,6\n";
+		assert_throws(matrix::read_csv<double>(file.path), matrix::format_error);
+	}
+
+	void testReadMatrixMarketArray() {
+		temporary_file file;
+		std::ofstream(file.path) << "%%MatrixMarket matrix array real general\n"
+		                         << "% column-major\n"
+		                         << "2 3\n"
+		                         << "1\n4\n2\n5\n3\n6\n";
+
+		auto m = matrix::read_matrix_market<int>(file.path);
+		assert(m == (matrix::dmatrix<int>({ { 1, 2, 3 },
+		                                    { 4, 5, 6 } })));
+	}
+
+	void testReadMatrixMarketCoordinate() {
+		temporary_file file;
+		std::ofstream(file.path) << "%%MatrixMarket matrix coordinate real symmetric\n"
+		                         << "3 3 3\n"
+		                         << "1 1 2.0\n"
+		                         << "3 1 -1.5\n"
+		                         << "2 2 4\n";
+
+		matrix::dmatrix<double> expected({ {  2.0, 0, -1.5 },
+		                                   {    0, 4,    0 },
+		                                   { -1.5, 0,    0 } });
+
+		auto dense = matrix::read_matrix_market<double>(file.path);
+		assert(dense == expected);
+
+		auto sparse = matrix::read_matrix_market_sparse<double>(file.path);
+		assert(sparse.nonzeros() == 4);
+		assert(sparse == expected);
+	}
+
+	void testReadInvalidMatrixMarket() {
+		temporary_file file;
+		std::ofstream(file.path) << "%%MatrixMarket matrix coordinate complex general\n"
+		                         << "1 1 1\n"
+		                         << "1 1 1 0\n";
+		assert_throws(matrix::read_matrix_market<double>(file.path), matrix::format_error);
+
+		std::ofstream(file.path) << "%%MatrixMarket matrix coordinate real general\n"
+		                         << "2 2 2\n"
+		                         << "1 1 1\n";
+		assert_throws(matrix::read_matrix_market<double>(file.path), matrix::format_error);
+
+		std::ofstream(file.path) << "%%MatrixMarket matrix coordinate real general\n"
+		                         << "2 2 1\n"
+		                         << "3 1 1\n";
+		assert_throws(matrix::read_matrix_market_sparse<double>(file.path), matrix::format_error);
+	}
+
+	void test() {
+		testParseNumber();
+		testReadCsv();
+		testReadCsvInParallel();
+		testReadInvalidCsv();
+		testReadMatrixMarketArray();
+		testReadMatrixMarketCoordinate();
+		testReadInvalidMatrixMarket();
+	}
+} /* namespace text_io */
+
+
+namespace numpy_io {
+	void writeNpy(const std::string& path, const std::string& dict, const std::string& data) {
+		std::string header = dict;
+		header.append(63 - (10 + header.size()) % 64, ' ');
+		header += '\n';
+
+		std::ofstream os(path, std::ios::binary);
+		os.write("\x93NUMPY\x01\x00", 8);
+		os.put(char(header.size() & 0xFF));
+		os.put(char(header.size() >> 8));
+		os << header << data;
+	}
+
+	template <typename T>
+	std::string bytesOf(std::initializer_list<T> values) {
+		return std::string(reinterpret_cast<const char*>(values.begin()), values.size() * sizeof(T));
+	}
+
+	void testSaveAndLoadZeroCopy() {
+		matrix::dmatrix<double> m({ { 1.5, 2.5, 3.5 },
+		                            { 4.5, 5.5, 6.5 } });
+		temporary_file file;
+		matrix::save_npy(file.path, m);
+
+		auto loaded = matrix::load_npy<double>(file.path);
+		assert(loaded.is_mapped());
+		assert(loaded == m);
+		assert(reinterpret_cast<std::uintptr_t>(loaded.data()) % 64 == 0);
+	}
+
+	void testLoadWithConversion() {
+		matrix::smatrix<int, 2, 2> m({ { 1, -2 },
+		                               { 3, -4 } });
+		temporary_file file;
+		matrix::save_npy(file.path, m);
+
+		auto loaded = matrix::load_npy<double>(file.path);
+		assert(!loaded.is_mapped());
+		assert(loaded == (matrix::dmatrix<double>({ { 1, -2 },
+		                                            { 3, -4 } })));
+
+		matrix::smatrix<long, 2, 2> sm;
+		matrix::load_npy(file.path, sm);
+		assert(sm == (matrix::smatrix<long, 2, 2>({ { 1, -2 },
+		                                            { 3, -4 } })));
+
+		matrix::smatrix<long, 1, 4> wrong_shape;
+		assert_throws(matrix::load_npy(file.path, wrong_shape), matrix::format_error);
+	}
+
+	void testLoadFortranOrder() {
+		temporary_file file;
+		writeNpy(file.path, "{'descr': '<i4', 'fortran_order': True, 'shape': (2, 3), }",
+		         bytesOf<std::int32_t>({ 1, 4, 2, 5, 3, 6 }));
+
+		auto loaded = matrix::load_npy<std::int32_t>(file.path);
+		assert(!loaded.is_mapped());
+		assert(loaded == (matrix::dmatrix<std::int32_t>({ { 1, 2, 3 },
+		                                                  { 4, 5, 6 } })));
+	}
+
+	void testLoadBigEndianAndVectors() {
+		temporary_file file;
+		writeNpy(file.path, "{'descr': '>u2', 'fortran_order': False, 'shape': (3,), }",
+		         std::string("\x00\x01\x01\x00\xff\xfe", 6));
+
+		auto loaded = matrix::load_npy<unsigned>(file.path);
+		assert(loaded == (matrix::dmatrix<unsigned>({ { 1 }, { 256 }, { 65534 } })));
+	}
+
+	void testLoadLastKeyWithoutComma() {
+		temporary_file file;
+		writeNpy(file.path, "{'descr': '<f8', 'shape': (2,), 'fortran_order': False}", bytesOf<double>({ 1.5, 2.5 }));
+		assert(matrix::load_npy<double>(file.path) == (matrix::dmatrix<double>({ { 1.5 }, { 2.5 } })));
+
+		writeNpy(file.path, "{'descr': '<i4', 'shape': (1, 2), 'fortran_order': True }", bytesOf<std::int32_t>({ 3, 4 }));
+		assert(matrix::load_npy<std::int32_t>(file.path) == (matrix::dmatrix<std::int32_t>({ { 3, 4 } })));
+	}
+
+	void testLoadInvalid() {
+		temporary_file file;
+		writeNpy(file.path, "{'descr': '<c16', 'fortran_order': False, 'shape': (1, 1), }", std::string(16, '\0'));
+		assert_throws(matrix::load_npy<double>(file.path), matrix::format_error);
+
+		writeNpy(file.path, "{'descr': '<f8', 'fortran_order': False, 'shape': (2, 2, 2), }", std::string(64, '\0'));
+		assert_throws(matrix::load_npy<double>(file.path), matrix::format_error);
+
+		writeNpy(file.path, "{'descr': '<f8', 'fortran_order': False, 'shape': (3, 3), }", std::string(64, '\0'));
+		assert_throws(matrix::load_npy<double>(file.path), matrix::format_error);
+
+		writeNpy(file.path, "{'descr': '<f8', 'fortran_order': False, 'shape': (99999999999999999999999, 1), }", "");
+		assert_throws(matrix::load_npy<double>(file.path), matrix::format_error);
+	}
+
+	void testSaveAndLoadNpz() {
+		matrix::dmatrix<double> a({ { 1, 2 },
+		                            { 3, 4 } });
+		matrix::smatrix<float, 1, 3> b({ { 5, 6, 7 } });
+		temporary_file file;
+		{
+			matrix::npz_writer writer(file.path);
+			writer.add("a", a);
+			writer.add("b", b);
+		}
+
+		auto arrays = matrix::load_npz<double>(file.path);
+		assert(arrays.size() == 2);
+		assert(arrays.at("a") == a);
+		assert(arrays.at("a").is_mapped());
+		assert(arrays.at("b") == (matrix::dmatrix<double>({ { 5, 6, 7 } })));
+		assert(!arrays.at("b").is_mapped());
+	}
+
+	// An archive of one central directory entry with the given sizes, local offset and extra field, and no member data
+	std::string zipDirectory(std::uint32_t sizes, std::uint32_t local_offset, const std::string& extra) {
+		using matrix::__impl::append_le;
+		std::string zip;
+		append_le(zip, 0x02014b50, 4);
+		append_le(zip, 45, 2);
+		append_le(zip, 45, 2);
+		append_le(zip, 0, 2);
+		append_le(zip, 0, 2);
+		append_le(zip, 0, 4);
+		append_le(zip, 0, 4);
+		append_le(zip, sizes, 4);
+		append_le(zip, sizes, 4);
+		append_le(zip, 1, 2);
+		append_le(zip, extra.size(), 2);
+		append_le(zip, 0, 2);
+		append_le(zip, 0, 2);
+		append_le(zip, 0, 2);
+		append_le(zip, 0, 4);
+		append_le(zip, local_offset, 4);
+		zip += "a" + extra;
+
+		std::size_t directory_size = zip.size();
+		append_le(zip, 0x06054b50, 4);
+		append_le(zip, 0, 4);
+		append_le(zip, 1, 2);
+		append_le(zip, 1, 2);
+		append_le(zip, directory_size, 4);
+		append_le(zip, 0, 4);
+		append_le(zip, 0, 2);
+		return zip;
+	}
+
+	void testCorruptZipDirectory() {
+		using matrix::__impl::append_le;
+		auto read = [](const std::string& zip) {
+			return matrix::__impl::read_zip_directory(zip.data(), zip.size());
+		};
+
+		// A zip64 field holding the sizes but not the local offset it should also hold
+		std::string short_field;
+		append_le(short_field, 0x0001, 2);
+		append_le(short_field, 16, 2);
+		append_le(short_field, 0, 8);
+		append_le(short_field, 0, 8);
+		assert_throws(read(zipDirectory(0xFFFFFFFF, 0xFFFFFFFF, short_field)), matrix::format_error);
+
+		// An extra field longer than the extra data
+		std::string overlong_field;
+		append_le(overlong_field, 0x0001, 2);
+		append_le(overlong_field, 24, 2);
+		append_le(overlong_field, 0, 8);
+		assert_throws(read(zipDirectory(0xFFFFFFFF, 0xFFFFFFFF, overlong_field)), matrix::format_error);
+
+		// A local offset so large that adding the header size to it wraps around
+		std::string wrapping_offset;
+		append_le(wrapping_offset, 0x0001, 2);
+		append_le(wrapping_offset, 8, 2);
+		append_le(wrapping_offset, std::uint64_t(0) - 16, 8);
+		assert_throws(read(zipDirectory(0, 0xFFFFFFFF, wrapping_offset)), matrix::format_error);
+		assert_throws(read(zipDirectory(0, 0x7FFFFFFF, "")), matrix::format_error);
+	}
+
+	void test() {
+		testSaveAndLoadZeroCopy();
+		testLoadWithConversion();
+		testLoadFortranOrder();
+		testLoadBigEndianAndVectors();
+		testLoadLastKeyWithoutComma();
+		testLoadInvalid();
+		testSaveAndLoadNpz();
+		testCorruptZipDirectory();
+	}
+} /* namespace numpy_io */
+
+
+namespace shared_dmatrix {
+	void testCopiesShareTheBuffer() {
+		matrix::shared_dmatrix<int> mA({ { 1, 2 },
+		                                 { 3, 4 } });
+		assert(!mA.is_shared());
+
+		const matrix::shared_dmatrix<int> mB = mA;
+		assert(mA.is_shared());
+		assert(mB.is_shared());
+		assert(&mA.get() == &mB.get());
+		assert(mB.element_at(1, 0) == 3);
+		assert(mA == mB);
+	}
+
+	void testWriteDetaches() {
+		matrix::shared_dmatrix<int> mA({ { 1, 2 },
+		                                 { 3, 4 } });
+		matrix::shared_dmatrix<int> mB = mA;
+		matrix::shared_dmatrix<int> mC = mA;
+
+		mB.element_at(0, 0) = 10;
+		assert(!mB.is_shared());
+		assert(mA.is_shared());
+		assert(&mA.get() == &mC.get());
+
+		mC[1][1] = 40;
+		assert(!mA.is_shared());
+		assert(!mC.is_shared());
+
+		assert(mA == (matrix::dmatrix<int>({ {  1, 2 }, { 3,  4 } })));
+		assert(mB == (matrix::dmatrix<int>({ { 10, 2 }, { 3,  4 } })));
+		assert(mC == (matrix::dmatrix<int>({ {  1, 2 }, { 3, 40 } })));
+	}
+
+	void testConstSubscriptsDoNotDetach() {
+		matrix::shared_dmatrix<double> mA({ { 1, 2 },
+		                                    { 3, 4 } });
+		auto mB = mA;
+		const auto& cB = mB;
+		double x = cB[0][1];
+		assert(x == 2);
+		assert(cB[matrix::drange(1, 1)] == (matrix::dmatrix<double>({ { 3, 4 } })));
+		assert(cB[matrix::all][matrix::drange(1, 1)] == (matrix::dmatrix<double>({ { 2 }, { 4 } })));
+		assert(mA.is_shared()  &&  mB.is_shared());
+		assert(&mA.get() == &mB.get());
+	}
+
+	void testMakeUnique() {
+		matrix::dmatrix<int> m({ { 1, 2, 3 } });
+		matrix::shared_dmatrix<int> mA(std::move(m));
+		matrix::shared_dmatrix<int> mB(mA);
+
+		const matrix::dmatrix<int>* shared_buffer = &mA.get();
+		matrix::dmatrix<int>& unique = mB.make_unique();
+		assert(&unique != shared_buffer);
+		assert(&mA.make_unique() == shared_buffer);
+
+		unique.element_at(0, 1) = 0;
+		assert(mA == (matrix::dmatrix<int>({ { 1, 2, 3 } })));
+		assert(mB == (matrix::dmatrix<int>({ { 1, 0, 3 } })));
+	}
+
+	void testAssignment() {
+		matrix::shared_dmatrix<int> mA({ { 1 } });
+		matrix::shared_dmatrix<int> mB({ { 2 } });
+
+		mB = mA;
+		assert(&mA.get() == &mB.get());
+		mB = mB;
+		assert(mB.is_shared());
+
+		mA = matrix::shared_dmatrix<int>({ { 3 } });
+		assert(!mB.is_shared());
+		assert(mA == 3);
+		assert(mB == 1);
+	}
+
+	void testMovedFrom() {
+		matrix::shared_dmatrix<int> mA({ { 1, 2 } });
+		matrix::shared_dmatrix<int> mB(std::move(mA));
+		assert(mB.rows() == 1  &&  mB.cols() == 2);
+		assert(mA.rows() == 0  &&  mA.cols() == 0);
+
+		matrix::shared_dmatrix<int> copy(mA);
+		assert(copy.rows() == 0  &&  copy.cols() == 0);
+		copy = mB;
+		assert(copy == mB);
+		assert(mA.make_unique().rows() == 0);
+
+		mA = mB;
+		assert(mA.element_at(0, 1) == 2);
+	}
+
+	void testConcurrentCopies() {
+		matrix::shared_dmatrix<long> m(100, 100);
+		std::vector<std::thread> threads;
+		for(int t = 0; t < 4; ++t) {
+			threads.emplace_back([&m, t]() {
+				for(int i = 0; i < 1000; ++i) {
+					matrix::shared_dmatrix<long> copy(m);
+					if(i % 100 == 0) {
+						copy.element_at(0, 0) = t;
+					}
+				}
+			});
+		}
+		for(auto& thread : threads) {
+			thread.join();
+		}
+
+		assert(!m.is_shared());
+		assert(m.element_at(0, 0) == 0);
+	}
+
+	void test() {
+		testCopiesShareTheBuffer();
+		testWriteDetaches();
+		testConstSubscriptsDoNotDetach();
+		testMakeUnique();
+		testAssignment();
+		testMovedFrom();
+		testConcurrentCopies();
+	}
+} /* namespace shared_dmatrix */
+
+
+namespace hmatrix {
+	using matrix::dynamic_extent;
+
+	void testBasics() {
+		static_assert(std::is_base_of<matrix::dynamic_matrix<matrix::hmatrix<int, dynamic_extent, 3>>,
+		                              matrix::hmatrix<int, dynamic_extent, 3>>::value, "");
+		static_assert(matrix::hmatrix<int, dynamic_extent, 3>::static_cols == 3, "");
+		static_assert(matrix::hmatrix<int, dynamic_extent, 3>::static_rows == dynamic_extent, "");
+	}
+
+	void testSizeConstructor() {
+		matrix::hmatrix<int, dynamic_extent, 3> m(4, 3);
+		assert(m.rows() == 4);
+		assert(m.cols() == 3);
+		assert(m.element_at(3, 2) == 0);
+
+		matrix::hmatrix<int, 2, dynamic_extent> n(2, 5);
+		assert(n.rows() == 2  &&  n.cols() == 5);
+
+		assert_throws((matrix::hmatrix<int, dynamic_extent, 3>(4, 2)), std::invalid_argument);
+		assert_throws((matrix::hmatrix<int, 2, dynamic_extent>(3, 2)), std::invalid_argument);
+	}
+
+	void testInitializerListConstructor() {
+		matrix::hmatrix<int, dynamic_extent, 3> m({ { 1, 2, 3 },
+		                                            { 4, 5 } });
+		assert(m.rows() == 2);
+		assert(m.element_at(0, 2) == 3);
+		assert(m.element_at(1, 2) == 0);
+
+		matrix::hmatrix<int, 3, dynamic_extent> n({ { 1, 2 } });
+		assert(n.rows() == 3  &&  n.cols() == 2);
+		assert(n.element_at(2, 1) == 0);
+
+		assert_throws((matrix::hmatrix<int, dynamic_extent, 2>({ { 1, 2, 3 } })), std::invalid_argument);
+	}
+
+	void testMatrixConstructor() {
+		matrix::dmatrix<int> d({ { 1, 2 },
+		                         { 3, 4 },
+		                         { 5, 6 } });
+		matrix::hmatrix<int, dynamic_extent, 2> m(d);
+		assert(m.rows() == 3);
+		assert(m.element_at(2, 1) == 6);
+
+		assert_throws((matrix::hmatrix<int, dynamic_extent, 3>(d)), std::invalid_argument);
+	}
+
+	void testSubscripts() {
+		matrix::hmatrix<int, dynamic_extent, 3> m({ { 1, 2, 3 },
+		                                            { 4, 5, 6 } });
+		const auto& cm = m;
+
+		assert(m[1][2] == 6);
+		assert(cm[0][1] == 2);
+		m[0][0] = 7;
+		assert(m.element_at(0, 0) == 7);
+		assert(m[matrix::drange(1, 1)][matrix::all] == (matrix::dmatrix<int>({ { 4, 5, 6 } })));
+		assert(m.data()[3] == 4);
+	}
+
+	void testComparison() {
+		matrix::hmatrix<int, dynamic_extent, 2> a({ { 1, 2 }, { 3, 4 } });
+		matrix::hmatrix<int, 2, dynamic_extent> b({ { 1, 2 }, { 3, 4 } });
+		matrix::hmatrix<int, dynamic_extent, 2> c({ { 1, 2 } });
+		matrix::smatrix<int, 2, 2> s({ { 1, 2 }, { 3, 5 } });
+
+		assert(a == b);
+		assert(!(a != b));
+		assert_throws((void)(a == c), matrix::incompatible_operands);
+		assert(a != s);
+		assert(s != b);
+		assert(a == (matrix::dmatrix<int>({ { 1, 2 }, { 3, 4 } })));
+
+		//assert_not_compilable(a == (matrix::hmatrix<int, dynamic_extent, 3>(2, 3)));
+		//assert_not_compilable(a == (matrix::smatrix<int, 2, 3>()));
+	}
+
+	void test() {
+		testBasics();
+		testSizeConstructor();
+		testInitializerListConstructor();
+		testMatrixConstructor();
+		testSubscripts();
+		testComparison();
+	}
+} /* namespace hmatrix */
+
+
+namespace reduce {
+	void testWholeMatrix() {
+		matrix::dmatrix<int> m({ { 3, -1, 4 },
+		                         { 1, -5, 9 } });
+
+		assert(matrix::sum(m) == 11);
+		assert(matrix::product(m) == 540);
+		assert(matrix::min(m) == -5);
+		assert(matrix::max(m) == 9);
+		assert(matrix::argmin(m) == (matrix::element_index{ 1, 1 }));
+		assert(matrix::argmax(m) == (matrix::element_index{ 1, 2 }));
+		assert(matrix::mean(m) == 11.0 / 6);
+		assert(std::abs(matrix::variance(m) - 677.0 / 36) < 1e-12);
+		assert(std::abs(matrix::variance(m, 1) - 677.0 / 30) < 1e-12);
+		assert(matrix::l1_norm(m) == 23);
+		assert(matrix::l2_norm(m) == std::sqrt(133.0));
+		assert(matrix::frobenius_norm(m) == matrix::l2_norm(m));
+		assert(matrix::linf_norm(m) == 9);
+
+		// Ties go to the first element in row-major order
+		matrix::dmatrix<int> ties({ { 1, 7 },
+		                            { 7, 1 } });
+		assert(matrix::argmin(ties) == (matrix::element_index{ 0, 0 }));
+		assert(matrix::argmax(ties) == (matrix::element_index{ 0, 1 }));
+	}
+
+	void testAlongAxes() {
+		matrix::dmatrix<int> m({ { 3, -1, 4 },
+		                         { 1, -5, 9 } });
+
+		assert(matrix::sum(m, matrix::each_row) == (matrix::dmatrix<int>({ { 6 }, { 5 } })));
+		assert(matrix::sum(m, matrix::each_col) == (matrix::dmatrix<int>({ { 4, -6, 13 } })));
+		assert(matrix::product(m, matrix::each_row) == (matrix::dmatrix<int>({ { -12 }, { -45 } })));
+		assert(matrix::min(m, matrix::each_col) == (matrix::dmatrix<int>({ { 1, -5, 4 } })));
+		assert(matrix::max(m, matrix::each_row) == (matrix::dmatrix<int>({ { 4 }, { 9 } })));
+		assert(matrix::argmin(m, matrix::each_row) == (matrix::dmatrix<unsigned>({ { 1 }, { 1 } })));
+		assert(matrix::argmax(m, matrix::each_col) == (matrix::dmatrix<unsigned>({ { 0, 0, 1 } })));
+		assert(matrix::mean(m, matrix::each_col) == (matrix::dmatrix<double>({ { 2, -3, 6.5 } })));
+		assert(matrix::variance(m, matrix::each_col) == (matrix::dmatrix<double>({ { 1, 4, 6.25 } })));
+		assert(matrix::variance(m, matrix::each_col, 1) == (matrix::dmatrix<double>({ { 2, 8, 12.5 } })));
+		assert(matrix::l1_norm(m, matrix::each_row) == (matrix::dmatrix<double>({ { 8 }, { 15 } })));
+		assert(matrix::l2_norm(m, matrix::each_col) == (matrix::dmatrix<double>({ { std::sqrt(10.0), std::sqrt(26.0), std::sqrt(97.0) } })));
+		assert(matrix::linf_norm(m, matrix::each_col) == (matrix::dmatrix<double>({ { 3, 5, 9 } })));
+	}
+
+	void testOtherMatrices() {
+		matrix::dmatrix<int> dm({ { 1, 2, 3, 4 },
+		                          { 5, 6, 7, 8 },
+		                          { 9, 10, 11, 12 } });
+
+		// Regions are reduced where they are
+		auto area = dm[matrix::drange(2, 1)][matrix::drange(2, 1)];
+		assert(matrix::sum(area) == 6 + 7 + 10 + 11);
+		assert(matrix::sum(area, matrix::each_col) == (matrix::dmatrix<int>({ { 16, 18 } })));
+		assert(matrix::argmax(area) == (matrix::element_index{ 1, 1 }));
+		const matrix::dmatrix<int>& const_dm = dm;
+		assert(matrix::max(const_dm[matrix::drange(2, 0)], matrix::each_row) == (matrix::dmatrix<int>({ { 4 }, { 8 } })));
+
+		matrix::smatrix<int, 2, 3> sm({ { 1, 2, 3 },
+		                                { 4, 5, 6 } });
+		assert(matrix::sum(sm) == 21);
+		assert(matrix::mean(sm[1]) == 5);
+		assert(matrix::sum(sm[matrix::all][matrix::srange<2>(1)], matrix::each_row) == (matrix::dmatrix<int>({ { 5 }, { 11 } })));
+
+		matrix::hmatrix<int, matrix::dynamic_extent, 2> hm({ { 1, 2 }, { 3, 4 } });
+		assert(matrix::product(hm) == 24);
+
+		auto csr = matrix::csr_matrix<double>::from_entries(2, 3, { { 0, 1, -2.0 }, { 1, 2, 3.0 } });
+		assert(matrix::sum(csr) == 1);
+		assert(matrix::min(csr, matrix::each_row) == (matrix::dmatrix<double>({ { -2 }, { 0 } })));
+		assert(matrix::argmax(csr) == (matrix::element_index{ 1, 2 }));
+	}
+
+	void testEmpty() {
+		matrix::dmatrix<double> empty(0, 3);
+
+		assert(matrix::sum(empty) == 0);
+		assert(matrix::l2_norm(empty) == 0);
+		assert(matrix::sum(empty, matrix::each_row).rows() == 0);
+		assert(matrix::sum(empty, matrix::each_col) == (matrix::dmatrix<double>({ { 0, 0, 0 } })));
+		assert_throws(matrix::min(empty), std::invalid_argument);
+		assert_throws(matrix::argmax(empty), std::invalid_argument);
+		assert_throws(matrix::mean(empty, matrix::each_col), std::invalid_argument);
+		assert(matrix::max(empty, matrix::each_row).rows() == 0);
+
+		matrix::dmatrix<double> one({ { 2.5 } });
+		assert(matrix::variance(one) == 0);
+		assert_throws(matrix::variance(one, 1), std::invalid_argument);
+	}
+
+	void testNaN() {
+		double nan = std::numeric_limits<double>::quiet_NaN();
+		matrix::dmatrix<double> m({ { nan, 2, nan }, { -1, nan, 3 } });
+		assert(matrix::min(m) == -1);
+		assert(matrix::max(m) == 3);
+
+		matrix::dmatrix<double> nans({ { nan, nan }, { nan, 4 } });
+		assert(std::isnan(matrix::min(nans[0])));
+		assert(std::isnan(matrix::max(nans[0])));
+		auto col_min = matrix::min(nans, matrix::each_col);
+		assert(std::isnan(col_min.element_at(0, 0))  &&  col_min.element_at(0, 1) == 4);
+		auto row_max = matrix::max(nans, matrix::each_row);
+		assert(std::isnan(row_max.element_at(0, 0))  &&  row_max.element_at(1, 0) == 4);
+
+		double inf = std::numeric_limits<double>::infinity();
+		assert(matrix::min(matrix::dmatrix<double>({ { inf, nan } })) == inf);
+		assert(matrix::max(matrix::dmatrix<double>({ { nan, -inf } })) == -inf);
+
+		// argmin and argmax skip leading NaNs, and give the first NaN when there is nothing else
+		assert(matrix::argmin(m) == (matrix::element_index{ 1, 0 }));
+		assert(matrix::argmax(m) == (matrix::element_index{ 1, 2 }));
+		assert(matrix::argmin(m, matrix::each_row) == (matrix::dmatrix<unsigned>({ { 1 }, { 0 } })));
+		assert(matrix::argmax(m, matrix::each_col) == (matrix::dmatrix<unsigned>({ { 1, 0, 1 } })));
+		assert(matrix::argmax(nans, matrix::each_row) == (matrix::dmatrix<unsigned>({ { 0 }, { 1 } })));
+		assert(matrix::argmin(nans, matrix::each_col) == (matrix::dmatrix<unsigned>({ { 0, 1 } })));
+		assert(matrix::argmin(nans[0]) == (matrix::element_index{ 0, 0 }));
+	}
+
+	void testParallel() {
+		auto m = matrix::dmatrix<double>::generate(1000, 300, [](unsigned row, unsigned col) {
+			return std::sin(row * 0.37 + col * 1.9) * 100;
+		});
+
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options threads;
+		threads.context = &context;
+		matrix::parallel_options serial;
+		serial.max_threads = 1;
+
+		// Rows are split the same way whatever the threads, so results agree exactly
+		assert(matrix::sum(m, threads) == matrix::sum(m, serial));
+		assert(matrix::variance(m, 0, threads) == matrix::variance(m, 0, serial));
+		assert(matrix::sum(m, matrix::each_col, threads) == matrix::sum(m, matrix::each_col, serial));
+		assert(matrix::argmin(m, threads) == matrix::argmin(m, serial));
+		assert(matrix::argmax(m, matrix::each_col, threads) == matrix::argmax(m, matrix::each_col, serial));
+
+		double expected_sum = 0;
+		double expected_max = m.element_at(0, 0);
+		matrix::element_index expected_argmax = { 0, 0 };
+		for(unsigned row = 0; row < m.rows(); ++row) {
+			for(unsigned col = 0; col < m.cols(); ++col) {
+				expected_sum += m.element_at(row, col);
+				if(m.element_at(row, col) > expected_max) {
+					expected_max = m.element_at(row, col);
+					expected_argmax = { row, col };
+				}
+			}
+		}
+		assert(std::abs(matrix::sum(m, threads) - expected_sum) < 1e-6);
+		assert(matrix::max(m, threads) == expected_max);
+		assert(matrix::argmax(m, threads) == expected_argmax);
+
+		auto col_sums = matrix::sum(m, matrix::each_col, threads);
+		double col_sum = 0;
+		for(unsigned row = 0; row < m.rows(); ++row) {
+			col_sum += m.element_at(row, 7);
+		}
+		assert(std::abs(col_sums.element_at(0, 7) - col_sum) < 1e-9);
+	}
+
+	void test() {
+		testWholeMatrix();
+		testAlongAxes();
+		testOtherMatrices();
+		testEmpty();
+		testNaN();
+		testParallel();
+	}
+} /* namespace reduce */
+
+
+namespace transform {
+	void testMap() {
+		matrix::dmatrix<int> a({ { 1, 2, 3 },
+		                         { 4, 5, 6 } });
+		matrix::smatrix<double, 2, 3> b({ { 0.5, 0.5, 0.5 },
+		                                  { 1.5, 1.5, 1.5 } });
+
+		auto squares = matrix::map([](int x) { return x * x; }, a);
+		assert(squares == (matrix::dmatrix<int>({ { 1, 4, 9 },
+		                                          { 16, 25, 36 } })));
+
+		// The result has whatever type the function returns
+		auto sums = matrix::map([](int x, double y) { return x + y; }, a, b);
+		static_assert(std::is_same<decltype(sums), matrix::dmatrix<double>>::value, "");
+		assert(sums == (matrix::dmatrix<double>({ { 1.5, 2.5, 3.5 },
+		                                          { 5.5, 6.5, 7.5 } })));
+
+		auto column = matrix::map([](int x) { return x * 10; }, a[matrix::all][1]);
+		assert(column == (matrix::dmatrix<int>({ { 20 }, { 50 } })));
+
+		auto csr = matrix::csr_matrix<int>::from_entries(2, 3, { { 1, 2, 7 } });
+		assert(matrix::map([](int x, int y) { return x - y; }, csr, a) == (matrix::dmatrix<int>({ { -1, -2, -3 },
+		                                                                                          { -4, -5, 1 } })));
+
+		assert_throws(matrix::map([](int x, int y) { return x + y; }, a, matrix::dmatrix<int>(3, 2)), matrix::incompatible_operands);
+	}
+
+	void testTransformInto() {
+		matrix::dmatrix<int> a({ { 1, 2, 3 },
+		                         { 4, 5, 6 } });
+		matrix::dmatrix<int> b(2, 3);
+
+		matrix::transform_into(b, [](int x, int y) { return x * y; }, a, a);
+		assert(b == (matrix::dmatrix<int>({ { 1, 4, 9 },
+		                                    { 16, 25, 36 } })));
+
+		// In place, and into a region from a region
+		matrix::transform_into(a, [](int x) { return -x; }, a);
+		assert(a == (matrix::dmatrix<int>({ { -1, -2, -3 },
+		                                    { -4, -5, -6 } })));
+		matrix::transform_into(a[matrix::all][matrix::drange(2, 1)], [](int x) { return x + 1; }, b[matrix::all][matrix::drange(2, 0)]);
+		assert(a == (matrix::dmatrix<int>({ { -1, 2, 5 },
+		                                    { -4, 17, 26 } })));
+
+		matrix::smatrix<int, 2, 2> s;
+		matrix::transform_into(s[1], [](int x) { return x + 3; }, a[1][matrix::drange(2, 0)]);
+		assert(s == (matrix::smatrix<int, 2, 2>({ { 0, 0 },
+		                                          { -1, 20 } })));
+
+		assert_throws(matrix::transform_into(b, [](int x) { return x; }, s), matrix::incompatible_operands);
+	}
+
+	void testParallel() {
+		auto a = matrix::dmatrix<double>::generate(500, 300, [](unsigned row, unsigned col) { return row - 0.5 * col; });
+
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+
+		std::atomic<unsigned long> calls(0);
+		auto doubled = matrix::map(options, [&](double x) { ++calls; return 2 * x; }, a);
+		assert(calls == 500 * 300);
+		for(unsigned row = 0; row < a.rows(); ++row) {
+			for(unsigned col = 0; col < a.cols(); ++col) {
+				assert(doubled.element_at(row, col) == 2 * a.element_at(row, col));
+			}
+		}
+
+		matrix::transform_into(options, doubled, [](double x, double y) { return x - 2 * y; }, doubled, a);
+		assert(doubled == matrix::dmatrix<double>(500, 300));
+	}
+
+	void test() {
+		testMap();
+		testTransformInto();
+		testParallel();
+	}
+} /* namespace transform */
+
+
+namespace gemm {
+	template <typename MA, typename MB>
+	matrix::dmatrix<double> naive_product(const matrix::matrix<MA>& a, const matrix::matrix<MB>& b) {
+		return matrix::dmatrix<double>::generate(matrix::rows(a), matrix::cols(b), [&](unsigned row, unsigned col) {
+			double sum = 0;
+			for(unsigned k = 0; k < matrix::cols(a); ++k) {
+				sum += matrix::element_at(a, row, k) * matrix::element_at(b, k, col);
+			}
+			return sum;
+		});
+	}
+
+	template <typename ML, typename MR>
+	double max_difference(const matrix::matrix<ML>& lhs, const matrix::matrix<MR>& rhs) {
+		return matrix::linf_norm(matrix::map([](double x, double y) { return x - y; }, lhs, rhs));
+	}
+
+	void testMultiply() {
+		matrix::dmatrix<double> a({ { 1, 2, 3 },
+		                            { 4, 5, 6 } });
+		matrix::smatrix<double, 3, 2> b({ { 1, -1 },
+		                                  { 0, 2 },
+		                                  { -2, 1 } });
+		assert(matrix::multiply(a, b) == (matrix::dmatrix<double>({ { -5, 6 },
+		                                                             { -8, 12 } })));
+
+		// Sizes that are not multiples of any block, on every edge
+		auto c = matrix::dmatrix<double>::generate(131, 300, [](unsigned row, unsigned col) { return (row * 7 + col * 3) % 11 - 5.0; });
+		auto d = matrix::dmatrix<double>::generate(300, 77, [](unsigned row, unsigned col) { return (row * 5 + col) % 13 * 0.25; });
+		assert(max_difference(matrix::multiply(c, d), naive_product(c, d)) < 1e-9);
+
+		// Regions, and operands without contiguous rows
+		auto e = c[matrix::drange(20, 10)][matrix::drange(30, 40)];
+		auto f = d[matrix::drange(30, 5)][matrix::drange(9, 1)];
+		assert(max_difference(matrix::multiply(e, f), naive_product(e, f)) < 1e-9);
+		auto csr = matrix::csr_matrix<double>::from_entries(2, 3, { { 0, 1, 2 }, { 1, 0, -1 } });
+		assert(matrix::multiply(csr, b) == (matrix::dmatrix<double>({ { 0, 4 },
+		                                                               { -1, 1 } })));
+
+		assert_throws(matrix::multiply(a, a), matrix::incompatible_operands);
+	}
+
+	void testMultiplyInto() {
+		matrix::dmatrix<double> a({ { 1, 2 },
+		                            { 3, 4 } });
+		matrix::dmatrix<double> c({ { 1, 1, 1 },
+		                            { 1, 1, 1 } });
+
+		// c = 2 * a * a + 3 * c, into a region of c
+		matrix::multiply_into(c[matrix::all][matrix::drange(2, 1)], a, a, 2.0, 3.0);
+		assert(c == (matrix::dmatrix<double>({ { 1, 17, 23 },
+		                                       { 1, 33, 47 } })));
+
+		// A zero beta ignores whatever c held
+		c.element_at(0, 0) = std::nan("");
+		matrix::multiply_into(c[matrix::all][matrix::drange(2, 0)], a, a);
+		assert(c == (matrix::dmatrix<double>({ { 7, 10, 23 },
+		                                       { 15, 22, 47 } })));
+
+		assert_throws(matrix::multiply_into(c, a, a), matrix::incompatible_operands);
+	}
+
+	void testParallel() {
+		auto a = matrix::dmatrix<double>::generate(300, 200, [](unsigned row, unsigned col) { return std::sin(row + 0.5 * col); });
+		auto b = matrix::dmatrix<double>::generate(200, 600, [](unsigned row, unsigned col) { return std::cos(0.25 * row - col); });
+
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+		assert(max_difference(matrix::multiply(a, b, options), naive_product(a, b)) < 1e-9);
+	}
+
+	void test() {
+		testMultiply();
+		testMultiplyInto();
+		testParallel();
+	}
+} /* namespace gemm */
+
+
+namespace lu {
+	// P * A from the pivots, to compare with L * U
+	matrix::dmatrix<double> permuted(matrix::dmatrix<double> a, const std::vector<unsigned>& pivots) {
+		for(unsigned row = 0; row < a.rows(); ++row) {
+			for(unsigned col = 0; col < a.cols(); ++col) {
+				std::swap(a.element_at(row, col), a.element_at(pivots[row], col));
+			}
+		}
+		return a;
+	}
+
+	matrix::dmatrix<double> product_of_factors(const matrix::dmatrix<double>& factors) {
+		auto l = matrix::dmatrix<double>::generate(factors.rows(), factors.cols(), [&](unsigned row, unsigned col) {
+			return row == col ? 1 : row > col ? factors.element_at(row, col) : 0;
+		});
+		auto u = matrix::dmatrix<double>::generate(factors.rows(), factors.cols(), [&](unsigned row, unsigned col) {
+			return row <= col ? factors.element_at(row, col) : 0;
+		});
+		return gemm::naive_product(l, u);
+	}
+
+	void testFactorization() {
+		matrix::dmatrix<double> a({ { 0, 2, 1 },
+		                            { 1, 1, 1 },
+		                            { 4, 2, 0 } });
+		auto factorization = matrix::lu(a);
+		assert(!factorization.singular());
+		assert(factorization.pivots() == (std::vector<unsigned>{ 2, 2, 2 }));
+		assert(gemm::max_difference(product_of_factors(factorization.factors()), permuted(a, factorization.pivots())) < 1e-12);
+		assert(std::abs(factorization.determinant() - 6) < 1e-12);
+
+		// Several panels, and every pivot is a row swap away
+		auto b = matrix::dmatrix<double>::generate(200, 200, [](unsigned row, unsigned col) {
+			return std::sin(row * 1.7 + col * 0.3) + (row == 199 - col ? 2 : 0);
+		});
+		auto large = matrix::lu(b);
+		assert(gemm::max_difference(product_of_factors(large.factors()), permuted(b, large.pivots())) < 1e-10);
+
+		assert_throws(matrix::lu(matrix::dmatrix<double>(2, 3)), std::invalid_argument);
+	}
+
+	void testSolve() {
+		matrix::dmatrix<double> a({ { 0, 2, 1 },
+		                            { 1, 1, 1 },
+		                            { 4, 2, 0 } });
+		matrix::smatrix<double, 3, 2> b({ { 3, 3 },
+		                                  { 3, 4 },
+		                                  { 6, 10 } });
+		auto x = matrix::solve(matrix::lu(a), b);
+		assert(gemm::max_difference(x, matrix::dmatrix<double>({ { 1, 2 },
+		                                                         { 1, 1 },
+		                                                         { 1, 1 } })) < 1e-12);
+
+		auto c = matrix::dmatrix<double>::generate(150, 150, [](unsigned row, unsigned col) {
+			return (row == col ? 40.0 : 0.0) + std::cos(row * 0.7 - col * 1.3);
+		});
+		auto d = matrix::dmatrix<double>::generate(150, 70, [](unsigned row, unsigned col) { return row * 0.01 - col; });
+
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+		auto y = matrix::solve(matrix::lu(c, options), d, options);
+		assert(gemm::max_difference(gemm::naive_product(c, y), d) < 1e-10);
+
+		assert_throws(matrix::solve(matrix::lu(a), matrix::dmatrix<double>(2, 1)), matrix::incompatible_operands);
+	}
+
+	void testSingular() {
+		matrix::dmatrix<double> a({ { 1, 2 },
+		                            { 2, 4 } });
+		auto factorization = matrix::lu(std::move(a));
+		assert(factorization.singular());
+		assert(factorization.determinant() == 0);
+		assert_throws(matrix::solve(factorization, matrix::dmatrix<double>(2, 1)), std::domain_error);
+	}
+
+	void test() {
+		testFactorization();
+		testSolve();
+		testSingular();
+	}
+} /* namespace lu */
+
+
+namespace cholesky {
+	// b * transpose(b) + n * identity, well away from singular
+	matrix::dmatrix<double> positive_definite(unsigned n) {
+		auto b = matrix::dmatrix<double>::generate(n, n, [](unsigned row, unsigned col) { return std::sin(row * 0.9 + col * 2.3); });
+		auto a = gemm::naive_product(b, matrix::dmatrix<double>::generate(n, n, [&](unsigned row, unsigned col) {
+			return b.element_at(col, row);
+		}));
+		for(unsigned index = 0; index < n; ++index) {
+			a.element_at(index, index) += n;
+		}
+		return a;
+	}
+
+	matrix::dmatrix<double> transposed(const matrix::dmatrix<double>& m) {
+		return matrix::dmatrix<double>::generate(m.cols(), m.rows(), [&](unsigned row, unsigned col) { return m.element_at(col, row); });
+	}
+
+	// l * d * transpose(l), from the packed factors of ldlt
+	matrix::dmatrix<double> product_of_ldlt(const matrix::dmatrix<double>& factors) {
+		auto ld = matrix::dmatrix<double>::generate(factors.rows(), factors.cols(), [&](unsigned row, unsigned col) {
+			return row == col ? factors.element_at(col, col) : row > col ? factors.element_at(row, col) * factors.element_at(col, col) : 0;
+		});
+		auto l = matrix::dmatrix<double>::generate(factors.rows(), factors.cols(), [&](unsigned row, unsigned col) {
+			return row == col ? 1 : row > col ? factors.element_at(row, col) : 0;
+		});
+		return gemm::naive_product(ld, transposed(l));
+	}
+
+	void testCholesky() {
+		matrix::dmatrix<double> a({ { 4, 2, -2 },
+		                            { 2, 10, 2 },
+		                            { -2, 2, 6 } });
+		auto factorization = matrix::cholesky(a);
+		assert(gemm::max_difference(factorization.factor(), matrix::dmatrix<double>({ { 2, 0, 0 },
+		                                                                             { 1, 3, 0 },
+		                                                                             { -1, 1, 2 } })) < 1e-12);
+		assert(std::abs(factorization.log_determinant() - std::log(144.0)) < 1e-12);
+
+		// Only the lower triangle is read
+		a.element_at(0, 2) = 100;
+		assert(matrix::cholesky(a).factor() == factorization.factor());
+
+		// Several panels
+		auto b = positive_definite(150);
+		auto large = matrix::cholesky(b);
+		assert(gemm::max_difference(gemm::naive_product(large.factor(), transposed(large.factor())), b) < 1e-9);
+
+		auto rhs = matrix::dmatrix<double>::generate(150, 3, [](unsigned row, unsigned col) { return row * 0.5 - col; });
+		assert(gemm::max_difference(gemm::naive_product(b, matrix::solve(large, rhs)), rhs) < 1e-9);
+
+		assert_throws(matrix::cholesky(matrix::dmatrix<double>({ { 1, 2 }, { 2, 1 } })), std::domain_error);
+		assert_throws(matrix::cholesky(matrix::dmatrix<double>(2, 3)), std::invalid_argument);
+		assert_throws(matrix::solve(large, matrix::dmatrix<double>(3, 1)), matrix::incompatible_operands);
+	}
+
+	void testUpdateAndDowndate() {
+		auto a = positive_definite(140);
+		auto x = matrix::dmatrix<double>::generate(140, 3, [](unsigned row, unsigned col) { return std::cos(row * 0.3 + col); });
+		auto updated = a;
+		matrix::multiply_into(updated, x, transposed(x), 1.0, 1.0);
+
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+
+		auto factorization = matrix::cholesky(a, options);
+		factorization.update(x, options);
+		assert(gemm::max_difference(factorization.factor(), matrix::cholesky(updated).factor()) < 1e-9);
+		factorization.downdate(x, options);
+		assert(gemm::max_difference(factorization.factor(), matrix::cholesky(a).factor()) < 1e-9);
+
+		// Taking away more than there is leaves no positive definite matrix
+		matrix::dmatrix<double> one({ { 1 } });
+		auto small = matrix::cholesky(one);
+		assert_throws(small.downdate(matrix::dmatrix<double>({ { 2 } })), std::domain_error);
+		assert_throws(factorization.update(matrix::dmatrix<double>(3, 1)), matrix::incompatible_operands);
+	}
+
+	void testLdlt() {
+		// Indefinite, which Cholesky would refuse
+		matrix::dmatrix<double> a({ { 4, 2, -2 },
+		                            { 2, -3, 1 },
+		                            { -2, 1, 5 } });
+		auto factorization = matrix::ldlt(a);
+		assert(gemm::max_difference(product_of_ldlt(factorization.factors()), a) < 1e-12);
+		assert(std::abs(factorization.determinant() - -80) < 1e-12);
+
+		matrix::dmatrix<double> b({ { 1 }, { 2 }, { 3 } });
+		assert(gemm::max_difference(gemm::naive_product(a, matrix::solve(factorization, b)), b) < 1e-12);
+
+		auto c = positive_definite(130);
+		auto large = matrix::ldlt(c);
+		assert(gemm::max_difference(product_of_ldlt(large.factors()), c) < 1e-9);
+
+		auto x = matrix::dmatrix<double>::generate(130, 2, [](unsigned row, unsigned col) { return std::sin(row * 0.7 - col); });
+		auto updated = c;
+		matrix::multiply_into(updated, x, transposed(x), 1.0, 1.0);
+		large.update(x);
+		assert(gemm::max_difference(large.factors(), matrix::ldlt(updated).factors()) < 1e-9);
+		large.downdate(x);
+		assert(gemm::max_difference(large.factors(), matrix::ldlt(c).factors()) < 1e-9);
+
+		assert_throws(matrix::ldlt(matrix::dmatrix<double>({ { 0, 1 }, { 1, 0 } })), std::domain_error);
+	}
+
+	void test() {
+		testCholesky();
+		testUpdateAndDowndate();
+		testLdlt();
+	}
+} /* namespace cholesky */
+
+
+namespace qr {
+	void testFactorization() {
+		matrix::dmatrix<double> a({ { 3, 1 },
+		                            { 4, 2 },
+		                            { 0, 2 } });
+		auto factorization = matrix::qr(a);
+		auto q = factorization.q();
+		auto r = factorization.r();
+		assert(std::abs(std::abs(r.element_at(0, 0)) - 5) < 1e-12);
+		assert(r.element_at(1, 0) == 0);
+		assert(gemm::max_difference(matrix::multiply(q, r), a) < 1e-12);
+
+		// Several panels, each factored down to leaves, and many rows
+		auto b = matrix::dmatrix<double>::generate(900, 75, [](unsigned row, unsigned col) { return std::sin(row * 1.3 + col * 0.7 + row * col * 0.01); });
+		auto large = matrix::qr(b);
+		auto large_q = large.q();
+		assert(gemm::max_difference(matrix::multiply(large_q, large.r()), b) < 1e-11);
+		auto identity = matrix::dmatrix<double>::generate(75, 75, [](unsigned row, unsigned col) { return row == col ? 1.0 : 0.0; });
+		assert(gemm::max_difference(gemm::naive_product(cholesky::transposed(large_q), large_q), identity) < 1e-12);
+		assert(gemm::max_difference(large.transpose_q_times(b)[matrix::drange(75, 0)], large.r()) < 1e-11);
+
+		// A column of zeros needs no reflector
+		matrix::dmatrix<double> c({ { 0, 1 },
+		                            { 0, 1 } });
+		assert(gemm::max_difference(matrix::multiply(matrix::qr(c).q(), matrix::qr(c).r()), c) < 1e-12);
+
+		assert_throws(matrix::qr(matrix::dmatrix<double>(2, 3)), std::invalid_argument);
+	}
+
+	void testLeastSquares() {
+		// The line through (0, 1), (1, 3), (2, 5) and (3, 7) is y = 1 + 2x
+		matrix::dmatrix<double> a({ { 1, 0 },
+		                            { 1, 1 },
+		                            { 1, 2 },
+		                            { 1, 3 } });
+		matrix::dmatrix<double> b({ { 1 }, { 3 }, { 5 }, { 7 } });
+		assert(gemm::max_difference(matrix::lstsq(a, b), matrix::dmatrix<double>({ { 1 }, { 2 } })) < 1e-12);
+
+		// The residual of the solution is orthogonal to the columns of a
+		auto c = matrix::dmatrix<double>::generate(5000, 40, [](unsigned row, unsigned col) { return std::sin((row + 1) * (col + 1) * 0.013) + (row % 41 == col); });
+		auto d = matrix::dmatrix<double>::generate(5000, 2, [](unsigned row, unsigned col) { return std::sin(row * 0.01 + col); });
+
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+		auto x = matrix::lstsq(c, d, options);
+		auto residual = matrix::map([](double y, double z) { return y - z; }, matrix::multiply(c, x), d);
+		assert(matrix::linf_norm(matrix::multiply(cholesky::transposed(c), residual)) < 1e-9);
+
+		matrix::dmatrix<double> dependent({ { 1, 2 },
+		                                    { 2, 4 },
+		                                    { 3, 6 } });
+		assert_throws(matrix::lstsq(dependent, matrix::dmatrix<double>(3, 1)), std::domain_error);
+		assert_throws(matrix::lstsq(a, matrix::dmatrix<double>(3, 1)), matrix::incompatible_operands);
+	}
+
+	void test() {
+		testFactorization();
+		testLeastSquares();
+	}
+} /* namespace qr */
+
+
+namespace triangular {
+	// op(a) as a dense matrix, with the other triangle zero
+	template <typename M>
+	matrix::dmatrix<double> dense(const matrix::matrix<M>& a, matrix::triangle uplo, matrix::diagonal diag, bool transposed) {
+		return matrix::dmatrix<double>::generate(matrix::rows(a), matrix::cols(a), [&](unsigned row, unsigned col) {
+			unsigned a_row = transposed ? col : row;
+			unsigned a_col = transposed ? row : col;
+			if(a_row == a_col) {
+				return diag == matrix::diagonal::unit ? 1.0 : matrix::element_at(a, a_row, a_col);
+			}
+			return (uplo == matrix::triangle::lower) == (a_row > a_col) ? matrix::element_at(a, a_row, a_col) : 0.0;
+		});
+	}
+
+	void testAllVariants() {
+		// Blocks of a larger matrix, with garbage in the triangle that is not read
+		auto big = matrix::dmatrix<double>::generate(200, 200, [](unsigned row, unsigned col) {
+			return row == col ? 3.0 + row % 5 : std::sin(row * 0.7 + col * 1.9) * 0.3;
+		});
+		auto a = big[matrix::drange(130, 10)][matrix::drange(130, 10)];
+		auto original = matrix::dmatrix<double>::generate(130, 70, [](unsigned row, unsigned col) { return std::cos(row * 0.3 - col * 0.11); });
+
+		for(auto where : { matrix::side::left, matrix::side::right }) {
+			for(auto uplo : { matrix::triangle::lower, matrix::triangle::upper }) {
+				for(auto diag : { matrix::diagonal::non_unit, matrix::diagonal::unit }) {
+					for(bool transposed : { false, true }) {
+						auto op_a = dense(a, uplo, diag, transposed);
+						matrix::dmatrix<double> b = where == matrix::side::left ? original : cholesky::transposed(original);
+						auto expected = where == matrix::side::left ? gemm::naive_product(op_a, b) : gemm::naive_product(b, op_a);
+
+						auto product = b;
+						matrix::triangular_multiply_into(product, a, where, uplo, diag, transposed, 2.0);
+						assert(gemm::max_difference(product, matrix::map([](double x) { return 2 * x; }, expected)) < 1e-11);
+
+						auto x = expected;
+						matrix::triangular_solve_into(x, a, where, uplo, diag, transposed);
+						assert(gemm::max_difference(x, b) < 1e-11);
+					}
+				}
+			}
+		}
+	}
+
+	void testRegions() {
+		// Solving with the diagonal block of a matrix for the block right of it, in place
+		matrix::dmatrix<double> m({ { 2, 0, 4, 6 },
+		                            { 1, 1, 3, 5 } });
+		matrix::triangular_solve_into(m[matrix::all][matrix::drange(2, 2)], m[matrix::all][matrix::drange(2, 0)],
+		                              matrix::side::left, matrix::triangle::lower);
+		assert(m == (matrix::dmatrix<double>({ { 2, 0, 2, 3 },
+		                                       { 1, 1, 1, 2 } })));
+
+		matrix::triangular_multiply_into(m[matrix::all][matrix::drange(2, 2)], m[matrix::all][matrix::drange(2, 0)],
+		                                 matrix::side::left, matrix::triangle::lower);
+		assert(m == (matrix::dmatrix<double>({ { 2, 0, 4, 6 },
+		                                       { 1, 1, 3, 5 } })));
+
+		matrix::dmatrix<double> a({ { 1, 2 },
+		                            { 0, 1 } });
+		assert_throws(matrix::triangular_solve_into(m, a, matrix::side::right, matrix::triangle::upper), matrix::incompatible_operands);
+		assert_throws(matrix::triangular_multiply_into(m, m, matrix::side::left, matrix::triangle::upper), matrix::incompatible_operands);
+	}
+
+	void testParallel() {
+		auto a = matrix::dmatrix<double>::generate(150, 150, [](unsigned row, unsigned col) { return row == col ? 2.0 : 0.01 * (row + col); });
+		auto b = matrix::dmatrix<double>::generate(150, 300, [](unsigned row, unsigned col) { return std::sin(row + 0.5 * col); });
+
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+		auto x = b;
+		matrix::triangular_solve_into(x, a, matrix::side::left, matrix::triangle::upper, matrix::diagonal::non_unit, false, 1.0, options);
+		matrix::triangular_multiply_into(x, a, matrix::side::left, matrix::triangle::upper, matrix::diagonal::non_unit, false, 1.0, options);
+		assert(gemm::max_difference(x, b) < 1e-12);
+	}
+
+	void test() {
+		testAllVariants();
+		testRegions();
+		testParallel();
+	}
+} /* namespace triangular */
+
+
+namespace krylov {
+	// Diagonally dominant, with a band far enough from the diagonal that ILU(0) drops fill
+	matrix::csr_matrix<double> banded(unsigned n, bool symmetric) {
+		std::vector<matrix::sparse_entry<double>> entries;
+		for(unsigned row = 0; row < n; ++row) {
+			entries.push_back({ row, row, 4.0 + row % 3 });
+			if(row > 0) {
+				entries.push_back({ row, row - 1, -1.0 });
+			}
+			if(row + 1 < n) {
+				entries.push_back({ row, row + 1, symmetric ? -1.0 : -0.4 });
+			}
+			if(row + 7 < n) {
+				entries.push_back({ row, row + 7, -0.5 });
+				entries.push_back({ row + 7, row, symmetric ? -0.5 : 0.8 });
+			}
+		}
+		return matrix::csr_matrix<double>::from_entries(n, n, std::move(entries));
+	}
+
+	matrix::dmatrix<double> right_hand_side(unsigned n) {
+		return matrix::dmatrix<double>::generate(n, 1, [](unsigned row, unsigned) { return std::sin(row * 0.37) + 0.5; });
+	}
+
+	template <typename M>
+	double relative_residual(const matrix::matrix<M>& a, const matrix::dmatrix<double>& x, const matrix::dmatrix<double>& b) {
+		return gemm::max_difference(gemm::naive_product(a, x), b) / matrix::linf_norm(b);
+	}
+
+	template <typename Solver>
+	void testSolver(Solver solve, bool symmetric) {
+		unsigned n = 300;
+		auto a = banded(n, symmetric);
+		auto b = right_hand_side(n);
+		matrix::iterative_options settings;
+		settings.tolerance = 1e-10;
+
+		matrix::dmatrix<double> x(n, 1);
+		auto plain = solve(x, a, b, matrix::identity_preconditioner(), settings);
+		assert(plain.converged  &&  plain.relative_residual <= 1e-10);
+		assert(relative_residual(a, x, b) < 1e-9);
+
+		matrix::dmatrix<double> jacobi_x(n, 1);
+		auto jacobi = solve(jacobi_x, a, b, matrix::jacobi_preconditioner<double>(a), settings);
+		assert(jacobi.converged  &&  relative_residual(a, jacobi_x, b) < 1e-9);
+
+		matrix::dmatrix<double> ilu_x(n, 1);
+		auto ilu = solve(ilu_x, a, b, matrix::ilu0_preconditioner<double>(a), settings);
+		assert(ilu.converged  &&  relative_residual(a, ilu_x, b) < 1e-9);
+		assert(ilu.iterations < plain.iterations);
+
+		// The same operator, dense and as a functor
+		matrix::dmatrix<double> dense = matrix::dmatrix<double>::generate(n, n, [&](unsigned row, unsigned col) { return a.element_at(row, col); });
+		matrix::dmatrix<double> dense_x(n, 1);
+		auto dense_result = solve(dense_x, dense, b, matrix::identity_preconditioner(), settings);
+		assert(dense_result.converged  &&  gemm::max_difference(dense_x, x) < 1e-9);
+
+		auto functor = [&](const double* v, double* y) {
+			for(unsigned row = 0; row < n; ++row) {
+				y[row] = 0;
+				for(unsigned col = 0; col < n; ++col) {
+					y[row] += dense.element_at(row, col) * v[col];
+				}
+			}
+		};
+		matrix::dmatrix<double> functor_x(n, 1);
+		assert(solve(functor_x, functor, b, matrix::identity_preconditioner(), settings).converged);
+		assert(gemm::max_difference(functor_x, x) < 1e-9);
+
+		// Starting from the solution takes no iteration
+		auto again = solve(x, a, b, matrix::identity_preconditioner(), settings);
+		assert(again.iterations == 0  &&  again.converged);
+
+		// Nor does a zero right-hand side
+		matrix::dmatrix<double> zero_b(n, 1);
+		auto zero = solve(x, a, zero_b, matrix::identity_preconditioner(), settings);
+		assert(zero.converged  &&  matrix::linf_norm(x) == 0);
+
+		settings.max_iterations = 3;
+		matrix::dmatrix<double> partial_x(n, 1);
+		auto partial = solve(partial_x, a, b, matrix::identity_preconditioner(), settings);
+		assert(!partial.converged  &&  partial.iterations == 3  &&  partial.relative_residual > 1e-10);
+
+		assert_throws(solve(x, a, matrix::dmatrix<double>(n + 1, 1), matrix::identity_preconditioner(), settings), matrix::incompatible_operands);
+		assert_throws(solve(x, a, matrix::dmatrix<double>(n, 2), matrix::identity_preconditioner(), settings), matrix::incompatible_operands);
+		assert_throws(solve(x, banded(n + 1, symmetric), b, matrix::identity_preconditioner(), settings), matrix::incompatible_operands);
+	}
+
+	struct conjugate_gradient {
+		template <typename Op, typename P>
+		matrix::iterative_result<double> operator()(matrix::dmatrix<double>& x, const Op& a, const matrix::dmatrix<double>& b, const P& p, const matrix::iterative_options& settings) const {
+			return matrix::conjugate_gradient_into(x, a, b, p, settings);
+		}
+	};
+
+	struct gmres {
+		template <typename Op, typename P>
+		matrix::iterative_result<double> operator()(matrix::dmatrix<double>& x, const Op& a, const matrix::dmatrix<double>& b, const P& p, matrix::iterative_options settings) const {
+			// Short cycles, so that restarts happen
+			settings.restart = 8;
+			return matrix::gmres_into(x, a, b, p, settings);
+		}
+	};
+
+	struct bicgstab {
+		template <typename Op, typename P>
+		matrix::iterative_result<double> operator()(matrix::dmatrix<double>& x, const Op& a, const matrix::dmatrix<double>& b, const P& p, const matrix::iterative_options& settings) const {
+			return matrix::bicgstab_into(x, a, b, p, settings);
+		}
+	};
+
+	void testSolvers() {
+		testSolver(conjugate_gradient(), true);
+		testSolver(gmres(), true);
+		testSolver(gmres(), false);
+		testSolver(bicgstab(), true);
+		testSolver(bicgstab(), false);
+
+		// Full GMRES finds the exact solution of a small system within its size
+		auto a = matrix::csr_matrix<double>::from_entries(3, 3, { { 0, 0, 2 }, { 0, 2, 1 }, { 1, 1, 3 }, { 2, 0, -1 }, { 2, 2, 1 } });
+		matrix::dmatrix<double> b({ { 3 }, { 3 }, { 0 } });
+		matrix::dmatrix<double> x(3, 1);
+		auto result = matrix::gmres_into(x, a, b);
+		assert(result.converged  &&  result.iterations <= 3);
+		assert(gemm::max_difference(x, matrix::dmatrix<double>({ { 1 }, { 1 }, { 1 } })) < 1e-12);
+	}
+
+	void testPreconditioners() {
+		// Without fill to drop, ILU(0) is the exact LU factorization
+		auto a = matrix::csr_matrix<double>::from_entries(3, 3, {
+			{ 0, 0, 4 }, { 0, 1, 1 },
+			{ 1, 0, 2 }, { 1, 1, 5 }, { 1, 2, 1 },
+			{ 2, 1, 3 }, { 2, 2, 6 }
+		});
+		matrix::ilu0_preconditioner<double> ilu(a);
+		double r[] = { 5, 8, 9 }, z[3];
+		ilu(r, z);
+		assert(std::abs(z[0] - 1) < 1e-14  &&  std::abs(z[1] - 1) < 1e-14  &&  std::abs(z[2] - 1) < 1e-14);
+
+		matrix::jacobi_preconditioner<double> jacobi(a);
+		jacobi(r, z);
+		assert(z[0] == 1.25  &&  z[1] == 1.6  &&  z[2] == 1.5);
+
+		auto no_diagonal = matrix::csr_matrix<double>::from_entries(2, 2, { { 0, 1, 1 }, { 1, 0, 1 } });
+		assert_throws(matrix::ilu0_preconditioner<double>{ no_diagonal }, std::domain_error);
+		assert_throws(matrix::jacobi_preconditioner<double>{ no_diagonal }, std::domain_error);
+		assert_throws(matrix::ilu0_preconditioner<double>(matrix::csr_matrix<double>::from_entries(2, 3, {})), std::invalid_argument);
+	}
+
+	void testIndefinite() {
+		matrix::dmatrix<double> a({ { 1, 0 },
+		                            { 0, -1 } });
+		matrix::dmatrix<double> b({ { 1 }, { 1 } });
+		matrix::dmatrix<double> x(2, 1);
+		assert_throws(matrix::conjugate_gradient_into(x, a, b), std::domain_error);
+
+		x = matrix::dmatrix<double>(2, 1);
+		assert(matrix::gmres_into(x, a, b).converged);
+		assert(gemm::max_difference(x, matrix::dmatrix<double>({ { 1 }, { -1 } })) < 1e-12);
+	}
+
+	void testParallel() {
+		// Several blocks of vector elements, summed in the same order whatever the threads
+		unsigned n = 40000;
+		auto a = banded(n, false);
+		auto b = right_hand_side(n);
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+		matrix::parallel_options serial;
+		serial.max_threads = 1;
+		matrix::iterative_options settings;
+		matrix::ilu0_preconditioner<double> ilu(a);
+
+		matrix::dmatrix<double> x(n, 1), serial_x(n, 1);
+		auto result = matrix::bicgstab_into(x, a, b, ilu, settings, options);
+		auto serial_result = matrix::bicgstab_into(serial_x, a, b, ilu, settings, serial);
+		assert(result.converged  &&  result.iterations == serial_result.iterations  &&  x == serial_x);
+
+		x = matrix::dmatrix<double>(n, 1);
+		serial_x = matrix::dmatrix<double>(n, 1);
+		result = matrix::gmres_into(x, a, b, matrix::identity_preconditioner(), settings, options);
+		serial_result = matrix::gmres_into(serial_x, a, b, matrix::identity_preconditioner(), settings, serial);
+		assert(result.converged  &&  result.iterations == serial_result.iterations  &&  x == serial_x);
+
+		auto symmetric = banded(n, true);
+		x = matrix::dmatrix<double>(n, 1);
+		result = matrix::conjugate_gradient_into(x, symmetric, b, matrix::jacobi_preconditioner<double>(symmetric), settings, options);
+		assert(result.converged  &&  result.relative_residual <= 1e-8);
+	}
+
+	void test() {
+		testSolvers();
+		testPreconditioners();
+		testIndefinite();
+		testParallel();
+	}
+} /* namespace krylov */
+
+
+namespace eigen {
+	// Symmetric, with garbage above the diagonal, which must not be read
+	matrix::dmatrix<double> symmetric(unsigned n) {
+		return matrix::dmatrix<double>::generate(n, n, [](unsigned row, unsigned col) {
+			if(row < col) {
+				return 1e6;
+			}
+			return std::sin(row * 1.3 + col * 0.7) + std::cos(row * col * 0.01) + (row == col ? row % 4 : 0);
+		});
+	}
+
+	matrix::dmatrix<double> lower_to_full(const matrix::dmatrix<double>& m) {
+		return matrix::dmatrix<double>::generate(m.rows(), m.cols(), [&](unsigned row, unsigned col) {
+			return row >= col ? m.element_at(row, col) : m.element_at(col, row);
+		});
+	}
+
+	// The largest elements of A * V - V * diag(values) and of transpose(V) * V - I
+	template <typename M>
+	void check(const matrix::matrix<M>& a, const matrix::symmetric_eigen_decomposition<double>& eigen, double tolerance) {
+		const auto& vectors = eigen.vectors();
+		assert(matrix::rows(vectors) == matrix::rows(a)  &&  matrix::cols(vectors) == eigen.values().size());
+		assert(std::is_sorted(eigen.values().begin(), eigen.values().end()));
+		auto scaled = matrix::dmatrix<double>::generate(matrix::rows(vectors), matrix::cols(vectors), [&](unsigned row, unsigned col) {
+			return vectors.element_at(row, col) * eigen.values()[col];
+		});
+		double scale = std::max(1.0, std::max(std::abs(eigen.values().front()), std::abs(eigen.values().back())));
+		assert(gemm::max_difference(gemm::naive_product(a, vectors), scaled) <= tolerance * scale);
+		auto gram = gemm::naive_product(cholesky::transposed(vectors), vectors);
+		for(unsigned row = 0; row < gram.rows(); ++row) {
+			gram.element_at(row, row) -= 1;
+		}
+		assert(matrix::linf_norm(gram) <= tolerance);
+	}
+
+	void testSmall() {
+		auto eigen = matrix::eigh(matrix::dmatrix<double>({ { 2, 0 },
+		                                                     { 1, 2 } }));
+		assert(std::abs(eigen.values()[0] - 1) < 1e-15  &&  std::abs(eigen.values()[1] - 3) < 1e-15);
+		check(matrix::dmatrix<double>({ { 2, 1 }, { 1, 2 } }), eigen, 1e-15);
+
+		auto single = matrix::eigh(matrix::dmatrix<double>({ { -4 } }));
+		assert(single.values() == std::vector<double>{ -4 }  &&  single.vectors() == (matrix::dmatrix<double>({ { 1 } })));
+		assert(matrix::eigh(matrix::dmatrix<double>(0, 0)).values().empty());
+
+		assert_throws(matrix::eigh(matrix::dmatrix<double>(2, 3)), std::invalid_argument);
+		assert_throws(matrix::eigvalsh(matrix::dmatrix<double>(3, 2)), std::invalid_argument);
+	}
+
+	void testSizes() {
+		// Several panels and levels of divide and conquer
+		for(unsigned n : { 3u, 7u, 33u, 64u, 65u, 130u, 300u }) {
+			auto a = symmetric(n);
+			auto eigen = matrix::eigh(a);
+			check(lower_to_full(a), eigen, 1e-12 * n);
+
+			auto values = matrix::eigvalsh(a);
+			for(unsigned index = 0; index < n; ++index) {
+				assert(std::abs(values[index] - eigen.values()[index]) <= 1e-12 * n * std::abs(eigen.values().back()));
+			}
+		}
+	}
+
+	void testDeflation() {
+		// Every eigenvalue repeated
+		auto identity = matrix::dmatrix<double>::generate(100, 100, [](unsigned row, unsigned col) { return row == col ? 1.0 : 0.0; });
+		auto eigen = matrix::eigh(identity);
+		check(identity, eigen, 1e-14);
+		assert(eigen.values().front() == 1  &&  eigen.values().back() == 1);
+
+		// I + u * transpose(u): one eigenvalue of 1 + |u|^2, all others 1
+		auto rank_one = matrix::dmatrix<double>::generate(120, 120, [](unsigned row, unsigned col) {
+			return (row == col) + 0.1 * std::sin(row + 1.0) * std::sin(col + 1.0);
+		});
+		eigen = matrix::eigh(rank_one);
+		check(rank_one, eigen, 1e-13);
+		assert(std::abs(eigen.values()[118] - 1) < 1e-13);
+
+		// A few clusters of close eigenvalues, and a tridiagonal matrix that splits into blocks
+		auto clustered = matrix::dmatrix<double>::generate(90, 90, [](unsigned row, unsigned col) {
+			return row == col ? double(row % 3) + 1e-13 * row : row == col + 1 ? (row % 30 == 0 ? 0.0 : 1e-9) : 0.0;
+		});
+		check(lower_to_full(clustered), matrix::eigh(clustered), 1e-13);
+	}
+
+	// Diagonally dominant and banded, with eigenvalues spread over [1, 9]
+	matrix::csr_matrix<double> banded(unsigned n) {
+		std::vector<matrix::sparse_entry<double>> entries;
+		for(unsigned row = 0; row < n; ++row) {
+			entries.push_back({ row, row, 5.0 + 3.0 * std::sin(row * 0.01) });
+			if(row + 1 < n) {
+				entries.push_back({ row, row + 1, -0.5 });
+				entries.push_back({ row + 1, row, -0.5 });
+			}
+		}
+		return matrix::csr_matrix<double>::from_entries(n, n, std::move(entries));
+	}
+
+	void testLanczos() {
+		unsigned n = 400;
+		auto a = banded(n);
+		auto dense = matrix::dmatrix<double>::generate(n, n, [&](unsigned row, unsigned col) { return a.element_at(row, col); });
+		auto all = matrix::eigh(dense);
+
+		auto top = matrix::eigsh(a, n, 6);
+		check(a, top, 1e-8);
+		for(unsigned index = 0; index < 6; ++index) {
+			assert(std::abs(top.values()[index] - all.values()[n - 6 + index]) < 1e-9);
+		}
+
+		// The same through a functor and with a small basis, which takes restarts
+		matrix::lanczos_options settings;
+		settings.basis_size = 12;
+		auto functor = [&](const double* x, double* y) {
+			for(unsigned row = 0; row < n; ++row) {
+				y[row] = 0;
+				for(unsigned col = 0; col < n; ++col) {
+					y[row] += dense.element_at(row, col) * x[col];
+				}
+			}
+		};
+		auto restarted = matrix::eigsh(functor, n, 3, settings);
+		for(unsigned index = 0; index < 3; ++index) {
+			assert(std::abs(restarted.values()[index] - all.values()[n - 3 + index]) < 1e-9);
+		}
+
+		// A basis as large as the operator gives every eigenpair
+		auto small = lower_to_full(symmetric(20));
+		auto whole = matrix::eigsh(small, 20, 20);
+		auto expected = matrix::eigh(small);
+		for(unsigned index = 0; index < 20; ++index) {
+			assert(std::abs(whole.values()[index] - expected.values()[index]) < 1e-11);
+		}
+
+		settings.max_restarts = 0;
+		assert_throws(matrix::eigsh(a, n, 3, settings), std::domain_error);
+		assert_throws(matrix::eigsh(a, n + 1, 3), std::invalid_argument);
+		assert_throws(matrix::eigsh(small, 20, 21), std::invalid_argument);
+		assert(matrix::eigsh(a, n, 0).values().empty());
+	}
+
+	void testParallel() {
+		auto a = symmetric(200);
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+		auto parallel = matrix::eigh(a, options);
+		check(lower_to_full(a), parallel, 1e-10);
+		auto serial = matrix::eigh(a);
+		assert(parallel.values() == serial.values()  &&  parallel.vectors() == serial.vectors());
+	}
+
+	void test() {
+		testSmall();
+		testSizes();
+		testDeflation();
+		testLanczos();
+		testParallel();
+	}
+} /* namespace eigen */
+
+
+namespace svd {
+	// u * diag(values) * transpose(v), with u and v orthonormal
+	matrix::dmatrix<double> with_singular_values(unsigned m, unsigned n, const std::vector<double>& values) {
+		unsigned rank = values.size();
+		auto u = matrix::qr(matrix::dmatrix<double>::generate(m, rank, [](unsigned row, unsigned col) {
+			return std::sin(row * 0.9 + col * 2.3 + 0.1 * row * col);
+		})).q();
+		auto vt = cholesky::transposed(matrix::qr(matrix::dmatrix<double>::generate(n, rank, [](unsigned row, unsigned col) {
+			return std::cos(row * 1.7 + col * 0.4 + 0.03 * row * col);
+		})).q());
+		for(unsigned row = 0; row < m; ++row) {
+			for(unsigned col = 0; col < rank; ++col) {
+				u.element_at(row, col) *= values[col];
+			}
+		}
+		return gemm::naive_product(u, vt);
+	}
+
+	// The largest elements of u * diag(values) * vt - a, of transpose(u) * u - I and of vt * transpose(vt) - I
+	template <typename M>
+	void check(const matrix::matrix<M>& a, const matrix::singular_value_decomposition<double>& svd, double tolerance) {
+		unsigned rank = svd.singular_values().size();
+		assert(svd.u().rows() == matrix::rows(a)  &&  svd.u().cols() == rank);
+		assert(svd.vt().rows() == rank  &&  svd.vt().cols() == matrix::cols(a));
+		assert(std::is_sorted(svd.singular_values().rbegin(), svd.singular_values().rend()));
+		auto scaled = matrix::dmatrix<double>::generate(svd.u().rows(), rank, [&](unsigned row, unsigned col) {
+			return svd.u().element_at(row, col) * svd.singular_values()[col];
+		});
+		assert(gemm::max_difference(gemm::naive_product(scaled, svd.vt()), a) <= tolerance * svd.singular_values().front());
+		for(auto gram : { gemm::naive_product(cholesky::transposed(svd.u()), svd.u()), gemm::naive_product(svd.vt(), cholesky::transposed(svd.vt())) }) {
+			for(unsigned row = 0; row < rank; ++row) {
+				gram.element_at(row, row) -= 1;
+			}
+			assert(matrix::linf_norm(gram) <= tolerance);
+		}
+	}
+
+	void testExactRank() {
+		// Wide enough to be read in two blocks of rows
+		std::vector<double> values{ 9, 7, 5, 4, 3, 2, 1, 0.5 };
+		auto a = with_singular_values(600, 2000, values);
+		auto svd = matrix::randomized_svd(a, 8);
+		check(a, svd, 1e-12);
+		for(unsigned index = 0; index < values.size(); ++index) {
+			assert(std::abs(svd.singular_values()[index] - values[index]) < 1e-12);
+		}
+
+		// The full rank, with nothing left to oversample
+		auto square = with_singular_values(40, 25, { 3, 2, 1, 1, 1, 0.5, 0.5, 0.25, 0.1, 0.1, 0.1, 0.1, 0.1,
+		                                               0.1, 0.05, 0.05, 0.05, 0.05, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.001 });
+		svd = matrix::randomized_svd(square, 25);
+		check(square, svd, 1e-13);
+		assert(std::abs(svd.singular_values().back() - 0.001) < 1e-14);
+	}
+
+	void testDecaying() {
+		std::vector<double> values(120);
+		for(unsigned index = 0; index < values.size(); ++index) {
+			values[index] = std::pow(0.7, index);
+		}
+		auto a = with_singular_values(300, 120, values);
+		auto svd = matrix::randomized_svd(a, 10);
+		for(unsigned index = 0; index < 10; ++index) {
+			assert(std::abs(svd.singular_values()[index] - values[index]) < 1e-10);
+		}
+		// What remains is the best rank 10 approximation, up to the 11th singular value
+		check(a, svd, 1.01 * values[10]);
+
+		// Without power iterations nor oversampling, the estimates are coarser
+		matrix::randomized_svd_options settings;
+		settings.power_iterations = 0;
+		settings.oversampling = 0;
+		auto coarse = matrix::randomized_svd(a, 10, settings);
+		assert(std::abs(coarse.singular_values()[0] - values[0]) < 1e-2);
+		assert(std::abs(coarse.singular_values()[0] - values[0]) > std::abs(svd.singular_values()[0] - values[0]));
+	}
+
+	void testOperands() {
+		// Rows that are not contiguous are copied, to the same result
+		std::vector<matrix::sparse_entry<double>> entries;
+		for(unsigned row = 0; row < 90; ++row) {
+			entries.push_back({ row, row % 70, 1.0 + row });
+			entries.push_back({ row, (row * 7) % 70, std::sin(row + 0.5) });
+		}
+		auto sparse = matrix::csr_matrix<double>::from_entries(90, 70, std::move(entries));
+		auto dense = matrix::dmatrix<double>::generate(90, 70, [&](unsigned row, unsigned col) { return sparse.element_at(row, col); });
+		auto from_sparse = matrix::randomized_svd(sparse, 5);
+		auto from_dense = matrix::randomized_svd(dense, 5);
+		assert(from_sparse.singular_values() == from_dense.singular_values());
+		assert(from_sparse.u() == from_dense.u()  &&  from_sparse.vt() == from_dense.vt());
+
+		assert_throws(matrix::randomized_svd(dense, 0), std::invalid_argument);
+		assert_throws(matrix::randomized_svd(dense, 71), std::invalid_argument);
+		assert_throws(matrix::randomized_svd(cholesky::transposed(dense), 71), std::invalid_argument);
+	}
+
+	void testParallel() {
+		auto a = with_singular_values(500, 200, { 5, 4, 3, 2, 1, 0.1, 0.01 });
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+		auto parallel = matrix::randomized_svd(a, 5, matrix::randomized_svd_options(), options);
+		auto serial = matrix::randomized_svd(a, 5);
+		check(a, parallel, 0.021);
+		assert(parallel.singular_values() == serial.singular_values());
+		assert(parallel.u() == serial.u()  &&  parallel.vt() == serial.vt());
+	}
+
+	void test() {
+		testExactRank();
+		testDecaying();
+		testOperands();
+		testParallel();
+	}
+} /* namespace svd */
+
+
+namespace power {
+	void testPow() {
+		// Fibonacci numbers, exactly, up to the largest that fits
+		matrix::smatrix<std::uint64_t, 2, 2> fibonacci({ { 1, 1 },
+		                                                 { 1, 0 } });
+		assert(matrix::pow(fibonacci, 0) == (matrix::smatrix<std::uint64_t, 2, 2>({ { 1, 0 }, { 0, 1 } })));
+		assert(matrix::pow(fibonacci, 1) == fibonacci);
+		assert(matrix::pow(fibonacci, 10) == (matrix::smatrix<std::uint64_t, 2, 2>({ { 89, 55 }, { 55, 34 } })));
+		auto f90 = matrix::pow(fibonacci, 90);
+		assert(f90.element_at(0, 0) == 4660046610375530309ull  &&  f90.element_at(0, 1) == 2880067194370816120ull);
+
+		auto dynamic = matrix::pow(matrix::dmatrix<std::uint64_t>({ { 1, 1 }, { 1, 0 } }), 90);
+		assert(dynamic.element_at(0, 0) == f90.element_at(0, 0)  &&  dynamic.element_at(1, 1) == f90.element_at(1, 1));
+		assert(matrix::pow(matrix::dmatrix<int>({ { 2, 1 }, { 0, 3 } }), 0) == (matrix::dmatrix<int>({ { 1, 0 }, { 0, 1 } })));
+		assert(matrix::pow(matrix::dmatrix<int>(0, 0), 5).rows() == 0);
+		assert_throws(matrix::pow(matrix::dmatrix<int>(2, 3), 2), std::invalid_argument);
+
+		// The same products as one after the other, through the direct kernel and through gemm
+		for(unsigned n : { 6u, 100u }) {
+			auto m = matrix::dmatrix<double>::generate(n, n, [](unsigned row, unsigned col) { return std::sin(row * 0.7 + col * 1.3) / 8; });
+			auto expected = m;
+			for(unsigned exponent = 2; exponent <= 13; ++exponent) {
+				expected = gemm::naive_product(expected, m);
+			}
+			assert(gemm::max_difference(matrix::pow(m, 13), expected) < 1e-13 * matrix::linf_norm(expected));
+		}
+
+		auto small = matrix::smatrix<double, 5, 5>();
+		auto small_dynamic = matrix::dmatrix<double>(5, 5);
+		for(unsigned row = 0; row < 5; ++row) {
+			for(unsigned col = 0; col < 5; ++col) {
+				small.element_at(row, col) = small_dynamic.element_at(row, col) = std::cos(row + 2.0 * col);
+			}
+		}
+		auto power = matrix::pow(small, 21);
+		auto dynamic_power = matrix::pow(small_dynamic, 21);
+		for(unsigned row = 0; row < 5; ++row) {
+			for(unsigned col = 0; col < 5; ++col) {
+				assert(std::abs(power.element_at(row, col) - dynamic_power.element_at(row, col)) < 1e-10 * std::abs(dynamic_power.element_at(0, 0)));
+			}
+		}
+	}
+
+	void testMarkov() {
+		// A chain whose rows sum to one, raised to a power far beyond its mixing time
+		unsigned n = 16;
+		auto p = matrix::dmatrix<double>::generate(n, n, [&](unsigned row, unsigned col) {
+			return col == (row + 1) % n ? 0.5 : col == row ? 0.3 : col == (row * 5 + 3) % n ? 0.2 : 0.0;
+		});
+		auto limit = matrix::pow(p, 1000000);
+		for(unsigned row = 0; row < n; ++row) {
+			double sum = 0;
+			for(unsigned col = 0; col < n; ++col) {
+				sum += limit.element_at(row, col);
+				assert(std::abs(limit.element_at(row, col) - limit.element_at(0, col)) < 1e-12);
+			}
+			assert(std::abs(sum - 1) < 1e-10);
+		}
+	}
+
+	// exp of the generator of rotations by angle
+	matrix::smatrix<double, 2, 2> rotation(double angle) {
+		return matrix::smatrix<double, 2, 2>({ { std::cos(angle), -std::sin(angle) },
+		                                       { std::sin(angle), std::cos(angle) } });
+	}
+
+	void testExpm() {
+		assert(matrix::expm(matrix::smatrix<double, 3, 3>({ { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } }))
+		       == (matrix::smatrix<double, 3, 3>({ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } })));
+		assert(matrix::expm(matrix::smatrix<double, 2, 2>({ { 0, 1 }, { 0, 0 } })) == (matrix::smatrix<double, 2, 2>({ { 1, 1 }, { 0, 1 } })));
+
+		auto diagonal = matrix::expm(matrix::smatrix<double, 3, 3>({ { 1, 0, 0 }, { 0, -2, 0 }, { 0, 0, 0.5 } }));
+		assert(std::abs(diagonal.element_at(0, 0) - std::exp(1.0)) < 1e-14 * std::exp(1.0));
+		assert(std::abs(diagonal.element_at(1, 1) - std::exp(-2.0)) < 1e-14);
+		assert(std::abs(diagonal.element_at(2, 2) - std::exp(0.5)) < 1e-14 * std::exp(0.5));
+
+		// Angles for every degree of approximant, and for several squarings
+		for(double angle : { 0.01, 0.2, 0.9, 2.0, 5.0, 30.0, 1000.0 }) {
+			auto computed = matrix::expm(matrix::smatrix<double, 2, 2>({ { 0, -angle }, { angle, 0 } }));
+			auto expected = rotation(angle);
+			for(unsigned row = 0; row < 2; ++row) {
+				for(unsigned col = 0; col < 2; ++col) {
+					assert(std::abs(computed.element_at(row, col) - expected.element_at(row, col)) < 1e-14 * std::max(1.0, angle));
+				}
+			}
+		}
+
+		assert_throws(matrix::expm(matrix::dmatrix<double>(2, 3)), std::invalid_argument);
+		assert(matrix::expm(matrix::dmatrix<double>(0, 0)).rows() == 0);
+	}
+
+	void testExpmDynamic() {
+		// exp(a) * exp(-a) = I, with the same result as an smatrix
+		auto a = matrix::dmatrix<double>::generate(6, 6, [](unsigned row, unsigned col) { return std::sin(row * 3.1 + col) * 1.5; });
+		auto minus_a = matrix::dmatrix<double>::generate(6, 6, [&](unsigned row, unsigned col) { return -a.element_at(row, col); });
+		auto product = gemm::naive_product(matrix::expm(a), matrix::expm(minus_a));
+		for(unsigned row = 0; row < 6; ++row) {
+			product.element_at(row, row) -= 1;
+		}
+		assert(matrix::linf_norm(product) < 1e-12);
+
+		matrix::smatrix<double, 6, 6> s;
+		for(unsigned row = 0; row < 6; ++row) {
+			for(unsigned col = 0; col < 6; ++col) {
+				s.element_at(row, col) = a.element_at(row, col);
+			}
+		}
+		auto from_static = matrix::expm(s);
+		auto from_dynamic = matrix::expm(a);
+		for(unsigned row = 0; row < 6; ++row) {
+			for(unsigned col = 0; col < 6; ++col) {
+				assert(std::abs(from_static.element_at(row, col) - from_dynamic.element_at(row, col)) < 1e-12 * matrix::linf_norm(from_dynamic));
+			}
+		}
+
+		// A symmetric matrix through gemm and lu, against its eigendecomposition
+		unsigned n = 90;
+		auto symmetric = matrix::dmatrix<double>::generate(n, n, [](unsigned row, unsigned col) {
+			return std::sin((row + 1) * (col + 1) * 0.37) / 10 + (row == col ? std::cos(row * 0.1) : 0.0);
+		});
+		auto eigen = matrix::eigh(symmetric);
+		auto scaled = matrix::dmatrix<double>::generate(n, n, [&](unsigned row, unsigned col) {
+			return eigen.vectors().element_at(row, col) * std::exp(eigen.values()[col]);
+		});
+		auto expected = gemm::naive_product(scaled, cholesky::transposed(eigen.vectors()));
+		assert(gemm::max_difference(matrix::expm(symmetric), expected) < 1e-12 * matrix::linf_norm(expected));
+	}
+
+	void testParallel() {
+		auto a = matrix::dmatrix<double>::generate(150, 150, [](unsigned row, unsigned col) { return std::cos(row * 0.3 + col * 0.11) / 20; });
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+		assert(matrix::pow(a, 77, options) == matrix::pow(a, 77));
+		assert(matrix::expm(a, options) == matrix::expm(a));
+	}
+
+	void test() {
+		testPow();
+		testMarkov();
+		testExpm();
+		testExpmDynamic();
+		testParallel();
+	}
+} /* namespace power */
+
+
+namespace structured {
+	template <typename M>
+	matrix::dmatrix<double> explicitly(const matrix::matrix<M>& m) {
+		return matrix::dmatrix<double>::generate(matrix::rows(m), matrix::cols(m), [&](unsigned row, unsigned col) {
+			return matrix::element_at(m, row, col);
+		});
+	}
+
+	matrix::dmatrix<double> filled(unsigned rows, unsigned cols, double seed) {
+		return matrix::dmatrix<double>::generate(rows, cols, [=](unsigned row, unsigned col) {
+			return std::sin(seed + row * 0.7 + col * 1.3);
+		});
+	}
+
+	void testKron() {
+		auto a = filled(3, 4, 0.1);
+		auto b = filled(5, 2, 0.2);
+		auto k = matrix::kron(a, b);
+		assert(k.rows() == 15  &&  k.cols() == 8);
+		for(unsigned row = 0; row < 15; ++row) {
+			for(unsigned col = 0; col < 8; ++col) {
+				assert(k.element_at(row, col) == a.element_at(row / 5, col / 2) * b.element_at(row % 5, col % 2));
+			}
+		}
+		assert(k == explicitly(k));
+
+		// Both orders of the two products, for wide and tall factors
+		auto x = filled(8, 3, 0.3);
+		assert(gemm::max_difference(matrix::multiply(k, x), gemm::naive_product(explicitly(k), x)) < 1e-12);
+		auto c = filled(2, 9, 0.4);
+		auto d = filled(6, 3, 0.5);
+		auto wide = matrix::kron(c, d);
+		auto y = filled(27, 2, 0.6);
+		assert(gemm::max_difference(matrix::multiply(wide, y), gemm::naive_product(explicitly(wide), y)) < 1e-12);
+
+		// Sparse factors and nested views are applied through their own structure
+		auto sparse = matrix::csr_matrix<double>::from_entries(4, 3, { { 0, 0, 2.0 }, { 1, 2, -1.0 }, { 3, 1, 0.5 } });
+		auto nested = matrix::kron(matrix::kron(b, sparse), a);
+		assert(nested.rows() == 60  &&  nested.cols() == 24);
+		auto z = filled(24, 1, 0.7);
+		assert(gemm::max_difference(matrix::multiply(nested, z), gemm::naive_product(explicitly(nested), z)) < 1e-12);
+
+		matrix::dmatrix<double> none(0, 2);
+		auto empty = matrix::kron(a, none);
+		assert(empty.rows() == 0  &&  empty.cols() == 8);
+		assert(matrix::multiply(empty, x).rows() == 0);
+		assert_throws(matrix::multiply(k, filled(7, 1, 0.0)), matrix::incompatible_operands);
+	}
+
+	void testBlockDiagonal() {
+		auto a = filled(2, 3, 0.1);
+		auto sparse = matrix::csr_matrix<double>::from_entries(3, 2, { { 0, 1, 4.0 }, { 2, 0, -2.0 } });
+		matrix::smatrix<double, 2, 2> s({ { 1, 2 },
+		                                  { 3, 4 } });
+		auto d = matrix::blockdiag(a, sparse, s);
+		assert(d == (matrix::dmatrix<double>({ { a.element_at(0, 0), a.element_at(0, 1), a.element_at(0, 2), 0, 0, 0, 0 },
+		                                       { a.element_at(1, 0), a.element_at(1, 1), a.element_at(1, 2), 0, 0, 0, 0 },
+		                                       { 0, 0, 0, 0, 4, 0, 0 },
+		                                       { 0, 0, 0, 0, 0, 0, 0 },
+		                                       { 0, 0, 0, -2, 0, 0, 0 },
+		                                       { 0, 0, 0, 0, 0, 1, 2 },
+		                                       { 0, 0, 0, 0, 0, 3, 4 } })));
+
+		auto x = filled(7, 2, 0.2);
+		assert(gemm::max_difference(matrix::multiply(d, x), gemm::naive_product(explicitly(d), x)) < 1e-12);
+	}
+
+	void testStacks() {
+		auto a = filled(4, 2, 0.1);
+		auto b = filled(4, 3, 0.2);
+		auto c = filled(3, 5, 0.3);
+		auto h = matrix::hstack(a, b, a);
+		assert(h.rows() == 4  &&  h.cols() == 7);
+		assert(h.element_at(2, 1) == a.element_at(2, 1)  &&  h.element_at(2, 4) == b.element_at(2, 2)  &&  h.element_at(3, 6) == a.element_at(3, 1));
+		auto d = filled(3, 2, 0.5);
+		auto v = matrix::vstack(h, matrix::hstack(c, d));
+		assert(v.rows() == 7  &&  v.cols() == 7);
+		assert(v.element_at(1, 3) == b.element_at(1, 1)  &&  v.element_at(5, 3) == c.element_at(1, 3));
+
+		auto x = filled(7, 3, 0.4);
+		assert(gemm::max_difference(matrix::multiply(h, x), gemm::naive_product(explicitly(h), x)) < 1e-12);
+		assert(gemm::max_difference(matrix::multiply(v, x), gemm::naive_product(explicitly(v), x)) < 1e-12);
+
+		assert_throws(matrix::hstack(a, c), matrix::incompatible_operands);
+		assert_throws(matrix::vstack(a, b), matrix::incompatible_operands);
+	}
+
+	void testAsMatrices() {
+		// Views compute their elements, and the generic algorithms read them by value
+		auto a = filled(3, 3, 0.1);
+		auto v = matrix::vstack(matrix::kron(a, a), matrix::blockdiag(a, a, a));
+		auto dense = explicitly(v);
+		assert(std::abs(matrix::sum(v) - matrix::sum(dense)) < 1e-12);
+		assert(matrix::max(v, matrix::each_col) == matrix::max(dense, matrix::each_col));
+		assert(matrix::map([](double x) { return 2 * x; }, v) == matrix::map([](double x) { return 2 * x; }, dense));
+		assert(matrix::multiply(cholesky::transposed(dense), v) == matrix::multiply(cholesky::transposed(dense), dense));
+	}
+
+	void testSolvers() {
+		// The Kronecker product of symmetric positive definite matrices is one as well
+		auto spd = [](unsigned n, double shift) {
+			return matrix::dmatrix<double>::generate(n, n, [=](unsigned row, unsigned col) {
+				return 1.0 / (1 + row + col) + (row == col ? shift : 0.0);
+			});
+		};
+		auto a = spd(12, 3.0);
+		auto c = spd(15, 2.0);
+		auto k = matrix::kron(a, c);
+		auto b = filled(180, 1, 0.5);
+		matrix::iterative_options settings;
+		settings.tolerance = 1e-12;
+		matrix::dmatrix<double> x(180, 1);
+		auto result = matrix::conjugate_gradient_into(x, k, b, matrix::identity_preconditioner(), settings);
+		assert(result.converged);
+		assert(gemm::max_difference(gemm::naive_product(explicitly(k), x), b) < 1e-10);
+
+		auto e = spd(20, 5.0);
+		auto f = spd(30, 1.0);
+		auto d = matrix::blockdiag(e, f);
+		auto largest = matrix::eigsh(d, 50, 3);
+		auto all = matrix::eigvalsh(explicitly(d));
+		for(unsigned index = 0; index < 3; ++index) {
+			assert(std::abs(largest.values()[index] - all[47 + index]) < 1e-10);
+		}
+	}
+
+	/*
+	 * Solvers apply views at every iteration, with scratch space allocated
+	 * once. Dense factors of a Kronecker product are multiplied by gemm,
+	 * which packs its operands into buffers of its own, so these are not.
+	 */
+	template <typename V>
+	void checkAppliesWithoutAllocating(const V& view) {
+		auto x = filled(view.cols(), 1, 0.7);
+		matrix::dmatrix<double> y(view.rows(), 1);
+		std::vector<double> scratch(matrix::__impl::operator_scratch_size(view));
+		matrix::parallel_options serial;
+		serial.max_threads = 1;
+
+		unsigned long before = allocation_count;
+		for(unsigned iteration = 0; iteration < 3; ++iteration) {
+			matrix::__impl::apply_operator(view, &x.element_at(0, 0), &y.element_at(0, 0), scratch.data(), serial);
+		}
+		assert(allocation_count == before);
+		assert(gemm::max_difference(y, gemm::naive_product(explicitly(view), x)) < 1e-12);
+	}
+
+	void testScratch() {
+		auto tall = filled(9, 2, 0.1);
+		auto square = filled(4, 4, 0.3);
+		auto wide = matrix::csr_matrix<double>::from_entries(2, 7, { { 0, 0, 1.5 }, { 0, 6, -2.0 }, { 1, 3, 0.5 } });
+		auto sparse = matrix::csr_matrix<double>::from_entries(4, 4, { { 0, 0, 2.0 }, { 1, 3, -1.0 }, { 3, 1, 0.5 } });
+		auto stacked = matrix::vstack(tall, tall);
+
+		// Both orders of the products
+		checkAppliesWithoutAllocating(matrix::kron(stacked, wide));
+		checkAppliesWithoutAllocating(matrix::kron(wide, stacked));
+		checkAppliesWithoutAllocating(matrix::hstack(square, sparse, square));
+		checkAppliesWithoutAllocating(matrix::kron(matrix::hstack(tall, tall), matrix::kron(sparse, wide)));
+		checkAppliesWithoutAllocating(matrix::vstack(matrix::kron(sparse, sparse), matrix::blockdiag(matrix::hstack(square, sparse), matrix::hstack(sparse, square))));
+	}
+
+	template <typename MA, typename MB, typename = void>
+	struct can_hstack : std::false_type {};
+
+	template <typename MA, typename MB>
+	struct can_hstack<MA, MB, decltype(void(matrix::hstack(std::declval<MA>(), std::declval<MB>())))> : std::true_type {};
+
+	template <typename MA, typename MB, typename MC, typename = void>
+	struct can_vstack : std::false_type {};
+
+	template <typename MA, typename MB, typename MC>
+	struct can_vstack<MA, MB, MC, decltype(void(matrix::vstack(std::declval<MA>(), std::declval<MB>(), std::declval<MC>())))> : std::true_type {};
+
+	void testTemporaries() {
+		// Views would be left referring to temporary matrices, but not to temporary views, which they copy
+		using Matrix = matrix::dmatrix<double>;
+		using View = matrix::kronecker_view<Matrix, Matrix>;
+		static_assert(can_hstack<Matrix&, const Matrix&>::value, "");
+		static_assert(can_hstack<View, Matrix&>::value, "");
+		static_assert(!can_hstack<Matrix&, Matrix>::value, "");
+		static_assert(!can_hstack<const Matrix, Matrix&>::value, "");
+		static_assert(can_vstack<Matrix&, View, Matrix&>::value, "");
+		static_assert(!can_vstack<Matrix&, Matrix&, Matrix>::value, "");
+
+		auto a = filled(2, 2, 0.1);
+		auto v = matrix::hstack(matrix::kron(a, a), matrix::blockdiag(a, a));
+		assert(v.element_at(3, 7) == a.element_at(1, 1));
+	}
+
+	void testParallel() {
+		auto a = filled(70, 60, 0.1);
+		auto b = filled(50, 40, 0.2);
+		auto k = matrix::kron(a, b);
+		auto x = filled(2400, 3, 0.3);
+		matrix::execution_context context(parallel::with_threads(4), 1);
+		matrix::parallel_options options;
+		options.context = &context;
+		assert(matrix::multiply(k, x, options) == matrix::multiply(k, x));
+	}
+
+	void test() {
+		testKron();
+		testBlockDiagonal();
+		testStacks();
+		testAsMatrices();
+		testSolvers();
+		testScratch();
+		testTemporaries();
+		testParallel();
+	}
+} /* namespace structured */
+
+
+namespace permuted {
+	void testSwapRows() {
+		matrix::dmatrix<int> m({ { 1, 2, 3 },
+		                         { 4, 5, 6 },
+		                         { 7, 8, 9 },
+		                         { 10, 11, 12 } });
+		auto p = matrix::permuted(m);
+		assert(p == m);
+		p.swap_rows(0, 3);
+		p.swap_rows(1, 3);
+		assert((p.order() == std::vector<unsigned>{ 3, 0, 2, 1 }));
+		assert(p == (matrix::dmatrix<int>({ { 10, 11, 12 },
+		                                    { 1, 2, 3 },
+		                                    { 7, 8, 9 },
+		                                    { 4, 5, 6 } })));
+		assert(m.element_at(0, 0) == 1);
+
+		// Writes go to the rows of the matrix
+		p.element_at(3, 2) = -6;
+		p[0][1] = -11;
+		assert(m.element_at(1, 2) == -6  &&  m.element_at(3, 1) == -11);
+
+		const auto& cm = m;
+		auto cp = matrix::permuted(cm);
+		cp.swap_rows(0, 1);
+		assert(cp[0][matrix::all] == (matrix::dmatrix<int>({ { 4, 5, -6 } })));
+	}
+
+	void testSubscripts() {
+		auto m = matrix::dmatrix<int>::generate(5, 4, [](unsigned row, unsigned col) { return int(row * 10 + col); });
+		matrix::permuted_dmatrix<matrix::dmatrix<int>> p(m, { 4, 2, 0, 3, 1 });
+		assert(p[1] == (matrix::dmatrix<int>({ { 20, 21, 22, 23 } })));
+		assert(p[1][matrix::drange(2, 1)] == (matrix::dmatrix<int>({ { 21, 22 } })));
+		assert(p[matrix::drange(2, 1)] == (matrix::dmatrix<int>({ { 20, 21, 22, 23 },
+		                                                          { 0, 1, 2, 3 } })));
+		assert(p[matrix::drange(3, 2)][matrix::drange(2, 2)] == (matrix::dmatrix<int>({ { 2, 3 },
+		                                                                              { 32, 33 },
+		                                                                              { 12, 13 } })));
+		assert(p[matrix::all][3] == (matrix::dmatrix<int>({ { 43 }, { 23 }, { 3 }, { 33 }, { 13 } })));
+
+		p[matrix::drange(2, 3)][matrix::all] = matrix::dmatrix<int>({ { -1, -2, -3, -4 },
+		                                                              { -5, -6, -7, -8 } });
+		assert(m[3] == (matrix::dmatrix<int>({ { -1, -2, -3, -4 } })));
+		assert(m[1] == (matrix::dmatrix<int>({ { -5, -6, -7, -8 } })));
+		assert(matrix::sum(p[matrix::drange(2, 0)]) == matrix::sum(m[4]) + matrix::sum(m[2]));
+
+		assert_throws(matrix::permuted_dmatrix<matrix::dmatrix<int>>(m, { 0, 1, 2, 3 }), std::invalid_argument);
+		assert_throws(matrix::permuted_dmatrix<matrix::dmatrix<int>>(m, { 0, 1, 2, 3, 3 }), std::invalid_argument);
+		assert_throws(matrix::permuted_dmatrix<matrix::dmatrix<int>>(m, { 0, 1, 2, 3, 5 }), std::invalid_argument);
+	}
+
+	void testSortAndApply() {
+		unsigned n = 2000;
+		auto m = matrix::dmatrix<double>::generate(n, 5, [](unsigned row, unsigned col) {
+			return col == 0 ? double(row * 7919 % 97) : row + col * 0.25;
+		});
+		auto p = matrix::permuted(m);
+		p.sort_rows([&](unsigned lhs, unsigned rhs) {
+			return m.element_at(lhs, 0) < m.element_at(rhs, 0);
+		});
+		for(unsigned row = 1; row < n; ++row) {
+			double previous = p.element_at(row - 1, 0);
+			assert(previous < p.element_at(row, 0)  ||  (previous == p.element_at(row, 0)  &&  p.order()[row - 1] < p.order()[row]));
+		}
+
+		auto expected = matrix::dmatrix<double>::generate(n, 5, [&](unsigned row, unsigned col) { return p.element_at(row, col); });
+		p.apply_permutation();
+		assert(m == expected  &&  p == expected);
+		for(unsigned row = 0; row < n; ++row) {
+			assert(p.order()[row] == row);
+		}
+	}
+
+	void testApplyCycles() {
+		// Two cycles, a fixed row and a swap, on elements that are moved rather than copied
+		matrix::dmatrix<std::string> m(6, 2);
+		for(unsigned row = 0; row < 6; ++row) {
+			m.element_at(row, 0) = std::string(20, char('a' + row));
+			m.element_at(row, 1) = std::to_string(row);
+		}
+		matrix::permuted_dmatrix<matrix::dmatrix<std::string>> p(m, { 2, 0, 1, 3, 5, 4 });
+		p.apply_permutation();
+		std::vector<unsigned> expected{ 2, 0, 1, 3, 5, 4 };
+		for(unsigned row = 0; row < 6; ++row) {
+			assert(m.element_at(row, 0) == std::string(20, char('a' + expected[row])));
+			assert(m.element_at(row, 1) == std::to_string(expected[row]));
+		}
+
+		matrix::dmatrix<int> empty(3, 0);
+		matrix::permuted_dmatrix<matrix::dmatrix<int>> q(empty, { 1, 2, 0 });
+		q.apply_permutation();
+		assert((q.order() == std::vector<unsigned>{ 0, 1, 2 }));
+	}
+
+#ifdef MATRIX_BOUNDS_CHECKING
+	void testChecked() {
+		using exception = matrix::bounds_verifier::exception;
+		matrix::dmatrix<int> m(3, 2);
+		auto p = matrix::permuted(m);
+		assert_throws(p.swap_rows(0, 3), exception);
+		assert_throws(p.element_at(3, 0), exception);
+		assert_throws(p[3], exception);
+		assert_throws(p[matrix::drange(2, 2)], exception);
+		assert_throws(p[matrix::drange(2, 1)][2], exception);
+		assert_throws(p[matrix::all].element_at(0, 2), exception);
+	}
+#endif
+
+	void test() {
+		testSwapRows();
+		testSubscripts();
+		testSortAndApply();
+		testApplyCycles();
+#ifdef MATRIX_BOUNDS_CHECKING
+		testChecked();
+#endif
+	}
+} /* namespace permuted */
+
+
 int main() {
 	storage::test();
 	safely_constructed_array::test();
+	heap_array::test();
+	bounds::test();
+	parallel::test();
 	base::test();
 	smatrix::test();
 	dmatrix::test();
 	common::test();
+	expected::test();
+	binary_io::test();
+	sparse::test();
+	text_io::test();
+	numpy_io::test();
+	shared_dmatrix::test();
+	hmatrix::test();
+	reduce::test();
+	transform::test();
+	gemm::test();
+	lu::test();
+	cholesky::test();
+	qr::test();
+	triangular::test();
+	krylov::test();
+	eigen::test();
+	svd::test();
+	power::test();
+	structured::test();
+	permuted::test();
 }
@@ -0,0 +1,573 @@
+#include "matrix.hpp"
+#include "cholesky.hpp"
+#include "eigen.hpp"
+#include "gemm.hpp"
+#include "hmatrix.hpp"
+#include "krylov.hpp"
+#include "lu.hpp"
+#include "permuted.hpp"
+#include "power.hpp"
+#include "qr.hpp"
+#include "reduce.hpp"
+#include "sparse.hpp"
+#include "structured.hpp"
+#include "svd.hpp"
+#include "transform.hpp"
+#include "triangular.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/*
+ * Micro-benchmarks. Every case runs its body repeatedly until a minimum time
+ * has elapsed; the best of several such runs is reported, in nanoseconds per
+ * call, as a JSON document on the standard output.
+ *
+ * Usage: matrix_bench [name-filter]
+ */
+
+
+namespace harness {
+	struct result {
+		std::string name;
+		std::string matrix_type;
+		unsigned rows;
+		unsigned cols;
+		std::size_t iterations;
+		double ns_per_iteration;
+	};
+
+	std::vector<result> results;
+	std::string filter;
+
+	// Keeps the compiler from discarding a computed value
+	template <typename T>
+	inline void keep(T&& value) {
+		asm volatile("" : : "g"(&value) : "memory");
+	}
+
+	template <typename F>
+	void run(const std::string& name, const std::string& matrix_type, unsigned rows, unsigned cols, F body) {
+		if(!filter.empty()  &&  name.find(filter) == std::string::npos) {
+			return;
+		}
+
+		using clock = std::chrono::steady_clock;
+		const auto min_duration = std::chrono::milliseconds(50);
+		const int repetitions = 5;
+
+		body();  // Warm up
+
+		double best = 0;
+		std::size_t iterations = 0;
+		for(int repetition = 0; repetition < repetitions; ++repetition) {
+			std::size_t count = 0;
+			auto start = clock::now();
+			auto elapsed = clock::duration::zero();
+			do {
+				body();
+				++count;
+				elapsed = clock::now() - start;
+			} while(elapsed < min_duration);
+
+			double ns = std::chrono::duration<double, std::nano>(elapsed).count() / count;
+			if(repetition == 0  ||  ns < best) {
+				best = ns;
+				iterations = count;
+			}
+		}
+
+		results.push_back({ name, matrix_type, rows, cols, iterations, best });
+		std::fprintf(stderr, "%-32s %-8s %5ux%-5u %14.1f ns\n", name.c_str(), matrix_type.c_str(), rows, cols, best);
+	}
+
+	void print_json() {
+		std::printf("{\n  \"unit\": \"ns\",\n  \"results\": [");
+		for(std::size_t i = 0; i < results.size(); ++i) {
+			const result& r = results[i];
+			std::printf("%s\n    { \"name\": \"%s\", \"matrix\": \"%s\", \"rows\": %u, \"cols\": %u, \"iterations\": %zu, \"ns_per_iteration\": %.3f }",
+				i > 0 ? "," : "", r.name.c_str(), r.matrix_type.c_str(), r.rows, r.cols, r.iterations, r.ns_per_iteration);
+		}
+		std::printf("\n  ]\n}\n");
+	}
+} /* namespace harness */
+
+
+namespace fixtures {
+	template <typename T, unsigned Rows, unsigned Cols>
+	matrix::smatrix<T, Rows, Cols> make_smatrix() {
+		T array[Rows][Cols];
+		for(unsigned row = 0; row < Rows; ++row) {
+			for(unsigned col = 0; col < Cols; ++col) {
+				array[row][col] = T(row * Cols + col);
+			}
+		}
+		return matrix::smatrix<T, Rows, Cols>(std::move(array));
+	}
+
+	template <typename T>
+	matrix::dmatrix<T> make_dmatrix(unsigned rows, unsigned cols) {
+		return matrix::dmatrix<T>::generate(rows, cols, [cols](unsigned row, unsigned col) {
+			return T(row * cols + col);
+		});
+	}
+} /* namespace fixtures */
+
+
+namespace access {
+	template <typename M>
+	double sum_by_subscripts(M& m) {
+		double sum = 0;
+		for(unsigned row = 0; row < m.rows(); ++row) {
+			for(unsigned col = 0; col < m.cols(); ++col) {
+				sum += static_cast<double&>(m[row][col]);
+			}
+		}
+		return sum;
+	}
+
+	template <typename M>
+	double sum_by_const_subscripts(const M& m) {
+		double sum = 0;
+		for(unsigned row = 0; row < m.rows(); ++row) {
+			for(unsigned col = 0; col < m.cols(); ++col) {
+				sum += m[row][col];
+			}
+		}
+		return sum;
+	}
+
+	template <typename M>
+	double sum_by_element_at(M& m) {
+		double sum = 0;
+		for(unsigned row = 0; row < m.rows(); ++row) {
+			for(unsigned col = 0; col < m.cols(); ++col) {
+				sum += m.element_at(row, col);
+			}
+		}
+		return sum;
+	}
+
+	double sum_by_pointer(const double* p, unsigned rows, unsigned cols) {
+		double sum = 0;
+		for(unsigned row = 0; row < rows; ++row) {
+			for(unsigned col = 0; col < cols; ++col) {
+				sum += p[row * cols + col];
+			}
+		}
+		return sum;
+	}
+
+	template <unsigned N>
+	void run_smatrix() {
+		static auto m = fixtures::make_smatrix<double, N, N>();
+		harness::run("element_at", "smatrix", N, N, [] { harness::keep(sum_by_element_at(m)); });
+		harness::run("subscript_chain", "smatrix", N, N, [] { harness::keep(sum_by_subscripts(m)); });
+		harness::run("const_subscript_chain", "smatrix", N, N, [] { harness::keep(sum_by_const_subscripts(m)); });
+		harness::run("raw_pointer", "smatrix", N, N, [] { harness::keep(sum_by_pointer(&m.element_at(0, 0), N, N)); });
+	}
+
+	void run_dmatrix(unsigned n) {
+		auto m = fixtures::make_dmatrix<double>(n, n);
+		harness::run("element_at", "dmatrix", n, n, [&] { harness::keep(sum_by_element_at(m)); });
+		harness::run("subscript_chain", "dmatrix", n, n, [&] { harness::keep(sum_by_subscripts(m)); });
+		harness::run("const_subscript_chain", "dmatrix", n, n, [&] { harness::keep(sum_by_const_subscripts(m)); });
+		harness::run("raw_pointer", "dmatrix", n, n, [&] { harness::keep(sum_by_pointer(&m.element_at(0, 0), n, n)); });
+	}
+
+	// Rows reordered through a permuted view, by key and by a scrambling permutation
+	void run_permuted(unsigned rows, unsigned cols) {
+		auto m = fixtures::make_dmatrix<double>(rows, cols);
+		auto key = [&](unsigned row) { return double(std::size_t(row) * 7919 % rows); };
+		std::vector<unsigned> scramble(rows);
+		for(unsigned row = 0; row < rows; ++row) {
+			scramble[row] = unsigned(key(row));
+		}
+
+		harness::run("sort_rows", "permuted", rows, cols, [&] {
+			auto p = matrix::permuted(m);
+			p.sort_rows([&](unsigned lhs, unsigned rhs) { return key(lhs) < key(rhs); });
+			harness::keep(p.order()[0]);
+		});
+		harness::run("apply_permutation", "permuted", rows, cols, [&] {
+			matrix::permuted_dmatrix<matrix::dmatrix<double>> p(m, scramble);
+			p.apply_permutation();
+			harness::keep(m.element_at(0, 0));
+		});
+		harness::run("gather_by_element_at", "permuted", rows, cols, [&] {
+			matrix::permuted_dmatrix<matrix::dmatrix<double>> p(m, scramble);
+			harness::keep(matrix::dmatrix<double>::generate(rows, cols, [&](unsigned row, unsigned col) { return p.element_at(row, col); }));
+		});
+	}
+
+	void run() {
+		run_smatrix<4>();
+		run_smatrix<16>();
+		run_smatrix<64>();
+		for(unsigned n : { 4, 16, 64, 256, 1024 }) {
+			run_dmatrix(n);
+		}
+		run_permuted(1000000, 8);
+	}
+} /* namespace access */
+
+
+namespace elementwise {
+	template <unsigned N>
+	void run_smatrix() {
+		static auto mA = fixtures::make_smatrix<double, N, N>();
+		static auto mB = fixtures::make_smatrix<double, N, N>();
+		static matrix::smatrix<double, N, N> mC;
+
+		harness::run("equal_to", "smatrix", N, N, [] { harness::keep(matrix::equal_to(mA, mB)); });
+		harness::run("for_each_element", "smatrix", N, N, [] {
+			matrix::for_each_element([](double& c, const double& a, const double& b) { c = a + b; }, mC, mA, mB);
+			harness::keep(mC);
+		});
+		harness::run("move_to", "smatrix", N, N, [] {
+			matrix::move_to(mC, std::move(mA));
+			harness::keep(mC);
+		});
+	}
+
+	void run_dmatrix(unsigned n) {
+		auto mA = fixtures::make_dmatrix<double>(n, n);
+		auto mB = fixtures::make_dmatrix<double>(n, n);
+		matrix::dmatrix<double> mC(n, n);
+
+		harness::run("equal_to", "dmatrix", n, n, [&] { harness::keep(matrix::equal_to(mA, mB)); });
+		harness::run("for_each_element", "dmatrix", n, n, [&] {
+			matrix::for_each_element([](double& c, const double& a, const double& b) { c = a + b; }, mC, mA, mB);
+			harness::keep(mC);
+		});
+		harness::run("parallel_for_each_element", "dmatrix", n, n, [&] {
+			matrix::parallel_for_each_element(matrix::parallel_options(), [](double& c, const double& a, const double& b) { c = a + b; }, mC, mA, mB);
+			harness::keep(mC);
+		});
+		harness::run("transform_into", "dmatrix", n, n, [&] {
+			matrix::transform_into(mC, [](double a, double b) { return a + b; }, mA, mB);
+			harness::keep(mC);
+		});
+		harness::run("map", "dmatrix", n, n, [&] {
+			harness::keep(matrix::map([](double a, double b) { return a * b + 1; }, mA, mB));
+		});
+
+		// The central quarter of each matrix, through region references
+		auto quarter = [n](matrix::dmatrix<double>& m) { return m[matrix::drange(n / 2, n / 4)][matrix::drange(n / 2, n / 4)]; };
+		auto rA = quarter(mA);
+		auto rB = quarter(mB);
+		auto rC = quarter(mC);
+		harness::run("for_each_element_region", "dmatrix", n, n, [&] {
+			matrix::for_each_element([](double& c, const double& a, const double& b) { c = a * b + 1; }, rC, rA, rB);
+			harness::keep(mC);
+		});
+		harness::run("transform_into_region", "dmatrix", n, n, [&] {
+			matrix::transform_into(rC, [](double a, double b) { return a * b + 1; }, rA, rB);
+			harness::keep(mC);
+		});
+		harness::run("zero_region_by_element", "dmatrix", n, n, [&] {
+			matrix::for_each_element([](double& c) { c = 0; }, rC);
+			harness::keep(mC);
+		});
+		harness::run("fill_region_zero", "dmatrix", n, n, [&] {
+			matrix::fill(rC, 0.0);
+			harness::keep(mC);
+		});
+		harness::run("scale_region", "dmatrix", n, n, [&] {
+			rC *= 1.5;
+			harness::keep(mC);
+		});
+		harness::run("move_to", "dmatrix", n, n, [&] {
+			matrix::move_to(mC, std::move(mA));
+			harness::keep(mC);
+		});
+	}
+
+	// Many short rows, where a static column count lets the inner loop unroll
+	template <unsigned Cols>
+	void run_narrow(unsigned n) {
+		using hmatrix = matrix::hmatrix<double, matrix::dynamic_extent, Cols>;
+		auto dA = fixtures::make_dmatrix<double>(n, Cols);
+		auto dB = fixtures::make_dmatrix<double>(n, Cols);
+		matrix::dmatrix<double> dC(n, Cols);
+		hmatrix hA(dA);
+		hmatrix hB(dB);
+		hmatrix hC(n, Cols);
+
+		auto add = [](double& c, const double& a, const double& b) { c = a + b; };
+		harness::run("for_each_element", "dmatrix", n, Cols, [&] {
+			matrix::for_each_element(add, dC, dA, dB);
+			harness::keep(dC);
+		});
+		harness::run("for_each_element", "hmatrix", n, Cols, [&] {
+			matrix::for_each_element(add, hC, hA, hB);
+			harness::keep(hC);
+		});
+	}
+
+	void run() {
+		run_smatrix<4>();
+		run_smatrix<16>();
+		run_smatrix<64>();
+		for(unsigned n : { 4, 16, 64, 256, 1024 }) {
+			run_dmatrix(n);
+		}
+		run_narrow<3>(4096);
+		run_narrow<4>(4096);
+	}
+} /* namespace elementwise */
+
+
+namespace construction {
+	template <unsigned N>
+	void run_smatrix() {
+		harness::run("construct_default", "smatrix", N, N, [] {
+			matrix::smatrix<double, N, N> m;
+			harness::keep(m);
+		});
+		harness::run("move_construct", "smatrix", N, N, [] {
+			static auto source = fixtures::make_smatrix<double, N, N>();
+			matrix::smatrix<double, N, N> m(std::move(source));
+			harness::keep(m);
+			source = std::move(m);
+		});
+	}
+
+	void run_dmatrix(unsigned n) {
+		std::vector<double> values(std::size_t(n) * n, 1.0);
+
+		harness::run("construct_default", "dmatrix", n, n, [&] {
+			matrix::dmatrix<double> m(n, n);
+			harness::keep(m);
+		});
+		harness::run("construct_uninitialized", "dmatrix", n, n, [&] {
+			matrix::dmatrix<double> m(n, n, matrix::uninitialized);
+			harness::keep(m);
+		});
+		harness::run("construct_from_pointer", "dmatrix", n, n, [&] {
+			matrix::dmatrix<double> m(n, n, values.data());
+			harness::keep(m);
+		});
+		harness::run("construct_generate", "dmatrix", n, n, [&] {
+			auto m = matrix::dmatrix<double>::generate(n, n, [](unsigned row, unsigned col) {
+				return double(row + col);
+			});
+			harness::keep(m);
+		});
+	}
+
+	void run() {
+		run_smatrix<4>();
+		run_smatrix<16>();
+		run_smatrix<64>();
+		for(unsigned n : { 4, 16, 64, 256, 1024 }) {
+			run_dmatrix(n);
+		}
+	}
+} /* namespace construction */
+
+
+namespace reductions {
+	void run_dmatrix(unsigned n) {
+		auto m = fixtures::make_dmatrix<double>(n, n);
+		const auto& const_m = m;
+
+		harness::run("sum_loop", "dmatrix", n, n, [&] { harness::keep(access::sum_by_pointer(&m.element_at(0, 0), n, n)); });
+		harness::run("sum", "dmatrix", n, n, [&] { harness::keep(matrix::sum(m)); });
+		harness::run("sum_each_row", "dmatrix", n, n, [&] { harness::keep(matrix::sum(m, matrix::each_row)); });
+		harness::run("sum_each_col", "dmatrix", n, n, [&] { harness::keep(matrix::sum(m, matrix::each_col)); });
+		harness::run("sum_region", "dmatrix", n, n, [&] {
+			harness::keep(matrix::sum(const_m[matrix::drange(n / 2, n / 4)][matrix::drange(n / 2, n / 4)]));
+		});
+		harness::run("max", "dmatrix", n, n, [&] { harness::keep(matrix::max(m)); });
+		harness::run("argmax", "dmatrix", n, n, [&] { harness::keep(matrix::argmax(m)); });
+		harness::run("l2_norm", "dmatrix", n, n, [&] { harness::keep(matrix::l2_norm(m)); });
+		harness::run("variance", "dmatrix", n, n, [&] { harness::keep(matrix::variance(m)); });
+	}
+
+	void run() {
+		for(unsigned n : { 16, 256, 1024, 4096 }) {
+			run_dmatrix(n);
+		}
+	}
+} /* namespace reductions */
+
+
+namespace linear_algebra {
+	void run_dmatrix(unsigned n) {
+		auto a = fixtures::make_dmatrix<double>(n, n);
+		auto b = fixtures::make_dmatrix<double>(n, n);
+		matrix::dmatrix<double> c(n, n);
+		// Diagonally dominant, so that it stays well conditioned at any size
+		auto d = matrix::dmatrix<double>::generate(n, n, [&](unsigned row, unsigned col) {
+			return a.element_at(row, col) + (row == col ? 2.0 * n : 0.0);
+		});
+		auto factorization = matrix::lu(d);
+
+		harness::run("multiply", "dmatrix", n, n, [&] { harness::keep(matrix::multiply(a, b)); });
+		harness::run("multiply_into", "dmatrix", n, n, [&] { matrix::multiply_into(c, a, b); harness::keep(c); });
+		harness::run("lu", "dmatrix", n, n, [&] { harness::keep(matrix::lu(d)); });
+		harness::run("lu_solve", "dmatrix", n, n, [&] { harness::keep(matrix::solve(factorization, b)); });
+
+		auto spd = matrix::dmatrix<double>::generate(n, n, [&](unsigned row, unsigned col) {
+			return (std::min(row, col) * 7 + std::max(row, col) * 3) % 11 / 11.0 + (row == col ? n : 0);
+		});
+		auto cholesky = matrix::cholesky(spd);
+		auto x = matrix::dmatrix<double>::generate(n, 8, [](unsigned row, unsigned col) { return (row + col) % 5 * 0.1; });
+		harness::run("cholesky", "dmatrix", n, n, [&] { harness::keep(matrix::cholesky(spd)); });
+		harness::run("ldlt", "dmatrix", n, n, [&] { harness::keep(matrix::ldlt(spd)); });
+		harness::run("cholesky_update_rank8", "dmatrix", n, n, [&] { cholesky.update(x); harness::keep(cholesky); });
+
+		// With the triangle of a well conditioned matrix, right-hand sides reset each time
+		harness::run("trsm_left", "dmatrix", n, n, [&] {
+			c = b;
+			matrix::triangular_solve_into(c, spd, matrix::side::left, matrix::triangle::lower);
+			harness::keep(c);
+		});
+		harness::run("trsm_right", "dmatrix", n, n, [&] {
+			c = b;
+			matrix::triangular_solve_into(c, spd, matrix::side::right, matrix::triangle::lower, matrix::diagonal::non_unit, true);
+			harness::keep(c);
+		});
+		harness::run("trmm_left", "dmatrix", n, n, [&] {
+			c = b;
+			matrix::triangular_multiply_into(c, spd, matrix::side::left, matrix::triangle::upper);
+			harness::keep(c);
+		});
+
+		harness::run("eigh", "dmatrix", n, n, [&] { harness::keep(matrix::eigh(spd)); });
+		harness::run("eigvalsh", "dmatrix", n, n, [&] { harness::keep(matrix::eigvalsh(spd)); });
+	}
+
+	// The transition matrix of a Markov chain, whose powers stay bounded
+	double transition(unsigned row, unsigned col, unsigned n) {
+		double sum = 0;
+		for(unsigned other = 0; other < n; ++other) {
+			sum += 1.0 + (row + other) % 3;
+		}
+		return (1.0 + (row + col) % 3) / sum;
+	}
+
+	template <unsigned N>
+	void run_power_smatrix() {
+		static matrix::smatrix<double, N, N> m;
+		for(unsigned row = 0; row < N; ++row) {
+			for(unsigned col = 0; col < N; ++col) {
+				m.element_at(row, col) = transition(row, col, N);
+			}
+		}
+		harness::run("pow_1000000", "smatrix", N, N, [] { harness::keep(matrix::pow(m, 1000000)); });
+		harness::run("expm", "smatrix", N, N, [] { harness::keep(matrix::expm(m)); });
+	}
+
+	void run_power_dmatrix(unsigned n) {
+		auto m = matrix::dmatrix<double>::generate(n, n, [n](unsigned row, unsigned col) { return transition(row, col, n); });
+		harness::run("pow_1000000", "dmatrix", n, n, [&] { harness::keep(matrix::pow(m, 1000000)); });
+		harness::run("expm", "dmatrix", n, n, [&] { harness::keep(matrix::expm(m)); });
+	}
+
+	// Regression design matrices: many more observations than variables
+	void run_tall(unsigned rows, unsigned cols) {
+		auto a = matrix::dmatrix<double>::generate(rows, cols, [](unsigned row, unsigned col) {
+			return std::sin((row + 1) * (col + 1) * 0.013) + (row % (col + 2) == 0);
+		});
+		auto b = matrix::dmatrix<double>::generate(rows, 1, [](unsigned row, unsigned) { return std::cos(row * 0.1); });
+
+		harness::run("qr", "dmatrix", rows, cols, [&] { harness::keep(matrix::qr(a)); });
+		harness::run("lstsq", "dmatrix", rows, cols, [&] { harness::keep(matrix::lstsq(a, b)); });
+		harness::run("randomized_svd_half", "dmatrix", rows, cols, [&] { harness::keep(matrix::randomized_svd(a, cols / 2)); });
+	}
+
+	// The 5-point Laplacian of a side x side grid, with a fixed number of iterations
+	void run_krylov(unsigned side) {
+		unsigned n = side * side;
+		std::vector<matrix::sparse_entry<double>> entries;
+		for(unsigned row = 0; row < n; ++row) {
+			entries.push_back({ row, row, 4.0 });
+			for(unsigned neighbor : { row - 1, row + 1, row - side, row + side }) {
+				if(neighbor < n  &&  (neighbor / side == row / side  ||  neighbor % side == row % side)) {
+					entries.push_back({ row, neighbor, -1.0 });
+				}
+			}
+		}
+		auto a = matrix::csr_matrix<double>::from_entries(n, n, std::move(entries));
+		auto b = matrix::dmatrix<double>::generate(n, 1, [](unsigned row, unsigned) { return std::sin(row * 0.01); });
+		matrix::ilu0_preconditioner<double> ilu(a);
+		matrix::iterative_options settings;
+		settings.tolerance = 0;
+		settings.max_iterations = 20;
+		matrix::dmatrix<double> x(n, 1);
+
+		harness::run("cg_20", "csr", n, n, [&] {
+			x = matrix::dmatrix<double>(n, 1);
+			harness::keep(matrix::conjugate_gradient_into(x, a, b, matrix::identity_preconditioner(), settings));
+		});
+		harness::run("cg_ilu0_20", "csr", n, n, [&] {
+			x = matrix::dmatrix<double>(n, 1);
+			harness::keep(matrix::conjugate_gradient_into(x, a, b, ilu, settings));
+		});
+		harness::run("gmres_20", "csr", n, n, [&] {
+			x = matrix::dmatrix<double>(n, 1);
+			harness::keep(matrix::gmres_into(x, a, b, matrix::identity_preconditioner(), settings));
+		});
+		harness::run("bicgstab_20", "csr", n, n, [&] {
+			x = matrix::dmatrix<double>(n, 1);
+			harness::keep(matrix::bicgstab_into(x, a, b, matrix::identity_preconditioner(), settings));
+		});
+	}
+
+	// A Kronecker product applied through its factors, against the same product formed first
+	void run_kron(unsigned side) {
+		unsigned n = side * side;
+		auto a = matrix::dmatrix<double>::generate(side, side, [](unsigned row, unsigned col) { return std::sin(row * 0.3 + col * 0.7); });
+		auto b = matrix::dmatrix<double>::generate(side, side, [](unsigned row, unsigned col) { return std::cos(row * 0.5 + col * 0.2); });
+		auto x = matrix::dmatrix<double>::generate(n, 1, [](unsigned row, unsigned) { return std::sin(row * 0.01); });
+		auto k = matrix::kron(a, b);
+
+		harness::run("kron_times_vector", "view", n, n, [&] {
+			harness::keep(matrix::multiply(k, x));
+		});
+		harness::run("kron_formed_times_vector", "dmatrix", n, n, [&] {
+			auto formed = matrix::dmatrix<double>::generate(n, n, [&](unsigned row, unsigned col) { return k.element_at(row, col); });
+			harness::keep(matrix::multiply(formed, x));
+		});
+	}
+
+	void run() {
+		for(unsigned n : { 64, 256, 1024 }) {
+			run_dmatrix(n);
+		}
+		run_power_smatrix<4>();
+		run_power_smatrix<8>();
+		run_power_smatrix<16>();
+		run_power_smatrix<64>();
+		for(unsigned n : { 4, 16, 64, 128 }) {
+			run_power_dmatrix(n);
+		}
+		run_tall(10000, 20);
+		run_tall(50000, 200);
+		run_krylov(1000);
+		run_kron(64);
+	}
+} /* namespace linear_algebra */
+
+
+int main(int argc, char* argv[]) {
+	if(argc > 1) {
+		harness::filter = argv[1];
+	}
+
+	access::run();
+	elementwise::run();
+	construction::run();
+	reductions::run();
+	linear_algebra::run();
+
+	harness::print_json();
+}
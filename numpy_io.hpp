@@ -0,0 +1,661 @@
+#ifndef NUMPY_IO_HPP_
+#define NUMPY_IO_HPP_
+
+#include "matrix.hpp"
+#include "binary_io.hpp"
+#include "mapped_dmatrix.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+inline bool is_little_endian() noexcept {
+	const std::uint16_t probe = 1;
+	return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+}
+
+
+struct npy_dtype {
+	binary_element_kind kind;
+	unsigned size;
+	bool swapped;  // Stored in the opposite byte order of this machine
+
+	template <typename T>
+	static npy_dtype of() {
+		return { binary_element_kind_of<T>(), sizeof(T), false };
+	}
+
+	template <typename T>
+	bool is() const {
+		return !swapped  &&  kind == binary_element_kind_of<T>()  &&  size == sizeof(T);
+	}
+
+	std::string descr() const {
+		char kind_char = kind == binary_element_kind::floating_point ? 'f'
+		               : kind == binary_element_kind::signed_integer ? 'i'
+		               :                                               'u';
+		char order_char = size == 1                    ? '|'
+		                : is_little_endian() != swapped ? '<'
+		                :                                 '>';
+		return std::string{ order_char, kind_char } + std::to_string(size);
+	}
+
+	static npy_dtype parse(const std::string& descr) {
+		if(descr.size() < 3) {
+			throw format_error("Unsupported NumPy dtype '" + descr + "'");
+		}
+
+		npy_dtype dtype;
+		switch(descr[0]) {
+			case '<': dtype.swapped = !is_little_endian(); break;
+			case '>': dtype.swapped =  is_little_endian(); break;
+			case '|':
+			case '=': dtype.swapped = false; break;
+			default: throw format_error("Unsupported NumPy dtype '" + descr + "'");
+		}
+		switch(descr[1]) {
+			case 'f': dtype.kind = binary_element_kind::floating_point; break;
+			case 'i': dtype.kind = binary_element_kind::signed_integer; break;
+			case 'u':
+			case 'b': dtype.kind = binary_element_kind::unsigned_integer; break;
+			default: throw format_error("Unsupported NumPy dtype '" + descr + "'");
+		}
+		std::string size = descr.substr(2);
+		if(size != "1"  &&  size != "2"  &&  size != "4"  &&  size != "8") {
+			throw format_error("Unsupported NumPy dtype '" + descr + "'");
+		}
+		dtype.size = size[0] - '0';
+		if(dtype.kind == binary_element_kind::floating_point  &&  dtype.size < 4) {
+			throw format_error("Unsupported NumPy dtype '" + descr + "'");
+		}
+		if(dtype.size == 1) {
+			dtype.swapped = false;
+		}
+		return dtype;
+	}
+
+	// Reads one element stored with this dtype and converts it to T
+	template <typename T>
+	T read(const char* p) const {
+		char bytes[8];
+		std::memcpy(bytes, p, size);
+		if(swapped) {
+			std::reverse(bytes, bytes + size);
+		}
+		switch(kind) {
+			case binary_element_kind::floating_point:
+				return size == 4 ? T(load<float>(bytes)) : T(load<double>(bytes));
+			case binary_element_kind::signed_integer:
+				switch(size) {
+					case 1:  return T(load<std::int8_t >(bytes));
+					case 2:  return T(load<std::int16_t>(bytes));
+					case 4:  return T(load<std::int32_t>(bytes));
+					default: return T(load<std::int64_t>(bytes));
+				}
+			default:
+				switch(size) {
+					case 1:  return T(load<std::uint8_t >(bytes));
+					case 2:  return T(load<std::uint16_t>(bytes));
+					case 4:  return T(load<std::uint32_t>(bytes));
+					default: return T(load<std::uint64_t>(bytes));
+				}
+		}
+	}
+
+private:
+	template <typename U>
+	static U load(const char* bytes) {
+		U value;
+		std::memcpy(&value, bytes, sizeof(value));
+		return value;
+	}
+};
+
+
+struct npy_header {
+	npy_dtype dtype;
+	bool fortran_order;
+	unsigned rows;
+	unsigned cols;
+	std::size_t data_offset;  // From the start of the .npy data
+
+	std::size_t data_size() const noexcept {
+		return std::size_t(rows) * cols * dtype.size;
+	}
+};
+
+
+// Extracts the text following `'key':` in the header dictionary
+inline std::string npy_header_value(const std::string& dict, const std::string& key) {
+	auto key_position = dict.find("'" + key + "'");
+	if(key_position == std::string::npos) {
+		throw format_error("Missing '" + key + "' in NumPy header");
+	}
+	auto colon = dict.find(':', key_position);
+	if(colon == std::string::npos) {
+		throw format_error("Malformed NumPy header");
+	}
+	auto first = dict.find_first_not_of(' ', colon + 1);
+	if(first == std::string::npos) {
+		throw format_error("Malformed NumPy header");
+	}
+
+	if(dict[first] == '\''  ||  dict[first] == '(') {
+		auto last = dict.find(dict[first] == '\'' ? '\'' : ')', first + 1);
+		if(last == std::string::npos) {
+			throw format_error("Malformed NumPy header");
+		}
+		return dict.substr(first + 1, last - first - 1);
+	}
+
+	// Anything else runs to the next key, or to the end of the dictionary for the last one
+	auto last = dict.find_first_of(",}", first);
+	if(last == std::string::npos) {
+		throw format_error("Malformed NumPy header");
+	}
+	last = dict.find_last_not_of(' ', last - 1);
+	return dict.substr(first, last + 1 - first);
+}
+
+
+inline npy_header parse_npy_header(const char* data, std::size_t size) {
+	static const char magic[] = "\x93NUMPY";
+	if(size < 10  ||  std::memcmp(data, magic, 6) != 0) {
+		throw format_error("Not a NumPy array");
+	}
+
+	unsigned major = static_cast<unsigned char>(data[6]);
+	std::size_t length_size = major == 1 ? 2 : 4;
+	if(major < 1  ||  major > 3  ||  size < 8 + length_size) {
+		throw format_error("Unsupported NumPy format version " + std::to_string(major));
+	}
+	std::size_t dict_size = 0;
+	for(std::size_t i = length_size; i > 0; --i) {
+		dict_size = dict_size << 8 | static_cast<unsigned char>(data[8 + i - 1]);
+	}
+	std::size_t dict_offset = 8 + length_size;
+	if(dict_size > size - dict_offset) {
+		throw format_error("Truncated NumPy header");
+	}
+	std::string dict(data + dict_offset, dict_size);
+
+	npy_header header;
+	header.dtype = npy_dtype::parse(npy_header_value(dict, "descr"));
+
+	std::string fortran_order = npy_header_value(dict, "fortran_order");
+	if(fortran_order != "True"  &&  fortran_order != "False") {
+		throw format_error("Malformed NumPy header");
+	}
+	header.fortran_order = (fortran_order == "True");
+
+	std::vector<std::uint64_t> shape;
+	std::string shape_text = npy_header_value(dict, "shape");
+	for(std::size_t p = 0; (p = shape_text.find_first_of("0123456789", p)) != std::string::npos; ) {
+		std::size_t end = shape_text.find_first_not_of("0123456789", p);
+		try {
+			shape.push_back(std::stoull(shape_text.substr(p, end - p)));
+		} catch(std::out_of_range&) {
+			throw format_error("NumPy array dimensions are too large");
+		}
+		p = end;
+	}
+	if(shape.size() > 2) {
+		throw format_error("Only NumPy arrays of up to 2 dimensions can be read as a matrix");
+	}
+	// 0-d arrays become 1x1 and 1-d arrays become column vectors
+	shape.resize(2, 1);
+	if(shape[0] > std::numeric_limits<unsigned>::max()  ||  shape[1] > std::numeric_limits<unsigned>::max()) {
+		throw format_error("NumPy array dimensions are too large");
+	}
+	header.rows = shape[0];
+	header.cols = shape[1];
+
+	header.data_offset = dict_offset + dict_size;
+	if(header.data_size() > size - header.data_offset) {
+		throw format_error("Truncated NumPy array data");
+	}
+	return header;
+}
+
+
+// The magic string, version, header length and header dictionary of a .npy image of m
+template <typename M>
+std::string npy_preamble(const matrix<M>& m) {
+	using value_type = typename std::remove_const<typename M::element_type>::type;
+
+	std::string dict = "{'descr': '" + npy_dtype::of<value_type>().descr() + "', "
+	                 + "'fortran_order': False, "
+	                 + "'shape': (" + std::to_string(rows(m)) + ", " + std::to_string(cols(m)) + "), }";
+
+	// Pad so the data starts at a multiple of 64 bytes, as NumPy does
+	std::size_t unpadded = 10 + dict.size() + 1;
+	dict.append((64 - unpadded % 64) % 64, ' ');
+	dict += '\n';
+
+	std::string preamble("\x93NUMPY\x01\x00", 8);
+	preamble += char(dict.size() & 0xFF);
+	preamble += char(dict.size() >> 8);
+	preamble += dict;
+	return preamble;
+}
+
+
+/*
+ * Writes a C-order .npy image of m through sink(const char*, std::size_t),
+ * one row at a time.
+ */
+template <typename M, typename Sink>
+void write_npy(const matrix<M>& m, Sink sink) {
+	using value_type = typename std::remove_const<typename M::element_type>::type;
+
+	std::string preamble = npy_preamble(m);
+	sink(preamble.data(), preamble.size());
+
+	std::vector<value_type> row_buffer(cols(m));
+	for(unsigned row = 0; row < rows(m); ++row) {
+		for(unsigned col = 0; col < cols(m); ++col) {
+			row_buffer[col] = element_at(m, row, col);
+		}
+		sink(reinterpret_cast<const char*>(row_buffer.data()), row_buffer.size() * sizeof(value_type));
+	}
+}
+
+
+/*
+ * Views the array stored in [data, data + size) of the mapped file. The
+ * mapping is used as is when the dtype and the order match T and C order;
+ * otherwise the elements are converted into an owned buffer.
+ */
+template <typename T>
+mapped_dmatrix<T> view_npy(const std::shared_ptr<const mapped_file>& file, const char* data, std::size_t size) {
+	npy_header header = parse_npy_header(data, size);
+	const char* elements = data + header.data_offset;
+
+	bool aligned = reinterpret_cast<std::uintptr_t>(elements) % alignof(T) == 0;
+	bool transposed = header.fortran_order  &&  header.rows > 1  &&  header.cols > 1;
+	if(header.dtype.is<T>()  &&  !transposed  &&  aligned) {
+		return mapped_dmatrix<T>(file, elements - file->data(), header.rows, header.cols);
+	}
+
+	std::size_t count = std::size_t(header.rows) * header.cols;
+	std::shared_ptr<T> buffer(new T[count], std::default_delete<T[]>());
+	for(std::size_t index = 0; index < count; ++index) {
+		std::size_t target = index;
+		if(transposed) {
+			// Element (row, col) is stored at col * rows + row
+			target = (index % header.rows) * header.cols + index / header.rows;
+		}
+		buffer.get()[target] = header.dtype.read<T>(elements + index * header.dtype.size);
+	}
+	return mapped_dmatrix<T>(std::move(buffer), header.rows, header.cols);
+}
+
+
+inline std::uint32_t crc32(std::uint32_t crc, const char* data, std::size_t size) {
+	static const auto table = [] {
+		std::vector<std::uint32_t> table(256);
+		for(std::uint32_t n = 0; n < 256; ++n) {
+			std::uint32_t c = n;
+			for(int k = 0; k < 8; ++k) {
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+		return table;
+	}();
+
+	crc = ~crc;
+	for(std::size_t i = 0; i < size; ++i) {
+		crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+
+inline std::uint64_t read_le(const char* p, unsigned size) {
+	std::uint64_t value = 0;
+	for(unsigned i = size; i > 0; --i) {
+		value = value << 8 | static_cast<unsigned char>(p[i - 1]);
+	}
+	return value;
+}
+
+inline void append_le(std::string& s, std::uint64_t value, unsigned size) {
+	for(unsigned i = 0; i < size; ++i) {
+		s += char(value >> (8 * i) & 0xFF);
+	}
+}
+
+
+struct zip_member {
+	std::string name;
+	std::size_t data_offset;
+	std::size_t size;
+};
+
+
+// Lists the members of an uncompressed zip archive held in [data, data + size)
+inline std::vector<zip_member> read_zip_directory(const char* data, std::size_t size) {
+	const std::size_t eocd_size = 22;
+	if(size < eocd_size) {
+		throw format_error("Not a zip archive");
+	}
+
+	// The end of central directory record is followed by a comment of up to 64 KiB
+	std::size_t eocd = size - eocd_size;
+	std::size_t lowest = size > eocd_size + 0xFFFF ? size - eocd_size - 0xFFFF : 0;
+	while(read_le(data + eocd, 4) != 0x06054b50) {
+		if(eocd == lowest) {
+			throw format_error("Not a zip archive");
+		}
+		--eocd;
+	}
+
+	std::size_t count = read_le(data + eocd + 10, 2);
+	std::size_t entry = read_le(data + eocd + 16, 4);
+	std::vector<zip_member> members;
+	for(std::size_t i = 0; i < count; ++i) {
+		if(entry + 46 > size  ||  read_le(data + entry, 4) != 0x02014b50) {
+			throw format_error("Corrupt zip central directory");
+		}
+		unsigned method = read_le(data + entry + 10, 2);
+		std::uint64_t compressed_size = read_le(data + entry + 20, 4);
+		std::uint64_t local_offset = read_le(data + entry + 42, 4);
+		std::size_t name_size = read_le(data + entry + 28, 2);
+		std::size_t extra_size = read_le(data + entry + 30, 2);
+		std::size_t comment_size = read_le(data + entry + 32, 2);
+		if(entry + 46 + name_size + extra_size > size) {
+			throw format_error("Corrupt zip central directory");
+		}
+		std::string name(data + entry + 46, name_size);
+
+		// Zip64 extended information replaces the fields saturated at 0xFFFFFFFF
+		const char* extra = data + entry + 46 + name_size;
+		for(std::size_t p = 0; p + 4 <= extra_size; ) {
+			unsigned id = read_le(extra + p, 2);
+			std::size_t field_size = read_le(extra + p + 2, 2);
+			if(p + 4 + field_size > extra_size) {
+				throw format_error("Corrupt zip extra field for '" + name + "'");
+			}
+			if(id == 0x0001) {
+				const char* field = extra + p + 4;
+				std::size_t used = 0;
+				auto next_value = [&] {
+					if(used + 8 > field_size) {
+						throw format_error("Corrupt zip64 extra field for '" + name + "'");
+					}
+					used += 8;
+					return read_le(field + used - 8, 8);
+				};
+				if(read_le(data + entry + 24, 4) == 0xFFFFFFFF) {
+					next_value();
+				}
+				if(compressed_size == 0xFFFFFFFF) {
+					compressed_size = next_value();
+				}
+				if(local_offset == 0xFFFFFFFF) {
+					local_offset = next_value();
+				}
+			}
+			p += 4 + field_size;
+		}
+
+		if(method != 0) {
+			throw format_error("Compressed zip member '" + name + "' is not supported");
+		}
+		// Bounds are written as differences, as offsets from the archive may be large enough to wrap sums
+		if(size < 30  ||  local_offset > size - 30  ||  read_le(data + local_offset, 4) != 0x04034b50) {
+			throw format_error("Corrupt zip local header for '" + name + "'");
+		}
+		std::uint64_t header_extra = read_le(data + local_offset + 26, 2) + read_le(data + local_offset + 28, 2);
+		if(header_extra > size - 30 - local_offset) {
+			throw format_error("Truncated zip member '" + name + "'");
+		}
+		std::size_t data_offset = local_offset + 30 + header_extra;
+		if(compressed_size > size - data_offset) {
+			throw format_error("Truncated zip member '" + name + "'");
+		}
+
+		members.push_back({ name, data_offset, std::size_t(compressed_size) });
+		entry += 46 + name_size + extra_size + comment_size;
+	}
+	return members;
+}
+
+
+} /* namespace __impl */
+
+
+template <typename M>
+void save_npy(std::ostream& os, const matrix<M>& m) {
+	__impl::write_npy(m, [&](const char* data, std::size_t size) {
+		os.write(data, size);
+	});
+	if(!os) {
+		throw std::ios_base::failure("Error writing NumPy array");
+	}
+}
+
+
+template <typename M>
+void save_npy(const std::string& path, const matrix<M>& m) {
+	std::ofstream os(path, std::ios::binary | std::ios::trunc);
+	if(!os) {
+		throw std::system_error(errno, std::generic_category(), "open " + path);
+	}
+	save_npy(os, m);
+	os.close();
+	if(!os) {
+		throw std::ios_base::failure("Error writing NumPy array to " + path);
+	}
+}
+
+
+/*
+ * Loads a .npy file. When its dtype is T and it is in C order (or is a
+ * vector), the result views the mapped file without copying; otherwise the
+ * elements are converted and reordered into memory.
+ */
+template <typename T>
+mapped_dmatrix<T> load_npy(const std::string& path) {
+	auto file = std::make_shared<const mapped_file>(path);
+	try {
+		return __impl::view_npy<T>(file, file->data(), file->size());
+	} catch(format_error& e) {
+		throw format_error(std::string(e.what()) + " in " + path);
+	}
+}
+
+
+template <typename T, unsigned Rows, unsigned Cols>
+void load_npy(const std::string& path, smatrix<T, Rows, Cols>& m) {
+	auto loaded = load_npy<T>(path);
+	if(loaded.rows() != Rows  ||  loaded.cols() != Cols) {
+		throw format_error("NumPy array in " + path + " does not have the shape of the smatrix");
+	}
+	for(unsigned row = 0; row < Rows; ++row) {
+		for(unsigned col = 0; col < Cols; ++col) {
+			m.element_at(row, col) = loaded.element_at(row, col);
+		}
+	}
+}
+
+
+/*
+ * Loads every array of an uncompressed .npz archive, keyed by name without
+ * the .npy extension. Members are viewed in place when possible, and all of
+ * them share the single mapping of the archive.
+ */
+template <typename T>
+std::map<std::string, mapped_dmatrix<T>> load_npz(const std::string& path) {
+	auto file = std::make_shared<const mapped_file>(path);
+	std::map<std::string, mapped_dmatrix<T>> arrays;
+	try {
+		for(const auto& member : __impl::read_zip_directory(file->data(), file->size())) {
+			std::string name = member.name;
+			if(name.size() > 4  &&  name.compare(name.size() - 4, 4, ".npy") == 0) {
+				name.resize(name.size() - 4);
+			}
+			arrays.emplace(name, __impl::view_npy<T>(file, file->data() + member.data_offset, member.size));
+		}
+	} catch(format_error& e) {
+		throw format_error(std::string(e.what()) + " in " + path);
+	}
+	return arrays;
+}
+
+
+/*
+ * Writes an uncompressed .npz archive that NumPy can load. Every array is
+ * streamed into the archive as it is added.
+ */
+class npz_writer {
+public:
+	npz_writer() = delete;
+
+	npz_writer(const npz_writer&) = delete;
+
+	explicit npz_writer(const std::string& path)
+		: path(path), os(path, std::ios::binary | std::ios::trunc)
+	{
+		if(!os) {
+			throw std::system_error(errno, std::generic_category(), "open " + path);
+		}
+	}
+
+	~npz_writer() {
+		if(!closed) {
+			try {
+				close();
+			} catch(...) {}
+		}
+	}
+
+	npz_writer& operator=(const npz_writer&) = delete;
+
+	template <typename M>
+	void add(const std::string& name, const matrix<M>& m) {
+		using value_type = typename std::remove_const<typename M::element_type>::type;
+
+		std::string file_name = name + ".npy";
+		std::uint64_t offset = os.tellp();
+
+		// The size is known up front; the CRC is patched in after the data
+		std::uint64_t size = __impl::npy_preamble(m).size()
+		                   + std::uint64_t(rows(m)) * cols(m) * sizeof(value_type);
+		if(size > 0xFFFFFFFE  ||  offset > 0xFFFFFFFE) {
+			throw format_error("Array '" + name + "' is too large for a zip archive without Zip64");
+		}
+
+		std::string local;
+		__impl::append_le(local, 0x04034b50, 4);
+		__impl::append_le(local, 20, 2);    // Version needed
+		__impl::append_le(local, 0, 2);     // Flags
+		__impl::append_le(local, 0, 2);     // Stored
+		__impl::append_le(local, 0, 2);     // Time
+		__impl::append_le(local, 0x21, 2);  // Date: 1980-01-01
+		__impl::append_le(local, 0, 4);     // CRC, patched below
+		__impl::append_le(local, size, 4);
+		__impl::append_le(local, size, 4);
+		__impl::append_le(local, file_name.size(), 2);
+
+		// Pad with an extra field so the array data lands on a 64-byte boundary,
+		// which lets load_npz() view it in place
+		std::size_t unpadded = offset + local.size() + 2 + file_name.size() + 4;
+		std::size_t padding = (64 - unpadded % 64) % 64;
+		__impl::append_le(local, 4 + padding, 2);
+		local += file_name;
+		__impl::append_le(local, 0xD935, 2);
+		__impl::append_le(local, padding, 2);
+		local.append(padding, '\0');
+		os.write(local.data(), local.size());
+
+		std::uint32_t crc = 0;
+		__impl::write_npy(m, [&](const char* data, std::size_t n) {
+			crc = __impl::crc32(crc, data, n);
+			os.write(data, n);
+		});
+
+		std::string crc_bytes;
+		__impl::append_le(crc_bytes, crc, 4);
+		auto end = os.tellp();
+		os.seekp(offset + 14);
+		os.write(crc_bytes.data(), crc_bytes.size());
+		os.seekp(end);
+		if(!os) {
+			throw std::ios_base::failure("Error writing NumPy archive " + path);
+		}
+
+		std::string& central = central_directory;
+		__impl::append_le(central, 0x02014b50, 4);
+		__impl::append_le(central, 20, 2);  // Version made by
+		__impl::append_le(central, 20, 2);  // Version needed
+		central.append(local, 6, 8);        // Flags, method, time, date
+		central += crc_bytes;
+		__impl::append_le(central, size, 4);
+		__impl::append_le(central, size, 4);
+		__impl::append_le(central, file_name.size(), 2);
+		__impl::append_le(central, 0, 2);   // Extra
+		__impl::append_le(central, 0, 2);   // Comment
+		__impl::append_le(central, 0, 2);   // Disk
+		__impl::append_le(central, 0, 2);   // Internal attributes
+		__impl::append_le(central, 0, 4);   // External attributes
+		__impl::append_le(central, offset, 4);
+		central += file_name;
+		++members;
+	}
+
+	void close() {
+		closed = true;
+
+		std::uint64_t offset = os.tellp();
+		std::string end;
+		__impl::append_le(end, 0x06054b50, 4);
+		__impl::append_le(end, 0, 2);
+		__impl::append_le(end, 0, 2);
+		__impl::append_le(end, members, 2);
+		__impl::append_le(end, members, 2);
+		__impl::append_le(end, central_directory.size(), 4);
+		__impl::append_le(end, offset, 4);
+		__impl::append_le(end, 0, 2);
+
+		os.write(central_directory.data(), central_directory.size());
+		os.write(end.data(), end.size());
+		os.close();
+		if(!os) {
+			throw std::ios_base::failure("Error writing NumPy archive " + path);
+		}
+	}
+
+private:
+	std::string path;
+	std::ofstream os;
+	std::string central_directory;
+	unsigned members = 0;
+	bool closed = false;
+};
+
+
+} /* namespace matrix */
+
+
+#endif /* NUMPY_IO_HPP_ */
@@ -0,0 +1,417 @@
+#ifndef PARALLEL_HPP_
+#define PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+inline unsigned hardware_parallelism() noexcept {
+	// Querying the system is not free, and the answer does not change
+	static const unsigned n = std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+
+} /* namespace __impl */
+
+
+struct thread_pool_options {
+	// Threads working on a parallel call, the calling one included; 0 for one per hardware thread
+	unsigned threads = 0;
+	// When not empty, worker threads are pinned to these, in turn; the calling thread is left as it is
+	std::vector<unsigned> cpus;
+
+	// The one worker thread i, from 1 to threads - 1, is pinned to
+	unsigned cpu_of(unsigned worker) const noexcept {
+		return cpus[(worker - 1) % cpus.size()];
+	}
+};
+
+
+/*
+ * A fixed set of worker threads sharing fork-join jobs. Every thread has its
+ * own task queue and steals from the others when it runs dry. A thread
+ * waiting for its job runs queued tasks meanwhile, so jobs started from
+ * within tasks reuse the same threads instead of oversubscribing the machine.
+ */
+class thread_pool {
+public:
+	explicit thread_pool(const thread_pool_options& options = thread_pool_options())
+		: epoch(0), stopping(false)
+	{
+		unsigned threads = options.threads > 0 ? options.threads : __impl::hardware_parallelism();
+
+		// Queue 0 takes the tasks of threads outside of the pool
+		for(unsigned index = 0; index < threads; ++index) {
+			queues.emplace_back(new task_queue);
+		}
+
+		workers.reserve(threads - 1);
+		for(unsigned worker = 1; worker < threads; ++worker) {
+			try {
+				workers.emplace_back([this, worker] { work(worker); });
+			} catch(std::system_error&) {
+				// Out of threads: make do with the ones started so far
+				break;
+			}
+			if(!options.cpus.empty()) {
+				pin(workers.back(), options.cpu_of(worker));
+			}
+		}
+	}
+
+	thread_pool(const thread_pool&) = delete;
+
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for(auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	// Threads that can work on a job at once, the calling one included
+	unsigned concurrency() const noexcept { return workers.size() + 1; }
+
+	/*
+	 * Calls func(0), ..., func(count - 1), possibly concurrently, and waits for
+	 * all of them; the calling thread takes part. If any call throws, the first
+	 * exception (by index) is rethrown after all calls have finished.
+	 */
+	template <typename F>
+	void run(unsigned count, F func) {
+		if(count == 0) {
+			return;
+		}
+
+		job j(count, func);
+		if(count > 1  &&  !workers.empty()) {
+			push(j, 1, count);
+			execute(task{ &j, 0 });
+			wait(j);
+		} else {
+			for(unsigned index = 0; index < count; ++index) {
+				execute(task{ &j, index });
+			}
+		}
+
+		for(auto& error : j.errors) {
+			if(error) {
+				std::rethrow_exception(error);
+			}
+		}
+	}
+
+private:
+	struct job {
+		void (*invoke)(void* func, unsigned index);
+		void* func;
+		std::atomic<unsigned> remaining;
+		std::vector<std::exception_ptr> errors;
+
+		template <typename F>
+		job(unsigned count, F& f)
+			: invoke([](void* func, unsigned index) { (*static_cast<F*>(func))(index); }),
+			  func(&f), remaining(count), errors(count)
+		{}
+	};
+
+	struct task {
+		job* owner;
+		unsigned index;
+	};
+
+	struct task_queue {
+		std::mutex mutex;
+		std::deque<task> tasks;
+	};
+
+	// The pool and queue of the running thread, if it is a worker
+	struct worker_identity {
+		const thread_pool* pool;
+		unsigned queue;
+	};
+
+	std::vector<std::unique_ptr<task_queue>> queues;
+	std::vector<std::thread> workers;
+
+	// Bumped whenever tasks are queued or a job finishes, to wake sleeping threads
+	std::mutex sleep_mutex;
+	std::condition_variable wake;
+	std::atomic<unsigned long> epoch;
+	bool stopping;
+
+	static worker_identity& current_worker() noexcept {
+		static thread_local worker_identity identity = { nullptr, 0 };
+		return identity;
+	}
+
+	unsigned own_queue() const noexcept {
+		const auto& identity = current_worker();
+		return identity.pool == this ? identity.queue : 0;
+	}
+
+	void notify() {
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			epoch.fetch_add(1, std::memory_order_release);
+		}
+		wake.notify_all();
+	}
+
+	void push(job& j, unsigned first, unsigned last) {
+		auto& queue = *queues[own_queue()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			for(unsigned index = first; index < last; ++index) {
+				queue.tasks.push_back(task{ &j, index });
+			}
+		}
+		notify();
+	}
+
+	void execute(task t) {
+		try {
+			t.owner->invoke(t.owner->func, t.index);
+		} catch(...) {
+			t.owner->errors[t.index] = std::current_exception();
+		}
+		if(t.owner->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			notify();
+		}
+	}
+
+	// Runs one task: the newest of the own queue, else the oldest of another one
+	bool run_one(unsigned own) {
+		task t = { nullptr, 0 };
+		bool found = false;
+		{
+			auto& queue = *queues[own];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if(!queue.tasks.empty()) {
+				t = queue.tasks.back();
+				queue.tasks.pop_back();
+				found = true;
+			}
+		}
+		for(std::size_t offset = 1; !found  &&  offset < queues.size(); ++offset) {
+			auto& queue = *queues[(own + offset) % queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if(!queue.tasks.empty()) {
+				t = queue.tasks.front();
+				queue.tasks.pop_front();
+				found = true;
+			}
+		}
+		if(found) {
+			execute(t);
+		}
+		return found;
+	}
+
+	void wait(job& j) {
+		unsigned own = own_queue();
+		while(j.remaining.load(std::memory_order_acquire) != 0) {
+			auto seen = epoch.load(std::memory_order_acquire);
+			if(run_one(own)) {
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleep_mutex);
+			wake.wait(lock, [&] {
+				return epoch.load(std::memory_order_relaxed) != seen
+				    || j.remaining.load(std::memory_order_acquire) == 0;
+			});
+		}
+	}
+
+	void work(unsigned queue) {
+		current_worker() = { this, queue };
+		for(;;) {
+			auto seen = epoch.load(std::memory_order_acquire);
+			if(run_one(queue)) {
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleep_mutex);
+			wake.wait(lock, [&] {
+				return stopping  ||  epoch.load(std::memory_order_relaxed) != seen;
+			});
+			if(stopping) {
+				return;
+			}
+		}
+	}
+
+	static void pin(std::thread& thread, unsigned cpu) noexcept {
+#if defined(__linux__)
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		// Best effort: an unavailable CPU leaves the thread unpinned
+		::pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+#else
+		(void)thread;
+		(void)cpu;
+#endif
+	}
+};
+
+
+/*
+ * What parallel operations run on: a thread pool, and the amount of work
+ * below which splitting it is not worth the overhead.
+ */
+class execution_context {
+public:
+	static constexpr std::size_t default_serial_threshold = 1 << 15;
+
+	explicit execution_context(
+		const thread_pool_options& options = thread_pool_options(),
+		std::size_t serial_threshold = default_serial_threshold
+	)
+		: _pool(options), _serial_threshold(serial_threshold)
+	{}
+
+	thread_pool& pool() noexcept { return _pool; }
+
+	std::size_t serial_threshold() const noexcept { return _serial_threshold; }
+
+private:
+	thread_pool _pool;
+	std::size_t _serial_threshold;
+};
+
+
+namespace __impl {
+
+
+inline std::mutex& default_execution_context_mutex() {
+	static std::mutex mutex;
+	return mutex;
+}
+
+inline std::shared_ptr<execution_context>& default_execution_context_slot() {
+	static std::shared_ptr<execution_context> context;
+	return context;
+}
+
+
+} /* namespace __impl */
+
+
+// The context of calls that do not name one; created on first use with one thread per hardware thread
+inline std::shared_ptr<execution_context> default_execution_context() {
+	std::lock_guard<std::mutex> lock(__impl::default_execution_context_mutex());
+	auto& context = __impl::default_execution_context_slot();
+	if(!context) {
+		context = std::make_shared<execution_context>();
+	}
+	return context;
+}
+
+// Calls already running keep the previous context until they finish
+inline void set_default_execution_context(std::shared_ptr<execution_context> context) {
+	std::lock_guard<std::mutex> lock(__impl::default_execution_context_mutex());
+	__impl::default_execution_context_slot() = std::move(context);
+}
+
+
+// Per-call overrides of the execution context settings
+struct parallel_options {
+	// nullptr for the default context
+	execution_context* context = nullptr;
+	// At most this many threads; 0 for as many as the context has, 1 to run serially
+	unsigned max_threads = 0;
+	// Overrides the serial threshold of the context when not 0
+	std::size_t serial_threshold = 0;
+};
+
+
+/*
+ * Calls body(begin, end) on consecutive subranges covering [first, last),
+ * possibly concurrently. work_per_item estimates the cost of one item (e.g.
+ * the elements of a row) to weigh against the serial threshold. The range is
+ * split into several chunks per thread, so idle threads can even out the load.
+ */
+template <typename F>
+void parallel_for(
+	std::size_t first, std::size_t last, std::size_t work_per_item, F body,
+	const parallel_options& options = parallel_options()
+) {
+	if(first >= last) {
+		return;
+	}
+
+	std::shared_ptr<execution_context> default_context;
+	if(!options.context) {
+		default_context = default_execution_context();
+	}
+	execution_context& context = options.context ? *options.context : *default_context;
+
+	std::size_t threshold = options.serial_threshold > 0 ? options.serial_threshold : context.serial_threshold();
+	unsigned threads = context.pool().concurrency();
+	if(options.max_threads > 0) {
+		threads = std::min(threads, options.max_threads);
+	}
+
+	std::size_t items = last - first;
+	work_per_item = std::max<std::size_t>(work_per_item, 1);
+	std::size_t min_chunk_items = std::max<std::size_t>(threshold / work_per_item, 1);
+	std::size_t chunks_per_thread = options.max_threads > 0 ? 1 : 4;
+	std::size_t chunks = std::min(items / min_chunk_items, threads * chunks_per_thread);
+	if(threads <= 1  ||  chunks <= 1) {
+		body(first, last);
+		return;
+	}
+
+	context.pool().run(chunks, [&](unsigned chunk) {
+		body(first + items * chunk / chunks, first + items * (chunk + 1) / chunks);
+	});
+}
+
+
+namespace __impl {
+
+
+/*
+ * Calls func(0), ..., func(count - 1) on the default execution context and
+ * waits for all of them. If any call throws, the first exception (by index)
+ * is rethrown after all calls have finished.
+ */
+template <typename F>
+void parallel_invoke_n(unsigned count, F func) {
+	default_execution_context()->pool().run(count, func);
+}
+
+
+} /* namespace __impl */
+
+
+} /* namespace matrix */
+
+
+#endif /* PARALLEL_HPP_ */
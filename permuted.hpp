@@ -0,0 +1,258 @@
+#ifndef PERMUTED_HPP_
+#define PERMUTED_HPP_
+
+#include "matrix.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace matrix {
+
+
+/*
+ * Rows of a dmatrix picked by an array of row indices, and a range of its
+ * columns: what subscripting a permuted_dmatrix by a range of rows refers
+ * to. Like the region references, it is invalid once the matrix or the
+ * permutation changes.
+ */
+template <typename DMatrix>
+class permuted_dmatrix_region : public dynamic_matrix<permuted_dmatrix_region<DMatrix>> {
+private:
+	using region = permuted_dmatrix_region<DMatrix>;
+	using const_region = const permuted_dmatrix_region<const DMatrix>;
+
+public:
+	using element_type = typename DMatrix::element_type;
+
+	permuted_dmatrix_region() = delete;
+
+	permuted_dmatrix_region(
+		DMatrix& dmatrix, const unsigned* row_indices,
+		unsigned rows, unsigned cols, unsigned first_col
+	) noexcept
+		: dmatrix(dmatrix), row_indices(row_indices),
+		  _rows(rows), _cols(cols), first_col(first_col)
+	{}
+
+	template <typename M>
+	permuted_dmatrix_region& operator=(dynamic_matrix<M>&& m) {
+		incompatible_operands::throw_if_not_same_shape(*this, "=", m);
+		move_to(*this, std::move(m));
+		return *this;
+	}
+
+	unsigned rows() const noexcept { return _rows; };
+
+	unsigned cols() const noexcept { return _cols; };
+
+	element_type& element_at(unsigned row, unsigned col) {
+		__impl::verify_element_index(row, col, _rows, _cols);
+		return dmatrix.element_at(row_indices[row], first_col + col);
+	}
+
+	const element_type& element_at(unsigned row, unsigned col) const {
+		__impl::verify_element_index(row, col, _rows, _cols);
+		return dmatrix.element_at(row_indices[row], first_col + col);
+	}
+
+	region operator[](unsigned col) {
+		__impl::verify_col_range(col, 1, _cols);
+		return { dmatrix, row_indices, _rows, 1, first_col + col };
+	}
+
+	const_region operator[](unsigned col) const {
+		__impl::verify_col_range(col, 1, _cols);
+		return { dmatrix, row_indices, _rows, 1, first_col + col };
+	}
+
+	region operator[](drange col_range) {
+		__impl::verify_col_range(col_range.first, col_range.size, _cols);
+		return { dmatrix, row_indices, _rows, col_range.size, first_col + col_range.first };
+	}
+
+	const_region operator[](drange col_range) const {
+		__impl::verify_col_range(col_range.first, col_range.size, _cols);
+		return { dmatrix, row_indices, _rows, col_range.size, first_col + col_range.first };
+	}
+
+	region operator[](all_t) {
+		return { dmatrix, row_indices, _rows, _cols, first_col };
+	}
+
+	const_region operator[](all_t) const {
+		return { dmatrix, row_indices, _rows, _cols, first_col };
+	}
+
+private:
+	DMatrix& dmatrix;
+	const unsigned* row_indices;
+	const unsigned _rows;
+	const unsigned _cols;
+	const unsigned first_col;
+};
+
+
+/*
+ * A dmatrix with its rows in another order: row r of the view is row
+ * order()[r] of the matrix. Swapping or sorting rows only moves their
+ * indices, and apply_permutation() moves the rows of the matrix to match
+ * at the end. Subscripts work as on the dmatrix: a single row is a row of
+ * the matrix, and a range of rows is a permuted_dmatrix_region.
+ */
+template <typename DMatrix>
+class permuted_dmatrix : public dynamic_matrix<permuted_dmatrix<DMatrix>> {
+private:
+	using rows_reference = dmatrix_rows_reference<DMatrix>;
+	using const_rows_reference = const dmatrix_rows_reference<const DMatrix>;
+	using region = permuted_dmatrix_region<DMatrix>;
+	using const_region = const permuted_dmatrix_region<const DMatrix>;
+
+public:
+	using element_type = typename DMatrix::element_type;
+
+	permuted_dmatrix() = delete;
+
+	// In the order of the matrix at first
+	explicit permuted_dmatrix(DMatrix& dmatrix)
+		: dmatrix(dmatrix), _order(dmatrix.rows())
+	{
+		std::iota(_order.begin(), _order.end(), 0u);
+	}
+
+	// Throws std::invalid_argument unless order holds each row of the matrix once
+	permuted_dmatrix(DMatrix& dmatrix, std::vector<unsigned> order)
+		: dmatrix(dmatrix), _order(std::move(order))
+	{
+		std::vector<bool> seen(dmatrix.rows());
+		bool is_permutation = _order.size() == dmatrix.rows();
+		for(std::size_t index = 0; index < _order.size()  &&  is_permutation; ++index) {
+			is_permutation = _order[index] < dmatrix.rows()  &&  !seen[_order[index]];
+			if(is_permutation) {
+				seen[_order[index]] = true;
+			}
+		}
+		if(!is_permutation) {
+			throw std::invalid_argument("Not a permutation of the rows of the matrix");
+		}
+	}
+
+	unsigned rows() const noexcept { return _order.size(); };
+
+	unsigned cols() const noexcept { return dmatrix.cols(); };
+
+	element_type& element_at(unsigned row, unsigned col) {
+		__impl::verify_element_index(row, col, rows(), cols());
+		return dmatrix.element_at(_order[row], col);
+	}
+
+	const element_type& element_at(unsigned row, unsigned col) const {
+		__impl::verify_element_index(row, col, rows(), cols());
+		return dmatrix.element_at(_order[row], col);
+	}
+
+	const std::vector<unsigned>& order() const noexcept { return _order; }
+
+	void swap_rows(unsigned row, unsigned other_row) noexcept(__impl::unchecked_access) {
+		__impl::verify_row_range(row, 1, rows());
+		__impl::verify_row_range(other_row, 1, rows());
+		std::swap(_order[row], _order[other_row]);
+	}
+
+	/*
+	 * Stable sort of the rows, where compare(lhs, rhs) tells whether row lhs
+	 * of the matrix goes before row rhs: only indices move.
+	 */
+	template <typename Compare>
+	void sort_rows(Compare compare) {
+		std::stable_sort(_order.begin(), _order.end(), compare);
+	}
+
+	/*
+	 * Moves the rows of the matrix into the order of the view, which becomes
+	 * the identity. Each row is moved once, as a whole, following the cycles
+	 * of the permutation, with one row of extra space.
+	 */
+	void apply_permutation() {
+		static_assert(!std::is_const<DMatrix>::value, "The rows of a const matrix cannot be moved");
+		unsigned row_size = cols();
+		if(row_size == 0) {
+			std::iota(_order.begin(), _order.end(), 0u);
+			return;
+		}
+		std::vector<element_type> spare(row_size);
+		auto move_row = [&](element_type* from, element_type* to) {
+			std::move(from, from + row_size, to);
+		};
+
+		for(unsigned start = 0; start < rows(); ++start) {
+			if(_order[start] == start) {
+				continue;
+			}
+			// Row start takes row _order[start], which takes row _order[_order[start]], and so on back to start
+			move_row(&dmatrix.element_at(start, 0), spare.data());
+			unsigned row = start;
+			while(_order[row] != start) {
+				unsigned from = _order[row];
+				move_row(&dmatrix.element_at(from, 0), &dmatrix.element_at(row, 0));
+				_order[row] = row;
+				row = from;
+			}
+			move_row(spare.data(), &dmatrix.element_at(row, 0));
+			_order[row] = row;
+		}
+	}
+
+	rows_reference operator[](unsigned row) {
+		__impl::verify_row_range(row, 1, rows());
+		return { dmatrix, 1, cols(), _order[row], 0 };
+	}
+
+	const_rows_reference operator[](unsigned row) const {
+		__impl::verify_row_range(row, 1, rows());
+		return { dmatrix, 1, cols(), _order[row], 0 };
+	}
+
+	region operator[](drange row_range) {
+		__impl::verify_row_range(row_range.first, row_range.size, rows());
+		return { dmatrix, _order.data() + row_range.first, row_range.size, cols(), 0 };
+	}
+
+	const_region operator[](drange row_range) const {
+		__impl::verify_row_range(row_range.first, row_range.size, rows());
+		return { dmatrix, _order.data() + row_range.first, row_range.size, cols(), 0 };
+	}
+
+	region operator[](all_t) {
+		return { dmatrix, _order.data(), rows(), cols(), 0 };
+	}
+
+	const_region operator[](all_t) const {
+		return { dmatrix, _order.data(), rows(), cols(), 0 };
+	}
+
+private:
+	DMatrix& dmatrix;
+	std::vector<unsigned> _order;
+};
+
+
+template <typename T>
+permuted_dmatrix<dmatrix<T>> permuted(dmatrix<T>& m) {
+	return permuted_dmatrix<dmatrix<T>>(m);
+}
+
+template <typename T>
+permuted_dmatrix<const dmatrix<T>> permuted(const dmatrix<T>& m) {
+	return permuted_dmatrix<const dmatrix<T>>(m);
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* PERMUTED_HPP_ */
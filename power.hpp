@@ -0,0 +1,473 @@
+#ifndef POWER_HPP_
+#define POWER_HPP_
+
+#include "matrix.hpp"
+#include "gemm.hpp"
+#include "lu.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+// Largest dynamic matrices multiplied and solved directly, rather than through gemm and lu
+constexpr unsigned power_direct_size = 64;
+// Largest static size whose products are unrolled along the depth
+constexpr unsigned power_unrolled_size = 16;
+
+
+/*
+ * The kernels below take the size either as unsigned or, for smatrix, as
+ * std::integral_constant, so that their loops have constant bounds the
+ * compiler unrolls and vectorizes. Rows they write are walked through a
+ * pointer to their first element, taken once.
+ */
+template <typename M, typename Size, typename F>
+void assign_square(M& m, Size n, F f) {
+	for(unsigned row = 0; row < n; ++row) {
+		auto* elements = &m.element_at(row, 0);
+		for(unsigned col = 0; col < n; ++col) {
+			elements[col] = f(row, col);
+		}
+	}
+}
+
+
+// The largest size a kernel is called with, for the buffers it keeps on the stack
+template <typename Size>
+struct square_capacity : std::integral_constant<unsigned, power_direct_size> {};
+
+template <unsigned N>
+struct square_capacity<std::integral_constant<unsigned, N>> : std::integral_constant<unsigned, N> {};
+
+
+// sums += a(row, k) * (row k of b)
+template <typename M, typename T, typename Size>
+void add_row_product(const M& a, const M& b, T* sums, unsigned row, unsigned k, Size n) {
+	T factor = a.element_at(row, k);
+	for(unsigned col = 0; col < n; ++col) {
+		sums[col] += factor * b.element_at(k, col);
+	}
+}
+
+// sums += (row of a) * b
+template <typename M, typename T>
+void add_row_products(const M& a, const M& b, T* sums, unsigned row, unsigned n) {
+	for(unsigned k = 0; k < n; ++k) {
+		add_row_product(a, b, sums, row, k, n);
+	}
+}
+
+/*
+ * With the size a small constant, the loop along the depth is unrolled up
+ * front: left as a loop, compilers tend to vectorize along it rather than
+ * along the row, which is several times slower for sizes of 8 or 16.
+ */
+template <typename M, typename T, unsigned N, std::size_t... K>
+void add_row_products(const M& a, const M& b, T* sums, unsigned row, std::integral_constant<unsigned, N> n, std::index_sequence<K...>) {
+	using expand = int[];
+	(void)expand{ 0, (add_row_product(a, b, sums, row, K, n), 0)... };
+}
+
+template <typename M, typename T, unsigned N>
+void add_row_products(const M& a, const M& b, T* sums, unsigned row, std::integral_constant<unsigned, N> n, std::true_type) {
+	add_row_products(a, b, sums, row, n, std::make_index_sequence<N>());
+}
+
+template <typename M, typename T, unsigned N>
+void add_row_products(const M& a, const M& b, T* sums, unsigned row, std::integral_constant<unsigned, N>, std::false_type) {
+	add_row_products(a, b, sums, row, N);
+}
+
+// Only sizes with terms to unroll take the unrolled overload, which would leave its arguments unused otherwise
+template <typename M, typename T, unsigned N>
+void add_row_products(const M& a, const M& b, T* sums, unsigned row, std::integral_constant<unsigned, N> n) {
+	add_row_products(a, b, sums, row, n, std::integral_constant<bool, N != 0  &&  N <= power_unrolled_size>());
+}
+
+
+// c = a * b, where c is neither a nor b; each row of c is summed on the stack, then stored
+template <typename M, typename Size>
+void multiply_square(const M& a, const M& b, M& c, Size n) {
+	using T = typename M::element_type;
+	T sums[square_capacity<Size>::value];
+	for(unsigned row = 0; row < n; ++row) {
+		for(unsigned col = 0; col < n; ++col) {
+			sums[col] = T(0);
+		}
+		add_row_products(a, b, sums, row, n);
+		T* elements = &c.element_at(row, 0);
+		for(unsigned col = 0; col < n; ++col) {
+			elements[col] = sums[col];
+		}
+	}
+}
+
+
+/*
+ * b = inverse(a) * b by Gaussian elimination with partial pivoting, which
+ * overwrites a. Throws std::domain_error if a is singular.
+ */
+template <typename M, typename Size>
+void solve_square(M& a, M& b, Size n) {
+	using T = typename M::element_type;
+	for(unsigned step = 0; step < n; ++step) {
+		unsigned pivot = step;
+		for(unsigned row = step + 1; row < n; ++row) {
+			if(std::abs(a.element_at(row, step)) > std::abs(a.element_at(pivot, step))) {
+				pivot = row;
+			}
+		}
+		if(a.element_at(pivot, step) == T(0)) {
+			throw std::domain_error("The matrix is singular");
+		}
+		T* a_step = &a.element_at(step, 0);
+		T* b_step = &b.element_at(step, 0);
+		if(pivot != step) {
+			std::swap_ranges(a_step + step, a_step + n, &a.element_at(pivot, step));
+			std::swap_ranges(b_step, b_step + n, &b.element_at(pivot, 0));
+		}
+
+		T inverse = T(1) / a_step[step];
+		for(unsigned row = step + 1; row < n; ++row) {
+			T* a_row = &a.element_at(row, 0);
+			T* b_row = &b.element_at(row, 0);
+			T factor = a_row[step] * inverse;
+			for(unsigned col = step + 1; col < n; ++col) {
+				a_row[col] -= factor * a_step[col];
+			}
+			for(unsigned col = 0; col < n; ++col) {
+				b_row[col] -= factor * b_step[col];
+			}
+		}
+	}
+
+	for(unsigned step = n; step-- > 0; ) {
+		T* b_step = &b.element_at(step, 0);
+		for(unsigned k = step + 1; k < n; ++k) {
+			T factor = a.element_at(step, k);
+			const T* b_k = &b.element_at(k, 0);
+			for(unsigned col = 0; col < n; ++col) {
+				b_step[col] -= factor * b_k[col];
+			}
+		}
+		T inverse = T(1) / a.element_at(step, step);
+		for(unsigned col = 0; col < n; ++col) {
+			b_step[col] *= inverse;
+		}
+	}
+}
+
+
+/*
+ * base to the power of exponent, which must not be zero, by repeated
+ * squaring. Each product goes into spare, which then swaps places with the
+ * factor it replaces, so that nothing is allocated; returns the buffer
+ * holding the result, among base, result and spare.
+ */
+template <typename M, typename Multiply>
+M* power(M* base, M* result, M* spare, std::uint64_t exponent, Multiply multiply) {
+	bool started = false;
+	for(;;) {
+		if(exponent & 1) {
+			if(started) {
+				multiply(*result, *base, *spare);
+				std::swap(result, spare);
+			} else {
+				*result = *base;
+				started = true;
+			}
+		}
+		exponent >>= 1;
+		if(exponent == 0) {
+			return result;
+		}
+		multiply(*base, *base, *spare);
+		std::swap(base, spare);
+	}
+}
+
+
+/*
+ * The coefficients of the [m/m] Padé approximants of exp used by expm, for
+ * m = 3, 5, 7, 9 and 13, and the largest 1-norm each is accurate to double
+ * precision for, from Higham, "The scaling and squaring method for the
+ * matrix exponential revisited" (2005).
+ */
+constexpr double pade3_coefficients[] = { 120, 60, 12, 1 };
+constexpr double pade5_coefficients[] = { 30240, 15120, 3360, 420, 30, 1 };
+constexpr double pade7_coefficients[] = { 17297280, 8648640, 1995840, 277200, 25200, 1512, 56, 1 };
+constexpr double pade9_coefficients[] = {
+	17643225600, 8821612800, 2075673600, 302702400, 30270240, 2162160, 110880, 3960, 90, 1
+};
+constexpr double pade13_coefficients[] = {
+	64764752532480000, 32382376266240000, 7771770303897600, 1187353796428800, 129060195264000,
+	10559470521600, 670442572800, 33522128640, 1323241920, 40840800, 960960, 16380, 182, 1
+};
+constexpr double pade_norm_bounds[] = {
+	1.495585217958292e-2, 2.539398330063230e-1, 9.504178996162932e-1, 2.097847961257068e0, 5.371920351148152e0
+};
+
+
+template <typename M, typename Size>
+typename M::element_type one_norm(const M& m, Size n) {
+	using T = typename M::element_type;
+	T largest(0);
+	for(unsigned col = 0; col < n; ++col) {
+		T sum(0);
+		for(unsigned row = 0; row < n; ++row) {
+			sum += std::abs(m.element_at(row, col));
+		}
+		largest = std::max(largest, sum);
+	}
+	return largest;
+}
+
+
+/*
+ * The buffers expm works in, all square of the same size. a holds the
+ * matrix on entry; the even powers of it follow, then the odd and even
+ * parts u and v of the approximant, and one more for products.
+ */
+template <typename M>
+struct exponential_workspace {
+	M* a;
+	M* powers[4];
+	M* u;
+	M* v;
+	M* spare;
+};
+
+
+/*
+ * exp(a) by scaling and squaring: a is divided by a power of two until a
+ * Padé approximant of degree at most 13 is accurate for it, then the
+ * approximant is squared as many times. Returns the buffer holding the
+ * result. The first approximant accurate enough for a is used as is.
+ */
+template <typename M, typename Size, typename Multiply, typename Solve>
+M* exponential(exponential_workspace<M> w, Size n, Multiply multiply, Solve solve) {
+	using T = typename M::element_type;
+	M& a = *w.a;
+	M& u = *w.u;
+	M& v = *w.v;
+	M& spare = *w.spare;
+	auto identity = [](unsigned row, unsigned col) { return row == col ? T(1) : T(0); };
+	// Buffers are only read through const access, which keeps the loops below free of checks
+	auto at = [](const M& m, unsigned row, unsigned col) { return m.element_at(row, col); };
+
+	T norm = one_norm(a, n);
+	const double* coefficients = nullptr;
+	unsigned degree = 13;
+	const double* small_coefficients[] = { pade3_coefficients, pade5_coefficients, pade7_coefficients, pade9_coefficients };
+	for(unsigned index = 0; index < 4; ++index) {
+		if(norm <= T(pade_norm_bounds[index])) {
+			coefficients = small_coefficients[index];
+			degree = 3 + 2 * index;
+			break;
+		}
+	}
+
+	int squarings = 0;
+	if(coefficients) {
+		// The even powers up to degree - 1, then u = a * (b1 + b3 * a^2 + ...) and v = b0 + b2 * a^2 + ...
+		unsigned count = (degree - 1) / 2;
+		multiply(a, a, *w.powers[0]);
+		for(unsigned index = 1; index < count; ++index) {
+			multiply(*w.powers[index - 1], *w.powers[0], *w.powers[index]);
+		}
+		auto sum = [&](unsigned first) {
+			return [&, first](unsigned row, unsigned col) {
+				T sum = T(coefficients[first]) * identity(row, col);
+				for(unsigned index = 0; index < count; ++index) {
+					sum += T(coefficients[first + 2 * index + 2]) * at(*w.powers[index], row, col);
+				}
+				return sum;
+			};
+		};
+		assign_square(spare, n, sum(1));
+		multiply(a, spare, u);
+		assign_square(v, n, sum(0));
+	} else {
+		if(norm > T(pade_norm_bounds[4])) {
+			std::frexp(norm / T(pade_norm_bounds[4]), &squarings);
+			assign_square(a, n, [&](unsigned row, unsigned col) { return std::ldexp(at(a, row, col), -squarings); });
+		}
+		const double* b = pade13_coefficients;
+		M& a2 = *w.powers[0];
+		M& a4 = *w.powers[1];
+		M& a6 = *w.powers[2];
+		M& product = *w.powers[3];
+		multiply(a, a, a2);
+		multiply(a2, a2, a4);
+		multiply(a4, a2, a6);
+		auto combine = [&](unsigned first) {
+			return [&, first](unsigned row, unsigned col) {
+				return T(b[first + 4]) * at(a6, row, col) + T(b[first + 2]) * at(a4, row, col)
+				     + T(b[first]) * at(a2, row, col);
+			};
+		};
+
+		// u = a * (a6 * (b13 * a6 + b11 * a4 + b9 * a2) + b7 * a6 + b5 * a4 + b3 * a2 + b1)
+		assign_square(spare, n, combine(9));
+		multiply(a6, spare, product);
+		assign_square(spare, n, [&](unsigned row, unsigned col) {
+			return at(product, row, col) + combine(3)(row, col) + T(b[1]) * identity(row, col);
+		});
+		multiply(a, spare, u);
+
+		// v = a6 * (b12 * a6 + b10 * a4 + b8 * a2) + b6 * a6 + b4 * a4 + b2 * a2 + b0
+		assign_square(spare, n, combine(8));
+		multiply(a6, spare, product);
+		assign_square(v, n, [&](unsigned row, unsigned col) {
+			return at(product, row, col) + combine(2)(row, col) + T(b[0]) * identity(row, col);
+		});
+	}
+
+	// The approximant solves (v - u) * x = v + u
+	assign_square(spare, n, [&](unsigned row, unsigned col) { return at(v, row, col) + at(u, row, col); });
+	assign_square(u, n, [&](unsigned row, unsigned col) { return at(v, row, col) - at(u, row, col); });
+	M* result = &spare;
+	solve(u, *result);
+
+	M* other = &v;
+	for(int index = 0; index < squarings; ++index) {
+		multiply(*result, *result, *other);
+		std::swap(result, other);
+	}
+	return result;
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * m to the power of exponent, by repeated squaring: at most 2 * log2(exponent)
+ * products, with loops of constant bounds, unrolled along the depth for
+ * small sizes, all into buffers set up beforehand.
+ */
+template <typename T, unsigned N>
+smatrix<T, N, N> pow(const smatrix<T, N, N>& m, std::uint64_t exponent) {
+	using size = std::integral_constant<unsigned, N>;
+	smatrix<T, N, N> base(m);
+	smatrix<T, N, N> result;
+	if(exponent == 0) {
+		__impl::assign_square(result, size(), [](unsigned row, unsigned col) { return row == col ? T(1) : T(0); });
+		return result;
+	}
+	smatrix<T, N, N> spare;
+	return *__impl::power(&base, &result, &spare, exponent, [](const smatrix<T, N, N>& a, const smatrix<T, N, N>& b, smatrix<T, N, N>& c) {
+		__impl::multiply_square(a, b, c, size());
+	});
+}
+
+
+/*
+ * m to the power of exponent, by repeated squaring. The three buffers the
+ * products alternate between are allocated once; matrices larger than
+ * __impl::power_direct_size are multiplied by gemm, on the threads of the
+ * execution context.
+ */
+template <typename M>
+dmatrix<typename std::remove_const<typename M::element_type>::type>
+pow(const dynamic_matrix<M>& m, std::uint64_t exponent, const parallel_options& options = parallel_options()) {
+	using T = typename std::remove_const<typename M::element_type>::type;
+	if(rows(m) != cols(m)) {
+		throw std::invalid_argument("Only square matrices have powers");
+	}
+	unsigned n = rows(m);
+	auto base = dmatrix<T>::generate(n, n, [&](unsigned row, unsigned col) {
+		return exponent == 0 ? T(row == col) : element_at(m, row, col);
+	});
+	if(exponent == 0) {
+		return base;
+	}
+	dmatrix<T> result(n, n, uninitialized);
+	dmatrix<T> spare(n, n, uninitialized);
+	return std::move(*__impl::power(&base, &result, &spare, exponent, [&](const dmatrix<T>& a, const dmatrix<T>& b, dmatrix<T>& c) {
+		if(n <= __impl::power_direct_size) {
+			__impl::multiply_square(a, b, c, n);
+		} else {
+			__impl::gemm<T>(T(1), __impl::strided(a), false, __impl::strided(b), false, T(0), __impl::strided(c), options);
+		}
+	}));
+}
+
+
+/*
+ * The matrix exponential of m, by scaling and squaring with Padé
+ * approximants as in Higham (2005), whose degrees are chosen for double
+ * precision, with the same kernels as pow.
+ */
+template <typename T, unsigned N>
+smatrix<T, N, N> expm(const smatrix<T, N, N>& m) {
+	static_assert(std::is_floating_point<T>::value, "The matrix exponential needs floating point elements");
+	using size = std::integral_constant<unsigned, N>;
+	smatrix<T, N, N> buffers[8];
+	buffers[0] = m;
+	__impl::exponential_workspace<smatrix<T, N, N>> workspace{
+		&buffers[0], { &buffers[1], &buffers[2], &buffers[3], &buffers[4] }, &buffers[5], &buffers[6], &buffers[7]
+	};
+	return *__impl::exponential(workspace, size(), [](const smatrix<T, N, N>& a, const smatrix<T, N, N>& b, smatrix<T, N, N>& c) {
+		__impl::multiply_square(a, b, c, size());
+	}, [](smatrix<T, N, N>& a, smatrix<T, N, N>& b) {
+		__impl::solve_square(a, b, size());
+	});
+}
+
+
+/*
+ * The matrix exponential of m, by scaling and squaring with Padé
+ * approximants as in Higham (2005). Matrices larger than
+ * __impl::power_direct_size go through gemm and lu, on the threads of the
+ * execution context.
+ */
+template <typename M>
+dmatrix<typename std::remove_const<typename M::element_type>::type>
+expm(const dynamic_matrix<M>& m, const parallel_options& options = parallel_options()) {
+	using T = typename std::remove_const<typename M::element_type>::type;
+	static_assert(std::is_floating_point<T>::value, "The matrix exponential needs floating point elements");
+	if(rows(m) != cols(m)) {
+		throw std::invalid_argument("Only square matrices have an exponential");
+	}
+	unsigned n = rows(m);
+	dmatrix<T> buffers[8] = {
+		dmatrix<T>::generate(n, n, [&](unsigned row, unsigned col) { return element_at(m, row, col); }),
+		dmatrix<T>(n, n, uninitialized), dmatrix<T>(n, n, uninitialized), dmatrix<T>(n, n, uninitialized),
+		dmatrix<T>(n, n, uninitialized), dmatrix<T>(n, n, uninitialized), dmatrix<T>(n, n, uninitialized),
+		dmatrix<T>(n, n, uninitialized)
+	};
+	__impl::exponential_workspace<dmatrix<T>> workspace{
+		&buffers[0], { &buffers[1], &buffers[2], &buffers[3], &buffers[4] }, &buffers[5], &buffers[6], &buffers[7]
+	};
+	return std::move(*__impl::exponential(workspace, n, [&](const dmatrix<T>& a, const dmatrix<T>& b, dmatrix<T>& c) {
+		if(n <= __impl::power_direct_size) {
+			__impl::multiply_square(a, b, c, n);
+		} else {
+			__impl::gemm<T>(T(1), __impl::strided(a), false, __impl::strided(b), false, T(0), __impl::strided(c), options);
+		}
+	}, [&](dmatrix<T>& a, dmatrix<T>& b) {
+		if(n <= __impl::power_direct_size) {
+			__impl::solve_square(a, b, n);
+		} else {
+			b = solve(lu(std::move(a), options), b, options);
+		}
+	}));
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* POWER_HPP_ */
@@ -0,0 +1,435 @@
+#ifndef QR_HPP_
+#define QR_HPP_
+
+#include "matrix.hpp"
+#include "gemm.hpp"
+#include "triangular.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+// Columns of one panel, whose reflectors are applied to the rest of the matrix at once
+constexpr unsigned qr_block_size = 32;
+
+
+/*
+ * The k x k top of a block of k reflectors, which are stored below the
+ * diagonal with an implicit one on it, as a dense unit lower triangle.
+ */
+template <typename T>
+dmatrix<T> reflectors_top(const strided_block<const T>& v) {
+	return dmatrix<T>::generate(v.cols, v.cols, [&](unsigned row, unsigned col) {
+		return row == col ? T(1) : row > col ? v(row, col) : T(0);
+	});
+}
+
+
+// w = transpose(v) * c, for reflectors v as stored
+template <typename T>
+void reflectors_transpose_times(
+	const strided_block<const T>& v, const strided_block<const T>& c, const strided_block<T>& w,
+	const parallel_options& options
+) {
+	unsigned k = v.cols;
+	auto top = reflectors_top(v);
+	gemm<T>(T(1), strided(static_cast<const dmatrix<T>&>(top)), true, c.block(0, 0, k, c.cols), false, T(0), w, options);
+	gemm<T>(T(1), v.block(k, 0, v.rows - k, k), true, c.block(k, 0, c.rows - k, c.cols), false, T(1), w, options);
+}
+
+
+// c -= v * w, for reflectors v as stored
+template <typename T>
+void subtract_reflectors_times(
+	const strided_block<const T>& v, const strided_block<const T>& w, const strided_block<T>& c,
+	const parallel_options& options
+) {
+	unsigned k = v.cols;
+	auto top = reflectors_top(v);
+	gemm<T>(T(-1), strided(static_cast<const dmatrix<T>&>(top)), false, w, false, T(1), c.block(0, 0, k, c.cols), options);
+	gemm<T>(T(-1), v.block(k, 0, v.rows - k, k), false, w, false, T(1), c.block(k, 0, c.rows - k, c.cols), options);
+}
+
+
+/*
+ * c = (I - v * op(t) * transpose(v)) * c, which is transpose(Q) * c for op
+ * transposing and Q * c otherwise, Q being the product of the reflectors
+ * in compact WY form. All of it runs in gemm.
+ */
+template <typename T>
+void apply_block_reflector(
+	const strided_block<const T>& v, const strided_block<const T>& t, bool transpose_t,
+	const strided_block<T>& c, const parallel_options& options
+) {
+	if(c.cols == 0) {
+		return;
+	}
+	dmatrix<T> w(v.cols, c.cols, uninitialized);
+	dmatrix<T> tw(v.cols, c.cols, uninitialized);
+	reflectors_transpose_times<T>(v, c, strided(w), options);
+	gemm<T>(T(1), t, transpose_t, strided(static_cast<const dmatrix<T>&>(w)), false, T(0), strided(tw), options);
+	subtract_reflectors_times<T>(v, strided(static_cast<const dmatrix<T>&>(tw)), c, options);
+}
+
+
+// Columns factored without recursion, and rows per block of the passes over them
+constexpr unsigned qr_leaf_cols = 8;
+constexpr unsigned qr_leaf_block_rows = 4096;
+
+
+/*
+ * Calls pass(first_row, last_row, partial) on fixed blocks of the rows of a
+ * in parallel, each accumulating into its own partial array of size
+ * elements, and returns their sum in block order, whatever the threads.
+ */
+template <typename T, typename Pass>
+std::vector<T> sum_over_row_blocks(unsigned rows, unsigned size, Pass pass, const parallel_options& options) {
+	unsigned blocks = std::max(1u, (rows + qr_leaf_block_rows - 1) / qr_leaf_block_rows);
+	std::vector<T> partials(std::size_t(blocks) * size, T(0));
+	parallel_for(0, blocks, std::size_t(qr_leaf_block_rows) * size, [&](std::size_t first, std::size_t last) {
+		for(std::size_t block = first; block < last; ++block) {
+			unsigned first_row = block * qr_leaf_block_rows;
+			pass(first_row, std::min(rows, first_row + qr_leaf_block_rows), partials.data() + block * size);
+		}
+	}, options);
+
+	for(unsigned block = 1; block < blocks; ++block) {
+		for(unsigned index = 0; index < size; ++index) {
+			partials[index] += partials[std::size_t(block) * size + index];
+		}
+	}
+	partials.resize(size);
+	return partials;
+}
+
+
+/*
+ * Householder QR of a few columns, going over whole rows so that every pass
+ * reads each row once: one scales the reflector of a column while
+ * summing its product with the columns right of it, the next applies it
+ * while summing the squares the next reflector needs. A last pass
+ * forms transpose(v) * v, from which t follows.
+ */
+template <typename T>
+void factor_qr_leaf(const strided_block<T>& a, const strided_block<T>& t, const parallel_options& options) {
+	unsigned m = a.rows;
+	unsigned k = a.cols;
+	std::vector<T> taus(k);
+
+	T norm_below = sum_over_row_blocks<T>(m, 1, [&](unsigned first_row, unsigned last_row, T* sum) {
+		for(unsigned row = std::max(first_row, 1u); row < last_row; ++row) {
+			*sum += a(row, 0) * a(row, 0);
+		}
+	}, options)[0];
+
+	for(unsigned col = 0; col < k; ++col) {
+		T alpha = a(col, col);
+		T beta = std::sqrt(alpha * alpha + norm_below);
+		if(alpha > T(0)) {
+			beta = -beta;
+		}
+		// A column already of the form beta * e1 needs no reflector
+		T tau = norm_below == T(0) ? T(0) : (beta - alpha) / beta;
+		T scale = norm_below == T(0) ? T(0) : T(1) / (alpha - beta);
+		if(norm_below != T(0)) {
+			a(col, col) = beta;
+		}
+		taus[col] = tau;
+		unsigned rest = k - col - 1;
+
+		// w = transpose(v) * a(rows, col + 1:), with v(col) = 1
+		std::vector<T> w = sum_over_row_blocks<T>(m, rest, [&](unsigned first_row, unsigned last_row, T* sum) {
+			T block_sum[qr_leaf_cols] = {};
+			for(unsigned row = std::max(first_row, col + 1); row < last_row; ++row) {
+				T* a_row = &a(row, 0);
+				T v = a_row[col] *= scale;
+				for(unsigned index = 0; index < rest; ++index) {
+					block_sum[index] += v * a_row[col + 1 + index];
+				}
+			}
+			std::copy(block_sum, block_sum + rest, sum);
+		}, options);
+		if(rest == 0) {
+			break;
+		}
+		for(unsigned index = 0; index < rest; ++index) {
+			w[index] = tau * (w[index] + a(col, col + 1 + index));
+			a(col, col + 1 + index) -= w[index];
+		}
+
+		norm_below = sum_over_row_blocks<T>(m, 1, [&](unsigned first_row, unsigned last_row, T* sum) {
+			T block_w[qr_leaf_cols];
+			std::copy(w.begin(), w.end(), block_w);
+			T block_sum(0);
+			for(unsigned row = std::max(first_row, col + 1); row < last_row; ++row) {
+				T* a_row = &a(row, 0);
+				T v = a_row[col];
+				for(unsigned index = 0; index < rest; ++index) {
+					a_row[col + 1 + index] -= v * block_w[index];
+				}
+				if(row > col + 1) {
+					block_sum += a_row[col + 1] * a_row[col + 1];
+				}
+			}
+			*sum = block_sum;
+		}, options)[0];
+	}
+
+	// t(0:j, j) = -tau(j) * t(0:j, 0:j) * transpose(v(:, 0:j)) * v(:, j)
+	std::vector<T> vtv = sum_over_row_blocks<T>(m, k * k, [&](unsigned first_row, unsigned last_row, T* sum) {
+		// The top rows hold the implicit ones and zeros of v
+		for(unsigned row = first_row; row < std::min(last_row, k); ++row) {
+			const T* a_row = &a(row, 0);
+			for(unsigned i = 0; i < row; ++i) {
+				for(unsigned j = i + 1; j < row; ++j) {
+					sum[i * k + j] += a_row[i] * a_row[j];
+				}
+				sum[i * k + row] += a_row[i];
+			}
+		}
+		T block_sum[qr_leaf_cols][qr_leaf_cols] = {};
+		for(unsigned row = std::max(first_row, k); row < last_row; ++row) {
+			const T* a_row = &a(row, 0);
+			for(unsigned i = 0; i < k; ++i) {
+				for(unsigned j = i + 1; j < k; ++j) {
+					block_sum[i][j] += a_row[i] * a_row[j];
+				}
+			}
+		}
+		for(unsigned i = 0; i < k; ++i) {
+			for(unsigned j = i + 1; j < k; ++j) {
+				sum[i * k + j] += block_sum[i][j];
+			}
+		}
+	}, options);
+	for(unsigned j = 0; j < k; ++j) {
+		t(j, j) = taus[j];
+		for(unsigned i = 0; i < j; ++i) {
+			T sum(0);
+			for(unsigned l = i; l < j; ++l) {
+				sum += t(i, l) * vtv[l * k + j];
+			}
+			t(i, j) = -taus[j] * sum;
+		}
+		for(unsigned i = j + 1; i < k; ++i) {
+			t(i, j) = T(0);
+		}
+	}
+}
+
+
+/*
+ * Factors the columns of a recursively, after Elmroth and Gustavson, down
+ * to a few columns at a time: each half is factored in turn, the first half's reflectors applied to the
+ * second with gemm, and the k x k upper triangular t of the compact WY form
+ * Q = I - v * t * transpose(v) assembled from those of the halves.
+ */
+template <typename T>
+void factor_qr_panel(const strided_block<T>& a, const strided_block<T>& t, const parallel_options& options) {
+	unsigned k = a.cols;
+	if(k <= qr_leaf_cols) {
+		factor_qr_leaf(a, t, options);
+		return;
+	}
+
+	unsigned k1 = k / 2;
+	unsigned k2 = k - k1;
+	auto v1 = a.block(0, 0, a.rows, k1);
+	auto t11 = t.block(0, 0, k1, k1);
+	factor_qr_panel(v1, t11, options);
+	apply_block_reflector<T>(v1, t11, true, a.block(0, k1, a.rows, k2), options);
+
+	auto v2 = a.block(k1, k1, a.rows - k1, k2);
+	auto t22 = t.block(k1, k1, k2, k2);
+	factor_qr_panel(v2, t22, options);
+
+	// t12 = -t11 * transpose(v1) * v2 * t22, where v2 is zero in the rows of v1's top
+	dmatrix<T> v2_v1(k2, k1, uninitialized);
+	reflectors_transpose_times<T>(v2, v1.block(k1, 0, a.rows - k1, k1), strided(v2_v1), options);
+	dmatrix<T> t11_v1_v2(k1, k2, uninitialized);
+	gemm<T>(T(1), t11, false, strided(static_cast<const dmatrix<T>&>(v2_v1)), true, T(0), strided(t11_v1_v2), options);
+	gemm<T>(T(-1), strided(static_cast<const dmatrix<T>&>(t11_v1_v2)), false, t22, false, T(0), t.block(0, k1, k1, k2), options);
+	for(unsigned row = k1; row < k; ++row) {
+		std::fill(&t(row, 0), &t(row, 0) + k1, T(0));
+	}
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * The factorization A = Q * R of a matrix with at least as many rows as
+ * columns, R being upper triangular and Q the product of one Householder
+ * reflector per column. Like LAPACK's geqrt, it is packed into the
+ * factors, holding R on and above the diagonal and the reflectors below,
+ * and the triangular factors of the compact WY form of each block of
+ * reflectors, side by side.
+ */
+template <typename T>
+class qr_factorization {
+public:
+	qr_factorization(dmatrix<T>&& factors, dmatrix<T>&& block_factors) noexcept
+		: _factors(std::move(factors)), _block_factors(std::move(block_factors))
+	{}
+
+	const dmatrix<T>& factors() const noexcept { return _factors; }
+
+	// The triangular factor of the block of reflectors starting at column first is at its columns
+	const dmatrix<T>& block_factors() const noexcept { return _block_factors; }
+
+	dmatrix<T> r() const {
+		return dmatrix<T>::generate(_factors.cols(), _factors.cols(), [&](unsigned row, unsigned col) {
+			return row <= col ? _factors.element_at(row, col) : T(0);
+		});
+	}
+
+	// The first cols() columns of Q, which span the columns of A
+	dmatrix<T> q(const parallel_options& options = parallel_options()) const {
+		// Starting from the identity, each block only changes the rows and columns from its first
+		dmatrix<T> result(_factors.rows(), _factors.cols());
+		for(unsigned index = 0; index < _factors.cols(); ++index) {
+			result.element_at(index, index) = T(1);
+		}
+		auto result_block = __impl::strided(result);
+		for(unsigned end = _factors.cols(); end > 0; ) {
+			unsigned first = (end - 1) / __impl::qr_block_size * __impl::qr_block_size;
+			apply_block(first, end, false, result_block.block(first, first, result.rows() - first, result.cols() - first), options);
+			end = first;
+		}
+		return result;
+	}
+
+	// transpose(Q) * b, where b has as many rows as A
+	template <typename M>
+	dmatrix<T> transpose_q_times(const matrix<M>& b, const parallel_options& options = parallel_options()) const {
+		if(rows(b) != _factors.rows()) {
+			throw incompatible_operands(_factors, "transpose_q_times", b);
+		}
+		auto result = dmatrix<T>::generate(rows(b), cols(b), [&](unsigned row, unsigned col) {
+			return element_at(b, row, col);
+		}, options);
+		auto result_block = __impl::strided(result);
+		for(unsigned first = 0; first < _factors.cols(); first += __impl::qr_block_size) {
+			unsigned end = std::min(first + __impl::qr_block_size, _factors.cols());
+			apply_block(first, end, true, result_block.block(first, 0, result.rows() - first, result.cols()), options);
+		}
+		return result;
+	}
+
+private:
+	void apply_block(unsigned first, unsigned end, bool transpose, const __impl::strided_block<T>& c, const parallel_options& options) const {
+		auto factors = __impl::strided(_factors);
+		auto block_factors = __impl::strided(_block_factors);
+		__impl::apply_block_reflector<T>(
+			factors.block(first, first, _factors.rows() - first, end - first),
+			block_factors.block(0, first, end - first, end - first), transpose,
+			c, options
+		);
+	}
+
+	dmatrix<T> _factors;
+	dmatrix<T> _block_factors;
+};
+
+
+/*
+ * Factors m in place, so passing it with std::move avoids any copy. Each
+ * panel of columns is factored recursively, then its reflectors are
+ * applied to the columns right of it as one block, so that nearly all the
+ * work runs in the parallel gemm kernel.
+ */
+template <typename T>
+qr_factorization<T> qr(dmatrix<T> m, const parallel_options& options = parallel_options()) {
+	if(m.rows() < m.cols()) {
+		throw std::invalid_argument("QR needs at least as many rows as columns");
+	}
+
+	unsigned n = m.cols();
+	dmatrix<T> block_factors(std::min(n, __impl::qr_block_size), n);
+	auto a = __impl::strided(m);
+	auto t = __impl::strided(block_factors);
+
+	// Panels are factored in a compact copy, as their many passes over long rows far apart thrash the TLB
+	dmatrix<T> panel_copy(m.rows(), std::min(n, __impl::qr_block_size), uninitialized);
+	auto copy = __impl::strided(panel_copy);
+	for(unsigned first = 0; first < n; first += __impl::qr_block_size) {
+		unsigned size = std::min(__impl::qr_block_size, n - first);
+		unsigned panel_rows = m.rows() - first;
+		auto panel = a.block(first, first, panel_rows, size);
+		auto compact = copy.block(0, 0, panel_rows, size);
+		auto copy_rows = [&](const __impl::strided_block<T>& from, const __impl::strided_block<T>& to) {
+			parallel_for(0, panel_rows, size, [&](std::size_t first_row, std::size_t last_row) {
+				for(unsigned row = first_row; row < last_row; ++row) {
+					std::copy(&from(row, 0), &from(row, 0) + size, &to(row, 0));
+				}
+			}, options);
+		};
+
+		copy_rows(panel, compact);
+		auto panel_t = t.block(0, first, size, size);
+		__impl::factor_qr_panel(compact, panel_t, options);
+		copy_rows(compact, panel);
+		__impl::apply_block_reflector<T>(compact, panel_t, true, a.block(first, first + size, panel_rows, n - first - size), options);
+	}
+	return qr_factorization<T>(std::move(m), std::move(block_factors));
+}
+
+
+/*
+ * The least-squares solution x minimizing the norm of A * x - b, for each
+ * column of b, from the factorization of A. Throws std::domain_error if
+ * the columns of A are linearly dependent, up to rounding: when a diagonal
+ * element of R is below max(rows, cols) * epsilon times the largest.
+ */
+template <typename T, typename M>
+dmatrix<T> solve(const qr_factorization<T>& qr, const matrix<M>& b, const parallel_options& options = parallel_options()) {
+	if(rows(b) != qr.factors().rows()) {
+		throw incompatible_operands(qr.factors(), "solve", b);
+	}
+	unsigned n = qr.factors().cols();
+	T largest(0);
+	for(unsigned index = 0; index < n; ++index) {
+		largest = std::max(largest, std::abs(qr.factors().element_at(index, index)));
+	}
+	T tolerance = largest * qr.factors().rows() * std::numeric_limits<T>::epsilon();
+	for(unsigned index = 0; index < n; ++index) {
+		if(!(std::abs(qr.factors().element_at(index, index)) > tolerance)) {
+			throw std::domain_error("The matrix is rank deficient");
+		}
+	}
+
+	auto qtb = qr.transpose_q_times(b, options);
+	auto x = dmatrix<T>::generate(n, qtb.cols(), [&](unsigned row, unsigned col) {
+		return qtb.element_at(row, col);
+	});
+	__impl::solve_left(__impl::strided(qr.factors()).block(0, 0, n, n), triangle::upper, false, diagonal::non_unit, __impl::strided(x), options);
+	return x;
+}
+
+
+// The least-squares solution of a * x = b, for each column of b
+template <typename T, typename M>
+dmatrix<T> lstsq(dmatrix<T> a, const matrix<M>& b, const parallel_options& options = parallel_options()) {
+	if(rows(b) != a.rows()) {
+		throw incompatible_operands(a, "lstsq", b);
+	}
+	return solve(qr(std::move(a), options), b, options);
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* QR_HPP_ */
@@ -0,0 +1,804 @@
+#ifndef REDUCE_HPP_
+#define REDUCE_HPP_
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+namespace matrix {
+
+
+// Reduce each row, or each column, to one value instead of the whole matrix
+enum class each_row_t { each_row };
+constexpr const each_row_t& each_row = each_row_t::each_row;
+
+enum class each_col_t { each_col };
+constexpr const each_col_t& each_col = each_col_t::each_col;
+
+
+// The position of an element, as found by argmin() and argmax()
+struct element_index {
+	unsigned row;
+	unsigned col;
+};
+
+inline bool operator==(element_index lhs, element_index rhs) {
+	return lhs.row == rhs.row  &&  lhs.col == rhs.col;
+}
+
+inline bool operator!=(element_index lhs, element_index rhs) {
+	return !(lhs == rhs);
+}
+
+
+namespace __impl {
+
+
+template <typename M>
+using value_type_of = typename std::remove_const<typename M::element_type>::type;
+
+// Floating point elements are reduced in their own type, other ones in double
+template <typename T>
+using real_type_of = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+
+template <typename Axis>
+struct is_axis : std::integral_constant<bool,
+		std::is_same<Axis, each_row_t>::value  ||  std::is_same<Axis, each_col_t>::value
+	> {};
+
+// The result of reducing along an axis, or no overload at all for other types
+template <typename Axis, typename T>
+using along_result = typename std::enable_if<is_axis<Axis>::value, dmatrix<T>>::type;
+
+
+/*
+ * A reduction folds elements into an accumulator starting from identity(),
+ * and merges the accumulators of separately folded parts with combine().
+ */
+template <typename T>
+struct sum_reduction {
+	using accumulator = T;
+	T identity() const { return T(0); }
+	template <typename U>
+	T accumulate(T acc, const U& x) const { return acc + x; }
+	T combine(T lhs, T rhs) const { return lhs + rhs; }
+};
+
+template <typename T>
+struct product_reduction {
+	using accumulator = T;
+	T identity() const { return T(1); }
+	template <typename U>
+	T accumulate(T acc, const U& x) const { return acc * x; }
+	T combine(T lhs, T rhs) const { return lhs * rhs; }
+};
+
+/*
+ * NaNs are skipped, so that the fold stays one comparison per element; a
+ * row, column or matrix of NaNs alone ends at the identity, and min() and
+ * max() turn that back into NaN with nan_where_only_nans().
+ */
+template <typename T>
+struct min_reduction {
+	using accumulator = T;
+	T identity() const {
+		return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+	}
+	template <typename U>
+	T accumulate(T acc, const U& x) const { return x < acc ? x : acc; }
+	T combine(T lhs, T rhs) const { return accumulate(lhs, rhs); }
+};
+
+template <typename T>
+struct max_reduction {
+	using accumulator = T;
+	T identity() const {
+		return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+	}
+	template <typename U>
+	T accumulate(T acc, const U& x) const { return acc < x ? x : acc; }
+	T combine(T lhs, T rhs) const { return accumulate(lhs, rhs); }
+};
+
+template <typename R>
+struct abs_sum_reduction {
+	using accumulator = R;
+	R identity() const { return R(0); }
+	template <typename U>
+	R accumulate(R acc, const U& x) const { return acc + std::abs(R(x)); }
+	R combine(R lhs, R rhs) const { return lhs + rhs; }
+};
+
+template <typename R>
+struct square_sum_reduction {
+	using accumulator = R;
+	R identity() const { return R(0); }
+	template <typename U>
+	R accumulate(R acc, const U& x) const { return acc + R(x) * R(x); }
+	R combine(R lhs, R rhs) const { return lhs + rhs; }
+};
+
+template <typename R>
+struct abs_max_reduction {
+	using accumulator = R;
+	R identity() const { return R(0); }
+	template <typename U>
+	R accumulate(R acc, const U& x) const {
+		R magnitude = std::abs(R(x));
+		return acc < magnitude ? magnitude : acc;
+	}
+	R combine(R lhs, R rhs) const { return lhs < rhs ? rhs : lhs; }
+};
+
+template <typename R>
+struct squared_deviation_reduction {
+	using accumulator = R;
+	R mean;
+	R identity() const { return R(0); }
+	template <typename U>
+	R accumulate(R acc, const U& x) const {
+		R deviation = R(x) - mean;
+		return acc + deviation * deviation;
+	}
+	R combine(R lhs, R rhs) const { return lhs + rhs; }
+};
+
+
+/*
+ * Several independent accumulators break the dependency between consecutive
+ * steps, so the loop vectorizes without reassociating the reduction.
+ */
+template <typename Reduction, typename T>
+typename Reduction::accumulator
+reduce_contiguous(const T* elements, std::size_t count, const Reduction& reduction) {
+	constexpr unsigned lanes = 8;
+	typename Reduction::accumulator acc[lanes];
+	for(unsigned lane = 0; lane < lanes; ++lane) {
+		acc[lane] = reduction.identity();
+	}
+
+	std::size_t index = 0;
+	for(; index + lanes <= count; index += lanes) {
+		for(unsigned lane = 0; lane < lanes; ++lane) {
+			acc[lane] = reduction.accumulate(acc[lane], elements[index + lane]);
+		}
+	}
+	for(; index < count; ++index) {
+		acc[0] = reduction.accumulate(acc[0], elements[index]);
+	}
+
+	for(unsigned lane = 1; lane < lanes; ++lane) {
+		acc[0] = reduction.combine(acc[0], acc[lane]);
+	}
+	return acc[0];
+}
+
+
+template <typename Reduction, typename M>
+typename Reduction::accumulator
+reduce_row(const matrix<M>& m, unsigned row, const Reduction& reduction) {
+	unsigned row_size = cols(m);
+	if(has_contiguous_rows<M>::value  &&  row_size > 0) {
+		return reduce_contiguous(row_elements(m, row), row_size, reduction);
+	}
+
+	auto acc = reduction.identity();
+	for(unsigned col = 0; col < row_size; ++col) {
+		acc = reduction.accumulate(acc, element_at(m, row, col));
+	}
+	return acc;
+}
+
+
+/*
+ * Whole-matrix and per-column reductions fold blocks of rows separately and
+ * combine them in order. The blocks depend only on the shape, not on the
+ * threads running them, so floating point results are reproducible.
+ */
+constexpr unsigned max_reduction_blocks = 64;
+constexpr std::size_t reduction_block_elements = 1 << 14;
+
+inline unsigned reduction_block_count(unsigned rows, unsigned cols) {
+	std::size_t blocks = std::size_t(rows) * cols / reduction_block_elements;
+	blocks = std::min<std::size_t>(blocks, std::min<std::size_t>(rows, max_reduction_blocks));
+	return std::max<std::size_t>(blocks, 1);
+}
+
+inline unsigned reduction_block_first_row(unsigned rows, unsigned blocks, unsigned block) {
+	return std::size_t(rows) * block / blocks;
+}
+
+
+template <typename Reduction, typename M>
+typename Reduction::accumulator
+reduce_rows(const matrix<M>& m, unsigned first_row, unsigned last_row, const Reduction& reduction) {
+	if(const auto* elements = contiguous_rows(m, first_row, last_row)) {
+		return reduce_contiguous(elements, std::size_t(last_row - first_row) * cols(m), reduction);
+	}
+
+	auto acc = reduction.identity();
+	for(unsigned row = first_row; row < last_row; ++row) {
+		acc = reduction.combine(acc, reduce_row(m, row, reduction));
+	}
+	return acc;
+}
+
+
+template <typename Reduction, typename M>
+typename Reduction::accumulator
+reduce_all(const matrix<M>& m, const Reduction& reduction, const parallel_options& options) {
+	unsigned blocks = reduction_block_count(rows(m), cols(m));
+	if(blocks == 1) {
+		return reduce_rows(m, 0, rows(m), reduction);
+	}
+
+	std::vector<typename Reduction::accumulator> partial(blocks);
+	parallel_for(0, blocks, std::size_t(rows(m)) * cols(m) / blocks, [&](std::size_t first, std::size_t last) {
+		for(std::size_t block = first; block < last; ++block) {
+			partial[block] = reduce_rows(
+				m,
+				reduction_block_first_row(rows(m), blocks, block),
+				reduction_block_first_row(rows(m), blocks, block + 1),
+				reduction
+			);
+		}
+	}, options);
+
+	auto acc = partial[0];
+	for(unsigned block = 1; block < blocks; ++block) {
+		acc = reduction.combine(acc, partial[block]);
+	}
+	return acc;
+}
+
+
+template <typename Reduction, typename M>
+dmatrix<typename Reduction::accumulator>
+reduce_along(const matrix<M>& m, const Reduction& reduction, each_row_t, const parallel_options& options) {
+	dmatrix<typename Reduction::accumulator> result(rows(m), 1, uninitialized);
+	parallel_for(0, rows(m), cols(m), [&](std::size_t first_row, std::size_t last_row) {
+		for(unsigned row = first_row; row < last_row; ++row) {
+			result.element_at(row, 0) = reduce_row(m, row, reduction);
+		}
+	}, options);
+	return result;
+}
+
+
+/*
+ * Folds each column into its own accumulator with step(acc, x, row, col).
+ * Rows are walked in memory order, every one updating all the column
+ * accumulators at once, which keeps row-major data streaming through the
+ * cache and vectorizes across columns.
+ */
+template <typename Acc, typename M, typename Step, typename Combine>
+dmatrix<Acc> reduce_columns(
+	const matrix<M>& m, Acc identity, Step step, Combine combine,
+	const parallel_options& options
+) {
+	unsigned row_count = rows(m);
+	unsigned col_count = cols(m);
+	unsigned blocks = reduction_block_count(row_count, col_count);
+	dmatrix<Acc> partial(blocks, col_count, uninitialized);
+
+	parallel_for(0, blocks, std::size_t(row_count) * col_count / blocks, [&](std::size_t first, std::size_t last) {
+		for(unsigned block = first; block < last  &&  col_count > 0; ++block) {
+			Acc* acc = &partial.element_at(block, 0);
+			std::fill(acc, acc + col_count, identity);
+
+			unsigned last_row = reduction_block_first_row(row_count, blocks, block + 1);
+			for(unsigned row = reduction_block_first_row(row_count, blocks, block); row < last_row; ++row) {
+				if(has_contiguous_rows<M>::value) {
+					const auto* elements = row_elements(m, row);
+					for(unsigned col = 0; col < col_count; ++col) {
+						acc[col] = step(acc[col], elements[col], row, col);
+					}
+				} else {
+					for(unsigned col = 0; col < col_count; ++col) {
+						acc[col] = step(acc[col], element_at(m, row, col), row, col);
+					}
+				}
+			}
+		}
+	}, options);
+
+	dmatrix<Acc> result(1, col_count, uninitialized);
+	for(unsigned col = 0; col < col_count; ++col) {
+		Acc acc = partial.element_at(0, col);
+		for(unsigned block = 1; block < blocks; ++block) {
+			acc = combine(acc, partial.element_at(block, col));
+		}
+		result.element_at(0, col) = acc;
+	}
+	return result;
+}
+
+
+template <typename Reduction, typename M>
+dmatrix<typename Reduction::accumulator>
+reduce_along(const matrix<M>& m, const Reduction& reduction, each_col_t, const parallel_options& options) {
+	using accumulator = typename Reduction::accumulator;
+	return reduce_columns(
+		m, reduction.identity(),
+		[&](accumulator acc, const value_type_of<M>& x, unsigned, unsigned) {
+			return reduction.accumulate(acc, x);
+		},
+		[&](accumulator lhs, accumulator rhs) {
+			return reduction.combine(lhs, rhs);
+		},
+		options
+	);
+}
+
+
+// How many elements are folded into each value of the result, and how many values there are
+template <typename M>
+std::size_t reduced_count(const matrix<M>& m) {
+	return std::size_t(rows(m)) * cols(m);
+}
+
+template <typename M>
+std::size_t reduced_count(const matrix<M>& m, each_row_t) {
+	return cols(m);
+}
+
+template <typename M>
+std::size_t reduced_count(const matrix<M>& m, each_col_t) {
+	return rows(m);
+}
+
+template <typename M>
+std::size_t result_count(const matrix<M>&) {
+	return 1;
+}
+
+template <typename M>
+std::size_t result_count(const matrix<M>& m, each_row_t) {
+	return rows(m);
+}
+
+template <typename M>
+std::size_t result_count(const matrix<M>& m, each_col_t) {
+	return cols(m);
+}
+
+
+// Some reductions have no value for no elements, as the minimum or the mean
+template <typename M, typename... Axis>
+void throw_if_reducing_nothing(const matrix<M>& m, const char* reduction, Axis... axis) {
+	if(reduced_count(m, axis...) == 0  &&  result_count(m, axis...) > 0) {
+		throw std::invalid_argument(std::string("Cannot take the ") + reduction + " of no elements");
+	}
+}
+
+
+template <typename M, typename... Axis>
+void throw_if_too_few_for_variance(const matrix<M>& m, unsigned ddof, Axis... axis) {
+	if(reduced_count(m, axis...) <= ddof  &&  result_count(m, axis...) > 0) {
+		throw std::invalid_argument("Cannot take the variance of no more elements than the degrees of freedom");
+	}
+}
+
+
+/*
+ * A minimum or maximum that ends at the identity of its reduction came from
+ * infinities, or from NaNs alone, which is rare enough to check afterwards by
+ * looking for an element that is not NaN.
+ */
+template <typename M>
+bool only_nans(const matrix<M>& m, unsigned first_row, unsigned last_row, unsigned first_col, unsigned last_col) {
+	for(unsigned row = first_row; row < last_row; ++row) {
+		for(unsigned col = first_col; col < last_col; ++col) {
+			const auto& x = element_at(m, row, col);
+			if(x == x) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template <typename M, typename T>
+T nan_where_only_nans(const matrix<M>& m, T result, T identity) {
+	if(std::numeric_limits<T>::has_quiet_NaN  &&  result == identity  &&  only_nans(m, 0, rows(m), 0, cols(m))) {
+		return std::numeric_limits<T>::quiet_NaN();
+	}
+	return result;
+}
+
+template <typename M, typename T>
+dmatrix<T> nan_where_only_nans(const matrix<M>& m, dmatrix<T>&& result, T identity, each_row_t) {
+	for(unsigned row = 0; row < result.rows()  &&  std::numeric_limits<T>::has_quiet_NaN; ++row) {
+		if(result.element_at(row, 0) == identity  &&  only_nans(m, row, row + 1, 0, cols(m))) {
+			result.element_at(row, 0) = std::numeric_limits<T>::quiet_NaN();
+		}
+	}
+	return std::move(result);
+}
+
+template <typename M, typename T>
+dmatrix<T> nan_where_only_nans(const matrix<M>& m, dmatrix<T>&& result, T identity, each_col_t) {
+	for(unsigned col = 0; col < result.cols()  &&  std::numeric_limits<T>::has_quiet_NaN; ++col) {
+		if(result.element_at(0, col) == identity  &&  only_nans(m, 0, rows(m), col, col + 1)) {
+			result.element_at(0, col) = std::numeric_limits<T>::quiet_NaN();
+		}
+	}
+	return std::move(result);
+}
+
+
+template <typename T, typename F>
+dmatrix<T> transform_elements(dmatrix<T>&& m, F func) {
+	for(unsigned row = 0; row < m.rows(); ++row) {
+		for(unsigned col = 0; col < m.cols(); ++col) {
+			m.element_at(row, col) = func(m.element_at(row, col));
+		}
+	}
+	return std::move(m);
+}
+
+
+template <typename U, typename T, typename F>
+dmatrix<U> convert_elements(const dmatrix<T>& m, F func) {
+	dmatrix<U> result(m.rows(), m.cols(), uninitialized);
+	for(unsigned row = 0; row < m.rows(); ++row) {
+		for(unsigned col = 0; col < m.cols(); ++col) {
+			result.element_at(row, col) = func(m.element_at(row, col));
+		}
+	}
+	return result;
+}
+
+
+// The best element seen so far and where it is; no_index until there is one
+template <typename T>
+struct indexed_value {
+	static constexpr std::size_t no_index = std::size_t(-1);
+
+	T value;
+	std::size_t index;
+};
+
+
+// Whether x takes the place of best; a NaN is replaced by anything else, so it is only kept where there is nothing else
+template <typename T, typename Better>
+bool replaces(const T& x, const T& best, Better better) {
+	return better(x, best)  ||  (best != best  &&  x == x);
+}
+
+
+// Ties keep lhs, which comes first wherever this is used
+template <typename T, typename Better>
+indexed_value<T> best_of(const indexed_value<T>& lhs, const indexed_value<T>& rhs, Better better) {
+	if(lhs.index == indexed_value<T>::no_index) {
+		return rhs;
+	}
+	return rhs.index != indexed_value<T>::no_index  &&  replaces(rhs.value, lhs.value, better) ? rhs : lhs;
+}
+
+
+// The row must not be empty
+template <typename M, typename Better>
+indexed_value<value_type_of<M>> best_in_row(const matrix<M>& m, unsigned row, Better better) {
+	indexed_value<value_type_of<M>> best = { element_at(m, row, 0), 0 };
+	for(unsigned col = 1; col < cols(m); ++col) {
+		const auto& x = element_at(m, row, col);
+		if(replaces(x, best.value, better)) {
+			best = { x, col };
+		}
+	}
+	return best;
+}
+
+
+template <typename M, typename Better>
+element_index arg_best(const matrix<M>& m, Better better, const parallel_options& options) {
+	using best_type = indexed_value<value_type_of<M>>;
+
+	// Indexes are linear, so that comparing them orders elements by row, then column
+	unsigned blocks = reduction_block_count(rows(m), cols(m));
+	std::vector<best_type> partial(blocks);
+	parallel_for(0, blocks, std::size_t(rows(m)) * cols(m) / blocks, [&](std::size_t first, std::size_t last) {
+		for(std::size_t block = first; block < last; ++block) {
+			best_type best = { value_type_of<M>(), best_type::no_index };
+			unsigned last_row = reduction_block_first_row(rows(m), blocks, block + 1);
+			for(unsigned row = reduction_block_first_row(rows(m), blocks, block); row < last_row; ++row) {
+				auto row_best = best_in_row(m, row, better);
+				row_best.index += std::size_t(row) * cols(m);
+				best = best_of(best, row_best, better);
+			}
+			partial[block] = best;
+		}
+	}, options);
+
+	best_type best = partial[0];
+	for(unsigned block = 1; block < blocks; ++block) {
+		best = best_of(best, partial[block], better);
+	}
+	return { unsigned(best.index / cols(m)), unsigned(best.index % cols(m)) };
+}
+
+
+template <typename M, typename Better>
+dmatrix<unsigned> arg_best(const matrix<M>& m, Better better, each_row_t, const parallel_options& options) {
+	dmatrix<unsigned> result(rows(m), 1, uninitialized);
+	parallel_for(0, rows(m), cols(m), [&](std::size_t first_row, std::size_t last_row) {
+		for(unsigned row = first_row; row < last_row; ++row) {
+			result.element_at(row, 0) = best_in_row(m, row, better).index;
+		}
+	}, options);
+	return result;
+}
+
+
+template <typename M, typename Better>
+dmatrix<unsigned> arg_best(const matrix<M>& m, Better better, each_col_t, const parallel_options& options) {
+	using best_type = indexed_value<value_type_of<M>>;
+	auto best = reduce_columns(
+		m, best_type{ value_type_of<M>(), best_type::no_index },
+		[&](const best_type& acc, const value_type_of<M>& x, unsigned row, unsigned) {
+			return acc.index == best_type::no_index  ||  replaces(x, acc.value, better) ? best_type{ x, row } : acc;
+		},
+		[&](const best_type& lhs, const best_type& rhs) {
+			return best_of(lhs, rhs, better);
+		},
+		options
+	);
+	return convert_elements<unsigned>(best, [](const best_type& b) { return unsigned(b.index); });
+}
+
+
+template <typename R, typename M>
+dmatrix<R> variance_along(const matrix<M>& m, unsigned ddof, each_row_t, const parallel_options& options) {
+	dmatrix<R> result(rows(m), 1, uninitialized);
+	parallel_for(0, rows(m), 2 * std::size_t(cols(m)), [&](std::size_t first_row, std::size_t last_row) {
+		for(unsigned row = first_row; row < last_row; ++row) {
+			R mean = reduce_row(m, row, sum_reduction<R>()) / cols(m);
+			result.element_at(row, 0) = reduce_row(m, row, squared_deviation_reduction<R>{ mean }) / (cols(m) - ddof);
+		}
+	}, options);
+	return result;
+}
+
+
+template <typename R, typename M>
+dmatrix<R> variance_along(const matrix<M>& m, unsigned ddof, each_col_t, const parallel_options& options) {
+	R count = rows(m);
+	auto means = transform_elements(
+		reduce_along(m, sum_reduction<R>(), each_col, options),
+		[=](R x) { return x / count; }
+	);
+	const R* mean = cols(m) > 0 ? &means.element_at(0, 0) : nullptr;
+	auto squared_deviations = reduce_columns(
+		m, R(0),
+		[&](R acc, const value_type_of<M>& x, unsigned, unsigned col) {
+			R deviation = R(x) - mean[col];
+			return acc + deviation * deviation;
+		},
+		std::plus<R>(),
+		options
+	);
+	return transform_elements(std::move(squared_deviations), [&](R x) { return x / (rows(m) - ddof); });
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * Reductions of the elements of any matrix, either all of them to one value
+ * or, given each_row or each_col, each row to a rows x 1 dmatrix or each
+ * column to a 1 x cols dmatrix. Regions are reduced in place. Large matrices
+ * are split across the threads of the execution context, in a way that does
+ * not depend on their number, so results are the same for any of them.
+ */
+template <typename M>
+__impl::value_type_of<M> sum(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	return __impl::reduce_all(m, __impl::sum_reduction<__impl::value_type_of<M>>(), options);
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, __impl::value_type_of<M>>
+sum(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	return __impl::reduce_along(m, __impl::sum_reduction<__impl::value_type_of<M>>(), axis, options);
+}
+
+
+template <typename M>
+__impl::value_type_of<M> product(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	return __impl::reduce_all(m, __impl::product_reduction<__impl::value_type_of<M>>(), options);
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, __impl::value_type_of<M>>
+product(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	return __impl::reduce_along(m, __impl::product_reduction<__impl::value_type_of<M>>(), axis, options);
+}
+
+
+// There must be elements to take the minimum of; NaNs are ignored unless there is nothing else, which gives NaN
+template <typename M>
+__impl::value_type_of<M> min(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	__impl::throw_if_reducing_nothing(m, "minimum");
+	__impl::min_reduction<__impl::value_type_of<M>> reduction;
+	return __impl::nan_where_only_nans(m, __impl::reduce_all(m, reduction, options), reduction.identity());
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, __impl::value_type_of<M>>
+min(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	__impl::throw_if_reducing_nothing(m, "minimum", axis);
+	__impl::min_reduction<__impl::value_type_of<M>> reduction;
+	return __impl::nan_where_only_nans(m, __impl::reduce_along(m, reduction, axis, options), reduction.identity(), axis);
+}
+
+
+template <typename M>
+__impl::value_type_of<M> max(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	__impl::throw_if_reducing_nothing(m, "maximum");
+	__impl::max_reduction<__impl::value_type_of<M>> reduction;
+	return __impl::nan_where_only_nans(m, __impl::reduce_all(m, reduction, options), reduction.identity());
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, __impl::value_type_of<M>>
+max(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	__impl::throw_if_reducing_nothing(m, "maximum", axis);
+	__impl::max_reduction<__impl::value_type_of<M>> reduction;
+	return __impl::nan_where_only_nans(m, __impl::reduce_along(m, reduction, axis, options), reduction.identity(), axis);
+}
+
+
+/*
+ * Where the first smallest element is. Along an axis, the result holds the
+ * column of the minimum of each row, or the row of the minimum of each column.
+ * NaNs are skipped, unless there is nothing else, which gives the first NaN.
+ */
+template <typename M>
+element_index argmin(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	__impl::throw_if_reducing_nothing(m, "minimum");
+	return __impl::arg_best(m, std::less<__impl::value_type_of<M>>(), options);
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, unsigned>
+argmin(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	__impl::throw_if_reducing_nothing(m, "minimum", axis);
+	return __impl::arg_best(m, std::less<__impl::value_type_of<M>>(), axis, options);
+}
+
+
+template <typename M>
+element_index argmax(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	__impl::throw_if_reducing_nothing(m, "maximum");
+	return __impl::arg_best(m, std::greater<__impl::value_type_of<M>>(), options);
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, unsigned>
+argmax(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	__impl::throw_if_reducing_nothing(m, "maximum", axis);
+	return __impl::arg_best(m, std::greater<__impl::value_type_of<M>>(), axis, options);
+}
+
+
+/*
+ * Norms of the elements taken as one vector, or of each row or column. They
+ * are entrywise: the induced matrix 1-norm, for one, is max(l1_norm(m, each_col)).
+ */
+template <typename M>
+__impl::real_type_of<__impl::value_type_of<M>>
+l1_norm(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	return __impl::reduce_all(m, __impl::abs_sum_reduction<real_type>(), options);
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, __impl::real_type_of<__impl::value_type_of<M>>>
+l1_norm(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	return __impl::reduce_along(m, __impl::abs_sum_reduction<real_type>(), axis, options);
+}
+
+
+template <typename M>
+__impl::real_type_of<__impl::value_type_of<M>>
+l2_norm(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	return std::sqrt(__impl::reduce_all(m, __impl::square_sum_reduction<real_type>(), options));
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, __impl::real_type_of<__impl::value_type_of<M>>>
+l2_norm(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	return __impl::transform_elements(
+		__impl::reduce_along(m, __impl::square_sum_reduction<real_type>(), axis, options),
+		[](real_type x) { return std::sqrt(x); }
+	);
+}
+
+
+// The l2_norm() of all the elements
+template <typename M>
+__impl::real_type_of<__impl::value_type_of<M>>
+frobenius_norm(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	return l2_norm(m, options);
+}
+
+
+template <typename M>
+__impl::real_type_of<__impl::value_type_of<M>>
+linf_norm(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	return __impl::reduce_all(m, __impl::abs_max_reduction<real_type>(), options);
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, __impl::real_type_of<__impl::value_type_of<M>>>
+linf_norm(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	return __impl::reduce_along(m, __impl::abs_max_reduction<real_type>(), axis, options);
+}
+
+
+// Integral elements are summed as double, so the mean neither overflows nor truncates
+template <typename M>
+__impl::real_type_of<__impl::value_type_of<M>>
+mean(const matrix<M>& m, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	__impl::throw_if_reducing_nothing(m, "mean");
+	return __impl::reduce_all(m, __impl::sum_reduction<real_type>(), options) / __impl::reduced_count(m);
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, __impl::real_type_of<__impl::value_type_of<M>>>
+mean(const matrix<M>& m, Axis axis, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	__impl::throw_if_reducing_nothing(m, "mean", axis);
+	real_type count = __impl::reduced_count(m, axis);
+	return __impl::transform_elements(
+		__impl::reduce_along(m, __impl::sum_reduction<real_type>(), axis, options),
+		[=](real_type x) { return x / count; }
+	);
+}
+
+
+/*
+ * The mean squared deviation from the mean, dividing by the number of
+ * elements minus ddof (1 for the unbiased sample variance), which must leave
+ * at least one. Deviations are summed in a second pass for accuracy.
+ */
+template <typename M>
+__impl::real_type_of<__impl::value_type_of<M>>
+variance(const matrix<M>& m, unsigned ddof = 0, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	__impl::throw_if_too_few_for_variance(m, ddof);
+	real_type mean = ::matrix::mean(m, options);
+	return __impl::reduce_all(m, __impl::squared_deviation_reduction<real_type>{ mean }, options)
+	     / (__impl::reduced_count(m) - ddof);
+}
+
+template <typename M, typename Axis>
+__impl::along_result<Axis, __impl::real_type_of<__impl::value_type_of<M>>>
+variance(const matrix<M>& m, Axis axis, unsigned ddof = 0, const parallel_options& options = parallel_options()) {
+	using real_type = __impl::real_type_of<__impl::value_type_of<M>>;
+	__impl::throw_if_too_few_for_variance(m, ddof, axis);
+	return __impl::variance_along<real_type>(m, ddof, axis, options);
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* REDUCE_HPP_ */
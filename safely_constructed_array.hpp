@@ -15,15 +15,27 @@ public:
 
 	safely_constructed_array()
 		: safely_constructed_array(
-			[](unsigned _index) {
+			[](unsigned) {
 				return T();
 			}
 		)
 	{}
 
-	safely_constructed_array(const safely_constructed_array&);
+	safely_constructed_array(const safely_constructed_array& other)
+		: safely_constructed_array(
+			[&](unsigned index) -> const T& {
+				return other[index];
+			}
+		)
+	{}
 
-	safely_constructed_array(safely_constructed_array&&);
+	safely_constructed_array(safely_constructed_array&& other)
+		: safely_constructed_array(
+			[&](unsigned index) -> T&& {
+				return std::move(other[index]);
+			}
+		)
+	{}
 
 	template <typename U, bool V>
 	safely_constructed_array(const safely_constructed_array<U, Size, V>&);
@@ -64,9 +76,19 @@ public:
 		destruct(Size);
 	}
 
-	safely_constructed_array& operator=(const safely_constructed_array&) &;
+	safely_constructed_array& operator=(const safely_constructed_array& other) & {
+		for(unsigned index = 0; index < Size; ++index) {
+			(*this)[index] = other[index];
+		}
+		return *this;
+	}
 
-	safely_constructed_array& operator=(safely_constructed_array&&) &;
+	safely_constructed_array& operator=(safely_constructed_array&& other) & {
+		for(unsigned index = 0; index < Size; ++index) {
+			(*this)[index] = std::move(other[index]);
+		}
+		return *this;
+	}
 
 	template <typename U, bool V>
 	safely_constructed_array& operator=(const safely_constructed_array<U, Size, V>&) &;
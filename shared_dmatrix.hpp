@@ -0,0 +1,169 @@
+#ifndef SHARED_DMATRIX_HPP_
+#define SHARED_DMATRIX_HPP_
+
+#include "matrix.hpp"
+#include <atomic>
+#include <utility>
+
+
+namespace matrix {
+
+
+/*
+ * A dmatrix whose copies share one reference-counted buffer. Reading
+ * through const access, const subscripts included, never copies; the first
+ * mutable access (mutable element_at(), a non-const subscript, or
+ * make_unique()) gives the matrix its own buffer if any other copy still
+ * shares it.
+ *
+ * As with any copy-on-write container, references returned by the mutable
+ * element_at() must not be kept across copying the matrix.
+ *
+ * A moved-from shared_dmatrix is 0x0; it shares one empty buffer with all
+ * the others until it is assigned to.
+ */
+template <typename T>
+class shared_dmatrix : public dynamic_matrix<shared_dmatrix<T>> {
+private:
+	using rows_reference = dmatrix_rows_reference<shared_dmatrix>;
+	using const_rows_reference = const dmatrix_rows_reference<const shared_dmatrix>;
+
+public:
+	using element_type = T;
+
+	shared_dmatrix() = delete;
+
+	shared_dmatrix(const shared_dmatrix& other) noexcept
+		: state(other.state)
+	{
+		state->references.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	shared_dmatrix(shared_dmatrix&& other) noexcept
+		: state(other.state)
+	{
+		other.state = empty_state();
+		other.state->references.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	shared_dmatrix(unsigned rows, unsigned cols)
+		: state(new shared_state(dmatrix<T>(rows, cols)))
+	{}
+
+	shared_dmatrix(std::initializer_list<std::initializer_list<T>> values)
+		: state(new shared_state(dmatrix<T>(values)))
+	{}
+
+	explicit shared_dmatrix(dmatrix<T>&& m)
+		: state(new shared_state(std::move(m)))
+	{}
+
+	explicit shared_dmatrix(const dmatrix<T>& m)
+		: state(new shared_state(m))
+	{}
+
+	~shared_dmatrix() {
+		release();
+	}
+
+	shared_dmatrix& operator=(const shared_dmatrix& other) & noexcept {
+		if(state != other.state) {
+			other.state->references.fetch_add(1, std::memory_order_relaxed);
+			release();
+			state = other.state;
+		}
+		return *this;
+	}
+
+	shared_dmatrix& operator=(shared_dmatrix&& other) & noexcept {
+		std::swap(state, other.state);
+		return *this;
+	}
+
+	unsigned rows() const noexcept { return state->value.rows(); };
+
+	unsigned cols() const noexcept { return state->value.cols(); };
+
+	T& element_at(unsigned row, unsigned col) {
+		return make_unique().element_at(row, col);
+	}
+
+	const T& element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		return state->value.element_at(row, col);
+	}
+
+	rows_reference operator[](unsigned row) {
+		return { *this, 1, cols(), row, 0 };
+	}
+
+	const_rows_reference operator[](unsigned row) const {
+		return { *this, 1, cols(), row, 0 };
+	}
+
+	rows_reference operator[](drange row_range) {
+		return { *this, row_range.size, cols(), row_range.first, 0 };
+	}
+
+	const_rows_reference operator[](drange row_range) const {
+		return { *this, row_range.size, cols(), row_range.first, 0 };
+	}
+
+	rows_reference operator[](all_t) {
+		return { *this, rows(), cols(), 0, 0 };
+	}
+
+	const_rows_reference operator[](all_t) const {
+		return { *this, rows(), cols(), 0, 0 };
+	}
+
+	bool is_shared() const noexcept {
+		return state->references.load(std::memory_order_acquire) > 1;
+	}
+
+	const dmatrix<T>& get() const noexcept {
+		return state->value;
+	}
+
+	// Detaches from the other copies now, and gives mutable access to the result
+	dmatrix<T>& make_unique() {
+		if(is_shared()) {
+			shared_state* unique = new shared_state(state->value);
+			release();
+			state = unique;
+		}
+		return state->value;
+	}
+
+private:
+	struct shared_state {
+		std::atomic<unsigned> references;
+		dmatrix<T> value;
+
+		explicit shared_state(dmatrix<T>&& m) : references(1), value(std::move(m)) {}
+		explicit shared_state(const dmatrix<T>& m) : references(1), value(m) {}
+	};
+
+	shared_state* state;
+
+	// Holds a reference of its own, so it is never deleted and is always shared
+	static shared_state* empty_state() noexcept {
+		static shared_state* const empty = new shared_state(dmatrix<T>(0, 0));
+		return empty;
+	}
+
+	void release() noexcept {
+		if(state->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			delete state;
+		}
+	}
+};
+
+
+template <typename T>
+struct has_contiguous_rows<shared_dmatrix<T>> : std::true_type {};
+
+
+} /* namespace matrix */
+
+
+#endif /* SHARED_DMATRIX_HPP_ */
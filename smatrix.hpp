@@ -1,7 +1,10 @@
 #ifndef SMATRIX_HPP_
 #define SMATRIX_HPP_
 
+#include "bounds.hpp"
+#include "heap_array.hpp"
 #include "safely_constructed_array.hpp"
+#include <cstddef>
 #include <type_traits>
 #include <utility>
 
@@ -9,12 +12,31 @@
 namespace matrix {
 
 
+// Size in bytes above which smatrix elements are kept on the heap
+#ifndef MATRIX_SMATRIX_HEAP_THRESHOLD
+# define MATRIX_SMATRIX_HEAP_THRESHOLD 16384
+#endif
+
+
+/*
+ * Whether smatrix<T, Rows, Cols> keeps its elements in a heap_array rather
+ * than inline. May be specialized to override the threshold for a shape.
+ */
+template <typename T, unsigned Rows, unsigned Cols>
+struct smatrix_uses_heap
+	: std::integral_constant<bool, (sizeof(T) * std::size_t(Rows) * Cols > MATRIX_SMATRIX_HEAP_THRESHOLD)>
+{};
+
+
 template <typename M>
 class static_matrix : public matrix<M> {};
 
 
 template <typename SMatrix, unsigned Rows, unsigned Cols, typename M>
 class smatrix_region_reference_base : public static_matrix<M> {
+private:
+	using value_type = typename std::remove_const<typename SMatrix::element_type>::type;
+
 public:
 	using element_type = typename SMatrix::element_type;
 	using referred_matrix_type = typename std::remove_const<SMatrix>::type;
@@ -31,7 +53,10 @@ public:
 
 	smatrix_region_reference_base(SMatrix& smatrix, unsigned first_row, unsigned first_col)
 		: smatrix(smatrix), first_row(first_row), first_col(first_col)
-	{}
+	{
+		__impl::verify_row_range(first_row, Rows, smatrix.rows());
+		__impl::verify_col_range(first_col, Cols, smatrix.cols());
+	}
 
 	~smatrix_region_reference_base() = default;
 
@@ -52,10 +77,11 @@ public:
 		return *this;
 	}
 
-	smatrix_region_reference_base& operator=(const element_type&) /* {
+	smatrix_region_reference_base& operator=(const element_type& value) {
 		static_assert_static_matrix_1x1(*this);
-		...
-	}*/;
+		this->element_at(0, 0) = value;
+		return *this;
+	}
 
 	smatrix_region_reference_base& operator=(element_type&& value) {
 		static_assert_static_matrix_1x1(*this);
@@ -63,11 +89,50 @@ public:
 		return *this;
 	}
 
+	/*
+	 * Scalars apply to every element; the value is copied first, as it may be
+	 * one of them. Any type converting to the elements is taken as is, so that
+	 * m[0] += 1 does not compete with the conversion of a 1x1 region.
+	 */
+	template <typename U>
+	typename std::enable_if<std::is_convertible<const U&, value_type>::value, M&>::type
+	operator+=(const U& value) {
+		value_type scalar(value);
+		__impl::update_elements(*this, [&](element_type& element) { element += scalar; });
+		return static_cast<M&>(*this);
+	}
+
+	template <typename U>
+	typename std::enable_if<std::is_convertible<const U&, value_type>::value, M&>::type
+	operator-=(const U& value) {
+		value_type scalar(value);
+		__impl::update_elements(*this, [&](element_type& element) { element -= scalar; });
+		return static_cast<M&>(*this);
+	}
+
+	template <typename U>
+	typename std::enable_if<std::is_convertible<const U&, value_type>::value, M&>::type
+	operator*=(const U& value) {
+		value_type scalar(value);
+		__impl::update_elements(*this, [&](element_type& element) { element *= scalar; });
+		return static_cast<M&>(*this);
+	}
+
+	template <typename U>
+	typename std::enable_if<std::is_convertible<const U&, value_type>::value, M&>::type
+	operator/=(const U& value) {
+		value_type scalar(value);
+		__impl::update_elements(*this, [&](element_type& element) { element /= scalar; });
+		return static_cast<M&>(*this);
+	}
+
 	element_type& element_at(unsigned row, unsigned col) {
+		__impl::verify_element_index(row, col, Rows, Cols);
 		return smatrix.element_at(first_row + row, first_col + col);
 	}
 
 	const element_type& element_at(unsigned row, unsigned col) const {
+		__impl::verify_element_index(row, col, Rows, Cols);
 		return smatrix.element_at(first_row + row, first_col + col);
 	}
 
@@ -76,10 +141,10 @@ public:
 		return this->element_at(0, 0);
 	}
 
-	operator const element_type&() const /*{
+	operator const element_type&() const {
 		static_assert_static_matrix_1x1(*this);
-		...
-	}*/;
+		return this->element_at(0, 0);
+	}
 
 protected:
 	SMatrix& smatrix;
@@ -120,7 +185,10 @@ public:
 		return *this;
 	}
 
-	smatrix_rows_reference& operator=(const element_type&);
+	smatrix_rows_reference& operator=(const element_type& value) {
+		base::operator=(value);
+		return *this;
+	}
 
 	smatrix_rows_reference& operator=(element_type&& value) {
 		base::operator=(std::move(value));
@@ -128,27 +196,37 @@ public:
 	}
 
 	area_reference<Rows, 1> operator[](unsigned col) {
+		__impl::verify_col_range(col, 1, Cols);
 		return { this->smatrix, this->first_row, this->first_col + col };
 	}
 
 	//const_area_reference<Rows, 1> operator[](unsigned col) const; //  <-- This line makes GCC 4.8.4 crash!
-	const smatrix_area_reference<const SMatrix, Rows, 1> operator[](unsigned col) const;
+	const smatrix_area_reference<const SMatrix, Rows, 1> operator[](unsigned col) const {
+		__impl::verify_col_range(col, 1, Cols);
+		return { this->smatrix, this->first_row, this->first_col + col };
+	}
 
 	template <unsigned RangeCols>
 	area_reference<Rows, RangeCols> operator[](srange<RangeCols> col_range) {
+		__impl::verify_col_range(col_range.first, RangeCols, Cols);
 		return { this->smatrix, this->first_row, this->first_col + col_range.first };
 	}
 
 	template <unsigned RangeCols>
 	//const_area_reference<Rows, RangeCols> operator[](range<RangeCols>) const; //  <-- This line makes GCC 4.8.4 crash!
-	const smatrix_area_reference<const SMatrix, Rows, RangeCols> operator[](srange<RangeCols>) const;
+	const smatrix_area_reference<const SMatrix, Rows, RangeCols> operator[](srange<RangeCols> col_range) const {
+		__impl::verify_col_range(col_range.first, RangeCols, Cols);
+		return { this->smatrix, this->first_row, this->first_col + col_range.first };
+	}
 
 	area_reference<Rows, Cols> operator[](all_t) {
 		return { this->smatrix, this->first_row, this->first_col };
 	}
 
 	//const_area_reference<Rows, Cols> operator[](all_t) const; //  <-- This line makes GCC 4.8.4 crash!
-	const smatrix_area_reference<const SMatrix, Rows, Cols> operator[](all_t) const;
+	const smatrix_area_reference<const SMatrix, Rows, Cols> operator[](all_t) const {
+		return { this->smatrix, this->first_row, this->first_col };
+	}
 };
 
 
@@ -180,7 +258,10 @@ public:
 		return *this;
 	}
 
-	smatrix_area_reference& operator=(const element_type&);
+	smatrix_area_reference& operator=(const element_type& value) {
+		base::operator=(value);
+		return *this;
+	}
 
 	smatrix_area_reference& operator=(element_type&& value) {
 		base::operator=(std::move(value));
@@ -188,11 +269,15 @@ public:
 	}
 
 	rows_reference<1, Cols> operator[](unsigned row) {
+		__impl::verify_row_range(row, 1, Rows);
 		return { this->smatrix, this->first_row + row, this->first_col };
 	}
 
 	//const_rows_reference<1, Cols> operator[](unsigned row) const; //  <-- This line makes GCC 4.8.4 crash!
-	const smatrix_rows_reference<const SMatrix, 1, Cols> operator[](unsigned row) const;
+	const smatrix_rows_reference<const SMatrix, 1, Cols> operator[](unsigned row) const {
+		__impl::verify_row_range(row, 1, Rows);
+		return { this->smatrix, this->first_row + row, this->first_col };
+	}
 };
 
 
@@ -214,9 +299,10 @@ public:
 
 	smatrix() = default;
 
-	smatrix(const smatrix&);
+	smatrix(const smatrix&) = default;
 
-	smatrix(smatrix&&);
+	// Only moves a pointer when the elements are on the heap
+	smatrix(smatrix&&) = default;
 
 	template <typename U>
 	smatrix(const smatrix<U, Rows, Cols>&);
@@ -244,19 +330,21 @@ public:
 
 	~smatrix() = default;
 
-	smatrix& operator=(const smatrix&) &;
+	smatrix& operator=(const smatrix&) & = default;
 
-	smatrix& operator=(smatrix&&) &;
+	smatrix& operator=(smatrix&&) & = default;
 
 	template <typename U>
 	smatrix& operator=(const smatrix<U, Rows, Cols>&) &;
 
-	T& element_at(unsigned row, unsigned col) noexcept {
+	T& element_at(unsigned row, unsigned col) noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, Rows, Cols);
 		unsigned index = to_linear_index(row, col);
 		return elements[index];
 	}
 
-	const T& element_at(unsigned row, unsigned col) const noexcept {
+	const T& element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, Rows, Cols);
 		unsigned index = to_linear_index(row, col);
 		return elements[index];
 	}
@@ -266,7 +354,9 @@ public:
 	}
 
 	//const_rows_reference<1, Cols> operator[](unsigned row) const; //  <-- This line makes GCC 4.8.4 crash!
-	const smatrix_rows_reference<const smatrix, 1, Cols> operator[](unsigned row) const;
+	const smatrix_rows_reference<const smatrix, 1, Cols> operator[](unsigned row) const {
+		return { *this, row, 0 };
+	}
 
 	template <unsigned RRows>
 	rows_reference<RRows, Cols> operator[](srange<RRows> row_range) {
@@ -275,17 +365,27 @@ public:
 
 	template <unsigned RRows>
 	//const_rows_reference<RRows, Cols> operator[](srange<RRows> row_range) const; //  <-- This line makes GCC 4.8.4 crash!
-	const smatrix_rows_reference<const smatrix, RRows, Cols> operator[](srange<RRows> row_range) const;
+	const smatrix_rows_reference<const smatrix, RRows, Cols> operator[](srange<RRows> row_range) const {
+		return { *this, row_range.first, 0 };
+	}
 
 	rows_reference<Rows, Cols> operator[](all_t) {
 		return { *this, 0, 0 };
 	}
 
 	//const_rows_reference<Rows, Cols> operator[](all_t) const; //  <-- This line makes GCC 4.8.4 crash!
-	const smatrix_rows_reference<const smatrix, Rows, Cols> operator[](all_t) const;
+	const smatrix_rows_reference<const smatrix, Rows, Cols> operator[](all_t) const {
+		return { *this, 0, 0 };
+	}
 
 private:
-	safely_constructed_array<T, Rows * Cols> elements;
+	using storage_type = typename std::conditional<
+			smatrix_uses_heap<T, Rows, Cols>::value,
+			heap_array<T, Rows * Cols>,
+			safely_constructed_array<T, Rows * Cols>
+		>::type;
+
+	storage_type elements;
 
 	struct indexes {
 		unsigned row;
@@ -302,6 +402,20 @@ private:
 };
 
 
+// Inline elements are wrapped in storage, which adds nothing unless verified
+template <typename T, unsigned Rows, unsigned Cols>
+struct has_contiguous_rows<smatrix<T, Rows, Cols>>
+	: std::integral_constant<bool, smatrix_uses_heap<T, Rows, Cols>::value  ||  sizeof(storage<T>) == sizeof(T)> {};
+
+template <typename SMatrix, unsigned Rows, unsigned Cols>
+struct has_contiguous_rows<smatrix_rows_reference<SMatrix, Rows, Cols>>
+	: has_contiguous_rows<typename std::remove_const<SMatrix>::type> {};
+
+template <typename SMatrix, unsigned Rows, unsigned Cols>
+struct has_contiguous_rows<smatrix_area_reference<SMatrix, Rows, Cols>>
+	: has_contiguous_rows<typename std::remove_const<SMatrix>::type> {};
+
+
 template <typename ML, typename MR>
 inline void static_assert_static_matrix_same_shape() {
 	static_assert(ML::rows() == MR::rows()  &&  ML::cols() == MR::cols(), "Both static_matrix'es must have the same shape for this operation");
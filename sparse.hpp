@@ -0,0 +1,125 @@
+#ifndef SPARSE_HPP_
+#define SPARSE_HPP_
+
+#include "matrix.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace matrix {
+
+
+template <typename T>
+struct sparse_entry {
+	unsigned row;
+	unsigned col;
+	T value;
+};
+
+
+/*
+ * Compressed sparse row matrix. The nonzeros of row r are
+ * values()[row_offsets()[r] .. row_offsets()[r + 1]), with their columns in
+ * col_indices() sorted in ascending order.
+ */
+template <typename T>
+class csr_matrix : public dynamic_matrix<csr_matrix<T>> {
+public:
+	// Absent elements are read as a shared zero, so elements are exposed as const
+	using element_type = const T;
+	using value_type = T;
+
+	csr_matrix() = delete;
+
+	csr_matrix(
+		unsigned rows, unsigned cols,
+		std::vector<std::size_t> row_offsets,
+		std::vector<unsigned> col_indices,
+		std::vector<T> values
+	)
+		: _rows(rows), _cols(cols),
+		  _row_offsets(std::move(row_offsets)),
+		  _col_indices(std::move(col_indices)),
+		  _values(std::move(values))
+	{
+		if(_row_offsets.size() != std::size_t(_rows) + 1
+		|| _row_offsets.front() != 0
+		|| _row_offsets.back() != _values.size()
+		|| _col_indices.size() != _values.size()) {
+			throw std::invalid_argument("Inconsistent compressed sparse row arrays");
+		}
+	}
+
+	// Duplicate entries are summed
+	static csr_matrix from_entries(unsigned rows, unsigned cols, std::vector<sparse_entry<T>> entries) {
+		auto by_position = [](const sparse_entry<T>& a, const sparse_entry<T>& b) {
+			return a.row < b.row  ||  (a.row == b.row  &&  a.col < b.col);
+		};
+		std::sort(entries.begin(), entries.end(), by_position);
+
+		std::vector<std::size_t> row_offsets(std::size_t(rows) + 1, 0);
+		std::vector<unsigned> col_indices;
+		std::vector<T> values;
+		col_indices.reserve(entries.size());
+		values.reserve(entries.size());
+
+		for(std::size_t i = 0; i < entries.size(); ++i) {
+			const auto& entry = entries[i];
+			if(entry.row >= rows  ||  entry.col >= cols) {
+				throw std::out_of_range("Sparse entry outside of the matrix");
+			}
+			if(i > 0  &&  entry.row == entries[i - 1].row  &&  entry.col == entries[i - 1].col) {
+				values.back() += entry.value;
+			} else {
+				col_indices.push_back(entry.col);
+				values.push_back(entry.value);
+				++row_offsets[entry.row + 1];
+			}
+		}
+		for(unsigned row = 0; row < rows; ++row) {
+			row_offsets[row + 1] += row_offsets[row];
+		}
+
+		return csr_matrix(rows, cols, std::move(row_offsets), std::move(col_indices), std::move(values));
+	}
+
+	unsigned rows() const noexcept { return _rows; };
+
+	unsigned cols() const noexcept { return _cols; };
+
+	std::size_t nonzeros() const noexcept { return _values.size(); }
+
+	const T& element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, _rows, _cols);
+		static const T zero = T();
+		auto first = _col_indices.begin() + _row_offsets[row];
+		auto last  = _col_indices.begin() + _row_offsets[row + 1];
+		auto found = std::lower_bound(first, last, col);
+		if(found == last  ||  *found != col) {
+			return zero;
+		}
+		return _values[found - _col_indices.begin()];
+	}
+
+	const std::vector<std::size_t>& row_offsets() const noexcept { return _row_offsets; }
+
+	const std::vector<unsigned>& col_indices() const noexcept { return _col_indices; }
+
+	const std::vector<T>& values() const noexcept { return _values; }
+
+private:
+	unsigned _rows;
+	unsigned _cols;
+	std::vector<std::size_t> _row_offsets;
+	std::vector<unsigned> _col_indices;
+	std::vector<T> _values;
+};
+
+
+} /* namespace matrix */
+
+
+#endif /* SPARSE_HPP_ */
@@ -0,0 +1,577 @@
+#ifndef STRUCTURED_HPP_
+#define STRUCTURED_HPP_
+
+#include "matrix.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+#include "sparse.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+// Specialized by the views below, which are cheap to copy and held by value in the views made of them
+template <typename M>
+struct is_structured_view : std::false_type {};
+
+template <typename M>
+using stored_operand = typename std::conditional<is_structured_view<M>::value, const M, const M&>::type;
+
+template <typename... M>
+using view_value_type = typename std::common_type<typename std::remove_const<typename M::element_type>::type...>::type;
+
+
+inline unsigned view_extent(std::uint64_t extent) {
+	if(extent > std::numeric_limits<unsigned>::max()) {
+		throw std::length_error("The view has too many rows or columns");
+	}
+	return unsigned(extent);
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * The Kronecker product of a and b: element (row, col) is
+ * a(row / rows(b), col / cols(b)) * b(row % rows(b), col % cols(b)),
+ * computed when read. Like the other views here, it refers to the matrices
+ * it is made of, which must outlive it, and its elements are returned by
+ * value. Views it is made of are copied into it instead, so views nest
+ * freely; kron() and the others do not compile for any other temporary.
+ */
+template <typename MA, typename MB>
+class kronecker_view : public dynamic_matrix<kronecker_view<MA, MB>> {
+public:
+	using value_type = __impl::view_value_type<MA, MB>;
+	using element_type = const value_type;
+
+	kronecker_view(const MA& a, const MB& b)
+		: _first(a), _second(b),
+		  _rows(__impl::view_extent(std::uint64_t(::matrix::rows(a)) * ::matrix::rows(b))),
+		  _cols(__impl::view_extent(std::uint64_t(::matrix::cols(a)) * ::matrix::cols(b)))
+	{}
+
+	unsigned rows() const noexcept { return _rows; }
+
+	unsigned cols() const noexcept { return _cols; }
+
+	value_type element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, _rows, _cols);
+		unsigned second_rows = ::matrix::rows(_second);
+		unsigned second_cols = ::matrix::cols(_second);
+		return value_type(::matrix::element_at(_first, row / second_rows, col / second_cols))
+			* value_type(::matrix::element_at(_second, row % second_rows, col % second_cols));
+	}
+
+	const MA& first() const noexcept { return _first; }
+
+	const MB& second() const noexcept { return _second; }
+
+private:
+	__impl::stored_operand<MA> _first;
+	__impl::stored_operand<MB> _second;
+	unsigned _rows;
+	unsigned _cols;
+};
+
+
+// a in the top left corner and b in the bottom right one, with zeros elsewhere
+template <typename MA, typename MB>
+class block_diagonal_view : public dynamic_matrix<block_diagonal_view<MA, MB>> {
+public:
+	using value_type = __impl::view_value_type<MA, MB>;
+	using element_type = const value_type;
+
+	block_diagonal_view(const MA& a, const MB& b)
+		: _first(a), _second(b),
+		  _rows(__impl::view_extent(std::uint64_t(::matrix::rows(a)) + ::matrix::rows(b))),
+		  _cols(__impl::view_extent(std::uint64_t(::matrix::cols(a)) + ::matrix::cols(b)))
+	{}
+
+	unsigned rows() const noexcept { return _rows; }
+
+	unsigned cols() const noexcept { return _cols; }
+
+	value_type element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, _rows, _cols);
+		unsigned first_rows = ::matrix::rows(_first);
+		unsigned first_cols = ::matrix::cols(_first);
+		if(row < first_rows) {
+			return col < first_cols ? value_type(::matrix::element_at(_first, row, col)) : value_type();
+		}
+		return col >= first_cols ? value_type(::matrix::element_at(_second, row - first_rows, col - first_cols)) : value_type();
+	}
+
+	const MA& first() const noexcept { return _first; }
+
+	const MB& second() const noexcept { return _second; }
+
+private:
+	__impl::stored_operand<MA> _first;
+	__impl::stored_operand<MB> _second;
+	unsigned _rows;
+	unsigned _cols;
+};
+
+
+// The columns of a followed by those of b
+template <typename MA, typename MB>
+class hstack_view : public dynamic_matrix<hstack_view<MA, MB>> {
+public:
+	using value_type = __impl::view_value_type<MA, MB>;
+	using element_type = const value_type;
+
+	hstack_view(const MA& a, const MB& b)
+		: _first(a), _second(b),
+		  _cols(__impl::view_extent(std::uint64_t(::matrix::cols(a)) + ::matrix::cols(b)))
+	{
+		if(::matrix::rows(a) != ::matrix::rows(b)) {
+			throw incompatible_operands(a, "hstack", b);
+		}
+	}
+
+	unsigned rows() const noexcept { return ::matrix::rows(_first); }
+
+	unsigned cols() const noexcept { return _cols; }
+
+	value_type element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, rows(), _cols);
+		unsigned first_cols = ::matrix::cols(_first);
+		if(col < first_cols) {
+			return value_type(::matrix::element_at(_first, row, col));
+		}
+		return value_type(::matrix::element_at(_second, row, col - first_cols));
+	}
+
+	const MA& first() const noexcept { return _first; }
+
+	const MB& second() const noexcept { return _second; }
+
+private:
+	__impl::stored_operand<MA> _first;
+	__impl::stored_operand<MB> _second;
+	unsigned _cols;
+};
+
+
+// The rows of a followed by those of b
+template <typename MA, typename MB>
+class vstack_view : public dynamic_matrix<vstack_view<MA, MB>> {
+public:
+	using value_type = __impl::view_value_type<MA, MB>;
+	using element_type = const value_type;
+
+	vstack_view(const MA& a, const MB& b)
+		: _first(a), _second(b),
+		  _rows(__impl::view_extent(std::uint64_t(::matrix::rows(a)) + ::matrix::rows(b)))
+	{
+		if(::matrix::cols(a) != ::matrix::cols(b)) {
+			throw incompatible_operands(a, "vstack", b);
+		}
+	}
+
+	unsigned rows() const noexcept { return _rows; }
+
+	unsigned cols() const noexcept { return ::matrix::cols(_first); }
+
+	value_type element_at(unsigned row, unsigned col) const noexcept(__impl::unchecked_access) {
+		__impl::verify_element_index(row, col, _rows, cols());
+		unsigned first_rows = ::matrix::rows(_first);
+		if(row < first_rows) {
+			return value_type(::matrix::element_at(_first, row, col));
+		}
+		return value_type(::matrix::element_at(_second, row - first_rows, col));
+	}
+
+	const MA& first() const noexcept { return _first; }
+
+	const MB& second() const noexcept { return _second; }
+
+private:
+	__impl::stored_operand<MA> _first;
+	__impl::stored_operand<MB> _second;
+	unsigned _rows;
+};
+
+
+namespace __impl {
+
+
+template <typename MA, typename MB>
+struct is_structured_view<kronecker_view<MA, MB>> : std::true_type {};
+
+template <typename MA, typename MB>
+struct is_structured_view<block_diagonal_view<MA, MB>> : std::true_type {};
+
+template <typename MA, typename MB>
+struct is_structured_view<hstack_view<MA, MB>> : std::true_type {};
+
+template <typename MA, typename MB>
+struct is_structured_view<vstack_view<MA, MB>> : std::true_type {};
+
+
+// Whether any of the operands, as forwarded, is a temporary the view would be left referring to
+template <typename... M>
+struct has_temporary_operand : std::false_type {};
+
+template <typename M, typename... MM>
+struct has_temporary_operand<M, MM...> : std::integral_constant<bool,
+		(!std::is_lvalue_reference<M>::value  &&  !is_structured_view<typename std::decay<M>::type>::value)
+		||  has_temporary_operand<MM...>::value
+	> {};
+
+
+} /* namespace __impl */
+
+
+template <typename MA, typename MB>
+kronecker_view<MA, MB> kron(const matrix<MA>& a, const matrix<MB>& b) {
+	return kronecker_view<MA, MB>(concrete_matrix(a), concrete_matrix(b));
+}
+
+template <typename MA, typename MB, typename = typename std::enable_if<__impl::has_temporary_operand<MA, MB>::value>::type>
+void kron(MA&& a, MB&& b) = delete;
+
+
+// More than two operands nest views from the left, so blockdiag(a, b, c) is blockdiag(blockdiag(a, b), c)
+template <typename MA, typename MB>
+block_diagonal_view<MA, MB> blockdiag(const matrix<MA>& a, const matrix<MB>& b) {
+	return block_diagonal_view<MA, MB>(concrete_matrix(a), concrete_matrix(b));
+}
+
+template <typename MA, typename MB, typename MC, typename... MM>
+auto blockdiag(const matrix<MA>& a, const matrix<MB>& b, const matrix<MC>& c, const matrix<MM>&... mm) {
+	return blockdiag(blockdiag(a, b), c, mm...);
+}
+
+template <typename... M, typename = typename std::enable_if<__impl::has_temporary_operand<M...>::value>::type>
+void blockdiag(M&&... m) = delete;
+
+
+template <typename MA, typename MB>
+hstack_view<MA, MB> hstack(const matrix<MA>& a, const matrix<MB>& b) {
+	return hstack_view<MA, MB>(concrete_matrix(a), concrete_matrix(b));
+}
+
+template <typename MA, typename MB, typename MC, typename... MM>
+auto hstack(const matrix<MA>& a, const matrix<MB>& b, const matrix<MC>& c, const matrix<MM>&... mm) {
+	return hstack(hstack(a, b), c, mm...);
+}
+
+template <typename... M, typename = typename std::enable_if<__impl::has_temporary_operand<M...>::value>::type>
+void hstack(M&&... m) = delete;
+
+
+template <typename MA, typename MB>
+vstack_view<MA, MB> vstack(const matrix<MA>& a, const matrix<MB>& b) {
+	return vstack_view<MA, MB>(concrete_matrix(a), concrete_matrix(b));
+}
+
+template <typename MA, typename MB, typename MC, typename... MM>
+auto vstack(const matrix<MA>& a, const matrix<MB>& b, const matrix<MC>& c, const matrix<MM>&... mm) {
+	return vstack(vstack(a, b), c, mm...);
+}
+
+template <typename... M, typename = typename std::enable_if<__impl::has_temporary_operand<M...>::value>::type>
+void vstack(M&&... m) = delete;
+
+
+namespace __impl {
+
+
+/*
+ * y = A * x, for dense and sparse matrices, for the views above through
+ * their structure, and for functors called as a(x, y). Declared first, as
+ * the views apply the matrices they are made of, whatever those are. The
+ * views keep their intermediate vectors in scratch, which holds at least
+ * operator_scratch_size(a) elements, so that solvers applying A at every
+ * iteration allocate it once, before they start.
+ */
+template <typename M>
+std::size_t operator_scratch_size(const M&) {
+	return 0;
+}
+
+template <typename MA, typename MB>
+std::size_t operator_scratch_size(const kronecker_view<MA, MB>& a);
+
+template <typename MA, typename MB>
+std::size_t operator_scratch_size(const block_diagonal_view<MA, MB>& a);
+
+template <typename MA, typename MB>
+std::size_t operator_scratch_size(const hstack_view<MA, MB>& a);
+
+template <typename MA, typename MB>
+std::size_t operator_scratch_size(const vstack_view<MA, MB>& a);
+
+template <typename T>
+void apply_operator(const csr_matrix<T>& a, const T* x, T* y, T* scratch, const parallel_options& options);
+
+template <typename T, typename M>
+void apply_operator(const matrix<M>& a, const T* x, T* y, T* scratch, const parallel_options& options);
+
+template <typename T, typename MA, typename MB>
+void apply_operator(const kronecker_view<MA, MB>& a, const T* x, T* y, T* scratch, const parallel_options& options);
+
+template <typename T, typename MA, typename MB>
+void apply_operator(const block_diagonal_view<MA, MB>& a, const T* x, T* y, T* scratch, const parallel_options& options);
+
+template <typename T, typename MA, typename MB>
+void apply_operator(const hstack_view<MA, MB>& a, const T* x, T* y, T* scratch, const parallel_options& options);
+
+template <typename T, typename MA, typename MB>
+void apply_operator(const vstack_view<MA, MB>& a, const T* x, T* y, T* scratch, const parallel_options& options);
+
+template <typename T, typename F>
+typename std::enable_if<!std::is_base_of<matrix<F>, F>::value>::type
+apply_operator(const F& a, const T* x, T* y, T* scratch, const parallel_options&);
+
+
+template <typename T>
+void apply_operator(const csr_matrix<T>& a, const T* x, T* y, T*, const parallel_options& options) {
+	const std::size_t* offsets = a.row_offsets().data();
+	const unsigned* col_indices = a.col_indices().data();
+	const T* values = a.values().data();
+	std::size_t row_nonzeros = a.nonzeros() / std::max(a.rows(), 1u) + 1;
+	parallel_for(0, a.rows(), row_nonzeros, [&](std::size_t first, std::size_t last) {
+		for(std::size_t row = first; row < last; ++row) {
+			T sum(0);
+			for(std::size_t at = offsets[row]; at < offsets[row + 1]; ++at) {
+				sum += values[at] * x[col_indices[at]];
+			}
+			y[row] = sum;
+		}
+	}, options);
+}
+
+template <typename T, typename M>
+void apply_operator(const matrix<M>& a, const T* x, T* y, const parallel_options& options, std::true_type) {
+	auto block = strided(a);
+	parallel_for(0, block.rows, block.cols, [&](std::size_t first, std::size_t last) {
+		for(std::size_t row = first; row < last; ++row) {
+			y[row] = dot_product<T>(&block(row, 0), x, block.cols);
+		}
+	}, options);
+}
+
+template <typename T, typename M>
+void apply_operator(const matrix<M>& a, const T* x, T* y, const parallel_options& options, std::false_type) {
+	parallel_for(0, rows(a), cols(a), [&](std::size_t first, std::size_t last) {
+		for(std::size_t row = first; row < last; ++row) {
+			T sum(0);
+			for(unsigned col = 0; col < cols(a); ++col) {
+				sum += element_at(a, row, col) * x[col];
+			}
+			y[row] = sum;
+		}
+	}, options);
+}
+
+template <typename T, typename M>
+void apply_operator(const matrix<M>& a, const T* x, T* y, T*, const parallel_options& options) {
+	apply_operator(a, x, y, options, has_contiguous_rows<M>());
+}
+
+template <typename T, typename F>
+typename std::enable_if<!std::is_base_of<matrix<F>, F>::value>::type
+apply_operator(const F& a, const T* x, T* y, T*, const parallel_options&) {
+	a(x, y);
+}
+
+
+/*
+ * The rows of ys = the rows of xs each multiplied by A, that is
+ * ys = xs * transpose(A), for count vectors stored one after the other.
+ * Dense matrices do it as one product, the others one vector at a time,
+ * with the scratch space of one.
+ */
+template <typename T, typename M>
+void apply_operator_to_rows(const M& a, const T* xs, T* ys, unsigned count, T*, const parallel_options& options, std::true_type) {
+	strided_block<const T> x_block{ xs, cols(a), count, cols(a) };
+	strided_block<T> y_block{ ys, rows(a), count, rows(a) };
+	gemm<T>(T(1), x_block, false, strided(a), true, T(0), y_block, options);
+}
+
+template <typename T, typename M>
+void apply_operator_to_rows(const M& a, const T* xs, T* ys, unsigned count, T* scratch, const parallel_options& options, std::false_type) {
+	for(unsigned index = 0; index < count; ++index) {
+		apply_operator(a, xs + std::size_t(index) * cols(a), ys + std::size_t(index) * rows(a), scratch, options);
+	}
+}
+
+template <typename T, typename M>
+void apply_operator_to_rows(const M& a, const T* xs, T* ys, unsigned count, T* scratch, const parallel_options& options) {
+	if(count == 0  ||  rows(a) == 0) {
+		return;
+	}
+	if(cols(a) == 0) {
+		std::fill_n(ys, std::size_t(count) * rows(a), T(0));
+		return;
+	}
+	apply_operator_to_rows(a, xs, ys, count, scratch, options, has_contiguous_rows<M>());
+}
+
+
+// to = transpose(from), for rows x cols elements, in square tiles that stay in cache
+template <typename T>
+void transpose_elements(const T* from, unsigned rows, unsigned cols, T* to) {
+	constexpr unsigned tile = 32;
+	for(unsigned first_row = 0; first_row < rows; first_row += tile) {
+		unsigned last_row = std::min(rows, first_row + tile);
+		for(unsigned first_col = 0; first_col < cols; first_col += tile) {
+			unsigned last_col = std::min(cols, first_col + tile);
+			for(unsigned row = first_row; row < last_row; ++row) {
+				for(unsigned col = first_col; col < last_col; ++col) {
+					to[std::size_t(col) * rows + row] = from[std::size_t(row) * cols + col];
+				}
+			}
+		}
+	}
+}
+
+
+/*
+ * With A m x n and B p x q, x is read as the n x q matrix X of its
+ * elements in row order, and y is the m x p matrix A * X * transpose(B) in
+ * the same order: two products with the factors instead of one with their
+ * (m * p) x (n * q) Kronecker product. The order of the products is the one
+ * with fewer multiplications.
+ */
+inline bool kronecker_applies_second_first(unsigned m, unsigned n, unsigned p, unsigned q) {
+	return std::uint64_t(n) * p * (q + m) <= std::uint64_t(m) * q * (n + p);
+}
+
+// The intermediate matrices of the order taken, then the scratch space of the factors
+template <typename MA, typename MB>
+std::size_t operator_scratch_size(const kronecker_view<MA, MB>& a) {
+	std::size_t m = rows(a.first());
+	std::size_t n = cols(a.first());
+	std::size_t p = rows(a.second());
+	std::size_t q = cols(a.second());
+	std::size_t intermediate = kronecker_applies_second_first(m, n, p, q) ? 2 * n * p + p * m : n * q + 2 * q * m;
+	return intermediate + std::max(operator_scratch_size(a.first()), operator_scratch_size(a.second()));
+}
+
+template <typename T, typename MA, typename MB>
+void apply_operator(const kronecker_view<MA, MB>& a, const T* x, T* y, T* scratch, const parallel_options& options) {
+	unsigned m = rows(a.first());
+	unsigned n = cols(a.first());
+	unsigned p = rows(a.second());
+	unsigned q = cols(a.second());
+	if(kronecker_applies_second_first(m, n, p, q)) {
+		// Z = X * transpose(B) first, then transpose(Y) = transpose(Z) * transpose(A)
+		T* z = scratch;
+		T* zt = z + std::size_t(n) * p;
+		T* yt = zt + std::size_t(n) * p;
+		T* factor_scratch = yt + std::size_t(p) * m;
+		apply_operator_to_rows(a.second(), x, z, n, factor_scratch, options);
+		transpose_elements(z, n, p, zt);
+		apply_operator_to_rows(a.first(), zt, yt, p, factor_scratch, options);
+		transpose_elements(yt, p, m, y);
+	} else {
+		// transpose(W) = transpose(X) * transpose(A) first, with W = A * X, then Y = W * transpose(B)
+		T* xt = scratch;
+		T* wt = xt + std::size_t(n) * q;
+		T* w = wt + std::size_t(q) * m;
+		T* factor_scratch = w + std::size_t(q) * m;
+		transpose_elements(x, n, q, xt);
+		apply_operator_to_rows(a.first(), xt, wt, q, factor_scratch, options);
+		transpose_elements(wt, q, m, w);
+		apply_operator_to_rows(a.second(), w, y, m, factor_scratch, options);
+	}
+}
+
+
+template <typename MA, typename MB>
+std::size_t operator_scratch_size(const block_diagonal_view<MA, MB>& a) {
+	return std::max(operator_scratch_size(a.first()), operator_scratch_size(a.second()));
+}
+
+template <typename T, typename MA, typename MB>
+void apply_operator(const block_diagonal_view<MA, MB>& a, const T* x, T* y, T* scratch, const parallel_options& options) {
+	apply_operator(a.first(), x, y, scratch, options);
+	apply_operator(a.second(), x + cols(a.first()), y + rows(a.first()), scratch, options);
+}
+
+
+// The product with b, then the scratch space of the operands
+template <typename MA, typename MB>
+std::size_t operator_scratch_size(const hstack_view<MA, MB>& a) {
+	return rows(a) + std::max(operator_scratch_size(a.first()), operator_scratch_size(a.second()));
+}
+
+template <typename T, typename MA, typename MB>
+void apply_operator(const hstack_view<MA, MB>& a, const T* x, T* y, T* scratch, const parallel_options& options) {
+	T* second = scratch;
+	apply_operator(a.first(), x, y, second + rows(a), options);
+	apply_operator(a.second(), x + cols(a.first()), second, second + rows(a), options);
+	for(unsigned row = 0; row < rows(a); ++row) {
+		y[row] += second[row];
+	}
+}
+
+
+template <typename MA, typename MB>
+std::size_t operator_scratch_size(const vstack_view<MA, MB>& a) {
+	return std::max(operator_scratch_size(a.first()), operator_scratch_size(a.second()));
+}
+
+template <typename T, typename MA, typename MB>
+void apply_operator(const vstack_view<MA, MB>& a, const T* x, T* y, T* scratch, const parallel_options& options) {
+	apply_operator(a.first(), x, y, scratch, options);
+	apply_operator(a.second(), x, y + rows(a.first()), scratch, options);
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * The product of a view and b, through the structure of the view rather
+ * than its elements, column of b by column of b: for a Kronecker product
+ * of n x n matrices, that is O(n^3) operations per column instead of O(n^4).
+ */
+template <typename V, typename M>
+typename std::enable_if<__impl::is_structured_view<V>::value, dmatrix<typename V::value_type>>::type
+multiply(const V& view, const matrix<M>& b, const parallel_options& options = parallel_options()) {
+	using T = typename V::value_type;
+	if(view.cols() != rows(b)) {
+		throw incompatible_operands(view, "*", b);
+	}
+	unsigned m = view.rows();
+	unsigned n = view.cols();
+	unsigned k = cols(b);
+
+	std::vector<T> bt(std::size_t(k) * n);
+	for(unsigned row = 0; row < n; ++row) {
+		for(unsigned col = 0; col < k; ++col) {
+			bt[std::size_t(col) * n + row] = element_at(b, row, col);
+		}
+	}
+	std::vector<T> ct(std::size_t(k) * m);
+	std::vector<T> scratch(__impl::operator_scratch_size(view));
+	__impl::apply_operator_to_rows(view, bt.data(), ct.data(), k, scratch.data(), options);
+
+	dmatrix<T> c(m, k, uninitialized);
+	if(m > 0  &&  k > 0) {
+		__impl::transpose_elements(ct.data(), k, m, &c.element_at(0, 0));
+	}
+	return c;
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* STRUCTURED_HPP_ */
@@ -0,0 +1,260 @@
+#ifndef SVD_HPP_
+#define SVD_HPP_
+
+#include "matrix.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+#include "qr.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+// Elements of the input in each block of rows read at once
+constexpr std::size_t svd_block_elements = std::size_t(1) << 20;
+// Sweeps of one-sided Jacobi before giving up
+constexpr unsigned jacobi_max_sweeps = 60;
+
+
+inline unsigned svd_block_rows(unsigned cols) {
+	return std::max<std::size_t>(1, svd_block_elements / std::max(1u, cols));
+}
+
+
+/*
+ * Calls pass(first_row, block) with the blocks of rows of a as dense
+ * blocks, in order, so that each pass reads the input once from front to
+ * back, as suits a mapped file. Rows that are not contiguous are copied
+ * one block at a time.
+ */
+template <typename T, typename M, typename Pass>
+void for_each_row_block(const matrix<M>& a, Pass pass, const parallel_options&, std::true_type) {
+	strided_block<const T> whole = strided(a);
+	unsigned block_rows = svd_block_rows(cols(a));
+	for(unsigned first = 0; first < rows(a); first += block_rows) {
+		pass(first, whole.block(first, 0, std::min(block_rows, rows(a) - first), cols(a)));
+	}
+}
+
+template <typename T, typename M, typename Pass>
+void for_each_row_block(const matrix<M>& a, Pass pass, const parallel_options& options, std::false_type) {
+	unsigned block_rows = svd_block_rows(cols(a));
+	dmatrix<T> copy(std::min(block_rows, rows(a)), cols(a), uninitialized);
+	auto dense = strided(copy);
+	for(unsigned first = 0; first < rows(a); first += block_rows) {
+		unsigned count = std::min(block_rows, rows(a) - first);
+		parallel_for(0, count, cols(a), [&](std::size_t first_row, std::size_t last_row) {
+			for(unsigned row = first_row; row < last_row; ++row) {
+				for(unsigned col = 0; col < cols(a); ++col) {
+					dense(row, col) = element_at(a, first + row, col);
+				}
+			}
+		}, options);
+		pass(first, strided_block<const T>(dense.block(0, 0, count, cols(a))));
+	}
+}
+
+template <typename T, typename M, typename Pass>
+void for_each_row_block(const matrix<M>& a, Pass pass, const parallel_options& options) {
+	for_each_row_block<T>(a, pass, options, has_contiguous_rows<M>());
+}
+
+
+/*
+ * One-sided Jacobi on the rows of the square w: rotations of pairs of rows
+ * make them orthogonal, and are applied to the rows of pt as well. With pt
+ * the identity at first, w = p * s * x after, where s holds the norms of
+ * the rows of w and the rows of x are orthonormal. Throws
+ * std::domain_error if the rows are not orthogonal after the sweeps allowed.
+ */
+template <typename T>
+void one_sided_jacobi(const strided_block<T>& w, const strided_block<T>& pt) {
+	unsigned n = w.rows;
+	T tolerance = n * std::numeric_limits<T>::epsilon();
+	auto rotate = [&](const strided_block<T>& m, unsigned i, unsigned j, T c, T s) {
+		T* row_i = &m(i, 0);
+		T* row_j = &m(j, 0);
+		for(unsigned col = 0; col < m.cols; ++col) {
+			T x = row_i[col];
+			T y = row_j[col];
+			row_i[col] = c * x - s * y;
+			row_j[col] = s * x + c * y;
+		}
+	};
+
+	for(unsigned sweep = 0; sweep < jacobi_max_sweeps; ++sweep) {
+		bool rotated = false;
+		for(unsigned i = 0; i < n; ++i) {
+			for(unsigned j = i + 1; j < n; ++j) {
+				T alpha = dot_product<T>(&w(i, 0), &w(i, 0), n);
+				T beta = dot_product<T>(&w(j, 0), &w(j, 0), n);
+				T gamma = dot_product<T>(&w(i, 0), &w(j, 0), n);
+				if(!(std::abs(gamma) > tolerance * std::sqrt(alpha * beta))) {
+					continue;
+				}
+				T zeta = (beta - alpha) / (2 * gamma);
+				T t = std::copysign(T(1), zeta) / (std::abs(zeta) + std::sqrt(1 + zeta * zeta));
+				T c = 1 / std::sqrt(1 + t * t);
+				rotate(w, i, j, c, c * t);
+				rotate(pt, i, j, c, c * t);
+				rotated = true;
+			}
+		}
+		if(!rotated) {
+			return;
+		}
+	}
+	throw std::domain_error("The singular values did not converge");
+}
+
+
+} /* namespace __impl */
+
+
+// Singular values in descending order, with the left singular vectors as the columns of u and the right ones as the rows of vt
+template <typename T>
+class singular_value_decomposition {
+public:
+	singular_value_decomposition(dmatrix<T>&& u, std::vector<T>&& values, dmatrix<T>&& vt) noexcept
+		: _u(std::move(u)), _values(std::move(values)), _vt(std::move(vt))
+	{}
+
+	const dmatrix<T>& u() const noexcept { return _u; }
+
+	const std::vector<T>& singular_values() const noexcept { return _values; }
+
+	const dmatrix<T>& vt() const noexcept { return _vt; }
+
+private:
+	dmatrix<T> _u;
+	std::vector<T> _values;
+	dmatrix<T> _vt;
+};
+
+
+struct randomized_svd_options {
+	// Columns sampled beyond the rank, which make the last singular triplets kept more accurate
+	unsigned oversampling = 10;
+	// Products with a * transpose(a), which sharpen the sample when the singular values decay slowly
+	unsigned power_iterations = 2;
+	// Of the random sample
+	unsigned seed = 1;
+};
+
+
+/*
+ * The rank largest singular values of a, and their singular vectors, as in
+ * Halko, Martinsson and Tropp: the range of a is sampled by its product
+ * with a random matrix of rank + oversampling columns, sharpened by power
+ * iterations, each orthonormalized by QR, and the small projection of a
+ * onto it is decomposed by QR and one-sided Jacobi. a is only read by
+ * products over blocks of its rows, each pass front to back, so a
+ * mapped_dmatrix streams from its file; there are 2 * power_iterations + 2
+ * passes. The columns of u for zero singular values are zero.
+ */
+template <typename M>
+singular_value_decomposition<typename std::remove_const<typename M::element_type>::type>
+randomized_svd(
+	const matrix<M>& a, unsigned rank,
+	const randomized_svd_options& settings = randomized_svd_options(),
+	const parallel_options& options = parallel_options()
+) {
+	using T = typename std::remove_const<typename M::element_type>::type;
+	unsigned m = rows(a);
+	unsigned n = cols(a);
+	if(rank == 0  ||  rank > std::min(m, n)) {
+		throw std::invalid_argument("The rank must be from 1 to the smaller dimension of the matrix");
+	}
+	unsigned samples = std::min(std::min(m, n) - rank, settings.oversampling) + rank;
+
+	auto times = [&](const dmatrix<T>& z) {
+		dmatrix<T> y(m, samples, uninitialized);
+		auto y_block = __impl::strided(y);
+		__impl::for_each_row_block<T>(a, [&](unsigned first, const __impl::strided_block<const T>& block) {
+			__impl::gemm<T>(T(1), block, false, __impl::strided(z), false, T(0), y_block.block(first, 0, block.rows, samples), options);
+		}, options);
+		return y;
+	};
+	auto transpose_times = [&](const dmatrix<T>& q) {
+		dmatrix<T> z(n, samples);
+		auto z_block = __impl::strided(z);
+		__impl::for_each_row_block<T>(a, [&](unsigned first, const __impl::strided_block<const T>& block) {
+			__impl::gemm<T>(T(1), block, true, __impl::strided(q).block(first, 0, block.rows, samples), false, T(1), z_block, options);
+		}, options);
+		return z;
+	};
+	auto orthonormalize = [&](dmatrix<T>&& y) {
+		return qr(std::move(y), options).q(options);
+	};
+
+	std::mt19937_64 generator(settings.seed);
+	dmatrix<T> sample(n, samples, uninitialized);
+	for(unsigned row = 0; row < n; ++row) {
+		for(unsigned col = 0; col < samples; ++col) {
+			sample.element_at(row, col) = std::ldexp(T(generator() >> 11), -52) - T(1);
+		}
+	}
+	auto q = orthonormalize(times(sample));
+	for(unsigned iteration = 0; iteration < settings.power_iterations; ++iteration) {
+		q = orthonormalize(times(orthonormalize(transpose_times(q))));
+	}
+
+	// transpose(q) * a = transpose(r) * transpose(q_z), and r = p * s * x by one-sided Jacobi
+	auto projection = qr(transpose_times(q), options);
+	auto w = projection.r();
+	auto pt = dmatrix<T>::generate(samples, samples, [](unsigned row, unsigned col) {
+		return row == col ? T(1) : T(0);
+	});
+	__impl::one_sided_jacobi(__impl::strided(w), __impl::strided(pt));
+
+	std::vector<T> norms(samples);
+	for(unsigned row = 0; row < samples; ++row) {
+		norms[row] = std::sqrt(__impl::dot_product<T>(&w.element_at(row, 0), &w.element_at(row, 0), samples));
+	}
+	std::vector<unsigned> order(samples);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](unsigned lhs, unsigned rhs) {
+		return norms[lhs] > norms[rhs];
+	});
+
+	std::vector<T> values(rank);
+	dmatrix<T> x(rank, samples, uninitialized);
+	dmatrix<T> p(rank, samples, uninitialized);
+	for(unsigned index = 0; index < rank; ++index) {
+		unsigned row = order[index];
+		values[index] = norms[row];
+		T scale = norms[row] > T(0) ? 1 / norms[row] : T(0);
+		for(unsigned col = 0; col < samples; ++col) {
+			x.element_at(index, col) = w.element_at(row, col) * scale;
+			p.element_at(index, col) = pt.element_at(row, col);
+		}
+	}
+
+	// u = q * transpose(x), and vt = p * transpose(q_z) with p the rows of pt kept
+	dmatrix<T> u(m, rank, uninitialized);
+	__impl::gemm<T>(T(1), __impl::strided(static_cast<const dmatrix<T>&>(q)), false, __impl::strided(static_cast<const dmatrix<T>&>(x)), true, T(0), __impl::strided(u), options);
+	auto q_z = projection.q(options);
+	dmatrix<T> vt(rank, n, uninitialized);
+	__impl::gemm<T>(T(1), __impl::strided(static_cast<const dmatrix<T>&>(p)), false, __impl::strided(static_cast<const dmatrix<T>&>(q_z)), true, T(0), __impl::strided(vt), options);
+
+	return singular_value_decomposition<T>(std::move(u), std::move(values), std::move(vt));
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* SVD_HPP_ */
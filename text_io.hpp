@@ -0,0 +1,618 @@
+#ifndef TEXT_IO_HPP_
+#define TEXT_IO_HPP_
+
+#include "matrix.hpp"
+#include "binary_io.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "sparse.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+namespace matrix {
+
+
+struct csv_options {
+	char delimiter = ',';
+	unsigned skip_rows = 0;  // Leading lines to ignore, e.g. a header
+	unsigned threads = 0;    // 0 means one per hardware thread
+};
+
+
+namespace __impl {
+
+
+// Largest mantissa and power of ten for which mantissa * 10^e is exact
+template <typename T> struct exact_decimal_limits;
+
+template <>
+struct exact_decimal_limits<float> {
+	static constexpr std::uint64_t max_mantissa = std::uint64_t(1) << 24;
+	static constexpr int max_exponent = 10;
+};
+
+template <>
+struct exact_decimal_limits<double> {
+	static constexpr std::uint64_t max_mantissa = std::uint64_t(1) << 53;
+	static constexpr int max_exponent = 22;
+};
+
+template <>
+struct exact_decimal_limits<long double> {
+	static constexpr std::uint64_t max_mantissa = 0;
+	static constexpr int max_exponent = -1;
+};
+
+
+inline void fallback_parse(const char* token, char** end, float& value) { value = std::strtof(token, end); }
+inline void fallback_parse(const char* token, char** end, double& value) { value = std::strtod(token, end); }
+inline void fallback_parse(const char* token, char** end, long double& value) { value = std::strtold(token, end); }
+
+
+/*
+ * Parses the whole of [first, last) as a floating point number. Decimal
+ * inputs whose mantissa and power of ten are both exactly representable are
+ * computed with a single multiplication or division, which is correctly
+ * rounded; anything else goes through strtod and friends.
+ */
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+parse_number(const char* first, const char* last, T& value) {
+	using limits = exact_decimal_limits<T>;
+	static const double powers_of_ten[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const char* p = first;
+	bool negative = false;
+	if(p < last  &&  (*p == '-'  ||  *p == '+')) {
+		negative = (*p == '-');
+		++p;
+	}
+
+	std::uint64_t mantissa = 0;
+	int significant_digits = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool truncated = false;
+
+	auto accumulate = [&](char c) {
+		if(mantissa == 0  &&  c == '0') {
+			return;
+		}
+		if(significant_digits < 19) {
+			mantissa = mantissa * 10 + (c - '0');
+			++significant_digits;
+		} else {
+			truncated = true;
+		}
+	};
+
+	for(; p < last  &&  *p >= '0'  &&  *p <= '9'; ++p, ++digits) {
+		accumulate(*p);
+		if(truncated) {
+			break;
+		}
+	}
+	if(!truncated  &&  p < last  &&  *p == '.') {
+		for(++p; p < last  &&  *p >= '0'  &&  *p <= '9'; ++p, ++digits) {
+			accumulate(*p);
+			if(truncated) {
+				break;
+			}
+			--exponent;
+		}
+	}
+	if(!truncated  &&  digits > 0  &&  p < last  &&  (*p == 'e'  ||  *p == 'E')) {
+		++p;
+		bool negative_exponent = false;
+		if(p < last  &&  (*p == '-'  ||  *p == '+')) {
+			negative_exponent = (*p == '-');
+			++p;
+		}
+		const char* exponent_digits = p;
+		int explicit_exponent = 0;
+		for(; p < last  &&  *p >= '0'  &&  *p <= '9'; ++p) {
+			if(explicit_exponent < 100000) {
+				explicit_exponent = explicit_exponent * 10 + (*p - '0');
+			}
+		}
+		if(p == exponent_digits) {
+			return false;
+		}
+		exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+	}
+
+	if(!truncated  &&  digits > 0  &&  p == last
+	&& mantissa <= limits::max_mantissa
+	&& exponent >= -limits::max_exponent  &&  exponent <= limits::max_exponent) {
+		double result = double(mantissa);
+		if(exponent < 0) {
+			result /= powers_of_ten[-exponent];
+		} else {
+			result *= powers_of_ten[exponent];
+		}
+		value = T(negative ? -result : result);
+		return true;
+	}
+
+	// Slow path: hand a null-terminated copy to the C library
+	char buffer[128];
+	std::size_t length = last - first;
+	if(length == 0  ||  length >= sizeof(buffer)) {
+		return false;
+	}
+	std::memcpy(buffer, first, length);
+	buffer[length] = '\0';
+	char* end;
+	fallback_parse(buffer, &end, value);
+	return end == buffer + length;
+}
+
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, bool>::type
+parse_number(const char* first, const char* last, T& value) {
+	const char* p = first;
+	bool negative = false;
+	if(p < last  &&  (*p == '-'  ||  *p == '+')) {
+		negative = (*p == '-');
+		++p;
+	}
+	if(p == last  ||  (negative  &&  !std::is_signed<T>::value)) {
+		return false;
+	}
+
+	// Checked before multiplying, as magnitude * 10 + digit may wrap around for 64-bit T
+	std::uint64_t limit = std::uint64_t(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+	std::uint64_t magnitude = 0;
+	for(; p < last; ++p) {
+		if(*p < '0'  ||  *p > '9') {
+			return false;
+		}
+		unsigned digit = *p - '0';
+		if(magnitude > (limit - digit) / 10) {
+			return false;
+		}
+		magnitude = magnitude * 10 + digit;
+	}
+	// The most negative value has no positive counterpart to negate
+	value = negative  &&  magnitude > 0 ? T(-T(magnitude - 1) - 1) : T(magnitude);
+	return true;
+}
+
+
+inline bool is_blank(char c) noexcept {
+	return c == ' '  ||  c == '\t'  ||  c == '\r';
+}
+
+inline const char* skip_blanks(const char* p, const char* last) noexcept {
+	while(p < last  &&  is_blank(*p)) {
+		++p;
+	}
+	return p;
+}
+
+inline const char* find_token_end(const char* p, const char* last, char delimiter) noexcept {
+	while(p < last  &&  *p != delimiter  &&  !is_blank(*p)) {
+		++p;
+	}
+	return p;
+}
+
+inline const char* find_line_end(const char* p, const char* last) noexcept {
+	auto found = static_cast<const char*>(std::memchr(p, '\n', last - p));
+	return found != nullptr ? found : last;
+}
+
+
+/*
+ * Calls func(first, last) for every line of [first, last) holding something
+ * other than blanks. Lines starting with comment_char are skipped too.
+ */
+template <typename F>
+void for_each_data_line(const char* first, const char* last, char comment_char, F func) {
+	while(first < last) {
+		const char* line_end = find_line_end(first, last);
+		const char* content = skip_blanks(first, line_end);
+		if(content < line_end  &&  *content != comment_char) {
+			func(content, line_end);
+		}
+		first = line_end + 1;
+	}
+}
+
+
+/*
+ * Splits [first, last) in up to `count` pieces at line boundaries. Returns
+ * the piece boundaries, so piece i is [result[i], result[i + 1]).
+ */
+inline std::vector<const char*> split_at_lines(const char* first, const char* last, unsigned count) {
+	// Not worth a thread below this many bytes
+	const std::size_t min_piece_size = 1 << 16;
+	std::size_t size = last - first;
+	count = std::max(1u, std::min<unsigned>(count, size / min_piece_size + 1));
+
+	std::vector<const char*> boundaries{ first };
+	for(unsigned i = 1; i < count; ++i) {
+		const char* nominal = first + size / count * i;
+		if(nominal <= boundaries.back()) {
+			continue;
+		}
+		const char* boundary = find_line_end(nominal, last);
+		if(boundary < last) {
+			boundaries.push_back(boundary + 1);
+		}
+	}
+	boundaries.push_back(last);
+	return boundaries;
+}
+
+
+inline unsigned resolve_threads(unsigned threads) noexcept {
+	return threads > 0 ? threads : default_execution_context()->pool().concurrency();
+}
+
+
+/*
+ * Counts the data lines of every piece of `boundaries` in parallel. Returns
+ * the index of the first line of every piece, followed by the total count.
+ */
+inline std::vector<std::size_t> count_data_lines(const std::vector<const char*>& boundaries, char comment_char) {
+	unsigned pieces = boundaries.size() - 1;
+	std::vector<std::size_t> first_line(pieces + 1, 0);
+
+	parallel_invoke_n(pieces, [&](unsigned piece) {
+		std::size_t count = 0;
+		for_each_data_line(boundaries[piece], boundaries[piece + 1], comment_char,
+			[&](const char*, const char*) { ++count; }
+		);
+		first_line[piece + 1] = count;
+	});
+	for(unsigned piece = 0; piece < pieces; ++piece) {
+		first_line[piece + 1] += first_line[piece];
+	}
+
+	return first_line;
+}
+
+
+// Parses a delimited line into exactly `count` values; returns false on any mismatch
+template <typename T>
+bool parse_fields(const char* p, const char* line_end, char delimiter, unsigned count, T* values) {
+	for(unsigned i = 0; i < count; ++i) {
+		p = skip_blanks(p, line_end);
+		const char* token_end = find_token_end(p, line_end, delimiter);
+		if(!parse_number(p, token_end, values[i])) {
+			return false;
+		}
+		p = skip_blanks(token_end, line_end);
+		if(i + 1 < count) {
+			if(delimiter != ' ') {
+				if(p == line_end  ||  *p != delimiter) {
+					return false;
+				}
+				++p;
+			}
+		}
+	}
+	return skip_blanks(p, line_end) == line_end;
+}
+
+
+inline unsigned count_fields(const char* p, const char* line_end, char delimiter) {
+	unsigned count = 0;
+	while(true) {
+		p = skip_blanks(p, line_end);
+		if(p == line_end) {
+			return count;
+		}
+		++count;
+		p = skip_blanks(find_token_end(p, line_end, delimiter), line_end);
+		if(p < line_end  &&  *p == delimiter  &&  delimiter != ' ') {
+			++p;
+		}
+	}
+}
+
+
+struct matrix_market_header {
+	enum class symmetry_type { general, symmetric, skew_symmetric };
+
+	bool coordinate;
+	bool pattern;
+	symmetry_type symmetry;
+	unsigned rows;
+	unsigned cols;
+	std::size_t entries;
+	const char* data;
+};
+
+
+inline matrix_market_header read_matrix_market_header(const char* first, const char* last, const std::string& path) {
+	auto fail = [&](const std::string& message) -> format_error {
+		return format_error(message + " in Matrix Market file " + path);
+	};
+
+	const char* line_end = find_line_end(first, last);
+	std::vector<std::string> words;
+	for(const char* p = first; (p = skip_blanks(p, line_end)) < line_end; ) {
+		const char* word_end = find_token_end(p, line_end, ' ');
+		std::string word(p, word_end);
+		std::transform(word.begin(), word.end(), word.begin(), [](char c) { return char(std::tolower(static_cast<unsigned char>(c))); });
+		words.push_back(word);
+		p = word_end;
+	}
+	if(words.size() != 5  ||  words[0] != "%%matrixmarket"  ||  words[1] != "matrix") {
+		throw fail("Missing or invalid banner");
+	}
+
+	matrix_market_header header;
+	if(words[2] == "coordinate") {
+		header.coordinate = true;
+	} else if(words[2] == "array") {
+		header.coordinate = false;
+	} else {
+		throw fail("Unknown format '" + words[2] + "'");
+	}
+
+	if(words[3] == "real"  ||  words[3] == "double"  ||  words[3] == "integer") {
+		header.pattern = false;
+	} else if(words[3] == "pattern"  &&  header.coordinate) {
+		header.pattern = true;
+	} else {
+		throw fail("Unsupported field '" + words[3] + "'");
+	}
+
+	if(words[4] == "general") {
+		header.symmetry = matrix_market_header::symmetry_type::general;
+	} else if(words[4] == "symmetric"  &&  header.coordinate) {
+		header.symmetry = matrix_market_header::symmetry_type::symmetric;
+	} else if(words[4] == "skew-symmetric"  &&  header.coordinate) {
+		header.symmetry = matrix_market_header::symmetry_type::skew_symmetric;
+	} else {
+		throw fail("Unsupported symmetry '" + words[4] + "'");
+	}
+
+	// The size line is the first data line after the banner
+	const char* p = line_end;
+	while(p < last) {
+		++p;
+		line_end = find_line_end(p, last);
+		const char* content = skip_blanks(p, line_end);
+		if(content < line_end  &&  *content != '%') {
+			std::size_t sizes[3] = { 0, 0, 0 };
+			unsigned expected = header.coordinate ? 3 : 2;
+			if(!parse_fields(content, line_end, ' ', expected, sizes)
+			|| sizes[0] > std::numeric_limits<unsigned>::max()
+			|| sizes[1] > std::numeric_limits<unsigned>::max()) {
+				throw fail("Invalid size line");
+			}
+			header.rows = sizes[0];
+			header.cols = sizes[1];
+			header.entries = header.coordinate ? sizes[2] : sizes[0] * sizes[1];
+			header.data = std::min(line_end + 1, last);
+			return header;
+		}
+		p = line_end;
+	}
+	throw fail("Missing size line");
+}
+
+
+// Parses a coordinate line as 1-based "row col [value]" into a 0-based entry
+template <typename T>
+bool parse_coordinate_entry(
+	const char* line, const char* line_end, const matrix_market_header& header,
+	sparse_entry<T>& entry
+) {
+	unsigned indexes[2];
+	const char* p = line;
+	for(unsigned& index : indexes) {
+		p = skip_blanks(p, line_end);
+		const char* token_end = find_token_end(p, line_end, ' ');
+		if(!parse_number(p, token_end, index)) {
+			return false;
+		}
+		p = token_end;
+	}
+	if(indexes[0] == 0  ||  indexes[0] > header.rows  ||  indexes[1] == 0  ||  indexes[1] > header.cols) {
+		return false;
+	}
+	entry.row = indexes[0] - 1;
+	entry.col = indexes[1] - 1;
+
+	if(header.pattern) {
+		entry.value = T(1);
+		return skip_blanks(p, line_end) == line_end;
+	}
+	return parse_fields(p, line_end, ' ', 1, &entry.value);
+}
+
+
+template <typename T>
+std::vector<sparse_entry<T>> read_matrix_market_entries(
+	const matrix_market_header& header, const char* last, unsigned threads, const std::string& path
+) {
+	using symmetry_type = matrix_market_header::symmetry_type;
+
+	auto boundaries = split_at_lines(header.data, last, resolve_threads(threads));
+	auto first_line = count_data_lines(boundaries, '%');
+	if(first_line.back() != header.entries) {
+		throw format_error("Expected " + std::to_string(header.entries) + " entries but found " + std::to_string(first_line.back()) + " in Matrix Market file " + path);
+	}
+
+	std::vector<std::vector<sparse_entry<T>>> pieces(boundaries.size() - 1);
+	parallel_invoke_n(pieces.size(), [&](unsigned piece) {
+		auto& entries = pieces[piece];
+		entries.reserve((first_line[piece + 1] - first_line[piece]) * (header.symmetry == symmetry_type::general ? 1 : 2));
+		std::size_t line = first_line[piece];
+		for_each_data_line(boundaries[piece], boundaries[piece + 1], '%', [&](const char* line_first, const char* line_last) {
+			sparse_entry<T> entry;
+			if(!parse_coordinate_entry(line_first, line_last, header, entry)) {
+				throw format_error("Invalid entry " + std::to_string(line + 1) + " in Matrix Market file " + path);
+			}
+			entries.push_back(entry);
+			if(header.symmetry != symmetry_type::general  &&  entry.row != entry.col) {
+				T mirrored = header.symmetry == symmetry_type::symmetric ? entry.value : T(-entry.value);
+				entries.push_back({ entry.col, entry.row, mirrored });
+			}
+			++line;
+		});
+	});
+
+	std::vector<sparse_entry<T>> entries;
+	std::size_t size = 0;
+	for(auto& piece : pieces) {
+		size += piece.size();
+	}
+	entries.reserve(size);
+	for(auto& piece : pieces) {
+		entries.insert(entries.end(), piece.begin(), piece.end());
+		std::vector<sparse_entry<T>>().swap(piece);
+	}
+	return entries;
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * Reads a delimited text file of numbers into a dmatrix. The file is mapped
+ * and split in pieces at line boundaries; pieces are parsed concurrently,
+ * each one writing its rows straight into the matrix storage.
+ */
+template <typename T>
+dmatrix<T> read_csv(const std::string& path, const csv_options& options = csv_options()) {
+	mapped_file file(path);
+	const char* first = file.data();
+	const char* last = first + file.size();
+
+	for(unsigned i = 0; i < options.skip_rows  &&  first < last; ++i) {
+		first = std::min(__impl::find_line_end(first, last) + 1, last);
+	}
+
+	// The first data line determines the number of columns
+	unsigned cols = 0;
+	for(const char* line = first; line < last  &&  cols == 0; ) {
+		const char* line_end = __impl::find_line_end(line, last);
+		cols = __impl::count_fields(line, line_end, options.delimiter);
+		line = line_end + 1;
+	}
+	if(cols == 0) {
+		return dmatrix<T>(0, 0);
+	}
+
+	// Count the rows of every piece before allocating the matrix once
+	auto boundaries = __impl::split_at_lines(first, last, __impl::resolve_threads(options.threads));
+	auto first_row = __impl::count_data_lines(boundaries, '\0');
+	if(first_row.back() > std::numeric_limits<unsigned>::max()) {
+		throw format_error("Too many rows in " + path);
+	}
+
+	dmatrix<T> m(first_row.back(), cols, uninitialized);
+	__impl::parallel_invoke_n(boundaries.size() - 1, [&](unsigned piece) {
+		std::size_t row = first_row[piece];
+		__impl::for_each_data_line(boundaries[piece], boundaries[piece + 1], '\0',
+			[&](const char* line, const char* line_end) {
+				if(!__impl::parse_fields(line, line_end, options.delimiter, cols, &m.element_at(row, 0))) {
+					throw format_error("Invalid or incomplete row " + std::to_string(row + 1) + " in " + path);
+				}
+				++row;
+			}
+		);
+	});
+
+	return m;
+}
+
+
+/*
+ * Reads a Matrix Market file into a dense dmatrix. Both the array (dense,
+ * column-major) and coordinate (sparse) formats are accepted.
+ */
+template <typename T>
+dmatrix<T> read_matrix_market(const std::string& path, unsigned threads = 0) {
+	mapped_file file(path);
+	const char* last = file.data() + file.size();
+	auto header = __impl::read_matrix_market_header(file.data(), last, path);
+
+	if(header.coordinate) {
+		dmatrix<T> m(header.rows, header.cols);
+		for(const auto& entry : __impl::read_matrix_market_entries<T>(header, last, threads, path)) {
+			m.element_at(entry.row, entry.col) += entry.value;
+		}
+		return m;
+	}
+
+	// Every element is listed, so nothing needs initializing beforehand
+	dmatrix<T> m(header.rows, header.cols, uninitialized);
+
+	// Array entries are listed column by column
+	auto boundaries = __impl::split_at_lines(header.data, last, __impl::resolve_threads(threads));
+	auto first_entry = __impl::count_data_lines(boundaries, '%');
+	if(first_entry.back() != header.entries) {
+		throw format_error("Expected " + std::to_string(header.entries) + " entries but found " + std::to_string(first_entry.back()) + " in Matrix Market file " + path);
+	}
+
+	__impl::parallel_invoke_n(boundaries.size() - 1, [&](unsigned piece) {
+		std::size_t index = first_entry[piece];
+		__impl::for_each_data_line(boundaries[piece], boundaries[piece + 1], '%',
+			[&](const char* line, const char* line_end) {
+				unsigned row = index % header.rows;
+				unsigned col = index / header.rows;
+				if(!__impl::parse_fields(line, line_end, ' ', 1, &m.element_at(row, col))) {
+					throw format_error("Invalid entry " + std::to_string(index + 1) + " in Matrix Market file " + path);
+				}
+				++index;
+			}
+		);
+	});
+
+	return m;
+}
+
+
+/*
+ * Reads a coordinate Matrix Market file into a csr_matrix. Entries are
+ * parsed in parallel; symmetric storage is expanded to both triangles.
+ */
+template <typename T>
+csr_matrix<T> read_matrix_market_sparse(const std::string& path, unsigned threads = 0) {
+	mapped_file file(path);
+	const char* last = file.data() + file.size();
+	auto header = __impl::read_matrix_market_header(file.data(), last, path);
+
+	if(!header.coordinate) {
+		dmatrix<T> m = read_matrix_market<T>(path, threads);
+		std::vector<sparse_entry<T>> entries;
+		for(unsigned row = 0; row < m.rows(); ++row) {
+			for(unsigned col = 0; col < m.cols(); ++col) {
+				if(m.element_at(row, col) != T()) {
+					entries.push_back({ row, col, m.element_at(row, col) });
+				}
+			}
+		}
+		return csr_matrix<T>::from_entries(header.rows, header.cols, std::move(entries));
+	}
+
+	return csr_matrix<T>::from_entries(header.rows, header.cols,
+		__impl::read_matrix_market_entries<T>(header, last, threads, path));
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* TEXT_IO_HPP_ */
@@ -0,0 +1,102 @@
+#ifndef TRANSFORM_HPP_
+#define TRANSFORM_HPP_
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+
+namespace matrix {
+
+
+namespace __impl {
+
+
+template <typename F, typename... M>
+using map_result_of = typename std::decay<
+		decltype(std::declval<F&>()(std::declval<const typename M::element_type&>()...))
+	>::type;
+
+
+// Plain pointers let the compiler vectorize func when it is simple enough
+template <typename T, typename F, typename... U>
+void transform_contiguous_row(T* to, unsigned count, F& func, const U*... from) {
+	for(unsigned col = 0; col < count; ++col) {
+		to[col] = func(from[col]...);
+	}
+}
+
+
+template <typename MT, typename F, typename... MF>
+void transform_rows(
+	MT& to, F& func, std::size_t first_row, std::size_t last_row,
+	const matrix<MF>&... from
+) {
+	unsigned row_size = cols(to);
+	for(unsigned row = first_row; row < last_row; ++row) {
+		if(all_have_contiguous_rows<MT, MF...>::value  &&  row_size > 0) {
+			transform_contiguous_row(&element_at(to, row, 0), row_size, func, row_elements(from, row)...);
+		} else {
+			for(unsigned col = 0; col < row_size; ++col) {
+				element_at(to, row, col) = func(element_at(from, row, col)...);
+			}
+		}
+	}
+}
+
+
+inline void ignore_all(std::initializer_list<int>) noexcept {}
+
+
+} /* namespace __impl */
+
+
+/*
+ * Assigns func(element of m at (row, col), ...) to every element of to,
+ * which must have the shape of all the sources. It may be one of them, but
+ * must not overlap them otherwise. Large matrices are split by rows across
+ * the threads of the execution context, so func must be safe to call
+ * concurrently.
+ */
+template <typename MT, typename F, typename M, typename... MM>
+void transform_into(const parallel_options& options, MT&& to, F func, const matrix<M>& m, const matrix<MM>&... mm) {
+	incompatible_operands::throw_if_not_same_shape(to, "transform_into", m);
+	__impl::ignore_all({ (incompatible_operands::throw_if_not_same_shape(to, "transform_into", mm), 0)... });
+
+	std::size_t work_per_row = std::size_t(cols(m)) * (2 + sizeof...(MM));
+	parallel_for(0, rows(m), work_per_row, [&](std::size_t first_row, std::size_t last_row) {
+		__impl::transform_rows(to, func, first_row, last_row, m, mm...);
+	}, options);
+}
+
+template <typename MT, typename F, typename M, typename... MM>
+void transform_into(MT&& to, F func, const matrix<M>& m, const matrix<MM>&... mm) {
+	transform_into(parallel_options(), std::forward<MT>(to), func, m, mm...);
+}
+
+
+// Like transform_into, but into a new dmatrix of whatever func returns
+template <typename F, typename M, typename... MM>
+dmatrix<__impl::map_result_of<F, M, MM...>>
+map(const parallel_options& options, F func, const matrix<M>& m, const matrix<MM>&... mm) {
+	__impl::ignore_all({ (incompatible_operands::throw_if_not_same_shape(m, "map", mm), 0)... });
+
+	dmatrix<__impl::map_result_of<F, M, MM...>> result(rows(m), cols(m), uninitialized);
+	transform_into(options, result, func, m, mm...);
+	return result;
+}
+
+template <typename F, typename M, typename... MM>
+dmatrix<__impl::map_result_of<F, M, MM...>>
+map(F func, const matrix<M>& m, const matrix<MM>&... mm) {
+	return map(parallel_options(), func, m, mm...);
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* TRANSFORM_HPP_ */
@@ -0,0 +1,344 @@
+#ifndef TRIANGULAR_HPP_
+#define TRIANGULAR_HPP_
+
+#include "matrix.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+
+namespace matrix {
+
+
+// Whether the triangular matrix multiplies or divides the other from the left or from the right
+enum class side { left, right };
+
+// Which triangle of the triangular matrix is read; the other one is taken as zeros
+enum class triangle { lower, upper };
+
+// Whether the diagonal is read, or taken as all ones
+enum class diagonal { non_unit, unit };
+
+
+namespace __impl {
+
+
+// Rows or columns of the triangular matrix done at once by substitution, between the gemm calls
+constexpr unsigned triangular_block_size = 64;
+
+
+/*
+ * Which triangle of op(a) holds its elements, op transposing when
+ * transposed is set: the blocked loops below run forward for lower ones on
+ * the left and upper ones on the right, backward otherwise.
+ */
+inline bool op_is_lower(triangle uplo, bool transposed) noexcept {
+	return (uplo == triangle::lower) != transposed;
+}
+
+
+/*
+ * Solves op(a) * x = b, in place of b, a block of rows of b at once: rows
+ * are first updated with a gemm against those already solved, then solved
+ * by substitution on whole rows of b, split by columns across threads.
+ */
+template <typename T>
+void solve_left(
+	const strided_block<const T>& a, triangle uplo, bool transposed, diagonal diag,
+	const strided_block<T>& b, const parallel_options& options
+) {
+	unsigned n = b.rows;
+	bool forward = op_is_lower(uplo, transposed);
+	for(unsigned done = 0; done < n; done += triangular_block_size) {
+		unsigned size = std::min(triangular_block_size, n - done);
+		unsigned first = forward ? done : n - done - size;
+		unsigned end = first + size;
+		if(forward) {
+			gemm<T>(T(-1), op_block(a, transposed, first, 0, size, first), transposed, b.block(0, 0, first, b.cols), false,
+			        T(1), b.block(first, 0, size, b.cols), options);
+		} else {
+			gemm<T>(T(-1), op_block(a, transposed, first, end, size, n - end), transposed, b.block(end, 0, n - end, b.cols), false,
+			        T(1), b.block(first, 0, size, b.cols), options);
+		}
+
+		parallel_for(0, b.cols, std::size_t(size) * size / 2, [&](std::size_t first_col, std::size_t last_col) {
+			unsigned count = last_col - first_col;
+			for(unsigned step = 0; step < size; ++step) {
+				unsigned row = forward ? first + step : end - 1 - step;
+				unsigned from = forward ? first : row + 1;
+				unsigned to = forward ? row : end;
+				T* b_row = &b(row, first_col);
+				for(unsigned k = from; k < to; ++k) {
+					T factor = op_element(a, transposed, row, k);
+					const T* b_k = &b(k, first_col);
+					for(unsigned col = 0; col < count; ++col) {
+						b_row[col] -= factor * b_k[col];
+					}
+				}
+				if(diag == diagonal::non_unit) {
+					T diagonal_element = a(row, row);
+					for(unsigned col = 0; col < count; ++col) {
+						b_row[col] /= diagonal_element;
+					}
+				}
+			}
+		}, options);
+	}
+}
+
+
+/*
+ * Solves x * op(a) = b in place of one row x of b, for the columns
+ * [first, first + size): with a's rows when they are op(a)'s, otherwise as
+ * dot products with them, so that a is always read along its rows.
+ */
+template <typename T>
+void solve_right_row(
+	const strided_block<const T>& a, triangle uplo, bool transposed, diagonal diag,
+	T* x, unsigned first, unsigned size
+) {
+	bool unit = diag == diagonal::unit;
+	bool lower = op_is_lower(uplo, transposed);
+	for(unsigned step = 0; step < size; ++step) {
+		unsigned j = lower ? size - 1 - step : step;
+		const T* a_row = &a(first + j, first);
+		if(!transposed) {
+			if(!unit) {
+				x[j] /= a_row[j];
+			}
+			unsigned from = lower ? 0 : j + 1;
+			unsigned to = lower ? j : size;
+			for(unsigned col = from; col < to; ++col) {
+				x[col] -= x[j] * a_row[col];
+			}
+		} else {
+			T sum = lower ? dot_product(x + j + 1, a_row + j + 1, size - j - 1) : dot_product(x, a_row, j);
+			x[j] = unit ? x[j] - sum : (x[j] - sum) / a_row[j];
+		}
+	}
+}
+
+
+// Solves x * op(a) = b in place of b, by blocks of columns, the rows of b split across threads
+template <typename T>
+void solve_right(
+	const strided_block<const T>& a, triangle uplo, bool transposed, diagonal diag,
+	const strided_block<T>& b, const parallel_options& options
+) {
+	unsigned n = b.cols;
+	bool forward = !op_is_lower(uplo, transposed);
+	for(unsigned done = 0; done < n; done += triangular_block_size) {
+		unsigned size = std::min(triangular_block_size, n - done);
+		unsigned first = forward ? done : n - done - size;
+		unsigned end = first + size;
+		if(forward) {
+			gemm<T>(T(-1), b.block(0, 0, b.rows, first), false, op_block(a, transposed, 0, first, first, size), transposed,
+			        T(1), b.block(0, first, b.rows, size), options);
+		} else {
+			gemm<T>(T(-1), b.block(0, end, b.rows, n - end), false, op_block(a, transposed, end, first, n - end, size), transposed,
+			        T(1), b.block(0, first, b.rows, size), options);
+		}
+
+		parallel_for(0, b.rows, std::size_t(size) * size / 2, [&](std::size_t first_row, std::size_t last_row) {
+			for(unsigned row = first_row; row < last_row; ++row) {
+				solve_right_row(a, uplo, transposed, diag, &b(row, first), first, size);
+			}
+		}, options);
+	}
+}
+
+
+/*
+ * b = op(a) * b in place, by blocks of rows taken in the order that leaves
+ * the rows a block needs untouched until it is done: its own by
+ * substitution, then the others with a gemm.
+ */
+template <typename T>
+void multiply_left(
+	const strided_block<const T>& a, triangle uplo, bool transposed, diagonal diag,
+	const strided_block<T>& b, const parallel_options& options
+) {
+	unsigned n = b.rows;
+	bool lower = op_is_lower(uplo, transposed);
+	for(unsigned done = 0; done < n; done += triangular_block_size) {
+		unsigned size = std::min(triangular_block_size, n - done);
+		unsigned first = lower ? n - done - size : done;
+		unsigned end = first + size;
+
+		parallel_for(0, b.cols, std::size_t(size) * size / 2, [&](std::size_t first_col, std::size_t last_col) {
+			unsigned count = last_col - first_col;
+			for(unsigned step = 0; step < size; ++step) {
+				unsigned row = lower ? end - 1 - step : first + step;
+				unsigned from = lower ? first : row + 1;
+				unsigned to = lower ? row : end;
+				T* b_row = &b(row, first_col);
+				if(diag == diagonal::non_unit) {
+					T diagonal_element = a(row, row);
+					for(unsigned col = 0; col < count; ++col) {
+						b_row[col] *= diagonal_element;
+					}
+				}
+				for(unsigned k = from; k < to; ++k) {
+					T factor = op_element(a, transposed, row, k);
+					const T* b_k = &b(k, first_col);
+					for(unsigned col = 0; col < count; ++col) {
+						b_row[col] += factor * b_k[col];
+					}
+				}
+			}
+		}, options);
+
+		if(lower) {
+			gemm<T>(T(1), op_block(a, transposed, first, 0, size, first), transposed, b.block(0, 0, first, b.cols), false,
+			        T(1), b.block(first, 0, size, b.cols), options);
+		} else {
+			gemm<T>(T(1), op_block(a, transposed, first, end, size, n - end), transposed, b.block(end, 0, n - end, b.cols), false,
+			        T(1), b.block(first, 0, size, b.cols), options);
+		}
+	}
+}
+
+
+// x = x * op(a) in place of one row x of b, for the columns [first, first + size)
+template <typename T>
+void multiply_right_row(
+	const strided_block<const T>& a, triangle uplo, bool transposed, diagonal diag,
+	T* x, unsigned first, unsigned size
+) {
+	bool unit = diag == diagonal::unit;
+	bool lower = op_is_lower(uplo, transposed);
+	for(unsigned step = 0; step < size; ++step) {
+		unsigned j = lower ? step : size - 1 - step;
+		const T* a_row = &a(first + j, first);
+		if(!transposed) {
+			unsigned from = lower ? 0 : j + 1;
+			unsigned to = lower ? j : size;
+			for(unsigned col = from; col < to; ++col) {
+				x[col] += x[j] * a_row[col];
+			}
+			if(!unit) {
+				x[j] *= a_row[j];
+			}
+		} else {
+			T sum = lower ? dot_product(x + j + 1, a_row + j + 1, size - j - 1) : dot_product(x, a_row, j);
+			x[j] = (unit ? x[j] : x[j] * a_row[j]) + sum;
+		}
+	}
+}
+
+
+// b = b * op(a) in place, by blocks of columns, the rows of b split across threads
+template <typename T>
+void multiply_right(
+	const strided_block<const T>& a, triangle uplo, bool transposed, diagonal diag,
+	const strided_block<T>& b, const parallel_options& options
+) {
+	unsigned n = b.cols;
+	bool lower = op_is_lower(uplo, transposed);
+	for(unsigned done = 0; done < n; done += triangular_block_size) {
+		unsigned size = std::min(triangular_block_size, n - done);
+		unsigned first = lower ? done : n - done - size;
+		unsigned end = first + size;
+
+		parallel_for(0, b.rows, std::size_t(size) * size / 2, [&](std::size_t first_row, std::size_t last_row) {
+			for(unsigned row = first_row; row < last_row; ++row) {
+				multiply_right_row(a, uplo, transposed, diag, &b(row, first), first, size);
+			}
+		}, options);
+
+		if(lower) {
+			gemm<T>(T(1), b.block(0, end, b.rows, n - end), false, op_block(a, transposed, end, first, n - end, size), transposed,
+			        T(1), b.block(0, first, b.rows, size), options);
+		} else {
+			gemm<T>(T(1), b.block(0, 0, b.rows, first), false, op_block(a, transposed, 0, first, first, size), transposed,
+			        T(1), b.block(0, first, b.rows, size), options);
+		}
+	}
+}
+
+
+// The TRSM of BLAS: b = alpha * inverse(op(a)) * b, or alpha * b * inverse(op(a)) on the right
+template <typename T>
+void triangular_solve(
+	side where, triangle uplo, bool transposed, diagonal diag, T alpha,
+	const strided_block<const T>& a, const strided_block<T>& b, const parallel_options& options
+) {
+	scale_block(b, alpha, options);
+	if(where == side::left) {
+		solve_left(a, uplo, transposed, diag, b, options);
+	} else {
+		solve_right(a, uplo, transposed, diag, b, options);
+	}
+}
+
+
+// The TRMM of BLAS: b = alpha * op(a) * b, or alpha * b * op(a) on the right
+template <typename T>
+void triangular_multiply(
+	side where, triangle uplo, bool transposed, diagonal diag, T alpha,
+	const strided_block<const T>& a, const strided_block<T>& b, const parallel_options& options
+) {
+	if(where == side::left) {
+		multiply_left(a, uplo, transposed, diag, b, options);
+	} else {
+		multiply_right(a, uplo, transposed, diag, b, options);
+	}
+	scale_block(b, alpha, options);
+}
+
+
+template <typename MB, typename MA>
+void throw_if_not_triangular_operands(const matrix<MB>& b, const char* operation, const matrix<MA>& a, side where) {
+	if(rows(a) != cols(a)  ||  (where == side::left ? rows(b) : cols(b)) != rows(a)) {
+		if(where == side::left) {
+			throw incompatible_operands(a, operation, b);
+		}
+		throw incompatible_operands(b, operation, a);
+	}
+}
+
+
+} /* namespace __impl */
+
+
+/*
+ * b = alpha * inverse(op(a)) * b, or b = alpha * b * inverse(op(a)) on the
+ * right, where op(a) is the given triangle of a, transposed if asked. Both
+ * may be regions of larger matrices, such as a diagonal block and the
+ * block beside it, and b is overwritten without any copy; they must not
+ * overlap. Blocks of a are applied with the parallel gemm kernel, and the
+ * substitutions run in parallel across the right-hand sides.
+ */
+template <typename MB, typename MA>
+void triangular_solve_into(
+	MB&& b, const matrix<MA>& a, side where, triangle uplo, diagonal diag = diagonal::non_unit,
+	bool transpose_a = false,
+	typename std::remove_const<typename MA::element_type>::type alpha = 1,
+	const parallel_options& options = parallel_options()
+) {
+	using T = typename std::remove_const<typename MA::element_type>::type;
+	__impl::throw_if_not_triangular_operands(b, "triangular_solve_into", a, where);
+	__impl::triangular_solve<T>(where, uplo, transpose_a, diag, alpha, __impl::strided(a), __impl::strided(b), options);
+}
+
+
+// Likewise b = alpha * op(a) * b, or b = alpha * b * op(a) on the right
+template <typename MB, typename MA>
+void triangular_multiply_into(
+	MB&& b, const matrix<MA>& a, side where, triangle uplo, diagonal diag = diagonal::non_unit,
+	bool transpose_a = false,
+	typename std::remove_const<typename MA::element_type>::type alpha = 1,
+	const parallel_options& options = parallel_options()
+) {
+	using T = typename std::remove_const<typename MA::element_type>::type;
+	__impl::throw_if_not_triangular_operands(b, "triangular_multiply_into", a, where);
+	__impl::triangular_multiply<T>(where, uplo, transpose_a, diag, alpha, __impl::strided(a), __impl::strided(b), options);
+}
+
+
+} /* namespace matrix */
+
+
+#endif /* TRIANGULAR_HPP_ */